@@ -14,6 +14,7 @@ static const auto logger = Logger::Create("StaticMeshComponent");
 
 REFLECT_STRUCT_BEGIN(StaticMeshComponent)
 REFLECT_STRUCT_MEMBER(isActive)
+REFLECT_STRUCT_MEMBER(isOccluder)
 REFLECT_STRUCT_END()
 
 static SerializedObjectSchema const STATIC_MESH_COMPONENT_SCHEMA =
@@ -22,6 +23,7 @@ static SerializedObjectSchema const STATIC_MESH_COMPONENT_SCHEMA =
                                SerializedPropertySchema("file", SerializedValueType::STRING, {}, "", true, {},
                                                         SerializedPropertyFlags({IsFilePathFlag()})),
                                SerializedPropertySchema("isActive", SerializedValueType::BOOL),
+                               SerializedPropertySchema("isOccluder", SerializedValueType::BOOL),
                            },
                            {SerializedObjectFlag::IS_COMPONENT});
 
@@ -34,8 +36,9 @@ class StaticMeshComponentDeserializer : public Deserializer
         auto file = obj.GetString("file").value();
         auto path = ctx->workingDirectory / file;
         auto isActive = obj.GetBool("isActive").value_or(true);
+        auto isOccluder = obj.GetBool("isOccluder").value_or(false);
         auto mesh = ResourceManager::GetResource<StaticMesh>(path.string());
-        auto ret = new StaticMeshComponent(file, mesh, isActive);
+        auto ret = new StaticMeshComponent(file, mesh, isActive, isOccluder);
         if (!mesh) {
             StaticMeshLoaderObj().LoadFile(path.string(), [path, ret](StaticMesh * mesh) {
                 if (!mesh) {
@@ -60,11 +63,11 @@ StaticMeshComponent::~StaticMeshComponent()
     }
 }
 
-StaticMeshComponent::StaticMeshComponent(std::string file, StaticMesh * mesh, bool isActive)
-    : file(file), mesh(mesh), isActive(isActive)
+StaticMeshComponent::StaticMeshComponent(std::string file, StaticMesh * mesh, bool isActive, bool isOccluder)
+    : file(file), mesh(mesh), isActive(isActive), isOccluder(isOccluder)
 {
     if (mesh) {
-        staticMeshInstance = RenderSystem::GetInstance()->CreateStaticMeshInstance(mesh);
+        staticMeshInstance = RenderSystem::GetInstance()->CreateStaticMeshInstance(mesh, isActive, isOccluder);
     }
 
     receiveTicks = false;
@@ -77,6 +80,7 @@ SerializedObject StaticMeshComponent::Serialize() const
         .WithString("type", this->Reflection.name)
         .WithString("file", this->file)
         .WithBool("isActive", this->isActive)
+        .WithBool("isOccluder", this->isOccluder)
         .Build();
 }
 
@@ -102,5 +106,6 @@ void StaticMeshComponent::OnEvent(HashedString name, EventArgs args)
 void StaticMeshComponent::SetMesh(StaticMesh * mesh)
 {
     this->mesh = mesh;
-    this->staticMeshInstance = RenderSystem::GetInstance()->CreateStaticMeshInstance(mesh, this->isActive);
+    this->staticMeshInstance =
+        RenderSystem::GetInstance()->CreateStaticMeshInstance(mesh, this->isActive, this->isOccluder);
 }
@@ -11,7 +11,7 @@ class StaticMesh;
 class EAPI StaticMeshComponent : public Component
 {
 public:
-    StaticMeshComponent(std::string file, StaticMesh * mesh, bool isActive = true);
+    StaticMeshComponent(std::string file, StaticMesh * mesh, bool isActive = true, bool isOccluder = false);
     ~StaticMeshComponent() override;
 
     SerializedObject Serialize() const override;
@@ -27,6 +27,8 @@ private:
     std::string file;
     StaticMesh * mesh;
     bool isActive;
+    // Whether the mesh hides other meshes behind it when occlusion culling is enabled
+    bool isOccluder;
 
     std::optional<StaticMeshInstanceId> staticMeshInstance;
 };
@@ -4,6 +4,18 @@
 
 #include <ThirdParty/imgui/imgui.h>
 
+void RenderStats::AddCounts(RenderStats const & other)
+{
+    numMeshBatches += other.numMeshBatches;
+    numTransparentMeshBatches += other.numTransparentMeshBatches;
+    numDraws += other.numDraws;
+    numInstances += other.numInstances;
+    numTriangles += other.numTriangles;
+    bytesUploaded += other.bytesUploaded;
+    numDescriptorSetBinds += other.numDescriptorSetBinds;
+    numPipelineBinds += other.numPipelineBinds;
+}
+
 void FrameContext::Destroy(FrameContext & context)
 {
     if (context.imguiDrawData) {
@@ -7,6 +7,32 @@ class ImDrawData;
 struct RenderStats {
     uint32_t numMeshBatches = 0;
     uint32_t numTransparentMeshBatches = 0;
+    // Every command of an indirect draw counts as one draw
+    uint32_t numDraws = 0;
+    uint32_t numInstances = 0;
+    // Summed over all passes, so a mesh drawn in both the prepass and the main pass counts twice
+    uint64_t numTriangles = 0;
+    // Bytes written by the CPU into buffers the GPU reads this frame
+    uint64_t bytesUploaded = 0;
+    uint32_t numDescriptorSetBinds = 0;
+    uint32_t numPipelineBinds = 0;
+
+    // CPU time spent in each stage of RenderSystem, in milliseconds
+    float startFrameMs = 0.f;
+    float createBatchesMs = 0.f;
+    float mainRenderFrameMs = 0.f;
+    float postProcessFrameMs = 0.f;
+
+    // GPU time spent in each render pass, in milliseconds. The GPU finishes a frame long after it has been recorded, so
+    // these are from the previous frame that used the same GPU frame index. Negative when the renderer does not
+    // support timestamp queries or no results are available yet.
+    float gpuPrepassMs = -1.f;
+    float gpuMainPassMs = -1.f;
+    float gpuSsaoPassMs = -1.f;
+    float gpuPostProcessPassMs = -1.f;
+
+    // Adds the counters of other to this one. The timings are left alone.
+    void AddCounts(RenderStats const & other);
 };
 
 /**
@@ -29,9 +55,8 @@ struct FrameContext {
     // should use it before renderSystem->StartFrame is called
     uint32_t currentGpuFrameIndex = 0;
 
-    // renderStats contains statistics from rendering this frame. It will be fully filled after renderSystem->EndFrame
-    // is finished. In the future the stats should be shown graphically somewhere in the editor, but for now they are
-    // only available in the debugger.
+    // renderStats contains statistics from rendering this frame. It will be fully filled after
+    // renderSystem->RenderFrame is finished, which also adds it to the RenderStatsHistory that the editor shows.
     RenderStats renderStats;
 
     // imguiDrawData contains a copy of the draw lists from Imgui for this frame. It is valid after
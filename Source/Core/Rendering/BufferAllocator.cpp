@@ -2,191 +2,273 @@
 
 #include <algorithm>
 #include <cassert>
+#include <numeric>
 
 #include <ThirdParty/optick/src/optick.h>
 
+#include "Console/Console.h"
 #include "Logging/Logger.h"
 #include "RenderingBackend/Abstract/RenderResources.h"
 #include "RenderingBackend/Abstract/ResourceCreationContext.h"
 #include "RenderingBackend/Renderer.h"
-#include "Util/Semaphore.h"
+#include "Util/Tlsf.h"
 
 auto const logger = Logger::Create("BufferAllocator");
 
 BufferAllocator * BufferAllocator::instance = nullptr;
 size_t const MIN_BUFFER_SIZE = 2 * 1024 * 1024;
+// At least MAX_BLOCKS * MIN_BUFFER_SIZE bytes can be allocated before running out of blocks
+uint32_t const MAX_BLOCKS = 4096;
+// Offsets are aligned to at least this even if the renderer has no alignment requirements of its own
+size_t const MIN_ALIGNMENT = 16;
+
+/**
+ * The free ranges of all blocks in a pool share one set of TLSF free lists, so finding a range never has to look at
+ * the blocks one by one. Ranges are only ever merged with their physical neighbours in the same block.
+ */
+struct BufferAllocator::Pool {
+    struct NodeData {
+        uint32_t block;
+    };
+
+    Pool(uint32_t bufferUsage, uint32_t memoryProperties, size_t baseAlignment)
+        : bufferUsage(bufferUsage), memoryProperties(memoryProperties), baseAlignment(baseAlignment)
+    {
+    }
+
+    /**
+     * Adds a block to the pool and returns the node covering all of it.
+     */
+    uint32_t AddBlock(uint32_t block, size_t size)
+    {
+        blockCount++;
+        blockBytes += size;
+        return ranges.AddRange(0, size, {block});
+    }
+
+    /**
+     * Returns the index of the node that was allocated, or NO_NODE if there is no free range large enough.
+     * alignment must be a multiple of baseAlignment.
+     */
+    uint32_t Allocate(size_t allocSize, size_t alignment)
+    {
+        // Every free range starts at a multiple of baseAlignment, so this is the most padding a range can need
+        auto node = ranges.FindFree(allocSize + alignment - baseAlignment);
+        if (node != Tlsf::NO_NODE) {
+            AllocateFrom(node, allocSize, alignment);
+        }
+        return node;
+    }
+
+    // Allocates the first aligned range of the free node and puts the rest of it back in the free lists
+    void AllocateFrom(uint32_t node, size_t allocSize, size_t alignment)
+    {
+        ranges.AllocateFrom(node, allocSize, alignment);
+        allocationCount++;
+        liveBytes += allocSize;
+        highWaterBytes = std::max(highWaterBytes, liveBytes);
+    }
+
+    void Free(uint32_t node)
+    {
+        allocationCount--;
+        liveBytes -= ranges.nodes[node].size;
+        ranges.Free(node);
+    }
+
+    uint32_t bufferUsage;
+    uint32_t memoryProperties;
+    size_t baseAlignment;
+
+    uint32_t blockCount = 0;
+    size_t blockBytes = 0;
+    uint32_t allocationCount = 0;
+    size_t liveBytes = 0;
+    size_t highWaterBytes = 0;
+
+    Tlsf::FreeLists<size_t, NodeData> ranges;
+};
 
 BufferAllocator * BufferAllocator::GetInstance()
 {
     return BufferAllocator::instance;
 }
 
-BufferAllocator::BufferAllocator(Renderer * renderer) : renderer(renderer)
+BufferAllocator::BufferAllocator(Renderer * renderer)
+    : blocks(std::make_unique<Block[]>(MAX_BLOCKS)), renderer(renderer)
 {
     BufferAllocator::instance = this;
+    auto const & properties = renderer->GetProperties();
+    alignment = std::max(
+        {MIN_ALIGNMENT, properties.GetUniformBufferAlignment(), properties.GetStorageBufferAlignment()});
+
+    CommandDefinition statsCommand("buffer_allocator_stats",
+                                   "buffer_allocator_stats - Logs how much buffer memory the BufferAllocator has "
+                                   "allocated for each pool and how much of it is in use.",
+                                   0,
+                                   [this](auto args) { this->LogStats(); });
+    Console::RegisterCommand(statsCommand);
 }
 
-BufferSlice BufferAllocator::AllocateBuffer(size_t size, uint32_t bufferUsage, uint32_t memoryProperties)
+BufferSlice BufferAllocator::AllocateBuffer(size_t size, uint32_t bufferUsage, uint32_t memoryProperties,
+                                            size_t offsetAlignment)
 {
     OPTICK_EVENT();
-    assert(size > 0);
-    logger.Info(
-        "Looking for buffer with size={}, bufferUsage={}, memoryProperties={}", size, bufferUsage, memoryProperties);
-    // TODO: There is currently nothing that removes FreeListNodes from the list when their size hits 0
-    // TODO: This is completely thread-unsafe...
-    for (auto & freeListNode : freeList) {
-        if (freeListNode.size >= size && buffers[freeListNode.bufferIdx].bufferUsage == bufferUsage &&
-            buffers[freeListNode.bufferIdx].memoryProperties == memoryProperties) {
-            logger.Info("Found FreeListNode with bufferIdx={}, buffer={}, offset={}, size={}",
-                        freeListNode.bufferIdx,
-                        buffers[freeListNode.bufferIdx].buffer,
-                        freeListNode.offset,
-                        freeListNode.size);
-            freeListNode.offset += size;
-            freeListNode.size -= size;
-            logger.Info("FreeListNode after allocation: offset={}, size={}", freeListNode.offset, freeListNode.size);
-            return BufferSlice(buffers[freeListNode.bufferIdx].buffer, freeListNode.offset, size);
+    assert(size > 0 && offsetAlignment > 0);
+    size_t allocSize = Tlsf::AlignUp(size, alignment);
+    size_t sliceAlignment = std::lcm(alignment, offsetAlignment);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto & pool = *pools[GetPoolIdx(bufferUsage, memoryProperties)];
+        auto node = pool.Allocate(allocSize, sliceAlignment);
+        if (node != Tlsf::NO_NODE) {
+            auto const & n = pool.ranges.nodes[node];
+            return BufferSlice(blocks[n.data.block].buffer, n.offset, size, n.data.block, node);
         }
     }
-    logger.Info("No matching FreeListNode found for allocation request with size={}, bufferUsage={}, "
-                "memoryProperties={}, will allocate a new buffer.",
-                size,
-                bufferUsage,
-                memoryProperties);
-    // If we end up here, there was no buffer large enough in the free list, so we allocate a new one
-    BufferHandle * ret;
-    Semaphore sem;
-    this->renderer->CreateResources(
-        [this, &ret, &sem, size, bufferUsage, memoryProperties](ResourceCreationContext & ctx) {
-            ResourceCreationContext::BufferCreateInfo ci;
-            ci.memoryProperties = (MemoryPropertyFlagBits)memoryProperties;
-            // We always round up to a multiplier of MIN_BUFFER_SIZE
-            size_t multiplier = (size + MIN_BUFFER_SIZE - 1) / MIN_BUFFER_SIZE;
-            ci.size = multiplier * MIN_BUFFER_SIZE;
-            ci.usage = bufferUsage;
-            auto buf = ctx.CreateBuffer(ci);
-            logger.Info("Allocated a new buffer={} with size={}", buf, ci.size);
-            BufferMetadata metadata{buf, ci.size, bufferUsage, memoryProperties};
-            this->buffers.push_back(metadata);
-            if (size != ci.size) {
-                FreeListNode freeListNode;
-                freeListNode.bufferIdx = this->buffers.size() - 1;
-                freeListNode.offset = size;
-                freeListNode.size = ci.size - size;
-                logger.Info("Inserting new FreeListNode with bufferIdx={}, buffer={}, offset={}, size={}",
-                            freeListNode.bufferIdx,
-                            buffers[freeListNode.bufferIdx].buffer,
-                            freeListNode.offset,
-                            freeListNode.size);
-                this->freeList.push_back(freeListNode);
-            }
-            ret = buf;
-            sem.Signal();
-        });
-    sem.Wait();
-    return BufferSlice(ret, 0, size);
+
+    // No free range was large enough so a new block is needed. The lock is not held while creating it since the
+    // renderer may run the function on a thread that is itself waiting for the lock.
+    // We always round up to a multiplier of MIN_BUFFER_SIZE
+    size_t blockSize = Tlsf::AlignUp(allocSize, MIN_BUFFER_SIZE);
+    // Host visible blocks are mapped once here and stay mapped for as long as the allocator exists
+    auto createBuffer = [blockSize, bufferUsage, memoryProperties](ResourceCreationContext & ctx) {
+        ResourceCreationContext::BufferCreateInfo ci;
+        ci.memoryProperties = (MemoryPropertyFlagBits)memoryProperties;
+        ci.size = blockSize;
+        ci.usage = bufferUsage;
+        auto buffer = ctx.CreateBuffer(ci);
+        uint8_t * mapped = nullptr;
+        if (memoryProperties & MemoryPropertyFlagBits::HOST_VISIBLE_BIT) {
+            mapped = ctx.MapBuffer(buffer, 0, blockSize);
+        }
+        return std::make_pair(buffer, mapped);
+    };
+    auto [buf, mapped] = this->renderer->CreateResourcesAsync(createBuffer).Get();
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (blockCount == MAX_BLOCKS) {
+        logger.Error("Failed to allocate slice with size={}, all {} blocks are in use", size, MAX_BLOCKS);
+        this->renderer->CreateResourcesAsync([buf](ResourceCreationContext & ctx) { ctx.DestroyBuffer(buf); });
+        return BufferSlice();
+    }
+    auto poolIdx = GetPoolIdx(bufferUsage, memoryProperties);
+    auto & pool = *pools[poolIdx];
+    uint32_t blockIdx = blockCount++;
+    blocks[blockIdx] = {buf, blockSize, poolIdx, memoryProperties, mapped};
+    // The allocation is taken from the new block directly since its size class may be rounded past blockSize
+    auto node = pool.AddBlock(blockIdx, blockSize);
+    pool.AllocateFrom(node, allocSize, sliceAlignment);
+    return BufferSlice(buf, 0, size, blockIdx, node);
 }
 
 void BufferAllocator::FreeBuffer(BufferSlice slice)
 {
     OPTICK_EVENT();
-    for (size_t i = 0; i < buffers.size(); ++i) {
-        if (buffers[i].buffer == slice.GetBuffer()) {
-            FreeListNode newNode;
-            newNode.bufferIdx = i;
-            newNode.offset = slice.GetOffset();
-            newNode.size = slice.GetSize();
-            freeList.push_back(newNode);
-            return;
-        }
+    std::lock_guard<std::mutex> guard(lock);
+    if (slice.block >= blockCount || blocks[slice.block].buffer != slice.GetBuffer()) {
+        logger.Warn("Failed to free buffer={}. Was it not allocated by the BufferAllocator?", slice.GetBuffer());
+        return;
     }
-    logger.Warn("Failed to free buffer={}. Was it not allocated by the BufferAllocator?", slice.GetBuffer());
+    auto & pool = *pools[blocks[slice.block].pool];
+    auto const & nodes = pool.ranges.nodes;
+    if (slice.node >= nodes.size() || nodes[slice.node].isFree || nodes[slice.node].size == 0 ||
+        nodes[slice.node].data.block != slice.block || nodes[slice.node].offset != slice.GetOffset()) {
+        logger.Warn("Failed to free slice={}. Has it already been freed?", slice);
+        return;
+    }
+    pool.Free(slice.node);
 }
 
 void * BufferAllocator::MapBuffer(BufferSlice slice)
+{
+    if (slice.block == BufferSlice::NOT_ALLOCATED) {
+        logger.Error("Attempted to map slice={} which was not allocated by the BufferAllocator", slice);
+        return nullptr;
+    }
+    auto mapped = blocks[slice.block].mapped;
+    if (mapped == nullptr) {
+        logger.Error("Attempted to map slice={} which is not host visible", slice);
+        return nullptr;
+    }
+    return mapped + slice.GetOffset();
+}
+
+void BufferAllocator::FlushBuffer(BufferSlice slice, size_t offset, size_t size)
 {
     OPTICK_EVENT();
-    logger.Info("Mapping slice={}", slice);
-    auto alreadyMapped = mappedBuffers.find(slice.GetBuffer());
-    if (alreadyMapped != mappedBuffers.end()) {
-        logger.Info("buffer={} is already mapped, will do mapping using basePtr", slice.GetBuffer());
-        void * finalPtr = ((uint8_t *)alreadyMapped->second.basePtr) + slice.GetOffset();
-        alreadyMapped->second.allMapped.push_back(finalPtr);
-        return finalPtr;
-    } else {
-        logger.Info("buffer={} is not already mapped, will do mapping using CreateResources", slice.GetBuffer());
-        size_t fullSize = 0;
-        for (auto const & b : buffers) {
-            if (b.buffer == slice.GetBuffer()) {
-                fullSize = b.allocatedSize;
+    assert(slice.block != BufferSlice::NOT_ALLOCATED && offset + size <= slice.GetSize());
+    if (blocks[slice.block].memoryProperties & MemoryPropertyFlagBits::HOST_COHERENT_BIT) {
+        return;
+    }
+    auto buffer = slice.GetBuffer();
+    auto bufferOffset = slice.GetOffset() + offset;
+    renderer->CreateResourcesAsync(
+        [buffer, bufferOffset, size](ResourceCreationContext & ctx) { ctx.FlushBuffer(buffer, bufferOffset, size); });
+}
+
+void BufferAllocator::FlushBuffer(BufferSlice slice)
+{
+    FlushBuffer(slice, 0, slice.GetSize());
+}
+
+std::vector<BufferPoolStats> BufferAllocator::GetStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<BufferPoolStats> ret;
+    for (auto const & pool : pools) {
+        BufferPoolStats s;
+        s.bufferUsage = pool->bufferUsage;
+        s.memoryProperties = pool->memoryProperties;
+        s.blockCount = pool->blockCount;
+        s.blockBytes = pool->blockBytes;
+        s.allocationCount = pool->allocationCount;
+        s.liveBytes = pool->liveBytes;
+        s.highWaterBytes = pool->highWaterBytes;
+        size_t freeBytes = 0;
+        for (auto const & node : pool->ranges.nodes) {
+            if (node.size > 0 && node.isFree) {
+                s.freeRangeCount++;
+                s.largestFreeRange = std::max(s.largestFreeRange, node.size);
+                freeBytes += node.size;
             }
         }
-        if (fullSize == 0) {
-            logger.Error("fullSize was 0 when mapping buffer={}. Was this buffer not allocated by BufferAllocator? "
-                         "Will return null.",
-                         slice.GetBuffer());
-            return nullptr;
-        }
-        uint8_t * basePtr = nullptr;
-        Semaphore sem;
-        renderer->CreateResources([&basePtr, fullSize, &sem, &slice](ResourceCreationContext & ctx) {
-            basePtr = ctx.MapBuffer(slice.GetBuffer(), 0, fullSize);
-            sem.Signal();
-        });
-        sem.Wait();
-        if (!basePtr) {
-            logger.Error("basePtr was null after mapping using CreateResources when mapping buffer={}",
-                         slice.GetBuffer());
-            return nullptr;
-        }
-        void * finalPtr = basePtr + slice.GetOffset();
-        logger.Info("Got basePtr={}, finalPtr={} when mapping slice={}", basePtr, finalPtr, slice);
-
-        mappedBuffers.insert({slice.GetBuffer(), {.basePtr = basePtr, .allMapped = {finalPtr}}});
-        return finalPtr;
+        s.fragmentation = freeBytes > 0 ? 1.f - (float)s.largestFreeRange / (float)freeBytes : 0.f;
+        ret.push_back(s);
     }
+    return ret;
 }
-void BufferAllocator::UnmapBuffer(void * ptr)
+
+void BufferAllocator::LogStats()
 {
-    OPTICK_EVENT();
-    logger.Info("Unmapping ptr={}", ptr);
-    auto mappedFrom = isMappedFrom.find(ptr);
-    if (mappedFrom == isMappedFrom.end()) {
-        logger.Warn("Attempted to unmap ptr={} but did not find which buffer it was mapped from. Perhaps it has "
-                    "already been unmapped?",
-                    ptr);
+    auto stats = GetStats();
+    if (stats.size() == 0) {
+        logger.Info("No buffers have been allocated");
         return;
     }
-    auto allMapped = mappedBuffers.find(mappedFrom->second);
-    if (allMapped == mappedBuffers.end()) {
-        isMappedFrom.erase(mappedFrom);
-        logger.Warn("Found bufferHandle={} for ptr={} when unmapping but did not find it in the mappedBuffers map",
-                    mappedFrom->second,
-                    mappedFrom->first);
-        return;
+    for (auto const & s : stats) {
+        logger.Info("bufferUsage={} memoryProperties={} blocks={} ({} KiB) allocations={} live={} KiB highWater={} KiB "
+                    "freeRanges={} largestFreeRange={} KiB fragmentation={}%",
+                    s.bufferUsage,
+                    s.memoryProperties,
+                    s.blockCount,
+                    s.blockBytes / 1024,
+                    s.allocationCount,
+                    s.liveBytes / 1024,
+                    s.highWaterBytes / 1024,
+                    s.freeRangeCount,
+                    s.largestFreeRange / 1024,
+                    (int)(s.fragmentation * 100.f));
     }
+}
 
-    BufferHandle * bufferHandle = mappedFrom->second;
-    logger.Info("Erasing ptr={} from isMappedFrom and allMapped. isMappedFromSizeBefore={}, allMappedSizeBefore={}",
-                ptr,
-                isMappedFrom.size(),
-                allMapped->second.allMapped.size());
-    isMappedFrom.erase(mappedFrom);
-    std::erase(allMapped->second.allMapped, ptr);
-    logger.Info("After erasing ptr={} from isMappedFrom and allMapped. isMappedFromSizeAfter={}, allMappedSizeAfter={}",
-                ptr,
-                isMappedFrom.size(),
-                allMapped->second.allMapped.size());
-    if (allMapped->second.allMapped.size() == 0) {
-        logger.Info("allMapped size was 0 after erasing ptr={}. Will unmap bufferHandle={} completely.",
-                    ptr,
-                    mappedFrom->second);
-        mappedBuffers.erase(allMapped);
-        Semaphore sem;
-        renderer->CreateResources([bufferHandle, &sem](ResourceCreationContext & ctx) {
-            ctx.UnmapBuffer(bufferHandle);
-            sem.Signal();
-        });
-        sem.Wait();
+uint32_t BufferAllocator::GetPoolIdx(uint32_t bufferUsage, uint32_t memoryProperties)
+{
+    for (uint32_t i = 0; i < pools.size(); ++i) {
+        if (pools[i]->bufferUsage == bufferUsage && pools[i]->memoryProperties == memoryProperties) {
+            return i;
+        }
     }
+    pools.push_back(std::make_unique<Pool>(bufferUsage, memoryProperties, alignment));
+    return (uint32_t)pools.size() - 1;
 }
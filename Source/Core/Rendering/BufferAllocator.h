@@ -1,7 +1,8 @@
 #pragma once
 
 #include <cstdint>
-#include <unordered_map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "BufferSlice.h"
@@ -9,11 +10,32 @@
 class BufferHandle;
 class Renderer;
 
-struct MappedBuffer {
-    void * basePtr;
-    std::vector<void *> allMapped;
+struct BufferPoolStats {
+    uint32_t bufferUsage = 0;
+    uint32_t memoryProperties = 0;
+    uint32_t blockCount = 0;
+    size_t blockBytes = 0;
+    uint32_t allocationCount = 0;
+    size_t liveBytes = 0;
+    // The largest liveBytes has been since the pool was created
+    size_t highWaterBytes = 0;
+    uint32_t freeRangeCount = 0;
+    size_t largestFreeRange = 0;
+    // 0 when all free space in the pool is one contiguous range, approaches 1 as it gets split into smaller ranges
+    float fragmentation = 0.f;
 };
 
+/**
+ * Hands out slices of large buffers so that small buffers don't each need a buffer and allocation of their own. There
+ * is one pool of buffers for each combination of buffer usage and memory properties, and each pool is split up with a
+ * two level segregated fit (TLSF) allocator so allocating and freeing is O(1). Freed slices are merged with their free
+ * neighbours.
+ *
+ * Blocks in host visible pools are mapped when they are created and stay mapped, so mapping a slice is free. Writes
+ * to slices without HOST_COHERENT_BIT must be made visible to the GPU with FlushBuffer.
+ *
+ * All public methods are thread safe.
+ */
 class BufferAllocator
 {
 public:
@@ -21,35 +43,53 @@ public:
 
     BufferAllocator(Renderer * renderer);
 
-    BufferSlice AllocateBuffer(size_t size, uint32_t bufferUsage, uint32_t memoryProperties);
+    /**
+     * Allocates a slice of size bytes. The slice's offset is a multiple of offsetAlignment, which does not have to be
+     * a power of two. Vertex buffers should pass the vertex size so draws can use offset / vertex size as the index of
+     * their first vertex.
+     */
+    BufferSlice AllocateBuffer(size_t size, uint32_t bufferUsage, uint32_t memoryProperties,
+                               size_t offsetAlignment = 1);
     void FreeBuffer(BufferSlice slice);
 
+    /**
+     * Returns a pointer to the start of the slice, which must have been allocated from a host visible pool. The
+     * pointer stays valid until the slice is freed and does not need to be unmapped.
+     */
     void * MapBuffer(BufferSlice slice);
-    void UnmapBuffer(void *);
+    /**
+     * Makes host writes to size bytes at offset within the slice visible to the GPU. Does nothing for slices in host
+     * coherent pools.
+     */
+    void FlushBuffer(BufferSlice slice, size_t offset, size_t size);
+    void FlushBuffer(BufferSlice slice);
+
+    std::vector<BufferPoolStats> GetStats();
+    void LogStats();
 
 private:
     static BufferAllocator * instance;
 
-    struct BufferMetadata {
-        BufferHandle * buffer;
-        size_t allocatedSize;
+    struct Pool;
 
-        uint32_t bufferUsage;
-        uint32_t memoryProperties;
-    };
-
-    struct FreeListNode {
-        size_t bufferIdx;
-        size_t offset;
+    struct Block {
+        BufferHandle * buffer;
         size_t size;
+        uint32_t pool;
+        uint32_t memoryProperties;
+        // nullptr if the pool is not host visible
+        uint8_t * mapped;
     };
 
-    std::vector<BufferMetadata> buffers;
-    // TODO: Maybe this should actually be a list...
-    std::vector<FreeListNode> freeList;
+    uint32_t GetPoolIdx(uint32_t bufferUsage, uint32_t memoryProperties);
 
-    std::unordered_map<void *, BufferHandle *> isMappedFrom;
-    std::unordered_map<BufferHandle *, MappedBuffer> mappedBuffers;
+    std::mutex lock;
+    std::vector<std::unique_ptr<Pool>> pools;
+    // Never reallocated, so MapBuffer can read the blocks of slices it is given without taking the lock
+    std::unique_ptr<Block[]> blocks;
+    uint32_t blockCount = 0;
+    // Every offset handed out is a multiple of this so slices can be bound as uniform and storage buffers
+    size_t alignment;
 
     Renderer * renderer;
 };
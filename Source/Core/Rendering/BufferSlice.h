@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <format>
 #include <sstream>
 
@@ -8,8 +9,16 @@ class BufferHandle;
 class BufferSlice
 {
 public:
-    BufferSlice() : buffer(nullptr), offset(offset), size(size) {}
-    BufferSlice(BufferHandle * buffer, size_t offset, size_t size) : buffer(buffer), offset(offset), size(size) {}
+    friend class BufferAllocator;
+
+    // Value of block and node for slices that were not returned by BufferAllocator::AllocateBuffer
+    static constexpr uint32_t NOT_ALLOCATED = UINT32_MAX;
+
+    BufferSlice() : buffer(nullptr), offset(0), size(0), block(NOT_ALLOCATED), node(NOT_ALLOCATED) {}
+    BufferSlice(BufferHandle * buffer, size_t offset, size_t size)
+        : buffer(buffer), offset(offset), size(size), block(NOT_ALLOCATED), node(NOT_ALLOCATED)
+    {
+    }
 
     operator bool() const { return buffer != nullptr; }
 
@@ -18,9 +27,19 @@ public:
     inline size_t GetSize() const { return size; }
 
 private:
+    BufferSlice(BufferHandle * buffer, size_t offset, size_t size, uint32_t block, uint32_t node)
+        : buffer(buffer), offset(offset), size(size), block(block), node(node)
+    {
+    }
+
     BufferHandle * buffer;
     size_t offset;
     size_t size;
+
+    // The BufferAllocator block the slice was allocated from and the node describing its range, so it can be freed
+    // without searching for it
+    uint32_t block;
+    uint32_t node;
 };
 
 template <typename CharT>
@@ -36,4 +55,4 @@ struct std::formatter<BufferSlice, CharT> : std::formatter<std::string, CharT> {
         ss << "}";
         return std::formatter<std::string, CharT>::format(ss.str(), ctx);
     }
-};
\ No newline at end of file
+};
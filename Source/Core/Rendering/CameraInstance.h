@@ -1,5 +1,7 @@
 #pragma once
 
+#include <ThirdParty/glm/glm/glm.hpp>
+
 class BufferHandle;
 class DescriptorSet;
 class RenderSystem;
@@ -15,10 +17,15 @@ public:
     DescriptorSet * GetDecsriptorSet() const { return descriptorSet; }
     BufferHandle * GetUniformBuffer() const { return uniformBuffer; }
     bool IsActive() const { return isActive; }
+    glm::mat4 const & GetView() const { return view; }
 
 private:
     CameraInstanceId id;
     DescriptorSet * descriptorSet;
     BufferHandle * uniformBuffer;
     bool isActive;
+
+    // Kept on the CPU for light culling
+    glm::mat4 projection;
+    glm::mat4 view;
 };
@@ -0,0 +1,206 @@
+#include "FrameRingAllocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+#include <ThirdParty/optick/src/optick.h>
+
+#include "Logging/Logger.h"
+#include "RenderingBackend/Abstract/RenderResources.h"
+#include "RenderingBackend/Abstract/ResourceCreationContext.h"
+#include "RenderingBackend/Renderer.h"
+#include "Util/Semaphore.h"
+
+static auto const logger = Logger::Create("FrameRingAllocator");
+
+FrameRingAllocator::FrameRingAllocator(Renderer * renderer, uint32_t bufferUsage, size_t initialSize)
+    : renderer(renderer), bufferUsage(bufferUsage), initialSize(initialSize)
+{
+}
+
+void FrameRingAllocator::BeginFrame(uint32_t frameIndex)
+{
+    OPTICK_EVENT();
+    std::lock_guard<std::mutex> guard(lock);
+    if (frameIndex >= frames.size()) {
+        frames.resize(frameIndex + 1);
+    }
+    currentFrameIndex = frameIndex;
+    auto & frame = frames[frameIndex];
+    frame.head = 0;
+    frame.allocatedBytes = 0;
+    if (frame.retired.size() > 0) {
+        DestroyRingBuffers(std::move(frame.retired));
+        frame.retired.clear();
+    }
+}
+
+FrameAllocation FrameRingAllocator::Allocate(size_t size, size_t alignment)
+{
+    OPTICK_EVENT();
+    assert(size > 0);
+    alignment = std::max<size_t>(alignment, 1);
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        assert(currentFrameIndex < frames.size());
+        auto & frame = frames[currentFrameIndex];
+        size_t offset = (frame.head + alignment - 1) / alignment * alignment;
+        if (frame.current.buffer != nullptr && offset + size <= frame.current.size) {
+            frame.head = offset + size;
+            frame.allocatedBytes += size;
+            return {frame.current.mapped + offset, frame.current.buffer, offset};
+        }
+
+        size_t newSize = std::max(initialSize, std::bit_ceil(size + alignment));
+        if (frame.current.buffer != nullptr) {
+            newSize = std::max(newSize, frame.current.size * 2);
+        }
+        // Creating the buffer waits for the render thread, so other threads may keep allocating from the current
+        // buffer in the meantime
+        auto frameIndex = currentFrameIndex;
+        auto replacedBuffer = frame.current.buffer;
+        guard.unlock();
+        auto ringBuffer = CreateRingBuffer(newSize);
+        guard.lock();
+
+        auto & currentFrame = frames[currentFrameIndex];
+        if (currentFrameIndex != frameIndex || currentFrame.current.buffer != replacedBuffer) {
+            // Another thread grew the buffer first, try again with its buffer
+            std::vector<RingBuffer> unused;
+            unused.push_back(std::move(ringBuffer));
+            DestroyRingBuffers(std::move(unused));
+            continue;
+        }
+        if (currentFrame.current.buffer != nullptr) {
+            logger.Info("Frame {} ran out of space in its buffer of size={}, growing to size={}",
+                        frameIndex,
+                        currentFrame.current.size,
+                        newSize);
+            currentFrame.retired.push_back(std::move(currentFrame.current));
+        }
+        currentFrame.current = std::move(ringBuffer);
+        currentFrame.head = 0;
+    }
+}
+
+size_t FrameRingAllocator::GetAllocatedBytes()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (currentFrameIndex >= frames.size()) {
+        return 0;
+    }
+    return frames[currentFrameIndex].allocatedBytes;
+}
+
+DescriptorSet * FrameRingAllocator::GetDescriptorSet(BufferHandle * buffer, DescriptorSetLayoutHandle * layout,
+                                                     size_t range)
+{
+    return GetDescriptorSet(buffer, layout, {{DescriptorType::UNIFORM_BUFFER_DYNAMIC, range}});
+}
+
+DescriptorSet * FrameRingAllocator::GetDescriptorSet(BufferHandle * buffer, DescriptorSetLayoutHandle * layout,
+                                                     std::vector<FrameRingDescriptor> const & descriptors)
+{
+    OPTICK_EVENT();
+    std::unique_lock<std::mutex> guard(lock);
+    auto frameIndex = currentFrameIndex;
+    auto ringBuffer = FindRingBuffer(frames[frameIndex], buffer);
+    if (ringBuffer == nullptr) {
+        logger.Error("GetDescriptorSet called with buffer={} which was not allocated from this frame", (void *)buffer);
+        return nullptr;
+    }
+    auto cached = FindDescriptorSet(*ringBuffer, layout, descriptors);
+    if (cached != nullptr) {
+        return cached;
+    }
+    // Creating the descriptor set waits for the render thread, which must not block the other threads' allocations
+    guard.unlock();
+
+    DescriptorSet * descriptorSet;
+    Semaphore sem;
+    renderer->CreateResources([&descriptorSet, &sem, &descriptors, buffer, layout](ResourceCreationContext & ctx) {
+        std::vector<ResourceCreationContext::DescriptorSetCreateInfo::Descriptor> createDescriptors;
+        for (uint32_t i = 0; i < descriptors.size(); ++i) {
+            ResourceCreationContext::DescriptorSetCreateInfo::BufferDescriptor bufferDescriptor = {
+                buffer, 0, descriptors[i].range};
+            createDescriptors.push_back({descriptors[i].type, i, bufferDescriptor});
+        }
+        ResourceCreationContext::DescriptorSetCreateInfo ci;
+        ci.descriptorCount = createDescriptors.size();
+        ci.descriptors = createDescriptors.data();
+        ci.layout = layout;
+        descriptorSet = ctx.CreateDescriptorSet(ci);
+        sem.Signal();
+    });
+    sem.Wait();
+
+    guard.lock();
+    // The buffer may have been retired while the lock was released, or another thread may have created the same set
+    ringBuffer = frameIndex < frames.size() ? FindRingBuffer(frames[frameIndex], buffer) : nullptr;
+    cached = ringBuffer != nullptr ? FindDescriptorSet(*ringBuffer, layout, descriptors) : nullptr;
+    if (ringBuffer == nullptr || cached != nullptr) {
+        renderer->CreateResources([descriptorSet](ResourceCreationContext & ctx) {
+            ctx.DestroyDescriptorSet(descriptorSet);
+        });
+        return cached;
+    }
+    ringBuffer->descriptorSets.push_back({layout, descriptors, descriptorSet});
+    return descriptorSet;
+}
+
+FrameRingAllocator::RingBuffer * FrameRingAllocator::FindRingBuffer(Frame & frame, BufferHandle * buffer)
+{
+    if (frame.current.buffer == buffer) {
+        return &frame.current;
+    }
+    for (auto & retired : frame.retired) {
+        if (retired.buffer == buffer) {
+            return &retired;
+        }
+    }
+    return nullptr;
+}
+
+DescriptorSet * FrameRingAllocator::FindDescriptorSet(RingBuffer const & ringBuffer, DescriptorSetLayoutHandle * layout,
+                                                      std::vector<FrameRingDescriptor> const & descriptors)
+{
+    for (auto const & cached : ringBuffer.descriptorSets) {
+        if (cached.layout == layout && cached.descriptors == descriptors) {
+            return cached.descriptorSet;
+        }
+    }
+    return nullptr;
+}
+
+FrameRingAllocator::RingBuffer FrameRingAllocator::CreateRingBuffer(size_t size)
+{
+    RingBuffer ret;
+    ret.size = size;
+    Semaphore sem;
+    renderer->CreateResources([this, &ret, &sem](ResourceCreationContext & ctx) {
+        ResourceCreationContext::BufferCreateInfo ci;
+        ci.size = ret.size;
+        ci.memoryProperties = MemoryPropertyFlagBits::HOST_VISIBLE_BIT | MemoryPropertyFlagBits::HOST_COHERENT_BIT;
+        ci.usage = bufferUsage;
+        ret.buffer = ctx.CreateBuffer(ci);
+        ret.mapped = ctx.MapBuffer(ret.buffer, 0, ret.size);
+        sem.Signal();
+    });
+    sem.Wait();
+    return ret;
+}
+
+void FrameRingAllocator::DestroyRingBuffers(std::vector<RingBuffer> && ringBuffers)
+{
+    renderer->CreateResources([ringBuffers = std::move(ringBuffers)](ResourceCreationContext & ctx) {
+        for (auto const & ringBuffer : ringBuffers) {
+            for (auto const & cached : ringBuffer.descriptorSets) {
+                ctx.DestroyDescriptorSet(cached.descriptorSet);
+            }
+            ctx.UnmapBuffer(ringBuffer.buffer);
+            ctx.DestroyBuffer(ringBuffer.buffer);
+        }
+    });
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "RenderingBackend/Abstract/RenderResources.h"
+
+class Renderer;
+struct BufferHandle;
+struct DescriptorSet;
+struct DescriptorSetLayoutHandle;
+
+struct FrameAllocation {
+    uint8_t * ptr = nullptr;
+    BufferHandle * buffer = nullptr;
+    size_t offset = 0;
+};
+
+struct FrameRingDescriptor {
+    DescriptorType type;
+    size_t range;
+
+    bool operator==(FrameRingDescriptor const &) const = default;
+};
+
+/**
+ * FrameRingAllocator hands out persistently mapped GPU memory for data that is rewritten every frame.
+ * Each frame in flight has its own buffer which allocations are bumped out of, and the buffer is rewound when the
+ * frame index comes around again, so an allocation is only valid until the frame it was made in has finished on the
+ * GPU.
+ * If a frame runs out of space a buffer twice the size is created and the old one is kept alive until the frame is
+ * reused. After the buffers have grown to fit the heaviest frame no more resources are created.
+ */
+class FrameRingAllocator
+{
+public:
+    FrameRingAllocator(Renderer * renderer, uint32_t bufferUsage, size_t initialSize);
+
+    /**
+     * Rewinds the buffer for frameIndex and makes it the target of Allocate. The GPU must be done with the previous
+     * frame that used frameIndex.
+     */
+    void BeginFrame(uint32_t frameIndex);
+
+    /**
+     * Allocates size bytes aligned to alignment from the current frame's buffer. Thread safe.
+     */
+    FrameAllocation Allocate(size_t size, size_t alignment);
+
+    /**
+     * Returns the total size of the allocations made since the last call to BeginFrame, not counting alignment padding.
+     * Thread safe.
+     */
+    size_t GetAllocatedBytes();
+
+    /**
+     * Returns a descriptor set using layout which has a single UNIFORM_BUFFER_DYNAMIC descriptor at binding 0 viewing
+     * range bytes of buffer. The allocation's offset should be passed as the dynamic offset when binding the set.
+     * buffer must come from an allocation made during the current frame. The descriptor set is destroyed together with
+     * the buffer.
+     */
+    DescriptorSet * GetDescriptorSet(BufferHandle * buffer, DescriptorSetLayoutHandle * layout, size_t range);
+
+    /**
+     * Like GetDescriptorSet above, but with one dynamic descriptor per element of descriptors. Descriptor i is at
+     * binding i and views range bytes of buffer, so every binding needs its own dynamic offset when the set is bound.
+     */
+    DescriptorSet * GetDescriptorSet(BufferHandle * buffer, DescriptorSetLayoutHandle * layout,
+                                     std::vector<FrameRingDescriptor> const & descriptors);
+
+private:
+    struct CachedDescriptorSet {
+        DescriptorSetLayoutHandle * layout;
+        std::vector<FrameRingDescriptor> descriptors;
+        DescriptorSet * descriptorSet;
+    };
+
+    struct RingBuffer {
+        BufferHandle * buffer = nullptr;
+        uint8_t * mapped = nullptr;
+        size_t size = 0;
+        std::vector<CachedDescriptorSet> descriptorSets;
+    };
+
+    struct Frame {
+        RingBuffer current;
+        size_t head = 0;
+        size_t allocatedBytes = 0;
+        // Buffers that were replaced by a larger one during the frame, they may still be used by the GPU until the
+        // frame index is reused
+        std::vector<RingBuffer> retired;
+    };
+
+    // Must be called with lock held
+    RingBuffer * FindRingBuffer(Frame & frame, BufferHandle * buffer);
+    // Must be called with lock held
+    DescriptorSet * FindDescriptorSet(RingBuffer const & ringBuffer, DescriptorSetLayoutHandle * layout,
+                                      std::vector<FrameRingDescriptor> const & descriptors);
+    // Waits for the render thread, so must be called without holding lock
+    RingBuffer CreateRingBuffer(size_t size);
+    void DestroyRingBuffers(std::vector<RingBuffer> && ringBuffers);
+
+    std::mutex lock;
+    Renderer * renderer;
+    uint32_t bufferUsage;
+    size_t initialSize;
+
+    uint32_t currentFrameIndex = 0;
+    std::vector<Frame> frames;
+};
@@ -1,15 +1,55 @@
 #include "GlslToSpirvShaderCompiler.h"
 
 #include <cassert>
+#include <cstring>
 #include <filesystem>
+#include <format>
+#include <fstream>
 #include <shaderc/shaderc.hpp>
+#include <thread>
 
 #include "Logging/Logger.h"
+#include "Util/Fnv1a.h"
 
 static const auto logger = Logger::Create("GlslToSpirvShaderCompiler");
 
+// Set by CMake to the commits of the shaderc, glslang and SPIRV-Tools submodules. Empty if they could not be found, in
+// which case cached code is not invalidated when the compiler is updated.
+#ifndef SHADER_COMPILER_VERSION
+#define SHADER_COMPILER_VERSION ""
+#endif
+
+// "VKSP"
+static constexpr uint32_t CACHE_MAGIC = 0x50534b56;
+// Must be bumped whenever the entry layout or the way keys are computed changes
+static constexpr uint32_t CACHE_VERSION = 3;
+
 const DynamicStringProperty GlslToSpirvShaderCompiler::compilationOptimizationLevel =
     Config::AddString("glsl.optimizationLevel", "zero");
+const DynamicStringProperty GlslToSpirvShaderCompiler::cacheDirectory =
+    Config::AddString("glsl.cacheDirectory", "cache/spirv");
+const DynamicBoolProperty GlslToSpirvShaderCompiler::useCache = Config::AddBool("glsl.useCache", true);
+
+// The length is hashed before the contents so that two different sequences of strings can't produce the same input
+static uint64_t HashString(std::string const & str, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    uint64_t size = str.size();
+    hash = Fnv1a(&size, sizeof(size), hash);
+    return Fnv1a(str.data(), str.size(), hash);
+}
+
+template <typename T>
+static bool ReadValue(std::ifstream & in, T & value)
+{
+    in.read((char *)&value, sizeof(T));
+    return in.good();
+}
+
+template <typename T>
+static void WriteValue(std::ofstream & out, T const & value)
+{
+    out.write((char const *)&value, sizeof(T));
+}
 
 shaderc_optimization_level GetOptimizationLevel(std::string const & str)
 {
@@ -40,7 +80,11 @@ shaderc_shader_kind GetShaderType(std::string const & fileExtension)
 class DefaultIncluder : public shaderc::CompileOptions::IncluderInterface
 {
 public:
-    explicit DefaultIncluder(std::shared_ptr<FileSlurper> fileSlurper) : fileSlurper(fileSlurper) {}
+    DefaultIncluder(std::shared_ptr<FileSlurper> fileSlurper,
+                    std::vector<GlslToSpirvShaderCompiler::CachedInclude> * includes)
+        : fileSlurper(fileSlurper), includes(includes)
+    {
+    }
 
     shaderc_include_result * GetInclude(const char * requested_source, shaderc_include_type type,
                                         const char * requesting_source, size_t include_depth) override
@@ -48,6 +92,7 @@ public:
         std::filesystem::path requestingSourcePath(requesting_source);
         auto requestedPath = requestingSourcePath.remove_filename().append(requested_source);
         auto fileContent = fileSlurper->SlurpFile(requestedPath.string());
+        includes->push_back({requestedPath.string(), HashString(fileContent)});
         auto contentCopy = new char[fileContent.size() + 1];
         strcpy(contentCopy, fileContent.c_str());
 
@@ -68,19 +113,45 @@ public:
 
 private:
     std::shared_ptr<FileSlurper> fileSlurper;
+    std::vector<GlslToSpirvShaderCompiler::CachedInclude> * includes;
 };
 
-SpirvCompilationResult GlslToSpirvShaderCompiler::CompileGlslFile(std::string const & fileName)
+SpirvCompilationResult GlslToSpirvShaderCompiler::CompileGlslFile(std::string const & fileName,
+                                                                  MacroDefinitions const & defines)
 {
     std::filesystem::path filePath(fileName);
     auto fileContent = fileSlurper->SlurpFile(fileName);
     auto shaderType = GetShaderType(filePath.extension().string());
+    auto optimizationLevel = compilationOptimizationLevel.Get();
+
+    std::optional<std::filesystem::path> entryPath;
+    if (useCache.Get()) {
+        auto key = Fnv1a(&CACHE_VERSION, sizeof(CACHE_VERSION));
+        // Code compiled by a different build of the compiler may differ even if nothing else has changed
+        key = HashString(SHADER_COMPILER_VERSION, key);
+        key = HashString(fileName, key);
+        key = HashString(fileContent, key);
+        key = HashString(optimizationLevel, key);
+        for (auto const & [name, value] : defines) {
+            key = HashString(name, key);
+            key = HashString(value, key);
+        }
+        entryPath = std::filesystem::path(cacheDirectory.Get()) / std::format("{:016x}.spv", key);
+        auto cachedCode = ReadCacheEntry(entryPath.value());
+        if (cachedCode.has_value()) {
+            return SpirvCompilationResult(cachedCode.value(), {}, true);
+        }
+    }
 
     shaderc::Compiler compiler;
     shaderc::CompileOptions options;
 
-    options.SetOptimizationLevel(GetOptimizationLevel(compilationOptimizationLevel.Get()));
-    options.SetIncluder(std::make_unique<DefaultIncluder>(fileSlurper));
+    std::vector<CachedInclude> includes;
+    options.SetOptimizationLevel(GetOptimizationLevel(optimizationLevel));
+    options.SetIncluder(std::make_unique<DefaultIncluder>(fileSlurper, &includes));
+    for (auto const & [name, value] : defines) {
+        options.AddMacroDefinition(name, value);
+    }
 
     auto result =
         compiler.CompileGlslToSpv(fileContent.data(), fileContent.size() - 1, shaderType, fileName.c_str(), options);
@@ -93,5 +164,98 @@ SpirvCompilationResult GlslToSpirvShaderCompiler::CompileGlslFile(std::string co
 
     std::vector<uint32_t> compiledCode(result.begin(), result.end());
 
+    if (entryPath.has_value()) {
+        WriteCacheEntry(entryPath.value(), includes, compiledCode);
+    }
+
     return SpirvCompilationResult(compiledCode, {}, true);
 }
+
+std::optional<std::vector<uint32_t>> GlslToSpirvShaderCompiler::ReadCacheEntry(std::filesystem::path const & entryPath)
+{
+    std::ifstream in(entryPath, std::ios::binary);
+    if (!in) {
+        return {};
+    }
+
+    uint32_t magic, version, includeCount;
+    if (!ReadValue(in, magic) || magic != CACHE_MAGIC || !ReadValue(in, version) || version != CACHE_VERSION ||
+        !ReadValue(in, includeCount)) {
+        logger.Warn("Ignoring SPIR-V cache entry {} with invalid header", entryPath);
+        return {};
+    }
+
+    for (uint32_t i = 0; i < includeCount; ++i) {
+        uint32_t fileNameLength;
+        if (!ReadValue(in, fileNameLength)) {
+            logger.Warn("Ignoring truncated SPIR-V cache entry {}", entryPath);
+            return {};
+        }
+        std::string includeFileName(fileNameLength, '\0');
+        in.read(includeFileName.data(), fileNameLength);
+        uint64_t includeHash;
+        if (!ReadValue(in, includeHash)) {
+            logger.Warn("Ignoring truncated SPIR-V cache entry {}", entryPath);
+            return {};
+        }
+        if (!std::filesystem::exists(includeFileName) ||
+            HashString(fileSlurper->SlurpFile(includeFileName)) != includeHash) {
+            logger.Info("SPIR-V cache entry {} is stale because {} has changed", entryPath, includeFileName);
+            return {};
+        }
+    }
+
+    uint32_t codeSize;
+    if (!ReadValue(in, codeSize) || codeSize == 0) {
+        logger.Warn("Ignoring truncated SPIR-V cache entry {}", entryPath);
+        return {};
+    }
+    std::vector<uint32_t> code(codeSize);
+    in.read((char *)code.data(), codeSize * sizeof(uint32_t));
+    if (!in) {
+        logger.Warn("Ignoring truncated SPIR-V cache entry {}", entryPath);
+        return {};
+    }
+    return code;
+}
+
+void GlslToSpirvShaderCompiler::WriteCacheEntry(std::filesystem::path const & entryPath,
+                                                std::vector<CachedInclude> const & includes,
+                                                std::vector<uint32_t> const & code)
+{
+    std::error_code err;
+    std::filesystem::create_directories(entryPath.parent_path(), err);
+    if (err) {
+        logger.Warn("Failed to create SPIR-V cache directory {}: {}", entryPath.parent_path(), err.message());
+        return;
+    }
+
+    // Write to a temporary file and rename it into place so that a shader compiled on another thread never reads a
+    // partially written entry
+    auto tempPath = entryPath;
+    tempPath += std::format(".{}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tempPath, std::ios::binary);
+        WriteValue(out, CACHE_MAGIC);
+        WriteValue(out, CACHE_VERSION);
+        WriteValue(out, (uint32_t)includes.size());
+        for (auto const & include : includes) {
+            WriteValue(out, (uint32_t)include.fileName.size());
+            out.write(include.fileName.data(), include.fileName.size());
+            WriteValue(out, include.hash);
+        }
+        WriteValue(out, (uint32_t)code.size());
+        out.write((char const *)code.data(), code.size() * sizeof(uint32_t));
+        if (!out) {
+            logger.Warn("Failed to write SPIR-V cache entry {}", tempPath);
+            out.close();
+            std::filesystem::remove(tempPath, err);
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, entryPath, err);
+    if (err) {
+        logger.Warn("Failed to move SPIR-V cache entry into place at {}: {}", entryPath, err.message());
+        std::filesystem::remove(tempPath, err);
+    }
+}
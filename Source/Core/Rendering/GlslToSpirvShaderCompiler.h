@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Core/Config/Config.h"
@@ -27,15 +30,35 @@ private:
     bool success;
 };
 
+/**
+ * Compiles GLSL files to SPIR-V using shaderc.
+ * Compiled code is cached on disk in glsl.cacheDirectory. An entry is keyed by a hash of the compiler's submodule
+ * commits, the file name, its source, the optimization level and the macro definitions, and also records the hash of
+ * every file that was #included while compiling. An entry is only used if all of those includes are unchanged, so
+ * editing an included file invalidates every shader that uses it without having to track dependencies anywhere else.
+ */
 class GlslToSpirvShaderCompiler
 {
 public:
+    using MacroDefinitions = std::vector<std::pair<std::string, std::string>>;
+
     explicit GlslToSpirvShaderCompiler(std::shared_ptr<FileSlurper> fileSlurper) : fileSlurper(fileSlurper) {}
 
-    SpirvCompilationResult CompileGlslFile(std::string const & fileName);
+    struct CachedInclude {
+        std::string fileName;
+        uint64_t hash;
+    };
+
+    SpirvCompilationResult CompileGlslFile(std::string const & fileName, MacroDefinitions const & defines = {});
 
 private:
+    std::optional<std::vector<uint32_t>> ReadCacheEntry(std::filesystem::path const & entryPath);
+    void WriteCacheEntry(std::filesystem::path const & entryPath, std::vector<CachedInclude> const & includes,
+                         std::vector<uint32_t> const & code);
+
     static const DynamicStringProperty compilationOptimizationLevel;
+    static const DynamicStringProperty cacheDirectory;
+    static const DynamicBoolProperty useCache;
 
     std::shared_ptr<FileSlurper> fileSlurper;
 };
@@ -24,10 +24,28 @@ private:
     glm::vec3 color;
 };
 
+// The view frustum of each camera is divided into a grid of clusters and every cluster gets a list of the lights which
+// reach into it. The tiles are evenly spaced in screen space and the slices are exponentially spaced in depth.
+// Must match Lights.glsl
+constexpr uint32_t LIGHT_CLUSTERS_X = 16;
+constexpr uint32_t LIGHT_CLUSTERS_Y = 9;
+constexpr uint32_t LIGHT_CLUSTERS_Z = 24;
+constexpr uint32_t LIGHT_CLUSTER_COUNT = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z;
+
+// A light's radius is where its attenuated intensity drops below this. Must match Lights.glsl
+constexpr float LIGHT_CUTOFF_INTENSITY = 1.f / 256.f;
+
 struct LightGpuData {
-    uint32_t isActive;
-    uint32_t _padding[3]; // For alignment to match GLSL
-    glm::mat4 localToWorld;
-    glm::vec3 color;
-    uint8_t _paddding2; // For alignment to match GLSL
+    // xyz: world position, w: radius
+    glm::vec4 positionAndRadius;
+    glm::vec4 color;
+};
+
+// The start of the per camera cluster buffer. It is followed by a glm::uvec2 (offset, count) per cluster into the
+// light index list which comes last.
+struct LightClusterGpuHeader {
+    glm::mat4 view;
+    glm::mat4 projection;
+    // x: near depth, y: far depth, z: slices per unit of log depth (or depth if w is 0), w: 1 if perspective
+    glm::vec4 depthParams;
 };
@@ -0,0 +1,344 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE2 1
+#endif
+
+#include <ThirdParty/optick/src/optick.h>
+
+#include "Jobs/JobEngine.h"
+#include "Util/Semaphore.h"
+
+// Each rasterization job covers this many rows of the depth buffer
+static constexpr uint32_t RASTERIZE_BAND_ROWS = 16;
+// Triangles are clipped against this clip space w instead of the camera's near plane so the culler does not need to
+// know which depth range the projection uses
+static constexpr float MIN_CLIP_W = 1e-3f;
+
+OcclusionCuller::OcclusionCuller()
+{
+    glm::uvec2 size(WIDTH, HEIGHT);
+    while (true) {
+        pyramidSizes.push_back(size);
+        depthPyramid.emplace_back(size.x * size.y, FLT_MAX);
+        minDepthPyramid.emplace_back(pyramidSizes.size() == 1 ? 0 : size.x * size.y, FLT_MAX);
+        if (size.x == 1 && size.y == 1) {
+            break;
+        }
+        size = glm::max(size / 2u, glm::uvec2(1));
+    }
+}
+
+void OcclusionCuller::Begin(glm::mat4 const & viewProjection)
+{
+    OPTICK_EVENT();
+    this->viewProjection = viewProjection;
+    triangles.clear();
+    std::fill(depthPyramid[0].begin(), depthPyramid[0].end(), FLT_MAX);
+}
+
+void OcclusionCuller::AddOccluder(OccluderMesh const & occluder, glm::mat4 const & localToWorld)
+{
+    OPTICK_EVENT();
+    glm::mat4 const localToClip = viewProjection * localToWorld;
+    clipVertices.resize(occluder.vertices.size());
+    for (size_t i = 0; i < occluder.vertices.size(); ++i) {
+        clipVertices[i] = localToClip * glm::vec4(occluder.vertices[i], 1.f);
+    }
+
+    for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+        glm::vec4 const in[3] = {clipVertices[occluder.indices[i]],
+                                 clipVertices[occluder.indices[i + 1]],
+                                 clipVertices[occluder.indices[i + 2]]};
+        // Triangles completely outside one of the side planes can not cover any pixels
+        bool isOutside = (in[0].x > in[0].w && in[1].x > in[1].w && in[2].x > in[2].w) ||
+                         (in[0].x < -in[0].w && in[1].x < -in[1].w && in[2].x < -in[2].w) ||
+                         (in[0].y > in[0].w && in[1].y > in[1].w && in[2].y > in[2].w) ||
+                         (in[0].y < -in[0].w && in[1].y < -in[1].w && in[2].y < -in[2].w);
+        if (isOutside) {
+            continue;
+        }
+
+        // Clipping a triangle against one plane gives at most a quad
+        glm::vec4 clipped[4];
+        size_t numClipped = 0;
+        for (size_t v = 0; v < 3; ++v) {
+            glm::vec4 const & curr = in[v];
+            glm::vec4 const & next = in[(v + 1) % 3];
+            float currDistance = curr.w - MIN_CLIP_W;
+            float nextDistance = next.w - MIN_CLIP_W;
+            if (currDistance >= 0.f) {
+                clipped[numClipped++] = curr;
+            }
+            if ((currDistance >= 0.f) != (nextDistance >= 0.f)) {
+                float t = currDistance / (currDistance - nextDistance);
+                clipped[numClipped++] = curr + (next - curr) * t;
+            }
+        }
+        for (size_t v = 1; v + 1 < numClipped; ++v) {
+            AddClippedTriangle(clipped[0], clipped[v], clipped[v + 1]);
+        }
+    }
+}
+
+void OcclusionCuller::AddClippedTriangle(glm::vec4 const & a, glm::vec4 const & b, glm::vec4 const & c)
+{
+    // Set up in double precision since vertices just in front of MIN_CLIP_W project very far outside the screen
+    double x[3], y[3], z[3];
+    glm::vec4 const * clip[3] = {&a, &b, &c};
+    for (size_t i = 0; i < 3; ++i) {
+        double invW = 1.0 / clip[i]->w;
+        x[i] = (clip[i]->x * invW * 0.5 + 0.5) * WIDTH;
+        y[i] = (0.5 - clip[i]->y * invW * 0.5) * HEIGHT;
+        z[i] = clip[i]->z * invW;
+    }
+    double area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0.0) {
+        return;
+    }
+    // Occluders are rasterized from both sides so they do not have to be closed meshes
+    if (area < 0.0) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    // Pixels are covered if their center is inside the triangle
+    double minX = std::min({x[0], x[1], x[2]});
+    double maxX = std::max({x[0], x[1], x[2]});
+    double minY = std::min({y[0], y[1], y[2]});
+    double maxY = std::max({y[0], y[1], y[2]});
+    ScreenTriangle tri;
+    tri.minX = (int)std::max(0.0, std::ceil(minX - 0.5));
+    tri.maxX = (int)std::min((double)WIDTH - 1, std::floor(maxX - 0.5));
+    tri.minY = (int)std::max(0.0, std::ceil(minY - 0.5));
+    tri.maxY = (int)std::min((double)HEIGHT - 1, std::floor(maxY - 0.5));
+    if (tri.minX > tri.maxX || tri.minY > tri.maxY) {
+        return;
+    }
+
+    double originX = tri.minX + 0.5;
+    double originY = tri.minY + 0.5;
+    double depth = 0.0;
+    double depthDx = 0.0;
+    double depthDy = 0.0;
+    for (size_t i = 0; i < 3; ++i) {
+        size_t from = (i + 1) % 3;
+        size_t to = (i + 2) % 3;
+        double edgeDx = -(y[to] - y[from]);
+        double edgeDy = x[to] - x[from];
+        double edge = edgeDx * (originX - x[from]) + edgeDy * (originY - y[from]);
+        tri.edge[i] = (float)edge;
+        tri.edgeDx[i] = (float)edgeDx;
+        tri.edgeDy[i] = (float)edgeDy;
+        // The edge functions divided by the area are the barycentric coordinates
+        depth += edge * z[i] / area;
+        depthDx += edgeDx * z[i] / area;
+        depthDy += edgeDy * z[i] / area;
+    }
+    tri.depth = (float)depth;
+    tri.depthDx = (float)depthDx;
+    tri.depthDy = (float)depthDy;
+    triangles.push_back(tri);
+}
+
+void OcclusionCuller::Rasterize(JobEngine * jobEngine)
+{
+    OPTICK_EVENT();
+    if (jobEngine == nullptr || triangles.empty()) {
+        RasterizeRows(0, HEIGHT);
+    } else {
+        // The bands do not overlap so the jobs never write to the same pixels
+        std::vector<JobId> bandJobs;
+        for (uint32_t row = 0; row < HEIGHT; row += RASTERIZE_BAND_ROWS) {
+            auto bandJob = jobEngine->CreateJob({}, [this, row]() {
+                OPTICK_EVENT("RasterizeOccluderBand");
+                RasterizeRows(row, std::min(row + RASTERIZE_BAND_ROWS, HEIGHT));
+            });
+            jobEngine->ScheduleJob(bandJob, JobPriority::HIGH);
+            bandJobs.push_back(bandJob);
+        }
+        Semaphore done;
+        auto gatherJob = jobEngine->CreateJob(bandJobs, [&done]() { done.Signal(); });
+        jobEngine->ScheduleJob(gatherJob, JobPriority::HIGH);
+        done.Wait();
+    }
+    BuildPyramid();
+}
+
+void OcclusionCuller::RasterizeRows(uint32_t beginRow, uint32_t endRow)
+{
+    float * depthBuffer = depthPyramid[0].data();
+    for (auto const & tri : triangles) {
+        int firstRow = std::max(tri.minY, (int)beginRow);
+        int lastRow = std::min(tri.maxY, (int)endRow - 1);
+        // Rows are processed 4 pixels at a time starting from a multiple of 4. WIDTH is a multiple of 4 so the last
+        // group never goes past the end of the row.
+        int firstColumn = tri.minX & ~3;
+        float startX = (float)(firstColumn - tri.minX);
+        for (int row = firstRow; row <= lastRow; ++row) {
+            float startY = (float)(row - tri.minY);
+            float edge[3];
+            for (size_t i = 0; i < 3; ++i) {
+                edge[i] = tri.edge[i] + tri.edgeDx[i] * startX + tri.edgeDy[i] * startY;
+            }
+            float depth = tri.depth + tri.depthDx * startX + tri.depthDy * startY;
+            float * rowDepth = depthBuffer + row * WIDTH;
+#if OCCLUSION_CULLER_SSE2
+            __m128 const lanes = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+            __m128 const zero = _mm_setzero_ps();
+            __m128 edge0 = _mm_add_ps(_mm_set1_ps(edge[0]), _mm_mul_ps(_mm_set1_ps(tri.edgeDx[0]), lanes));
+            __m128 edge1 = _mm_add_ps(_mm_set1_ps(edge[1]), _mm_mul_ps(_mm_set1_ps(tri.edgeDx[1]), lanes));
+            __m128 edge2 = _mm_add_ps(_mm_set1_ps(edge[2]), _mm_mul_ps(_mm_set1_ps(tri.edgeDx[2]), lanes));
+            __m128 depths = _mm_add_ps(_mm_set1_ps(depth), _mm_mul_ps(_mm_set1_ps(tri.depthDx), lanes));
+            __m128 const edge0Step = _mm_set1_ps(tri.edgeDx[0] * 4.f);
+            __m128 const edge1Step = _mm_set1_ps(tri.edgeDx[1] * 4.f);
+            __m128 const edge2Step = _mm_set1_ps(tri.edgeDx[2] * 4.f);
+            __m128 const depthStep = _mm_set1_ps(tri.depthDx * 4.f);
+            for (int x = firstColumn; x <= tri.maxX; x += 4) {
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)),
+                                           _mm_cmpge_ps(edge2, zero));
+                if (_mm_movemask_ps(inside) != 0) {
+                    __m128 previous = _mm_loadu_ps(rowDepth + x);
+                    __m128 nearest = _mm_min_ps(previous, depths);
+                    _mm_storeu_ps(rowDepth + x,
+                                  _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+                }
+                edge0 = _mm_add_ps(edge0, edge0Step);
+                edge1 = _mm_add_ps(edge1, edge1Step);
+                edge2 = _mm_add_ps(edge2, edge2Step);
+                depths = _mm_add_ps(depths, depthStep);
+            }
+#else
+            for (int x = firstColumn; x <= tri.maxX; ++x) {
+                if (edge[0] >= 0.f && edge[1] >= 0.f && edge[2] >= 0.f) {
+                    rowDepth[x] = std::min(rowDepth[x], depth);
+                }
+                edge[0] += tri.edgeDx[0];
+                edge[1] += tri.edgeDx[1];
+                edge[2] += tri.edgeDx[2];
+                depth += tri.depthDx;
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+    OPTICK_EVENT();
+    for (size_t level = 1; level < depthPyramid.size(); ++level) {
+        glm::uvec2 const size = pyramidSizes[level];
+        glm::uvec2 const prevSize = pyramidSizes[level - 1];
+        auto const & prevMax = depthPyramid[level - 1];
+        auto const & prevMin = level == 1 ? depthPyramid[0] : minDepthPyramid[level - 1];
+        auto & currMax = depthPyramid[level];
+        auto & currMin = minDepthPyramid[level];
+        for (uint32_t y = 0; y < size.y; ++y) {
+            uint32_t y0 = std::min(y * 2, prevSize.y - 1);
+            uint32_t y1 = std::min(y * 2 + 1, prevSize.y - 1);
+            for (uint32_t x = 0; x < size.x; ++x) {
+                uint32_t x0 = std::min(x * 2, prevSize.x - 1);
+                uint32_t x1 = std::min(x * 2 + 1, prevSize.x - 1);
+                currMax[y * size.x + x] = std::max({prevMax[y0 * prevSize.x + x0],
+                                                    prevMax[y0 * prevSize.x + x1],
+                                                    prevMax[y1 * prevSize.x + x0],
+                                                    prevMax[y1 * prevSize.x + x1]});
+                currMin[y * size.x + x] = std::min({prevMin[y0 * prevSize.x + x0],
+                                                    prevMin[y0 * prevSize.x + x1],
+                                                    prevMin[y1 * prevSize.x + x0],
+                                                    prevMin[y1 * prevSize.x + x1]});
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(glm::vec3 boundsMin, glm::vec3 boundsMax, glm::mat4 const & localToWorld) const
+{
+    glm::mat4 const localToClip = viewProjection * localToWorld;
+    glm::vec3 ndcMin(FLT_MAX);
+    glm::vec3 ndcMax(-FLT_MAX);
+    size_t numBehind = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x,
+                         (i & 2) ? boundsMax.y : boundsMin.y,
+                         (i & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = localToClip * glm::vec4(corner, 1.f);
+        if (clip.w < MIN_CLIP_W) {
+            numBehind++;
+            continue;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+    if (numBehind == 8) {
+        return false;
+    }
+    if (numBehind > 0) {
+        return true;
+    }
+    if (ndcMax.x < -1.f || ndcMin.x > 1.f || ndcMax.y < -1.f || ndcMin.y > 1.f || ndcMin.z > 1.f) {
+        return false;
+    }
+
+    // Every pixel the box touches is tested, not just the ones whose center it covers
+    glm::ivec4 rect((int)std::floor((ndcMin.x * 0.5f + 0.5f) * WIDTH),
+                    (int)std::floor((0.5f - ndcMax.y * 0.5f) * HEIGHT),
+                    (int)std::floor((ndcMax.x * 0.5f + 0.5f) * WIDTH),
+                    (int)std::floor((0.5f - ndcMin.y * 0.5f) * HEIGHT));
+    rect = glm::clamp(rect, glm::ivec4(0), glm::ivec4(WIDTH - 1, HEIGHT - 1, WIDTH - 1, HEIGHT - 1));
+
+    // Start at the finest level where the rect covers at most 2x2 texels
+    uint32_t level = 0;
+    while (((rect.z >> level) - (rect.x >> level)) > 1 || ((rect.w >> level) - (rect.y >> level)) > 1) {
+        level++;
+    }
+    for (int y = rect.y >> level; y <= rect.w >> level; ++y) {
+        for (int x = rect.x >> level; x <= rect.z >> level; ++x) {
+            if (IsRectVisible(level, x, y, rect, ndcMin.z)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool OcclusionCuller::IsRectVisible(uint32_t level, uint32_t x, uint32_t y, glm::ivec4 const & rect,
+                                    float depth) const
+{
+    size_t const index = y * pyramidSizes[level].x + x;
+    // Every occluder in the texel is in front of the box
+    if (depthPyramid[level][index] < depth) {
+        return false;
+    }
+    if (level == 0) {
+        return true;
+    }
+    // The box is in front of every occluder in the texel
+    if (minDepthPyramid[level][index] >= depth) {
+        return true;
+    }
+    uint32_t const childLevel = level - 1;
+    glm::uvec2 const childSize = pyramidSizes[childLevel];
+    for (uint32_t childY = y * 2; childY <= y * 2 + 1 && childY < childSize.y; ++childY) {
+        if ((int)childY < (rect.y >> childLevel) || (int)childY > (rect.w >> childLevel)) {
+            continue;
+        }
+        for (uint32_t childX = x * 2; childX <= x * 2 + 1 && childX < childSize.x; ++childX) {
+            if ((int)childX < (rect.x >> childLevel) || (int)childX > (rect.z >> childLevel)) {
+                continue;
+            }
+            if (IsRectVisible(childLevel, childX, childY, rect, depth)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
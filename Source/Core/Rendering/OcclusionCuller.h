@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <ThirdParty/glm/glm/glm.hpp>
+
+#include "Core/Resources/StaticMesh.h"
+
+class JobEngine;
+
+/**
+ * OcclusionCuller rasterizes occluder meshes into a small depth buffer on the CPU and tests bounding boxes against it.
+ * The depth buffer stores the projected depth (clip z / clip w) of the nearest occluder in each pixel. A min and max
+ * depth pyramid is built on top of it so most boxes are accepted or rejected without looking at individual pixels.
+ *
+ * Usage per view: Begin, AddOccluder for every occluder, Rasterize, then IsVisible for every box to test.
+ * Nothing in here touches the GPU.
+ */
+class OcclusionCuller
+{
+public:
+    static constexpr uint32_t WIDTH = 256;
+    static constexpr uint32_t HEIGHT = 128;
+
+    OcclusionCuller();
+
+    // Clears the depth buffer and forgets the occluders of the previous view
+    void Begin(glm::mat4 const & viewProjection);
+    // Transforms and clips the triangles of occluder, they are rasterized by the next call to Rasterize
+    void AddOccluder(OccluderMesh const & occluder, glm::mat4 const & localToWorld);
+    /**
+     * Rasterizes the added occluders and builds the depth pyramid. If jobEngine is not null the depth buffer is split
+     * into bands of rows which are rasterized by separate jobs. The calling thread blocks until it is done.
+     */
+    void Rasterize(JobEngine * jobEngine = nullptr);
+
+    /**
+     * Returns false if the box is outside the view or completely behind the occluders. Boxes crossing the camera plane
+     * are always visible.
+     */
+    bool IsVisible(glm::vec3 boundsMin, glm::vec3 boundsMax, glm::mat4 const & localToWorld) const;
+
+    // Row major, WIDTH * HEIGHT values. Pixels without occluders are FLT_MAX.
+    std::vector<float> const & GetDepthBuffer() const { return depthPyramid[0]; }
+
+private:
+    /**
+     * A triangle set up for rasterization. The edge functions and depth are planes evaluated at the center of the
+     * pixel (minX, minY) so they stay precise for triangles that extend far outside the depth buffer.
+     */
+    struct ScreenTriangle {
+        int minX, minY, maxX, maxY;
+        // Edge i is positive on the inside of the edge opposite vertex i
+        float edge[3];
+        float edgeDx[3];
+        float edgeDy[3];
+        float depth;
+        float depthDx;
+        float depthDy;
+    };
+
+    void RasterizeRows(uint32_t beginRow, uint32_t endRow);
+    void AddClippedTriangle(glm::vec4 const & a, glm::vec4 const & b, glm::vec4 const & c);
+    void BuildPyramid();
+    bool IsRectVisible(uint32_t level, uint32_t x, uint32_t y, glm::ivec4 const & rect, float depth) const;
+
+    glm::mat4 viewProjection;
+    std::vector<glm::vec4> clipVertices;
+    std::vector<ScreenTriangle> triangles;
+    // Level 0 is the full resolution depth buffer, every level after it is half the size of the one before and holds
+    // the farthest depth of the 2x2 texels it covers
+    std::vector<std::vector<float>> depthPyramid;
+    // Same as depthPyramid but with the nearest depth. Level 0 is left empty since it would equal depthPyramid[0].
+    std::vector<std::vector<float>> minDepthPyramid;
+    std::vector<glm::uvec2> pyramidSizes;
+};
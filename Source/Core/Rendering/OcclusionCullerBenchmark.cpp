@@ -0,0 +1,163 @@
+#include "OcclusionCullerBenchmark.h"
+
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include <ThirdParty/glm/glm/gtc/matrix_transform.hpp>
+#include <ThirdParty/optick/src/optick.h>
+
+#include "Core/Rendering/OcclusionCuller.h"
+#include "Logging/Logger.h"
+
+static const auto logger = Logger::Create("OcclusionCullerBenchmark");
+
+// The wall is split into this many quads along each axis so rasterizing it costs about as much as a real occluder
+static constexpr uint32_t WALL_QUADS = 64;
+static constexpr float WALL_DISTANCE = 10.f;
+static constexpr uint32_t BOX_GRID_SIZE = 64;
+static constexpr float BOX_SIZE = 0.5f;
+// Boxes whose projection is within this distance of the wall's edge are not checked since the low resolution depth
+// buffer may go either way for them
+static constexpr float EDGE_MARGIN = 0.1f;
+
+struct BenchmarkBox {
+    glm::vec3 min;
+    glm::vec3 max;
+    // nullopt if the box is too close to the edge of the wall for its visibility to be checked
+    std::optional<bool> expectedVisible;
+};
+
+static float MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A grid of quads at z = -WALL_DISTANCE covering everything left of x = 0 and more than the height of the view
+static OccluderMesh CreateWall()
+{
+    OccluderMesh wall;
+    float const minX = -4.f * WALL_DISTANCE;
+    float const minY = -2.f * WALL_DISTANCE;
+    float const quadWidth = 4.f * WALL_DISTANCE / WALL_QUADS;
+    float const quadHeight = 4.f * WALL_DISTANCE / WALL_QUADS;
+    for (uint32_t y = 0; y <= WALL_QUADS; ++y) {
+        for (uint32_t x = 0; x <= WALL_QUADS; ++x) {
+            wall.vertices.push_back(glm::vec3(minX + x * quadWidth, minY + y * quadHeight, -WALL_DISTANCE));
+        }
+    }
+    for (uint32_t y = 0; y < WALL_QUADS; ++y) {
+        for (uint32_t x = 0; x < WALL_QUADS; ++x) {
+            uint32_t i = y * (WALL_QUADS + 1) + x;
+            wall.indices.insert(wall.indices.end(),
+                                {i, i + 1, i + WALL_QUADS + 2, i, i + WALL_QUADS + 2, i + WALL_QUADS + 1});
+        }
+    }
+    return wall;
+}
+
+// Boxes spread over the whole view, half of them in front of the wall and half behind it
+static std::vector<BenchmarkBox> CreateBoxes(float tanHalfFovX, float tanHalfFovY)
+{
+    std::vector<BenchmarkBox> boxes;
+    for (uint32_t y = 0; y < BOX_GRID_SIZE; ++y) {
+        for (uint32_t x = 0; x < BOX_GRID_SIZE; ++x) {
+            bool const isBehindWall = (x + y) % 2 == 0;
+            float const distance = isBehindWall ? 2.f * WALL_DISTANCE : 0.5f * WALL_DISTANCE;
+            // Centers in normalized screen coordinates, kept away from the edges of the view
+            float const screenX = ((x + 0.5f) / BOX_GRID_SIZE * 2.f - 1.f) * 0.9f;
+            float const screenY = ((y + 0.5f) / BOX_GRID_SIZE * 2.f - 1.f) * 0.9f;
+            glm::vec3 center(screenX * tanHalfFovX * distance, screenY * tanHalfFovY * distance, -distance);
+            BenchmarkBox box;
+            box.min = center - glm::vec3(BOX_SIZE * 0.5f);
+            box.max = center + glm::vec3(BOX_SIZE * 0.5f);
+            float const nearX = tanHalfFovX * -box.max.z;
+            float const farX = tanHalfFovX * -box.min.z;
+            float const minScreenX = glm::min(box.min.x / nearX, box.min.x / farX);
+            float const maxScreenX = glm::max(box.max.x / nearX, box.max.x / farX);
+            if (!isBehindWall || minScreenX > EDGE_MARGIN) {
+                box.expectedVisible = true;
+            } else if (maxScreenX < -EDGE_MARGIN) {
+                box.expectedVisible = false;
+            }
+            boxes.push_back(box);
+        }
+    }
+    return boxes;
+}
+
+bool RunOcclusionCullerBenchmark(JobEngine * jobEngine, uint32_t iterations)
+{
+    OPTICK_EVENT();
+    float const aspect = (float)OcclusionCuller::WIDTH / OcclusionCuller::HEIGHT;
+    float const fovY = glm::radians(60.f);
+    float const tanHalfFovY = glm::tan(fovY * 0.5f);
+    float const tanHalfFovX = tanHalfFovY * aspect;
+    glm::mat4 const viewProjection = glm::perspective(fovY, aspect, 0.1f, 1000.f);
+    auto const wall = CreateWall();
+    auto const boxes = CreateBoxes(tanHalfFovX, tanHalfFovY);
+
+    OcclusionCuller culler;
+    float rasterizeMs = 0.f;
+    float rasterizeJobsMs = 0.f;
+    float testMs = 0.f;
+    uint32_t wrongCount = 0;
+    uint32_t checkedCount = 0;
+    for (uint32_t i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        culler.Begin(viewProjection);
+        culler.AddOccluder(wall, glm::mat4(1.f));
+        culler.Rasterize();
+        rasterizeMs += MillisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        culler.Begin(viewProjection);
+        culler.AddOccluder(wall, glm::mat4(1.f));
+        culler.Rasterize(jobEngine);
+        rasterizeJobsMs += MillisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        std::vector<bool> isVisible(boxes.size());
+        for (size_t b = 0; b < boxes.size(); ++b) {
+            isVisible[b] = culler.IsVisible(boxes[b].min, boxes[b].max, glm::mat4(1.f));
+        }
+        testMs += MillisecondsSince(start);
+
+        // The results are the same every iteration so they are only checked once
+        if (i > 0) {
+            continue;
+        }
+        for (size_t b = 0; b < boxes.size(); ++b) {
+            if (!boxes[b].expectedVisible.has_value()) {
+                continue;
+            }
+            checkedCount++;
+            if (isVisible[b] != boxes[b].expectedVisible.value()) {
+                wrongCount++;
+                logger.Error("Box min=({}, {}, {}) max=({}, {}, {}) was {} but should have been {}",
+                             boxes[b].min.x,
+                             boxes[b].min.y,
+                             boxes[b].min.z,
+                             boxes[b].max.x,
+                             boxes[b].max.y,
+                             boxes[b].max.z,
+                             isVisible[b] ? "visible" : "hidden",
+                             boxes[b].expectedVisible.value() ? "visible" : "hidden");
+            }
+        }
+    }
+
+    logger.Info("iterations={} occluderTriangles={} boxes={} checked={} wrong={}",
+                iterations,
+                wall.indices.size() / 3,
+                boxes.size(),
+                checkedCount,
+                wrongCount);
+    if (iterations > 0) {
+        logger.Info("Average rasterize={:.3f}ms rasterizeWithJobs={:.3f}ms testBoxes={:.3f}ms",
+                    rasterizeMs / iterations,
+                    rasterizeJobsMs / iterations,
+                    testMs / iterations);
+    }
+    return wrongCount == 0;
+}
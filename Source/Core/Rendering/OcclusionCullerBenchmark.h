@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+class JobEngine;
+
+/**
+ * Runs the OcclusionCuller on a synthetic scene whose results are known, so it can be checked and timed without a GPU.
+ * The scene is a wall covering the left half of the view and a grid of boxes, some hidden behind the wall and some
+ * not. Logs an error for every box the culler gets wrong and logs the average time of rasterizing and of testing the
+ * boxes over iterations runs. Returns true if every box had the expected visibility.
+ */
+bool RunOcclusionCullerBenchmark(JobEngine * jobEngine, uint32_t iterations);
@@ -13,6 +13,7 @@
 #include "Core/Resources/ResourceManager.h"
 #include "Core/Resources/ShaderProgram.h"
 #include "Util/Lerp.h"
+#include "Util/RadixSort.h"
 #include "Util/RandomFloat.h"
 
 static auto const logger = Logger::Create("ParticleSystem");
@@ -174,6 +175,7 @@ void ParticleSystem::PreRender(FrameContext const & context, std::vector<UpdateP
 {
     OPTICK_EVENT();
     // TODO: This is all very unsafe since PreRender may run concurrently with Tick
+    CollectReadyGpuHandles();
     for (auto const & update : updates) {
         auto emitterIt = emitters.find(update.id);
         if (emitterIt == emitters.end()) {
@@ -184,7 +186,10 @@ void ParticleSystem::PreRender(FrameContext const & context, std::vector<UpdateP
         }
         auto gpuHandlesIt = emitterGpuHandles.find(update.id);
         if (gpuHandlesIt == emitterGpuHandles.end()) {
-            logger.Warn("Did not find GPU handles for particle emitter with id={} during PreRender. Bug?", update.id);
+            if (!pendingGpuHandles.contains(update.id)) {
+                logger.Warn("Did not find GPU handles for particle emitter with id={} during PreRender. Bug?",
+                            update.id);
+            }
             continue;
         }
         auto particlesIt = particles.find(update.id);
@@ -211,7 +216,8 @@ void ParticleSystem::PreRender(FrameContext const & context, std::vector<UpdateP
     }
 }
 
-void ParticleSystem::Render(FrameContext const & context, CameraInstance const & camera, CommandBuffer * commandBuffer)
+void ParticleSystem::Render(FrameContext const & context, CameraInstance const & camera, CommandBuffer * commandBuffer,
+                            RenderStats & stats)
 {
     OPTICK_EVENT();
     if (isDebugDrawEnabled) {
@@ -235,13 +241,9 @@ void ParticleSystem::Render(FrameContext const & context, CameraInstance const &
         }
     }
 
-    commandBuffer->CmdBindVertexBuffer(quadVbo.GetBuffer(), 0, quadVbo.GetOffset(), sizeof(ParticleVertex));
-    commandBuffer->CmdBindIndexBuffer(quadEbo.GetBuffer(), quadEbo.GetOffset(), CommandBuffer::IndexType::UINT32);
-    commandBuffer->CmdBindDescriptorSets(emitterPipelineLayout, 1, {camera.GetDecsriptorSet()});
-
-    commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
-                                   localSpaceParticleRenderingProgram->GetPipeline());
-    ShaderProgram * currentProgram = localSpaceParticleRenderingProgram;
+    // The emitters are drawn back to front by the depth of their origin. The particles inside an emitter are not
+    // sorted.
+    sortedEmitters.clear();
     for (auto const & emitter : emitters) {
         if (!emitter.second.isActive) {
             continue;
@@ -249,25 +251,51 @@ void ParticleSystem::Render(FrameContext const & context, CameraInstance const &
 
         auto gpuHandlesIt = emitterGpuHandles.find(emitter.first);
         if (gpuHandlesIt == emitterGpuHandles.end()) {
-            logger.Warn("Did not find GPU handles for particle emitter with id={} during Render. Bug?", emitter.first);
+            if (!pendingGpuHandles.contains(emitter.first)) {
+                logger.Warn("Did not find GPU handles for particle emitter with id={} during Render. Bug?",
+                            emitter.first);
+            }
             continue;
         }
 
         auto & thisFrame = gpuHandlesIt->second.perFrame[context.currentGpuFrameIndex];
+        float depth = -(camera.GetView() * emitter.second.localToWorld[3]).z;
+        // Inverted so the farthest emitters come first
+        sortedEmitters.push_back({~FloatToRadixKey(depth), &emitter.second, thisFrame.descriptorSet});
+    }
+    // There are too few emitters for the sort to be worth splitting across the job threads
+    RadixSort(sortedEmitters, sortedEmittersScratch, [](SortedEmitter const & sorted) { return sorted.depthKey; });
+
+    commandBuffer->CmdBindVertexBuffer(quadVbo.GetBuffer(), 0, quadVbo.GetOffset(), sizeof(ParticleVertex));
+    commandBuffer->CmdBindIndexBuffer(quadEbo.GetBuffer(), quadEbo.GetOffset(), CommandBuffer::IndexType::UINT32);
+    commandBuffer->CmdBindDescriptorSets(emitterPipelineLayout, 1, {camera.GetDecsriptorSet()});
+    stats.numDescriptorSetBinds++;
 
-        if (emitter.second.isWorldSpace && currentProgram != worldSpaceParticleRenderingProgram) {
+    commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
+                                   localSpaceParticleRenderingProgram->GetPipeline());
+    stats.numPipelineBinds++;
+    ShaderProgram * currentProgram = localSpaceParticleRenderingProgram;
+    for (auto const & sorted : sortedEmitters) {
+        auto const & emitter = *sorted.emitter;
+        if (emitter.isWorldSpace && currentProgram != worldSpaceParticleRenderingProgram) {
             commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
                                            worldSpaceParticleRenderingProgram->GetPipeline());
             currentProgram = worldSpaceParticleRenderingProgram;
-        } else if (!emitter.second.isWorldSpace && currentProgram != localSpaceParticleRenderingProgram) {
+            stats.numPipelineBinds++;
+        } else if (!emitter.isWorldSpace && currentProgram != localSpaceParticleRenderingProgram) {
             commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
                                            localSpaceParticleRenderingProgram->GetPipeline());
             currentProgram = localSpaceParticleRenderingProgram;
+            stats.numPipelineBinds++;
         }
 
-        commandBuffer->CmdBindDescriptorSets(emitterPipelineLayout, 0, {thisFrame.descriptorSet});
+        commandBuffer->CmdBindDescriptorSets(emitterPipelineLayout, 0, {sorted.descriptorSet});
+        stats.numDescriptorSetBinds++;
 
-        commandBuffer->CmdDrawIndexed(6, emitter.second.numActiveParticles, 0, quadVbo.GetOffset(), 0);
+        commandBuffer->CmdDrawIndexed(6, emitter.numActiveParticles, 0, quadVbo.GetOffset(), 0);
+        stats.numDraws++;
+        stats.numInstances += emitter.numActiveParticles;
+        stats.numTriangles += 2 * emitter.numActiveParticles;
     }
 }
 
@@ -298,56 +326,75 @@ std::optional<ParticleEmitterId> ParticleSystem::AddEmitter(ParticleEmitter cons
     }
     particles.insert({id, eParticles});
 
+    // The buffers come from the BufferAllocator on this thread, only the descriptor sets need the renderer
     EmitterGpuHandles gpuHandles;
-    Semaphore sem;
-    renderer->CreateResources([this, &emitter, &gpuHandles, &sem](ResourceCreationContext & ctx) {
-        auto swapCount = renderer->GetSwapCount();
-        for (size_t i = 0; i < swapCount; ++i) {
-            BufferSlice emitterUbo = bufferAllocator->AllocateBuffer(sizeof(EmitterUboData),
-                                                                     BufferUsageFlags::UNIFORM_BUFFER_BIT,
-                                                                     MemoryPropertyFlagBits::HOST_COHERENT_BIT |
-                                                                         MemoryPropertyFlagBits::HOST_VISIBLE_BIT);
-            EmitterUboData * emitterUboMapped = (EmitterUboData *)bufferAllocator->MapBuffer(emitterUbo);
-
-            BufferSlice particlesSsbo = bufferAllocator->AllocateBuffer(emitter.numParticles * sizeof(ParticleSsboData),
-                                                                        BufferUsageFlags::STORAGE_BUFFER_BIT,
-                                                                        MemoryPropertyFlagBits::HOST_COHERENT_BIT |
-                                                                            MemoryPropertyFlagBits::HOST_VISIBLE_BIT);
-            ParticleSsboData * particlesSsboMapped = (ParticleSsboData *)bufferAllocator->MapBuffer(particlesSsbo);
+    auto swapCount = renderer->GetSwapCount();
+    for (size_t i = 0; i < swapCount; ++i) {
+        BufferSlice emitterUbo = bufferAllocator->AllocateBuffer(sizeof(EmitterUboData),
+                                                                 BufferUsageFlags::UNIFORM_BUFFER_BIT,
+                                                                 MemoryPropertyFlagBits::HOST_COHERENT_BIT |
+                                                                     MemoryPropertyFlagBits::HOST_VISIBLE_BIT);
+        EmitterUboData * emitterUboMapped = (EmitterUboData *)bufferAllocator->MapBuffer(emitterUbo);
+
+        BufferSlice particlesSsbo = bufferAllocator->AllocateBuffer(emitter.numParticles * sizeof(ParticleSsboData),
+                                                                    BufferUsageFlags::STORAGE_BUFFER_BIT,
+                                                                    MemoryPropertyFlagBits::HOST_COHERENT_BIT |
+                                                                        MemoryPropertyFlagBits::HOST_VISIBLE_BIT);
+        ParticleSsboData * particlesSsboMapped = (ParticleSsboData *)bufferAllocator->MapBuffer(particlesSsbo);
+
+        gpuHandles.perFrame.push_back({
+            .descriptorSet = nullptr,
+            .emitterUbo = emitterUbo,
+            .emitterUboMapped = emitterUboMapped,
+            .particlesSsbo = particlesSsbo,
+            .particlesSsboMapped = particlesSsboMapped,
+        });
+    }
 
+    auto createDescriptorSets = [gpuHandles,
+                                 image = emitter.image,
+                                 sampler = this->sampler,
+                                 layout = this->emitterLayout](ResourceCreationContext & ctx) mutable {
+        for (auto & frame : gpuHandles.perFrame) {
             ResourceCreationContext::DescriptorSetCreateInfo emitterDSCi;
             ResourceCreationContext::DescriptorSetCreateInfo::ImageDescriptor emitterImgDescs[] = {
-                {.sampler = sampler, .imageView = emitter.image}};
+                {.sampler = sampler, .imageView = image}};
             ResourceCreationContext::DescriptorSetCreateInfo::BufferDescriptor emitterBufferDescs[] = {
-                {.buffer = emitterUbo.GetBuffer(), .offset = emitterUbo.GetOffset(), .range = emitterUbo.GetSize()},
-                {.buffer = particlesSsbo.GetBuffer(),
-                 .offset = particlesSsbo.GetOffset(),
-                 .range = particlesSsbo.GetSize()}};
+                {.buffer = frame.emitterUbo.GetBuffer(),
+                 .offset = frame.emitterUbo.GetOffset(),
+                 .range = frame.emitterUbo.GetSize()},
+                {.buffer = frame.particlesSsbo.GetBuffer(),
+                 .offset = frame.particlesSsbo.GetOffset(),
+                 .range = frame.particlesSsbo.GetSize()}};
             ResourceCreationContext::DescriptorSetCreateInfo::Descriptor emitterDescs[] = {
                 {.type = DescriptorType::UNIFORM_BUFFER, .binding = 0, .descriptor = emitterBufferDescs[0]},
                 {.type = DescriptorType::STORAGE_BUFFER, .binding = 1, .descriptor = emitterBufferDescs[1]},
                 {.type = DescriptorType::COMBINED_IMAGE_SAMPLER, .binding = 2, .descriptor = emitterImgDescs[0]}};
             emitterDSCi.descriptorCount = 3;
             emitterDSCi.descriptors = emitterDescs;
-            emitterDSCi.layout = emitterLayout;
-
-            gpuHandles.perFrame.push_back({
-                .descriptorSet = ctx.CreateDescriptorSet(emitterDSCi),
-                .emitterUbo = emitterUbo,
-                .emitterUboMapped = emitterUboMapped,
-                .particlesSsbo = particlesSsbo,
-                .particlesSsboMapped = particlesSsboMapped,
-            });
-        }
+            emitterDSCi.layout = layout;
 
-        sem.Signal();
-    });
-    sem.Wait();
-    emitterGpuHandles.insert({id, gpuHandles});
+            frame.descriptorSet = ctx.CreateDescriptorSet(emitterDSCi);
+        }
+        return gpuHandles;
+    };
+    pendingGpuHandles.insert({id, renderer->CreateResourcesAsync(createDescriptorSets)});
 
     return id;
 }
 
+void ParticleSystem::CollectReadyGpuHandles()
+{
+    for (auto it = pendingGpuHandles.begin(); it != pendingGpuHandles.end();) {
+        if (it->second.IsReady()) {
+            emitterGpuHandles.insert({it->first, it->second.Get()});
+            it = pendingGpuHandles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 std::optional<ParticleEmitter const> ParticleSystem::GetEmitter(ParticleEmitterId id)
 {
     auto it = emitters.find(id);
@@ -362,23 +409,24 @@ void ParticleSystem::RemoveEmitter(ParticleEmitterId id)
     OPTICK_EVENT();
     emitters.erase(id);
     particles.erase(id);
+    auto pendingIt = pendingGpuHandles.find(id);
+    if (pendingIt != pendingGpuHandles.end()) {
+        emitterGpuHandles.insert({id, pendingIt->second.Get()});
+        pendingGpuHandles.erase(pendingIt);
+    }
     auto gpuHandlesIt = emitterGpuHandles.find(id);
     if (gpuHandlesIt == emitterGpuHandles.end()) {
         logger.Warn("Did not find GPU handles for particle emitter with id={} when trying to remove it.", id);
     } else {
-        Semaphore sem;
-        // TODO: Do this in RenderSystem::DestroyResources
-        renderer->CreateResources([&sem, this, gpuHandlesIt](ResourceCreationContext & ctx) {
-            for (auto & frame : gpuHandlesIt->second.perFrame) {
-                bufferAllocator->UnmapBuffer(frame.particlesSsboMapped);
+        // Destroyed once the frames that may still be using the emitter have finished
+        auto gpuHandles = gpuHandlesIt->second;
+        ResourceManager::DestroyResources([this, gpuHandles](ResourceCreationContext & ctx) {
+            for (auto & frame : gpuHandles.perFrame) {
                 bufferAllocator->FreeBuffer(frame.particlesSsbo);
-                bufferAllocator->UnmapBuffer(frame.emitterUboMapped);
                 bufferAllocator->FreeBuffer(frame.emitterUbo);
                 ctx.DestroyDescriptorSet(frame.descriptorSet);
             }
-            sem.Signal();
         });
-        sem.Wait();
-        emitterGpuHandles.erase(id);
+        emitterGpuHandles.erase(gpuHandlesIt);
     }
 }
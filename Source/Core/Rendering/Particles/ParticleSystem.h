@@ -9,6 +9,7 @@
 #include "Core/Rendering/BufferSlice.h"
 #include "Core/Rendering/Vertex.h"
 #include "ParticleEmitter.h"
+#include "Util/Future.h"
 
 class BufferAllocator;
 class BufferHandle;
@@ -20,6 +21,7 @@ class DescriptorSetLayoutHandle;
 class FrameContext;
 class PipelineLayoutHandle;
 class Renderer;
+struct RenderStats;
 class SamplerHandle;
 class ShaderProgram;
 
@@ -73,7 +75,7 @@ public:
     void Tick(float dt);
 
     void PreRender(FrameContext const &, std::vector<UpdateParticleEmitter> const &);
-    void Render(FrameContext const &, CameraInstance const &, CommandBuffer *);
+    void Render(FrameContext const &, CameraInstance const &, CommandBuffer *, RenderStats &);
 
     std::optional<ParticleEmitterId> AddEmitter(ParticleEmitter const &);
     std::optional<ParticleEmitter const> GetEmitter(ParticleEmitterId id);
@@ -85,10 +87,25 @@ public:
 private:
     static ParticleSystem * instance;
 
+    // Moves the GPU handles of emitters whose descriptor sets have been created into emitterGpuHandles
+    void CollectReadyGpuHandles();
+
+    // An emitter to render for the current camera
+    struct SortedEmitter {
+        uint32_t depthKey;
+        ParticleEmitter const * emitter;
+        DescriptorSet * descriptorSet;
+    };
+    // Only used inside Render, which is not called for several cameras at the same time
+    std::vector<SortedEmitter> sortedEmitters;
+    std::vector<SortedEmitter> sortedEmittersScratch;
+
     std::atomic_uint64_t currentEmitterId{0};
     std::unordered_map<ParticleEmitterId, ParticleEmitter> emitters;
     std::unordered_map<ParticleEmitterId, std::vector<Particle>> particles;
     std::unordered_map<ParticleEmitterId, EmitterGpuHandles> emitterGpuHandles;
+    // Emitters are not rendered until the renderer has created their descriptor sets
+    std::unordered_map<ParticleEmitterId, Future<EmitterGpuHandles>> pendingGpuHandles;
 
     bool isDebugDrawEnabled = false;
 
@@ -1,7 +1,10 @@
 #include "RenderPrimitiveFactory.h"
 
+#include <cstddef>
+
 #include <ThirdParty/imgui/imgui.h>
 
+#include "Core/Rendering/SpriteInstance.h"
 #include "Core/Rendering/Vertex.h"
 #include "Core/Resources/Image.h"
 #include "Core/Resources/Material.h"
@@ -23,6 +26,7 @@ void RenderPrimitiveFactory::CreatePrimitives()
 
         auto passthroughTransformPipelineLayout = CreatePassthroughTransformPipelineLayout(ctx);
         auto passthroughTransformVertexInputState = CreatePassthroughTransformVertexInputState(ctx);
+        CreateSpriteVertexInputState(ctx);
 
         CreateMeshPipelineLayout(ctx);
         CreateMeshVertexInputState(ctx);
@@ -256,10 +260,9 @@ PipelineLayoutHandle * RenderPrimitiveFactory::CreatePassthroughTransformPipelin
     auto cameraPtLayout = ctx.CreateDescriptorSetLayout({1, cameraUniformBindings});
     ResourceManager::AddResource("_Primitives/DescriptorSetLayouts/cameraPt.layout", cameraPtLayout);
 
-    ResourceCreationContext::DescriptorSetLayoutCreateInfo::Binding spriteUniformBindings[2] = {
-        {0, DescriptorType::UNIFORM_BUFFER, ShaderStageFlagBits::SHADER_STAGE_VERTEX_BIT},
-        {1, DescriptorType::COMBINED_IMAGE_SAMPLER, ShaderStageFlagBits::SHADER_STAGE_FRAGMENT_BIT}};
-    auto spritePtLayout = ctx.CreateDescriptorSetLayout({2, spriteUniformBindings});
+    ResourceCreationContext::DescriptorSetLayoutCreateInfo::Binding spriteUniformBindings[1] = {
+        {0, DescriptorType::COMBINED_IMAGE_SAMPLER, ShaderStageFlagBits::SHADER_STAGE_FRAGMENT_BIT}};
+    auto spritePtLayout = ctx.CreateDescriptorSetLayout({1, spriteUniformBindings});
     ResourceManager::AddResource("_Primitives/DescriptorSetLayouts/spritePt.layout", spritePtLayout);
 
     auto ptPipelineLayout = ctx.CreatePipelineLayout({{cameraPtLayout, spritePtLayout}});
@@ -287,11 +290,34 @@ RenderPrimitiveFactory::CreatePassthroughTransformVertexInputState(ResourceCreat
     return ptInputState;
 }
 
+void RenderPrimitiveFactory::CreateSpriteVertexInputState(ResourceCreationContext & ctx)
+{
+    // Binding 0 is the quad, binding 1 is the SpriteGpuData of each instance
+    std::vector<ResourceCreationContext::VertexInputStateCreateInfo::VertexBindingDescription> binding = {
+        {0, sizeof(VertexWithColorAndUv)}, {1, sizeof(SpriteGpuData), VertexInputRate::INSTANCE}};
+
+    std::vector<ResourceCreationContext::VertexInputStateCreateInfo::VertexAttributeDescription> attributes = {
+        {0, 0, VertexComponentType::FLOAT, 3, false, 0},
+        {0, 1, VertexComponentType::FLOAT, 3, false, 3 * sizeof(float)},
+        {0, 2, VertexComponentType::FLOAT, 2, false, 6 * sizeof(float)},
+        {1, 3, VertexComponentType::FLOAT, 4, false, offsetof(SpriteGpuData, localToWorld)},
+        {1, 4, VertexComponentType::FLOAT, 4, false, offsetof(SpriteGpuData, localToWorld) + sizeof(glm::vec4)},
+        {1, 5, VertexComponentType::FLOAT, 4, false, offsetof(SpriteGpuData, localToWorld) + 2 * sizeof(glm::vec4)},
+        {1, 6, VertexComponentType::FLOAT, 4, false, offsetof(SpriteGpuData, localToWorld) + 3 * sizeof(glm::vec4)},
+        {1, 7, VertexComponentType::FLOAT, 4, false, offsetof(SpriteGpuData, uvRect)}};
+    ResourceCreationContext::VertexInputStateCreateInfo vertexInputStateCreateInfo;
+    vertexInputStateCreateInfo.vertexAttributeDescriptions = attributes;
+    vertexInputStateCreateInfo.vertexBindingDescriptions = binding;
+    auto spriteInputState = ctx.CreateVertexInputState(vertexInputStateCreateInfo);
+    ResourceManager::AddResource("_Primitives/VertexInputStates/sprite.state", spriteInputState);
+}
+
 void RenderPrimitiveFactory::CreateMeshPipelineLayout(ResourceCreationContext & ctx)
 {
-    ResourceCreationContext::DescriptorSetLayoutCreateInfo::Binding lightsUniformBindings[1] = {
-        {0, DescriptorType::UNIFORM_BUFFER, ShaderStageFlagBits::SHADER_STAGE_FRAGMENT_BIT}};
-    auto lightsMeshLayout = ctx.CreateDescriptorSetLayout({1, lightsUniformBindings});
+    ResourceCreationContext::DescriptorSetLayoutCreateInfo::Binding lightsBindings[2] = {
+        {0, DescriptorType::STORAGE_BUFFER_DYNAMIC, ShaderStageFlagBits::SHADER_STAGE_FRAGMENT_BIT},
+        {1, DescriptorType::STORAGE_BUFFER_DYNAMIC, ShaderStageFlagBits::SHADER_STAGE_FRAGMENT_BIT}};
+    auto lightsMeshLayout = ctx.CreateDescriptorSetLayout({2, lightsBindings});
     ResourceManager::AddResource("_Primitives/DescriptorSetLayouts/lightsMesh.layout", lightsMeshLayout);
 
     ResourceCreationContext::DescriptorSetLayoutCreateInfo::Binding cameraUniformBindings[1] = {
@@ -322,13 +348,13 @@ void RenderPrimitiveFactory::CreateMeshPipelineLayout(ResourceCreationContext &
 void RenderPrimitiveFactory::CreateMeshVertexInputState(ResourceCreationContext & ctx)
 {
     std::vector<ResourceCreationContext::VertexInputStateCreateInfo::VertexBindingDescription> binding = {
-        {0, sizeof(VertexWithNormal)}};
+        {0, sizeof(PackedVertexWithNormal)}};
 
     std::vector<ResourceCreationContext::VertexInputStateCreateInfo::VertexAttributeDescription> attributes = {
-        {0, 0, VertexComponentType::FLOAT, 3, false, 0},
-        {0, 1, VertexComponentType::FLOAT, 3, false, 3 * sizeof(float)},
-        {0, 2, VertexComponentType::FLOAT, 3, false, 6 * sizeof(float)},
-        {0, 3, VertexComponentType::FLOAT, 2, false, 9 * sizeof(float)}};
+        {0, 0, VertexComponentType::FLOAT, 3, false, offsetof(PackedVertexWithNormal, pos)},
+        {0, 1, VertexComponentType::UBYTE, 4, true, offsetof(PackedVertexWithNormal, color)},
+        {0, 2, VertexComponentType::SHORT, 2, true, offsetof(PackedVertexWithNormal, normal)},
+        {0, 3, VertexComponentType::HALF_FLOAT, 2, false, offsetof(PackedVertexWithNormal, uv)}};
     ResourceCreationContext::VertexInputStateCreateInfo vertexInputStateCreateInfo;
     vertexInputStateCreateInfo.vertexAttributeDescriptions = attributes;
     vertexInputStateCreateInfo.vertexBindingDescriptions = binding;
@@ -350,7 +376,7 @@ void RenderPrimitiveFactory::CreateSkeletalMeshPipelineLayout(ResourceCreationCo
         ResourceManager::GetResource<DescriptorSetLayoutHandle>("_Primitives/DescriptorSetLayouts/materialMesh.layout");
 
     ResourceCreationContext::DescriptorSetLayoutCreateInfo::Binding boneBindings[1] = {
-        {0, DescriptorType::UNIFORM_BUFFER, ShaderStageFlagBits::SHADER_STAGE_VERTEX_BIT}};
+        {0, DescriptorType::UNIFORM_BUFFER_DYNAMIC, ShaderStageFlagBits::SHADER_STAGE_VERTEX_BIT}};
     auto boneLayout = ctx.CreateDescriptorSetLayout({1, boneBindings});
     ResourceManager::AddResource("_Primitives/DescriptorSetLayouts/boneMesh.layout", boneLayout);
 
@@ -362,20 +388,15 @@ void RenderPrimitiveFactory::CreateSkeletalMeshPipelineLayout(ResourceCreationCo
 void RenderPrimitiveFactory::CreateSkeletalMeshVertexInputState(ResourceCreationContext & ctx)
 {
     std::vector<ResourceCreationContext::VertexInputStateCreateInfo::VertexBindingDescription> binding = {
-        {0, sizeof(VertexWithSkinning)}};
+        {0, sizeof(PackedVertexWithSkinning)}};
 
     std::vector<ResourceCreationContext::VertexInputStateCreateInfo::VertexAttributeDescription> attributes = {
-        {0, 0, VertexComponentType::FLOAT, 3, false, 0},
-        {0, 1, VertexComponentType::FLOAT, 3, false, 3 * sizeof(float)},
-        {0, 2, VertexComponentType::FLOAT, 3, false, 6 * sizeof(float)},
-        {0, 3, VertexComponentType::FLOAT, 2, false, 9 * sizeof(float)},
-        {0, 4, VertexComponentType::UINT, MAX_VERTEX_WEIGHTS, false, 11 * sizeof(float)},
-        {0,
-         5,
-         VertexComponentType::FLOAT,
-         MAX_VERTEX_WEIGHTS,
-         false,
-         11 * sizeof(float) + MAX_VERTEX_WEIGHTS * sizeof(uint32_t)},
+        {0, 0, VertexComponentType::FLOAT, 3, false, offsetof(PackedVertexWithSkinning, pos)},
+        {0, 1, VertexComponentType::UBYTE, 4, true, offsetof(PackedVertexWithSkinning, color)},
+        {0, 2, VertexComponentType::SHORT, 2, true, offsetof(PackedVertexWithSkinning, normal)},
+        {0, 3, VertexComponentType::HALF_FLOAT, 2, false, offsetof(PackedVertexWithSkinning, uv)},
+        {0, 4, VertexComponentType::UBYTE, MAX_VERTEX_WEIGHTS, false, offsetof(PackedVertexWithSkinning, bones)},
+        {0, 5, VertexComponentType::USHORT, MAX_VERTEX_WEIGHTS, true, offsetof(PackedVertexWithSkinning, weights)},
     };
     ResourceCreationContext::VertexInputStateCreateInfo vertexInputStateCreateInfo;
     vertexInputStateCreateInfo.vertexAttributeDescriptions = attributes;
@@ -757,7 +778,7 @@ void RenderPrimitiveFactory::CreateQuadMesh()
     BufferSlice indexBufferSlice{indexBuffer, 0, 6 * sizeof(uint32_t)};
     BufferSlice vertexBufferSlice{vertexBuffer, 0, 4 * sizeof(VertexWithColorAndUv)};
     Submesh submesh("main", material, 6, indexBufferSlice, 4, vertexBufferSlice);
-    auto staticMesh = new StaticMesh({submesh});
+    auto staticMesh = new StaticMesh({submesh}, glm::vec3(-1.f, -1.f, 0.f), glm::vec3(1.f, 1.f, 0.f));
     ResourceManager::AddResource("/_Primitives/Meshes/Quad.obj", staticMesh);
 }
 
@@ -814,12 +835,18 @@ void RenderPrimitiveFactory::CreateBoxVbo(ResourceCreationContext & ctx)
 		-0.5f, 0.5f, -0.5f, 1.f, 1.f, 1.f, 0.f, 1.f, 0.f, 0.0f, 1.0f,
         //clang-format on
     };
-    auto boxVbo = ctx.CreateBuffer({// 11 floats per vert, 6 verts per face, 6 faces
-                                    sizeof(VertexWithNormal) * 6 * 6,
+    // 11 floats per vert, 6 verts per face, 6 faces
+    auto unpackedBoxVerts = (VertexWithNormal const *)boxVerts.data();
+    std::vector<PackedVertexWithNormal> packedBoxVerts(6 * 6);
+    for (size_t i = 0; i < packedBoxVerts.size(); ++i) {
+        packedBoxVerts[i] = PackVertex(unpackedBoxVerts[i]);
+    }
+    auto boxVbo = ctx.CreateBuffer({sizeof(PackedVertexWithNormal) * 6 * 6,
                                     BufferUsageFlags::VERTEX_BUFFER_BIT | BufferUsageFlags::TRANSFER_DST_BIT,
                                     DEVICE_LOCAL_BIT});
 
-    ctx.BufferSubData(boxVbo, (uint8_t *)&boxVerts[0], 0, boxVerts.size() * sizeof(float));
+    ctx.BufferSubData(
+        boxVbo, (uint8_t *)packedBoxVerts.data(), 0, packedBoxVerts.size() * sizeof(PackedVertexWithNormal));
 
     ResourceManager::AddResource("_Primitives/Buffers/BoxVBO.buffer", boxVbo);
 }
@@ -830,9 +857,16 @@ void RenderPrimitiveFactory::CreateBoxMesh()
     auto material = ResourceManager::GetResource<Material>("_Primitives/Materials/default.mtl");
 
     BufferSlice vertexBufferSlice{
-        vertexBuffer, 0, 6 * 6 * sizeof(VertexWithNormal)
+        vertexBuffer, 0, 6 * 6 * sizeof(PackedVertexWithNormal)
     };
     Submesh submesh("main", material, 6 * 6, vertexBufferSlice);
-    auto staticMesh = new StaticMesh({submesh});
+    // The corners of the box with two triangles per face
+    OccluderMesh occluder;
+    for (size_t i = 0; i < 8; ++i) {
+        occluder.vertices.emplace_back((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+    }
+    occluder.indices = {0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+                        2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5};
+    auto staticMesh = new StaticMesh({submesh}, glm::vec3(-0.5f), glm::vec3(0.5f), {}, std::move(occluder));
     ResourceManager::AddResource("/_Primitives/Meshes/Box.obj", staticMesh);
 }
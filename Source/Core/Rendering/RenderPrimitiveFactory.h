@@ -29,6 +29,7 @@ private:
 
     PipelineLayoutHandle * CreatePassthroughTransformPipelineLayout(ResourceCreationContext &);
     VertexInputStateHandle * CreatePassthroughTransformVertexInputState(ResourceCreationContext &);
+    void CreateSpriteVertexInputState(ResourceCreationContext &);
 
     void CreateMeshPipelineLayout(ResourceCreationContext &);
     void CreateMeshVertexInputState(ResourceCreationContext &);
@@ -0,0 +1,96 @@
+#include "RenderStatsHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+struct StatColumn {
+    char const * name;
+    double (*get)(RenderStats const &);
+};
+
+// clang-format off
+static StatColumn const STAT_COLUMNS[] = {
+    {"meshBatches", [](RenderStats const & s) -> double { return s.numMeshBatches; }},
+    {"transparentMeshBatches", [](RenderStats const & s) -> double { return s.numTransparentMeshBatches; }},
+    {"draws", [](RenderStats const & s) -> double { return s.numDraws; }},
+    {"instances", [](RenderStats const & s) -> double { return s.numInstances; }},
+    {"triangles", [](RenderStats const & s) -> double { return s.numTriangles; }},
+    {"bytesUploaded", [](RenderStats const & s) -> double { return s.bytesUploaded; }},
+    {"descriptorSetBinds", [](RenderStats const & s) -> double { return s.numDescriptorSetBinds; }},
+    {"pipelineBinds", [](RenderStats const & s) -> double { return s.numPipelineBinds; }},
+    {"cpuStartFrameMs", [](RenderStats const & s) -> double { return s.startFrameMs; }},
+    {"cpuCreateBatchesMs", [](RenderStats const & s) -> double { return s.createBatchesMs; }},
+    {"cpuMainRenderFrameMs", [](RenderStats const & s) -> double { return s.mainRenderFrameMs; }},
+    {"cpuPostProcessFrameMs", [](RenderStats const & s) -> double { return s.postProcessFrameMs; }},
+    {"gpuPrepassMs", [](RenderStats const & s) -> double { return s.gpuPrepassMs; }},
+    {"gpuMainPassMs", [](RenderStats const & s) -> double { return s.gpuMainPassMs; }},
+    {"gpuSsaoPassMs", [](RenderStats const & s) -> double { return s.gpuSsaoPassMs; }},
+    {"gpuPostProcessPassMs", [](RenderStats const & s) -> double { return s.gpuPostProcessPassMs; }},
+};
+// clang-format on
+
+// Nearest rank percentile, values must be sorted and not empty
+static double Percentile(std::vector<double> const & values, double percentile)
+{
+    auto rank = static_cast<size_t>(std::ceil(percentile / 100.0 * values.size()));
+    return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+void RenderStatsHistory::Push(RenderStats const & stats)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (frames.size() < MAX_FRAMES) {
+        frames.push_back(stats);
+    } else {
+        frames[next] = stats;
+    }
+    next = (next + 1) % MAX_FRAMES;
+}
+
+RenderStats RenderStatsHistory::GetLatest() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (frames.size() == 0) {
+        return {};
+    }
+    return frames[(next + MAX_FRAMES - 1) % MAX_FRAMES];
+}
+
+bool RenderStatsHistory::WritePercentilesCsv(std::filesystem::path const & path) const
+{
+    std::vector<RenderStats> framesCopy;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        framesCopy = frames;
+    }
+    if (framesCopy.size() == 0) {
+        return false;
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "stat,frames,min,p50,p90,p99,max\n";
+    std::vector<double> values;
+    for (auto const & column : STAT_COLUMNS) {
+        values.clear();
+        for (auto const & frame : framesCopy) {
+            double value = column.get(frame);
+            // Only the GPU timings can be negative, and only when they were not available
+            if (value >= 0.0) {
+                values.push_back(value);
+            }
+        }
+        out << column.name << ',' << values.size();
+        if (values.size() == 0) {
+            out << ",,,,,\n";
+            continue;
+        }
+        std::sort(values.begin(), values.end());
+        out << ',' << values.front() << ',' << Percentile(values, 50.0) << ',' << Percentile(values, 90.0) << ','
+            << Percentile(values, 99.0) << ',' << values.back() << '\n';
+    }
+    return static_cast<bool>(out);
+}
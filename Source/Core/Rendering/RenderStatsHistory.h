@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#include "Core/FrameContext.h"
+
+/**
+ * RenderStatsHistory keeps the RenderStats of the most recently rendered frames. Frames are added by the render job
+ * and read by the editor and console on other threads, so every method locks.
+ */
+class RenderStatsHistory
+{
+public:
+    static constexpr size_t MAX_FRAMES = 1024;
+
+    void Push(RenderStats const & stats);
+
+    // Returns the stats of the last frame that was pushed, or default values if no frame has been pushed yet
+    RenderStats GetLatest() const;
+
+    /**
+     * Writes a CSV file with one row per stat containing the minimum, 50th, 90th and 99th percentile and maximum over
+     * the stored frames. Frames where a GPU timing was not available are left out of that stat's row. Returns false if
+     * no frames have been pushed or the file could not be opened.
+     */
+    bool WritePercentilesCsv(std::filesystem::path const & path) const;
+
+private:
+    mutable std::mutex lock;
+    // Ring buffer of at most MAX_FRAMES frames, next is where the next frame is written
+    std::vector<RenderStats> frames;
+    size_t next = 0;
+};
@@ -1,10 +1,17 @@
 ﻿#include "Core/Rendering/RenderSystem.h"
 
-#include <set>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <optional>
 
 #include <ThirdParty/glm/glm/gtc/type_ptr.hpp>
 #include <ThirdParty/optick/src/optick.h>
 
+#include "Core/Config/Config.h"
 #include "Core/FrameContext.h"
 #include "Core/Rendering/Particles/ParticleSystem.h"
 #include "Core/Resources/Image.h"
@@ -16,6 +23,7 @@
 #include "DebugDrawSystem.h"
 #include "Logging/Logger.h"
 #include "RenderingBackend/Renderer.h"
+#include "Util/RadixSort.h"
 #include "Util/Semaphore.h"
 #include "Vertex.h"
 
@@ -27,6 +35,18 @@ static constexpr CommandBuffer::ClearValue DEFAULT_CLEAR_VALUES[] = {
 };
 
 static constexpr size_t MIN_INDEXES_BUFFER_SIZE = 128 * sizeof(uint32_t);
+static constexpr size_t BONE_PALETTE_SIZE = MAX_BONES_PER_MESH * sizeof(glm::mat4);
+// Batch ranges smaller than this are not worth recording in their own secondary command buffer
+static constexpr size_t MIN_BATCHES_PER_RECORDING_JOB = 64;
+// A static mesh LOD is only used while its simplification error covers at most this many pixels on screen
+static constexpr float LOD_MAX_ERROR_PIXELS = 1.f;
+
+static auto const occlusionCullingEnabled = Config::AddBool("render.occlusionCulling", false);
+
+static float MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
 RenderSystem * RenderSystem::instance = nullptr;
 
@@ -38,6 +58,7 @@ RenderSystem * RenderSystem::GetInstance()
 void RenderSystem::StartFrame(FrameContext & context, PreRenderCommands const & preRenderCommands)
 {
     OPTICK_EVENT();
+    auto startTime = std::chrono::steady_clock::now();
     auto willBePreviousFrameIndex = context.currentGpuFrameIndex;
     auto & willBePreviousFrame = frameInfo[willBePreviousFrameIndex];
     auto updateAnimationsJob = jobEngine->CreateJob({}, [this, &preRenderCommands]() {
@@ -80,6 +101,7 @@ void RenderSystem::StartFrame(FrameContext & context, PreRenderCommands const &
         InitSwapchainResources();
         nextFrame = AcquireNextFrame(context);
     }
+    context.renderStats.startFrameMs = MillisecondsSince(startTime);
 }
 
 void RenderSystem::RenderFrame(FrameContext & context)
@@ -97,12 +119,22 @@ void RenderSystem::RenderFrame(FrameContext & context)
         OPTICK_EVENT("WaitForPreRenderJobs")
         sem.Wait();
     }
+    CullStaticMeshes();
+    auto stageStart = std::chrono::steady_clock::now();
     CreateBatches(context);
+    context.renderStats.createBatchesMs = MillisecondsSince(stageStart);
+    stageStart = std::chrono::steady_clock::now();
     MainRenderFrame(context);
+    context.renderStats.mainRenderFrameMs = MillisecondsSince(stageStart);
+    stageStart = std::chrono::steady_clock::now();
     PostProcessFrame(context);
+    context.renderStats.postProcessFrameMs = MillisecondsSince(stageStart);
 
     SubmitSwap(context);
     prevFrame.preRenderJobs.clear();
+
+    context.renderStats.bytesUploaded += transientAllocator.GetAllocatedBytes();
+    statsHistory.Push(context.renderStats);
 }
 
 void RenderSystem::CreateResources(std::function<void(ResourceCreationContext &)> && fun)
@@ -174,7 +206,13 @@ uint32_t RenderSystem::AcquireNextFrame(FrameContext & context)
     context.currentGpuFrameIndex = nextFrameInfoIdx;
     auto & currFrame = frameInfo[context.currentGpuFrameIndex];
     currFrame.canStartFrame->Wait(std::numeric_limits<uint64_t>::max());
+    ReadGpuTimings(currFrame, context.renderStats);
     currFrame.commandBufferAllocator->Reset();
+    transientAllocator.BeginFrame(context.currentGpuFrameIndex);
+    for (size_t i = 0; i < currFrame.secondaryCommandBufferAllocators.size(); ++i) {
+        currFrame.secondaryCommandBufferAllocators[i]->Reset();
+        currFrame.numUsedSecondaryCommandBuffers[i] = 0;
+    }
     return context.currentGpuFrameIndex;
 }
 
@@ -206,27 +244,158 @@ void RenderSystem::MainRenderFrame(FrameContext & context)
     OPTICK_EVENT("MainRenderFrame");
 
     auto & currFrame = frameInfo[context.currentGpuFrameIndex];
-    currFrame.mainCommandBuffer->Reset();
-    currFrame.mainCommandBuffer->BeginRecording(nullptr);
+    auto res = renderer->GetResolution();
 
-    Prepass(context, currFrame.meshBatches);
+    // Each recording is recorded into its own secondary command buffer on a job thread. The secondary command buffers
+    // are executed in the order the recordings were added, so the draw order is the same as when recording inline.
+    struct SecondaryRecording {
+        RenderPassHandle * renderPass;
+        FramebufferHandle * framebuffer;
+        std::function<void(CommandBuffer *, RenderStats &)> record;
+        // Indexes of recordings that must finish before this one starts
+        std::vector<size_t> dependsOn;
+        CommandBuffer * commandBuffer = nullptr;
+        RenderStats stats;
+    };
+    std::vector<SecondaryRecording> recordings;
+
+    size_t const numRecordingThreads = jobEngine->GetNumThreads() + 1;
+    // Every camera has its own copy of the batches with the static mesh LODs picked for it. The ranges of the
+    // transparent batches are recorded in order, so the back to front order is kept across command buffers.
+    auto forEachBatchRange = [&](std::span<MeshBatch const> allBatches, auto const & fn) {
+        size_t const batchesPerRange = std::max(MIN_BATCHES_PER_RECORDING_JOB,
+                                                (allBatches.size() + numRecordingThreads - 1) / numRecordingThreads);
+        for (size_t begin = 0; begin < allBatches.size(); begin += batchesPerRange) {
+            fn(allBatches.subspan(begin, std::min(batchesPerRange, allBatches.size() - begin)));
+        }
+    };
 
-    auto res = renderer->GetResolution();
-    CommandBuffer::RenderPassBeginInfo beginInfo = {
-        mainRenderpass, currFrame.framebuffer, {{0, 0}, {res.x, res.y}}, 2, DEFAULT_CLEAR_VALUES};
-    currFrame.mainCommandBuffer->CmdBeginRenderPass(&beginInfo, CommandBuffer::SubpassContents::INLINE);
+    if (currFrame.meshUniformsDescriptorSet) {
+        for (auto const & camera : cameras) {
+            if (!camera.isActive) {
+                continue;
+            }
+            forEachBatchRange(currFrame.cameraMeshBatches[camera.id], [&](std::span<MeshBatch const> batches) {
+                recordings.push_back(
+                    {prepass,
+                     currFrame.prepassFramebuffer,
+                     [this, &context, &camera, batches](CommandBuffer * commandBuffer, RenderStats & stats) {
+                         Prepass(context, camera, batches, commandBuffer, stats);
+                     }});
+            });
+        }
+    }
+
+    std::optional<size_t> previousParticleRecording;
     for (auto const & camera : cameras) {
         if (!camera.isActive) {
             continue;
         }
-        RenderMeshes(context, camera, currFrame.meshBatches);
-        RenderSprites(context, camera);
+        forEachBatchRange(currFrame.cameraMeshBatches[camera.id], [&](std::span<MeshBatch const> batches) {
+            recordings.push_back(
+                {mainRenderpass,
+                 currFrame.framebuffer,
+                 [this, &context, &camera, batches](CommandBuffer * commandBuffer, RenderStats & stats) {
+                     RenderMeshes(context, camera, batches, commandBuffer, stats);
+                 }});
+        });
+        recordings.push_back({mainRenderpass,
+                              currFrame.framebuffer,
+                              [this, &context, &camera](CommandBuffer * commandBuffer, RenderStats & stats) {
+                                  RenderSprites(context, camera, commandBuffer, stats);
+                              }});
+        forEachBatchRange(currFrame.cameraTransparentBatches[camera.id], [&](std::span<MeshBatch const> batches) {
+            recordings.push_back(
+                {mainRenderpass,
+                 currFrame.framebuffer,
+                 [this, &context, &camera, batches](CommandBuffer * commandBuffer, RenderStats & stats) {
+                     RenderTransparentMeshes(context, camera, batches, commandBuffer, stats);
+                 }});
+        });
+        // The particle system's debug drawing is not thread safe, so the cameras' particles are recorded one at a time
+        SecondaryRecording particleRecording = {
+            mainRenderpass,
+            currFrame.framebuffer,
+            [this, &context, &camera](CommandBuffer * commandBuffer, RenderStats & stats) {
+                particleSystem->Render(context, camera, commandBuffer, stats);
+            }};
+        if (previousParticleRecording.has_value()) {
+            particleRecording.dependsOn.push_back(previousParticleRecording.value());
+        }
+        previousParticleRecording = recordings.size();
+        recordings.push_back(std::move(particleRecording));
+    }
+
+    if (recordings.size() > 0) {
+        std::vector<JobId> recordingJobs(recordings.size());
+        for (size_t i = 0; i < recordings.size(); ++i) {
+            std::vector<JobId> dependsOn;
+            for (auto dependency : recordings[i].dependsOn) {
+                dependsOn.push_back(recordingJobs[dependency]);
+            }
+            recordingJobs[i] = jobEngine->CreateJob(dependsOn, [this, &currFrame, &recording = recordings[i]]() {
+                OPTICK_EVENT("RecordSecondaryCommandBuffer");
+                recording.commandBuffer =
+                    BeginSecondaryCommandBuffer(currFrame, recording.renderPass, recording.framebuffer);
+                recording.record(recording.commandBuffer, recording.stats);
+                recording.commandBuffer->EndRecording();
+            });
+            jobEngine->ScheduleJob(recordingJobs[i], JobPriority::HIGH);
+        }
+        Semaphore recordingsDone;
+        auto gatherJob = jobEngine->CreateJob(recordingJobs, [&recordingsDone]() { recordingsDone.Signal(); });
+        jobEngine->ScheduleJob(gatherJob, JobPriority::HIGH);
+        recordingsDone.Wait();
+    }
 
-        RenderTransparentMeshes(context, camera, currFrame.meshBatches);
-        particleSystem->Render(context, camera, currFrame.mainCommandBuffer);
+    std::vector<CommandBuffer *> prepassCommandBuffers;
+    std::vector<CommandBuffer *> mainCommandBuffers;
+    for (auto const & recording : recordings) {
+        if (recording.renderPass == prepass) {
+            prepassCommandBuffers.push_back(recording.commandBuffer);
+        } else {
+            mainCommandBuffers.push_back(recording.commandBuffer);
+        }
+        context.renderStats.AddCounts(recording.stats);
     }
 
-    currFrame.mainCommandBuffer->CmdEndRenderPass();
+    currFrame.mainCommandBuffer->Reset();
+    currFrame.mainCommandBuffer->BeginRecording(nullptr);
+    if (currFrame.timestampQueries != nullptr) {
+        currFrame.mainCommandBuffer->CmdResetQueryPool(currFrame.timestampQueries, 0, NUM_GPU_TIMESTAMPS);
+    }
+    WriteTimestamp(currFrame, currFrame.mainCommandBuffer, TIMESTAMP_FRAME_START);
+
+    auto executeInRenderPass = [&](CommandBuffer::RenderPassBeginInfo * beginInfo,
+                                   std::vector<CommandBuffer *> && commandBuffers) {
+        if (commandBuffers.size() == 0) {
+            // The render pass is still begun and ended so that the attachments are cleared and transitioned
+            currFrame.mainCommandBuffer->CmdBeginRenderPass(beginInfo, CommandBuffer::SubpassContents::INLINE);
+        } else {
+            currFrame.mainCommandBuffer->CmdBeginRenderPass(
+                beginInfo, CommandBuffer::SubpassContents::SECONDARY_COMMAND_BUFFERS);
+            currFrame.mainCommandBuffer->CmdExecuteCommands(std::move(commandBuffers));
+        }
+        currFrame.mainCommandBuffer->CmdEndRenderPass();
+    };
+
+    CommandBuffer::ClearValue depthClear;
+    depthClear.type = CommandBuffer::ClearValue::Type::DEPTH_STENCIL;
+    depthClear.depthStencil.depth = 1.f;
+    depthClear.depthStencil.stencil = 0;
+    CommandBuffer::RenderPassBeginInfo prepassBeginInfo = {
+        prepass, currFrame.prepassFramebuffer, {{0, 0}, {res.x, res.y}}, 1, &depthClear};
+    // TODO: If there are no meshes in the scene, the prepass is only begun and ended to transition the prepass depth
+    // image into the right layout. This is slightly wasteful but I currently think it's more work than it's worth to
+    // create alternate framebuffers and render passes for sprite-only scenes
+    executeInRenderPass(&prepassBeginInfo, std::move(prepassCommandBuffers));
+    WriteTimestamp(currFrame, currFrame.mainCommandBuffer, TIMESTAMP_PREPASS_END);
+
+    CommandBuffer::RenderPassBeginInfo beginInfo = {
+        mainRenderpass, currFrame.framebuffer, {{0, 0}, {res.x, res.y}}, 2, DEFAULT_CLEAR_VALUES};
+    executeInRenderPass(&beginInfo, std::move(mainCommandBuffers));
+    WriteTimestamp(currFrame, currFrame.mainCommandBuffer, TIMESTAMP_MAIN_PASS_END);
+
     currFrame.mainCommandBuffer->EndRecording();
     renderer->ExecuteCommandBuffer(
         currFrame.mainCommandBuffer,
@@ -245,8 +414,18 @@ void RenderSystem::PostProcessFrame(FrameContext & context)
     CommandBuffer::Viewport viewport = {0.f, 0.f, static_cast<float>(res.x), static_cast<float>(res.y), 0.f, 1.f};
     CommandBuffer::Rect2D scissor = {{0, 0}, {res.x, res.y}};
 
+    // Every fullscreen pass binds a pipeline and one descriptor set and draws a quad
+    auto countFullscreenPass = [&stats = context.renderStats]() {
+        stats.numPipelineBinds++;
+        stats.numDescriptorSetBinds++;
+        stats.numDraws++;
+        stats.numInstances++;
+        stats.numTriangles += 2;
+    };
+
     currFrame.postProcessCommandBuffer->Reset();
     currFrame.postProcessCommandBuffer->BeginRecording(nullptr);
+    WriteTimestamp(currFrame, currFrame.postProcessCommandBuffer, TIMESTAMP_POSTPROCESS_START);
 
     {
         CommandBuffer::RenderPassBeginInfo ssaoBeginInfo = {
@@ -262,7 +441,9 @@ void RenderSystem::PostProcessFrame(FrameContext & context)
         currFrame.postProcessCommandBuffer->CmdBindVertexBuffer(quadVbo, 0, 0, sizeof(VertexWithColorAndUv));
         currFrame.postProcessCommandBuffer->CmdDrawIndexed(6, 1, 0, 0, 0);
         currFrame.postProcessCommandBuffer->CmdEndRenderPass();
+        countFullscreenPass();
     }
+    WriteTimestamp(currFrame, currFrame.postProcessCommandBuffer, TIMESTAMP_SSAO_END);
 
     CommandBuffer::RenderPassBeginInfo beginInfo = {
         postprocessRenderpass, currFrame.postprocessFramebuffer, {{0, 0}, {res.x, res.y}}, 0, nullptr};
@@ -278,6 +459,7 @@ void RenderSystem::PostProcessFrame(FrameContext & context)
         ambientOcclusionBlurLayout, 0, {currFrame.ssaoBlurDescriptorSet});
     currFrame.postProcessCommandBuffer->CmdBindVertexBuffer(quadVbo, 0, 0, sizeof(VertexWithColorAndUv));
     currFrame.postProcessCommandBuffer->CmdDrawIndexed(6, 1, 0, 0, 0);
+    countFullscreenPass();
 
     currFrame.postProcessCommandBuffer->CmdNextSubpass(CommandBuffer::SubpassContents::INLINE);
 
@@ -289,6 +471,7 @@ void RenderSystem::PostProcessFrame(FrameContext & context)
     currFrame.postProcessCommandBuffer->CmdBindDescriptorSets(tonemapLayout, 0, {currFrame.tonemapDescriptorSet});
     currFrame.postProcessCommandBuffer->CmdBindVertexBuffer(quadVbo, 0, 0, sizeof(VertexWithColorAndUv));
     currFrame.postProcessCommandBuffer->CmdDrawIndexed(6, 1, 0, 0, 0);
+    countFullscreenPass();
 
     if (backbufferOverride != nullptr) {
         CommandBuffer::Viewport viewport = {0.f, 0.f, static_cast<float>(res.x), static_cast<float>(res.y), 0.f, 1.f};
@@ -305,6 +488,7 @@ void RenderSystem::PostProcessFrame(FrameContext & context)
 
         currFrame.postProcessCommandBuffer->CmdBindDescriptorSets(postprocessLayout, 0, {backbufferOverride});
         currFrame.postProcessCommandBuffer->CmdDrawIndexed(6, 1, 0, 0, 0);
+        countFullscreenPass();
     }
 
     for (auto const & camera : cameras) {
@@ -318,11 +502,13 @@ void RenderSystem::PostProcessFrame(FrameContext & context)
     uiRenderSystem.RenderUi(context, currFrame.postProcessCommandBuffer);
 
     currFrame.postProcessCommandBuffer->CmdEndRenderPass();
+    WriteTimestamp(currFrame, currFrame.postProcessCommandBuffer, TIMESTAMP_POSTPROCESS_END);
     currFrame.postProcessCommandBuffer->EndRecording();
     renderer->ExecuteCommandBuffer(currFrame.postProcessCommandBuffer,
                                    {currFrame.mainRenderPassFinished},
                                    {currFrame.postprocessFinished},
                                    currFrame.canStartFrame);
+    currFrame.hasWrittenTimestamps = currFrame.timestampQueries != nullptr;
 }
 
 void RenderSystem::SubmitSwap(FrameContext & context)
@@ -332,93 +518,52 @@ void RenderSystem::SubmitSwap(FrameContext & context)
     renderer->SwapWindow(context.currentGpuFrameIndex, currFrame.postprocessFinished);
 }
 
-void RenderSystem::Prepass(FrameContext & context, std::vector<MeshBatch> const & batches)
+void RenderSystem::Prepass(FrameContext & context, CameraInstance const & cam, std::span<MeshBatch const> batches,
+                           CommandBuffer * commandBuffer, RenderStats & stats)
 {
     OPTICK_EVENT();
     auto & currFrame = frameInfo[context.currentGpuFrameIndex];
-    auto res = renderer->GetResolution();
-
-    CommandBuffer::ClearValue depthClear;
-    depthClear.type = CommandBuffer::ClearValue::Type::DEPTH_STENCIL;
-    depthClear.depthStencil.depth = 1.f;
-    depthClear.depthStencil.stencil = 0;
-    CommandBuffer::RenderPassBeginInfo beginInfo = {
-        prepass, currFrame.prepassFramebuffer, {{0, 0}, {res.x, res.y}}, 1, &depthClear};
-    currFrame.mainCommandBuffer->CmdBeginRenderPass(&beginInfo, CommandBuffer::SubpassContents::INLINE);
-
-    if (!currFrame.meshUniformsDescriptorSet) {
-        // If there are no meshes in the scene, the prepass is not used.
-        // TODO: We begin and end the renderpass just to transition the prepass depth image into the right layout.
-        // This is slightly wasteful but I currently think it's more work than it's worth to create alternate
-        // framebuffers and render passes for sprite-only scenes
-        currFrame.mainCommandBuffer->CmdEndRenderPass();
-        return;
-    }
-
-    CommandBuffer::Viewport viewport = {0.f, 0.f, static_cast<float>(res.x), static_cast<float>(res.y), 0.f, 1.f};
-    currFrame.mainCommandBuffer->CmdSetViewport(0, 1, &viewport);
 
-    CommandBuffer::Rect2D scissor = {{0, 0}, {res.x, res.y}};
-    currFrame.mainCommandBuffer->CmdSetScissor(0, 1, &scissor);
+    // commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
+    //                                prepassProgram->GetPipeline());
 
-    // currFrame.mainCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
-    //                                             prepassProgram->GetPipeline());
+    commandBuffer->CmdBindDescriptorSets(
+        prepassPipelineLayout, 0, {cam.descriptorSet, currFrame.meshUniformsDescriptorSet});
+    stats.numDescriptorSetBinds += 2;
 
-    size_t currentBoneOffset = 0;
-    DescriptorSet * currentBoneSet = nullptr;
+    uint32_t currentBoneOffset = 0;
+    bool isBoneSetBound = false;
     ShaderProgram * currentShaderProgram = nullptr;
-    for (auto const & cam : cameras) {
-        if (!cam.isActive) {
+    for (auto const & batch : batches) {
+        if (!batch.material->GetDescriptorSet()) {
             continue;
         }
-        currFrame.mainCommandBuffer->CmdBindDescriptorSets(
-            prepassPipelineLayout, 0, {cam.descriptorSet, currFrame.meshUniformsDescriptorSet});
-        DescriptorSet * currentMeshDescriptorSet = nullptr;
-        for (auto const & batch : batches) {
-            if (!batch.material->GetDescriptorSet()) {
-                continue;
-            }
-            if (batch.material->GetAlbedo()->HasTransparency()) {
-                continue;
-            }
 
-            if (batch.shaderProgram != currentShaderProgram) {
-                currentShaderProgram = batch.shaderProgram;
-                currFrame.mainCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
-                                                             batch.shaderProgram == meshProgram
-                                                                 ? prepassProgram->GetPipeline()
-                                                                 : skeletalPrepassProgram->GetPipeline());
-            }
-            if (batch.shaderProgram == skeletalMeshProgram &&
-                (batch.boneTransformsOffset != currentBoneOffset || !currentBoneSet)) {
-                currentBoneOffset = batch.boneTransformsOffset;
-                currentBoneSet = currFrame.boneTransformOffsets[batch.boneTransformsOffset];
-                currFrame.mainCommandBuffer->CmdBindDescriptorSets(skeletalPrepassPipelineLayout, 2, {currentBoneSet});
-            }
-
-            currFrame.mainCommandBuffer->CmdBindVertexBuffer(batch.vertexBuffer, 0, 0, batch.vertexSize);
-            if (batch.indexBuffer != nullptr) {
-                currFrame.mainCommandBuffer->CmdBindIndexBuffer(batch.indexBuffer, 0, CommandBuffer::IndexType::UINT32);
-            }
+        if (batch.shaderProgram != currentShaderProgram) {
+            currentShaderProgram = batch.shaderProgram;
+            commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
+                                           batch.shaderProgram == meshProgram ? prepassProgram->GetPipeline()
+                                                                              : skeletalPrepassProgram->GetPipeline());
+            stats.numPipelineBinds++;
+        }
+        if (batch.shaderProgram == skeletalMeshProgram &&
+            (batch.boneTransformsOffset != currentBoneOffset || !isBoneSetBound)) {
+            currentBoneOffset = batch.boneTransformsOffset;
+            isBoneSetBound = true;
+            commandBuffer->CmdBindDescriptorSets(skeletalPrepassPipelineLayout,
+                                                 2,
+                                                 {currFrame.boneTransformsDescriptorSet},
+                                                 {batch.boneTransformsOffset});
+            stats.numDescriptorSetBinds++;
+        }
 
-            if (batch.drawCommandsCount > 0) {
-                currFrame.mainCommandBuffer->CmdDrawIndirect(currFrame.meshIndirect,
-                                                             batch.drawCommandsOffset * sizeof(DrawIndirectCommand),
-                                                             batch.drawCommandsCount);
-            }
-            if (batch.drawIndexedCommands.size() > 0) {
-                for (auto const & command : batch.drawIndexedCommands) {
-                    currFrame.mainCommandBuffer->CmdDrawIndexed(command.indexCount,
-                                                                command.instanceCount,
-                                                                command.firstIndex,
-                                                                command.vertexOffset,
-                                                                command.firstInstance);
-                }
-            }
+        commandBuffer->CmdBindVertexBuffer(batch.vertexBuffer, 0, 0, batch.vertexSize);
+        if (batch.indexBuffer != nullptr) {
+            commandBuffer->CmdBindIndexBuffer(batch.indexBuffer, 0, batch.indexType);
         }
-    }
 
-    currFrame.mainCommandBuffer->CmdEndRenderPass();
+        DrawMeshBatch(currFrame, batch, commandBuffer, stats);
+    }
 }
 
 void RenderSystem::PreRenderCameras(FrameContext const & context, std::vector<UpdateCamera> const & cameraUpdates)
@@ -428,6 +573,8 @@ void RenderSystem::PreRenderCameras(FrameContext const & context, std::vector<Up
     for (auto const & camera : cameraUpdates) {
         auto cam = GetCamera(camera.cameraHandle);
         cam->isActive = camera.isActive;
+        cam->projection = camera.projection;
+        cam->view = camera.view;
         struct {
             glm::mat4 p;
             glm::mat4 v;
@@ -450,13 +597,19 @@ void RenderSystem::PreRenderMeshes(FrameContext const & context, std::vector<Upd
 
     for (auto const & meshUpdate : meshes) {
         auto instance = GetStaticMeshInstance(meshUpdate.staticMeshInstance);
-        instance->isActive = meshUpdate.isActive;
-        instance->localToWorld = meshUpdate.localToWorld;
+        if (instance->isActive != meshUpdate.isActive) {
+            instance->isActive = meshUpdate.isActive;
+            staticMeshBatchesDirty = true;
+        }
+        if (instance->localToWorld != meshUpdate.localToWorld) {
+            instance->localToWorld = meshUpdate.localToWorld;
+            MarkStaticMeshTransformDirty(instance);
+        }
     }
 }
 
-void RenderSystem::RenderMeshes(FrameContext & context, CameraInstance const & cam,
-                                std::vector<MeshBatch> const & batches)
+void RenderSystem::RenderMeshes(FrameContext & context, CameraInstance const & cam, std::span<MeshBatch const> batches,
+                                CommandBuffer * commandBuffer, RenderStats & stats)
 {
     OPTICK_EVENT();
     if (batches.size() == 0) {
@@ -468,76 +621,62 @@ void RenderSystem::RenderMeshes(FrameContext & context, CameraInstance const & c
         return;
     }
 
-    auto res = renderer->GetResolution();
+    //    commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
+    //                                   meshProgram->GetPipeline());
 
-    CommandBuffer::Viewport viewport = {0.f, 0.f, static_cast<float>(res.x), static_cast<float>(res.y), 0.f, 1.f};
-    currFrame.mainCommandBuffer->CmdSetViewport(0, 1, &viewport);
-
-    CommandBuffer::Rect2D scissor = {{0, 0}, {res.x, res.y}};
-    currFrame.mainCommandBuffer->CmdSetScissor(0, 1, &scissor);
-
-    //    currFrame.mainCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
-    //                                               meshProgram->GetPipeline());
-
-    currFrame.mainCommandBuffer->CmdBindDescriptorSets(
-        meshPipelineLayout, 0, {currFrame.lightsDescriptorSet, cam.descriptorSet, currFrame.meshUniformsDescriptorSet});
+    commandBuffer->CmdBindDescriptorSets(
+        meshPipelineLayout,
+        0,
+        {currFrame.lightsDescriptorSet, cam.descriptorSet, currFrame.meshUniformsDescriptorSet},
+        {currFrame.lightsOffset, currFrame.lightClusterOffsets[cam.id]});
+    stats.numDescriptorSetBinds += 3;
 
     DescriptorSet * currentMaterialDescriptorSet = nullptr;
-    size_t currentBoneOffset = 0;
-    DescriptorSet * currentBoneSet = nullptr;
+    uint32_t currentBoneOffset = 0;
+    bool isBoneSetBound = false;
     ShaderProgram * currentShaderProgram = nullptr;
     for (auto const & batch : batches) {
         if (!batch.material->GetDescriptorSet()) {
             continue;
         }
-        if (batch.material->GetAlbedo()->HasTransparency()) {
-            continue;
-        }
 
-        context.renderStats.numMeshBatches++;
+        stats.numMeshBatches++;
 
         if (batch.material->GetDescriptorSet() != currentMaterialDescriptorSet) {
             currentMaterialDescriptorSet = batch.material->GetDescriptorSet();
-            currFrame.mainCommandBuffer->CmdBindDescriptorSets(
-                meshPipelineLayout, 3, {batch.material->GetDescriptorSet()});
+            commandBuffer->CmdBindDescriptorSets(meshPipelineLayout, 3, {batch.material->GetDescriptorSet()});
+            stats.numDescriptorSetBinds++;
         }
 
         if (batch.shaderProgram != currentShaderProgram) {
             currentShaderProgram = batch.shaderProgram;
-            currFrame.mainCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
-                                                         batch.shaderProgram->GetPipeline());
+            commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
+                                           batch.shaderProgram->GetPipeline());
+            stats.numPipelineBinds++;
         }
 
         if (batch.shaderProgram == skeletalMeshProgram &&
-            (batch.boneTransformsOffset != currentBoneOffset || !currentBoneSet)) {
+            (batch.boneTransformsOffset != currentBoneOffset || !isBoneSetBound)) {
             currentBoneOffset = batch.boneTransformsOffset;
-            currentBoneSet = currFrame.boneTransformOffsets[batch.boneTransformsOffset];
-            currFrame.mainCommandBuffer->CmdBindDescriptorSets(skeletalMeshPipelineLayout, 4, {currentBoneSet});
+            isBoneSetBound = true;
+            commandBuffer->CmdBindDescriptorSets(skeletalMeshPipelineLayout,
+                                                 4,
+                                                 {currFrame.boneTransformsDescriptorSet},
+                                                 {batch.boneTransformsOffset});
+            stats.numDescriptorSetBinds++;
         }
 
-        currFrame.mainCommandBuffer->CmdBindVertexBuffer(batch.vertexBuffer, 0, 0, batch.vertexSize);
+        commandBuffer->CmdBindVertexBuffer(batch.vertexBuffer, 0, 0, batch.vertexSize);
         if (batch.indexBuffer != nullptr) {
-            currFrame.mainCommandBuffer->CmdBindIndexBuffer(batch.indexBuffer, 0, CommandBuffer::IndexType::UINT32);
-        }
-        if (batch.drawCommandsCount > 0) {
-            currFrame.mainCommandBuffer->CmdDrawIndirect(currFrame.meshIndirect,
-                                                         batch.drawCommandsOffset * sizeof(DrawIndirectCommand),
-                                                         batch.drawCommandsCount);
-        }
-        if (batch.drawIndexedCommands.size() > 0) {
-            for (auto const & command : batch.drawIndexedCommands) {
-                currFrame.mainCommandBuffer->CmdDrawIndexed(command.indexCount,
-                                                            command.instanceCount,
-                                                            command.firstIndex,
-                                                            command.vertexOffset,
-                                                            command.firstInstance);
-            }
+            commandBuffer->CmdBindIndexBuffer(batch.indexBuffer, 0, batch.indexType);
         }
+        DrawMeshBatch(currFrame, batch, commandBuffer, stats);
     }
 }
 
 void RenderSystem::RenderTransparentMeshes(FrameContext & context, CameraInstance const & cam,
-                                           std::vector<MeshBatch> const & batches)
+                                           std::span<MeshBatch const> batches, CommandBuffer * commandBuffer,
+                                           RenderStats & stats)
 {
     OPTICK_EVENT();
     if (batches.size() == 0) {
@@ -549,71 +688,69 @@ void RenderSystem::RenderTransparentMeshes(FrameContext & context, CameraInstanc
         return;
     }
 
-    auto res = renderer->GetResolution();
-
-    CommandBuffer::Viewport viewport = {0.f, 0.f, static_cast<float>(res.x), static_cast<float>(res.y), 0.f, 1.f};
-    currFrame.mainCommandBuffer->CmdSetViewport(0, 1, &viewport);
-
-    CommandBuffer::Rect2D scissor = {{0, 0}, {res.x, res.y}};
-    currFrame.mainCommandBuffer->CmdSetScissor(0, 1, &scissor);
-
-    // currFrame.mainCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
-    //                                             transparentMeshProgram->GetPipeline());
+    // commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
+    //                                transparentMeshProgram->GetPipeline());
 
-    currFrame.mainCommandBuffer->CmdBindDescriptorSets(
-        meshPipelineLayout, 0, {currFrame.lightsDescriptorSet, cam.descriptorSet, currFrame.meshUniformsDescriptorSet});
+    commandBuffer->CmdBindDescriptorSets(
+        meshPipelineLayout,
+        0,
+        {currFrame.lightsDescriptorSet, cam.descriptorSet, currFrame.meshUniformsDescriptorSet},
+        {currFrame.lightsOffset, currFrame.lightClusterOffsets[cam.id]});
+    stats.numDescriptorSetBinds += 3;
 
-    size_t currentBoneOffset = 0;
-    DescriptorSet * currentBoneSet = nullptr;
+    // The batches are in back to front order, so the same state can come back after a few batches and is only bound
+    // when it changes
+    uint32_t currentBoneOffset = 0;
+    bool isBoneSetBound = false;
     DescriptorSet * currentMaterialDescriptorSet = nullptr;
     ShaderProgram * currentShaderProgram = nullptr;
+    BufferHandle * currentVertexBuffer = nullptr;
+    size_t currentVertexSize = 0;
+    BufferHandle * currentIndexBuffer = nullptr;
+    CommandBuffer::IndexType currentIndexType = CommandBuffer::IndexType::UINT32;
     for (auto const & batch : batches) {
         if (!batch.material->GetDescriptorSet()) {
             continue;
         }
-        if (!batch.material->GetAlbedo()->HasTransparency()) {
-            continue;
-        }
 
-        context.renderStats.numTransparentMeshBatches++;
+        stats.numTransparentMeshBatches++;
 
         if (batch.material->GetDescriptorSet() != currentMaterialDescriptorSet) {
             currentMaterialDescriptorSet = batch.material->GetDescriptorSet();
-            currFrame.mainCommandBuffer->CmdBindDescriptorSets(
-                meshPipelineLayout, 3, {batch.material->GetDescriptorSet()});
+            commandBuffer->CmdBindDescriptorSets(meshPipelineLayout, 3, {batch.material->GetDescriptorSet()});
+            stats.numDescriptorSetBinds++;
         }
 
         if (batch.shaderProgram != currentShaderProgram) {
             currentShaderProgram = batch.shaderProgram;
-            currFrame.mainCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
-                                                         batch.shaderProgram->GetPipeline());
+            commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
+                                           batch.shaderProgram->GetPipeline());
+            stats.numPipelineBinds++;
         }
 
         if (batch.shaderProgram == skeletalMeshProgram &&
-            (batch.boneTransformsOffset != currentBoneOffset || !currentBoneSet)) {
+            (batch.boneTransformsOffset != currentBoneOffset || !isBoneSetBound)) {
             currentBoneOffset = batch.boneTransformsOffset;
-            currentBoneSet = currFrame.boneTransformOffsets[batch.boneTransformsOffset];
-            currFrame.mainCommandBuffer->CmdBindDescriptorSets(skeletalMeshPipelineLayout, 4, {currentBoneSet});
+            isBoneSetBound = true;
+            commandBuffer->CmdBindDescriptorSets(skeletalMeshPipelineLayout,
+                                                 4,
+                                                 {currFrame.boneTransformsDescriptorSet},
+                                                 {batch.boneTransformsOffset});
+            stats.numDescriptorSetBinds++;
         }
 
-        currFrame.mainCommandBuffer->CmdBindVertexBuffer(batch.vertexBuffer, 0, 0, batch.vertexSize);
-        if (batch.indexBuffer != nullptr) {
-            currFrame.mainCommandBuffer->CmdBindIndexBuffer(batch.indexBuffer, 0, CommandBuffer::IndexType::UINT32);
+        if (batch.vertexBuffer != currentVertexBuffer || batch.vertexSize != currentVertexSize) {
+            currentVertexBuffer = batch.vertexBuffer;
+            currentVertexSize = batch.vertexSize;
+            commandBuffer->CmdBindVertexBuffer(batch.vertexBuffer, 0, 0, batch.vertexSize);
         }
-        if (batch.drawCommandsCount > 0) {
-            currFrame.mainCommandBuffer->CmdDrawIndirect(currFrame.meshIndirect,
-                                                         batch.drawCommandsOffset * sizeof(DrawIndirectCommand),
-                                                         batch.drawCommandsCount);
-        }
-        if (batch.drawIndexedCommands.size() > 0) {
-            for (auto const & command : batch.drawIndexedCommands) {
-                currFrame.mainCommandBuffer->CmdDrawIndexed(command.indexCount,
-                                                            command.instanceCount,
-                                                            command.firstIndex,
-                                                            command.vertexOffset,
-                                                            command.firstInstance);
-            }
+        if (batch.indexBuffer != nullptr &&
+            (batch.indexBuffer != currentIndexBuffer || batch.indexType != currentIndexType)) {
+            currentIndexBuffer = batch.indexBuffer;
+            currentIndexType = batch.indexType;
+            commandBuffer->CmdBindIndexBuffer(batch.indexBuffer, 0, batch.indexType);
         }
+        DrawMeshBatch(currFrame, batch, commandBuffer, stats);
     }
 }
 
@@ -637,58 +774,28 @@ void RenderSystem::RenderDebugDraws(FrameContext & context, CameraInstance const
     auto & currFrame = frameInfo[context.currentGpuFrameIndex];
     auto res = renderer->GetResolution();
 
-    size_t requiredLinesSize = draws.lines.size() * 4 * sizeof(glm::vec3);
-    size_t requiredPointsSize = draws.points.size() * 2 * sizeof(glm::vec3);
-    if (requiredPointsSize > currFrame.debugPointsSize || requiredLinesSize > currFrame.debugLinesSize) {
-        Semaphore sem;
-        CreateResources([this, &currFrame, &sem, requiredLinesSize, requiredPointsSize](ResourceCreationContext & ctx) {
-            if (requiredLinesSize > currFrame.debugLinesSize) {
-                if (currFrame.debugLinesMapped && currFrame.debugLines) {
-                    ctx.UnmapBuffer(currFrame.debugLines);
-                    ctx.DestroyBuffer(currFrame.debugLines);
-                }
-                currFrame.debugLinesSize = requiredLinesSize;
-                ResourceCreationContext::BufferCreateInfo debugLinesCreateInfo;
-                debugLinesCreateInfo.memoryProperties =
-                    MemoryPropertyFlagBits::HOST_VISIBLE_BIT | MemoryPropertyFlagBits::HOST_COHERENT_BIT;
-                debugLinesCreateInfo.size = currFrame.debugLinesSize;
-                debugLinesCreateInfo.usage = BufferUsageFlags::VERTEX_BUFFER_BIT;
-                currFrame.debugLines = ctx.CreateBuffer(debugLinesCreateInfo);
-                currFrame.debugLinesMapped =
-                    (glm::vec3 *)ctx.MapBuffer(currFrame.debugLines, 0, currFrame.debugLinesSize);
-            }
-            if (requiredPointsSize > currFrame.debugPointsSize) {
-                if (currFrame.debugPointsMapped && currFrame.debugPoints) {
-                    ctx.UnmapBuffer(currFrame.debugPoints);
-                    ctx.DestroyBuffer(currFrame.debugPoints);
-                }
-                currFrame.debugPointsSize = requiredPointsSize;
-                ResourceCreationContext::BufferCreateInfo debugPointsCreateInfo;
-                debugPointsCreateInfo.memoryProperties =
-                    MemoryPropertyFlagBits::HOST_VISIBLE_BIT | MemoryPropertyFlagBits::HOST_COHERENT_BIT;
-                debugPointsCreateInfo.size = currFrame.debugPointsSize;
-                debugPointsCreateInfo.usage = BufferUsageFlags::VERTEX_BUFFER_BIT;
-                currFrame.debugPoints = ctx.CreateBuffer(debugPointsCreateInfo);
-                currFrame.debugPointsMapped =
-                    (glm::vec3 *)ctx.MapBuffer(currFrame.debugPoints, 0, currFrame.debugPointsSize);
-            }
-            sem.Signal();
-        });
-        sem.Wait();
-    }
-
-    size_t debugLinesIdx = 0;
-    for (auto const & line : draws.lines) {
-        currFrame.debugLinesMapped[debugLinesIdx++] = line.worldSpaceStartPos;
-        currFrame.debugLinesMapped[debugLinesIdx++] = line.color;
-        currFrame.debugLinesMapped[debugLinesIdx++] = line.worldSpaceEndPos;
-        currFrame.debugLinesMapped[debugLinesIdx++] = line.color;
+    FrameAllocation debugLines;
+    if (draws.lines.size() > 0) {
+        debugLines = transientAllocator.Allocate(draws.lines.size() * 4 * sizeof(glm::vec3), alignof(glm::vec3));
+        auto debugLinesMapped = (glm::vec3 *)debugLines.ptr;
+        size_t debugLinesIdx = 0;
+        for (auto const & line : draws.lines) {
+            debugLinesMapped[debugLinesIdx++] = line.worldSpaceStartPos;
+            debugLinesMapped[debugLinesIdx++] = line.color;
+            debugLinesMapped[debugLinesIdx++] = line.worldSpaceEndPos;
+            debugLinesMapped[debugLinesIdx++] = line.color;
+        }
     }
 
-    size_t debugPointsIdx = 0;
-    for (auto const & point : draws.points) {
-        currFrame.debugPointsMapped[debugPointsIdx++] = point.worldSpacePos;
-        currFrame.debugPointsMapped[debugPointsIdx++] = point.color;
+    FrameAllocation debugPoints;
+    if (draws.points.size() > 0) {
+        debugPoints = transientAllocator.Allocate(draws.points.size() * 2 * sizeof(glm::vec3), alignof(glm::vec3));
+        auto debugPointsMapped = (glm::vec3 *)debugPoints.ptr;
+        size_t debugPointsIdx = 0;
+        for (auto const & point : draws.points) {
+            debugPointsMapped[debugPointsIdx++] = point.worldSpacePos;
+            debugPointsMapped[debugPointsIdx++] = point.color;
+        }
     }
 
     CommandBuffer::Viewport viewport = {0.f, 0.f, static_cast<float>(res.x), static_cast<float>(res.y), 0.f, 1.f};
@@ -698,19 +805,28 @@ void RenderSystem::RenderDebugDraws(FrameContext & context, CameraInstance const
     currFrame.postProcessCommandBuffer->CmdSetScissor(0, 1, &scissor);
 
     currFrame.postProcessCommandBuffer->CmdBindDescriptorSets(debugDrawLayout, 0, {camera.descriptorSet});
+    context.renderStats.numDescriptorSetBinds++;
 
     if (draws.lines.size() > 0) {
         currFrame.postProcessCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
                                                             debugDrawLinesProgram->GetPipeline());
-        currFrame.postProcessCommandBuffer->CmdBindVertexBuffer(currFrame.debugLines, 0, 0, 2 * sizeof(glm::vec3));
+        currFrame.postProcessCommandBuffer->CmdBindVertexBuffer(
+            debugLines.buffer, 0, debugLines.offset, 2 * sizeof(glm::vec3));
         currFrame.postProcessCommandBuffer->CmdDraw(draws.lines.size() * 2, 1, 0, 0);
+        context.renderStats.numPipelineBinds++;
+        context.renderStats.numDraws++;
+        context.renderStats.numInstances++;
     }
 
     if (draws.points.size() > 0) {
         currFrame.postProcessCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
                                                             debugDrawPointsProgram->GetPipeline());
-        currFrame.postProcessCommandBuffer->CmdBindVertexBuffer(currFrame.debugPoints, 0, 0, 2 * sizeof(glm::vec3));
+        currFrame.postProcessCommandBuffer->CmdBindVertexBuffer(
+            debugPoints.buffer, 0, debugPoints.offset, 2 * sizeof(glm::vec3));
         currFrame.postProcessCommandBuffer->CmdDraw(draws.points.size(), 1, 0, 0);
+        context.renderStats.numPipelineBinds++;
+        context.renderStats.numDraws++;
+        context.renderStats.numInstances++;
     }
 }
 
@@ -719,96 +835,94 @@ void RenderSystem::CreateBatches(FrameContext & context)
     OPTICK_EVENT();
 
     auto & currFrame = frameInfo[context.currentGpuFrameIndex];
+    uint32_t const currFrameBit = 1 << context.currentGpuFrameIndex;
 
-    std::set<StaticMeshInstanceId> inactiveInstances;
-    std::unordered_map<StaticMeshInstanceId, size_t> instanceIdToLtwIndex;
-    std::vector<glm::mat4> localToWorlds;
-    {
-        OPTICK_EVENT("BuildLtwBuffer");
-        for (auto const & mesh : skeletalMeshes) {
-            if (!mesh.isActive) {
-                continue;
-            }
-            // TODO: +1000000 is just a hack for now to get skeletal meshes rendering
-            auto existingLtwIndex = instanceIdToLtwIndex.find(mesh.id + 1000000);
-            if (existingLtwIndex == instanceIdToLtwIndex.end()) {
-                localToWorlds.push_back(mesh.localToWorld);
-                instanceIdToLtwIndex[mesh.id + 1000000] = localToWorlds.size() - 1;
-            }
-        }
-        for (auto const & submeshInstance : sortedSubmeshInstances) {
-            auto const staticMeshInstance = GetStaticMeshInstance(submeshInstance.instanceId);
-            if (!staticMeshInstance->isActive) {
-                inactiveInstances.insert(submeshInstance.instanceId);
-                continue;
-            }
-            auto existingLtwIndex = instanceIdToLtwIndex.find(submeshInstance.instanceId);
-            if (existingLtwIndex == instanceIdToLtwIndex.end()) {
-                localToWorlds.push_back(staticMeshInstance->localToWorld);
-                instanceIdToLtwIndex[submeshInstance.instanceId] = localToWorlds.size() - 1;
-            }
-        }
+    if (staticMeshBatchesDirty) {
+        RebuildStaticMeshBatches();
     }
 
-    // I've probably made this part overly complicated...
-    std::vector<size_t> neededBoneOffsetDescriptorSets;
-    std::unordered_map<SkeletalMeshInstanceId, size_t> instanceIdToBoneOffset;
-    std::vector<glm::mat4> bones;
-    std::vector<size_t> boneOffsets;
-    std::vector<size_t> boneSplits;
-    size_t totalBoneSize = 0;
+    // The static mesh transforms are laid out in the same order as sortedSubmeshInstances so instanced draws read
+    // contiguous matrices. Skeletal meshes are placed after them.
+    size_t const skeletalLtwOffset = sortedSubmeshInstances.size();
+    size_t numActiveSkeletalMeshes = 0;
+
+    // Every active skeletal mesh gets a bone palette in one allocation. The palettes are bound with dynamic offsets, so
+    // they must be aligned to the uniform buffer alignment and the descriptor always views a full palette.
+    auto & boneOffsets = currFrame.skeletalMeshBoneOffsets;
+    boneOffsets.clear();
     {
-        OPTICK_EVENT("BuildBoneBuffer");
-        size_t currentBoneOffset = 0;
+        OPTICK_EVENT("UploadBoneTransforms");
+        size_t const uboAlignment = GetUniformBufferAlignment();
+        size_t boneTransformsSize = 0;
         for (auto const & mesh : skeletalMeshes) {
             if (!mesh.isActive) {
                 continue;
             }
+            numActiveSkeletalMeshes++;
+            boneTransformsSize = (boneTransformsSize + uboAlignment - 1) / uboAlignment * uboAlignment;
+            boneOffsets.push_back(static_cast<uint32_t>(boneTransformsSize));
+            boneTransformsSize += std::min(mesh.bones.size(), MAX_BONES_PER_MESH) * sizeof(glm::mat4);
+        }
 
-            for (auto const & bone : mesh.bones) {
-                bones.push_back(bone.currentTransform);
-            }
-            boneOffsets.push_back(currentBoneOffset);
-            boneSplits.push_back(mesh.bones.size());
-            instanceIdToBoneOffset[mesh.id] = currentBoneOffset;
-            if (currFrame.boneTransformOffsets.find(currentBoneOffset) == currFrame.boneTransformOffsets.end()) {
-                neededBoneOffsetDescriptorSets.push_back(currentBoneOffset);
-            }
+        if (numActiveSkeletalMeshes > 0) {
+            // The last palette is padded so a full palette can be viewed at its offset
+            auto allocation = transientAllocator.Allocate(boneOffsets.back() + BONE_PALETTE_SIZE, uboAlignment);
+            currFrame.boneTransformsDescriptorSet =
+                transientAllocator.GetDescriptorSet(allocation.buffer, skeletalMeshBoneLayout, BONE_PALETTE_SIZE);
 
-            totalBoneSize += mesh.bones.size() * sizeof(glm::mat4);
-            currentBoneOffset += mesh.bones.size() * sizeof(glm::mat4);
-            auto uboAlignment = rendererProperties.GetUniformBufferAlignment();
-            if (uboAlignment != 0 && currentBoneOffset % uboAlignment != 0) {
-                // Fix alignment - the bones will be submitted as a UBO and UBO offsets must follow alignment
-                size_t alignment = currentBoneOffset % uboAlignment;
-                currentBoneOffset += alignment;
-                totalBoneSize += alignment;
+            size_t skeletalIndex = 0;
+            for (auto const & mesh : skeletalMeshes) {
+                if (!mesh.isActive) {
+                    continue;
+                }
+                auto boneTransforms = (glm::mat4 *)(allocation.ptr + boneOffsets[skeletalIndex]);
+                for (size_t i = 0; i < std::min(mesh.bones.size(), MAX_BONES_PER_MESH); ++i) {
+                    boneTransforms[i] = mesh.bones[i].currentTransform;
+                }
+                boneOffsets[skeletalIndex] += static_cast<uint32_t>(allocation.offset);
+                skeletalIndex++;
             }
         }
     }
 
-    currFrame.meshBatches.clear();
-    size_t drawCommandsOffset = 0;
-    std::vector<DrawIndirectCommand> drawCommands;
-    size_t drawIndexedOffset = 0;
-    std::vector<DrawIndexedIndirectCommand> drawIndexedCommands;
+    // The static mesh batches are only copied into the frame when they have changed since the last time this frame was
+    // rendered. The skeletal mesh batches are rebuilt every frame and placed after them.
+    bool staticBatchesChanged = currFrame.staticMeshBatchesVersion != staticMeshBatchesVersion;
+    auto & drawCommands = currFrame.meshDrawCommands;
+    auto & drawIndexedCommands = currFrame.meshDrawIndexedCommands;
+    if (staticBatchesChanged) {
+        currFrame.meshBatches.assign(staticMeshBatches.begin(), staticMeshBatches.end());
+        drawCommands.assign(staticMeshDrawCommands.begin(), staticMeshDrawCommands.end());
+        drawIndexedCommands.assign(staticMeshDrawIndexedCommands.begin(), staticMeshDrawIndexedCommands.end());
+        currFrame.staticMeshBatchesVersion = staticMeshBatchesVersion;
+    } else {
+        currFrame.meshBatches.resize(staticMeshBatches.size());
+        drawCommands.resize(staticMeshDrawCommands.size());
+        drawIndexedCommands.resize(staticMeshDrawIndexedCommands.size());
+    }
+
     {
-        OPTICK_EVENT("GatherBatches");
+        OPTICK_EVENT("GatherSkeletalBatches");
+        size_t drawCommandsOffset = drawCommands.size();
+        size_t drawIndexedOffset = drawIndexedCommands.size();
         MeshBatch currentBatch;
-        currentBatch.vertexSize = sizeof(VertexWithSkinning);
+        currentBatch.vertexSize = sizeof(PackedVertexWithSkinning);
         currentBatch.shaderProgram = skeletalMeshProgram;
         // TODO: Merge with static mesh batches
+        size_t skeletalIndex = 0;
         for (auto const & mesh : skeletalMeshes) {
             if (!mesh.isActive) {
                 continue;
             }
-            auto offset = instanceIdToBoneOffset.at(mesh.id);
+            auto offset = boneOffsets[skeletalIndex];
+            uint32_t ltwIndex = skeletalLtwOffset + skeletalIndex;
+            skeletalIndex++;
             for (auto const & submesh : mesh.mesh->GetSubmeshes()) {
                 if (submesh.GetMaterial() != currentBatch.material ||
                     submesh.GetVertexBuffer().GetBuffer() != currentBatch.vertexBuffer ||
                     (submesh.GetIndexBuffer().has_value() ? submesh.GetIndexBuffer().value().GetBuffer() : nullptr) !=
                         currentBatch.indexBuffer ||
-                    offset != currentBatch.boneTransformsOffset) {
+                    submesh.GetIndexType() != currentBatch.indexType || offset != currentBatch.boneTransformsOffset) {
                     currentBatch.drawCommandsOffset = drawCommandsOffset;
                     currentBatch.drawCommandsCount = drawCommands.size() - drawCommandsOffset;
                     currentBatch.drawIndexedCommandsOffset = drawIndexedOffset;
@@ -818,94 +932,32 @@ void RenderSystem::CreateBatches(FrameContext & context)
                     }
                     drawCommandsOffset = drawCommands.size();
                     drawIndexedOffset = drawIndexedCommands.size();
-                    currentBatch.drawCommands.clear();
-                    currentBatch.drawIndexedCommands.clear();
                     currentBatch.indexBuffer =
                         (submesh.GetIndexBuffer().has_value() ? submesh.GetIndexBuffer().value().GetBuffer() : nullptr);
+                    currentBatch.indexType = submesh.GetIndexType();
                     currentBatch.material = submesh.GetMaterial();
                     currentBatch.vertexBuffer = submesh.GetVertexBuffer().GetBuffer();
                     currentBatch.boneTransformsOffset = offset;
                 }
                 if (submesh.GetIndexBuffer().has_value()) {
                     DrawIndexedIndirectCommand command;
-                    command.firstIndex = submesh.GetIndexBuffer().value().GetOffset() / sizeof(uint32_t);
-                    command.firstInstance = instanceIdToLtwIndex.at(mesh.id + 1000000);
-                    command.indexCount = submesh.GetIndexBuffer().value().GetSize() / sizeof(uint32_t);
+                    command.firstIndex = submesh.GetIndexBuffer().value().GetOffset() / submesh.GetIndexSize();
+                    command.firstInstance = ltwIndex;
+                    command.indexCount = submesh.GetIndexBuffer().value().GetSize() / submesh.GetIndexSize();
                     command.instanceCount = 1;
-                    command.vertexOffset = submesh.GetVertexBuffer().GetOffset() / sizeof(VertexWithSkinning);
-                    currentBatch.drawIndexedCommands.push_back(command);
+                    command.vertexOffset = submesh.GetVertexBuffer().GetOffset() / sizeof(PackedVertexWithSkinning);
                     drawIndexedCommands.push_back(command);
                 } else {
                     DrawIndirectCommand command;
-                    command.firstInstance = instanceIdToLtwIndex.at(mesh.id + 1000000);
-                    command.firstVertex = submesh.GetVertexBuffer().GetOffset() / sizeof(VertexWithSkinning);
+                    command.firstInstance = ltwIndex;
+                    command.firstVertex = submesh.GetVertexBuffer().GetOffset() / sizeof(PackedVertexWithSkinning);
                     command.instanceCount = 1;
-                    command.vertexCount = submesh.GetVertexBuffer().GetSize() / sizeof(VertexWithSkinning);
-                    currentBatch.drawCommands.push_back(command);
+                    command.vertexCount = submesh.GetVertexBuffer().GetSize() / sizeof(PackedVertexWithSkinning);
                     drawCommands.push_back(command);
                 }
             }
         }
 
-        if (currentBatch.material != nullptr) {
-            currFrame.meshBatches.push_back(currentBatch);
-        }
-        // Force new batch for static meshes since vertex size and shader program is different
-        currentBatch.material = nullptr;
-
-        currentBatch.vertexSize = sizeof(VertexWithNormal);
-        currentBatch.shaderProgram = meshProgram;
-        for (auto const & submesh : sortedSubmeshInstances) {
-            // TODO: Replace with contains when upgraded to C++20.
-            // I can't belive a set implementation does not have a straightforward contains method...
-            if (inactiveInstances.count(submesh.instanceId) > 0) {
-                continue;
-            }
-            if (submesh.submesh->GetMaterial() != currentBatch.material ||
-                submesh.submesh->GetVertexBuffer().GetBuffer() != currentBatch.vertexBuffer ||
-                (submesh.submesh->GetIndexBuffer().has_value() ? submesh.submesh->GetIndexBuffer()->GetBuffer()
-                                                               : nullptr) != currentBatch.indexBuffer) {
-                currentBatch.drawCommandsOffset = drawCommandsOffset;
-                currentBatch.drawCommandsCount = drawCommands.size() - drawCommandsOffset;
-                currentBatch.drawIndexedCommandsOffset = drawIndexedOffset;
-                currentBatch.drawIndexedCommandsCount = drawIndexedCommands.size() - drawIndexedOffset;
-                if (currentBatch.material != nullptr) {
-                    if (currentBatch.material->GetAlbedo()->HasTransparency()) {
-                        currentBatch.shaderProgram = transparentMeshProgram;
-                    } else {
-                        currentBatch.shaderProgram = meshProgram;
-                    }
-                    currFrame.meshBatches.push_back(currentBatch);
-                }
-                drawCommandsOffset = drawCommands.size();
-                drawIndexedOffset = drawIndexedCommands.size();
-                currentBatch.drawCommands.clear();
-                currentBatch.drawIndexedCommands.clear();
-                currentBatch.indexBuffer =
-                    (submesh.submesh->GetIndexBuffer().has_value() ? submesh.submesh->GetIndexBuffer()->GetBuffer()
-                                                                   : nullptr);
-                currentBatch.material = submesh.submesh->GetMaterial();
-                currentBatch.vertexBuffer = submesh.submesh->GetVertexBuffer().GetBuffer();
-            }
-            if (submesh.submesh->GetIndexBuffer().has_value()) {
-                DrawIndexedIndirectCommand command;
-                command.firstIndex = submesh.submesh->GetIndexBuffer()->GetOffset();
-                command.firstInstance = instanceIdToLtwIndex.at(submesh.instanceId);
-                command.indexCount = submesh.submesh->GetNumIndexes();
-                command.instanceCount = 1;
-                command.vertexOffset = submesh.submesh->GetVertexBuffer().GetOffset() / sizeof(VertexWithNormal);
-                currentBatch.drawIndexedCommands.push_back(command);
-                drawIndexedCommands.push_back(command);
-            } else {
-                DrawIndirectCommand command;
-                command.firstInstance = instanceIdToLtwIndex.at(submesh.instanceId);
-                command.firstVertex = submesh.submesh->GetVertexBuffer().GetOffset() / sizeof(VertexWithNormal);
-                command.instanceCount = 1;
-                command.vertexCount = submesh.submesh->GetNumVertices();
-                currentBatch.drawCommands.push_back(command);
-                drawCommands.push_back(command);
-            }
-        }
         if (currentBatch.material != nullptr) {
             currentBatch.drawCommandsOffset = drawCommandsOffset;
             currentBatch.drawCommandsCount = drawCommands.size() - drawCommandsOffset;
@@ -915,28 +967,30 @@ void RenderSystem::CreateBatches(FrameContext & context)
         }
     }
 
+    BuildCameraMeshBatches(currFrame, drawCommands, drawIndexedCommands);
+
+    size_t requiredUniformsSize = (skeletalLtwOffset + numActiveSkeletalMeshes) * sizeof(glm::mat4);
+    bool recreatedUniforms = false;
+    bool recreatedIndirect = false;
     Semaphore uniformCreationDone;
-    if (localToWorlds.size() * sizeof(glm::mat4) > currFrame.meshUniformsSize ||
+    if (requiredUniformsSize > currFrame.meshUniformsSize ||
         drawCommands.size() * sizeof(DrawIndirectCommand) > currFrame.meshIndirectSize ||
-        drawIndexedCommands.size() * sizeof(DrawIndexedIndirectCommand) > currFrame.meshIndexedIndirectSize ||
-        neededBoneOffsetDescriptorSets.size() > 0 || totalBoneSize > currFrame.boneTransformsSize) {
+        drawIndexedCommands.size() * sizeof(DrawIndexedIndirectCommand) > currFrame.meshIndexedIndirectSize) {
         renderer->CreateResources([this,
                                    &uniformCreationDone,
                                    &currFrame,
                                    &drawCommands,
                                    &drawIndexedCommands,
-                                   &localToWorlds,
-                                   &bones,
-                                   totalBoneSize,
-                                   &instanceIdToBoneOffset,
-                                   &neededBoneOffsetDescriptorSets](ResourceCreationContext & ctx) {
+                                   requiredUniformsSize,
+                                   &recreatedUniforms,
+                                   &recreatedIndirect](ResourceCreationContext & ctx) {
             OPTICK_EVENT("CreateUniformBuffers");
-            if (localToWorlds.size() * sizeof(glm::mat4) > currFrame.meshUniformsSize) {
+            if (requiredUniformsSize > currFrame.meshUniformsSize) {
                 if (currFrame.meshUniforms) {
                     ctx.UnmapBuffer(currFrame.meshUniforms);
                     ctx.DestroyBuffer(currFrame.meshUniforms);
                 }
-                currFrame.meshUniformsSize = localToWorlds.size() * sizeof(glm::mat4);
+                currFrame.meshUniformsSize = requiredUniformsSize;
                 ResourceCreationContext::BufferCreateInfo uniformsCreateInfo;
                 uniformsCreateInfo.memoryProperties =
                     MemoryPropertyFlagBits::HOST_VISIBLE_BIT | MemoryPropertyFlagBits::HOST_COHERENT_BIT;
@@ -945,6 +999,7 @@ void RenderSystem::CreateBatches(FrameContext & context)
                 currFrame.meshUniforms = ctx.CreateBuffer(uniformsCreateInfo);
                 currFrame.meshUniformsMapped =
                     (glm::mat4 *)ctx.MapBuffer(currFrame.meshUniforms, 0, currFrame.meshUniformsSize);
+                recreatedUniforms = true;
             }
             if (currFrame.meshUniformsDescriptorSet) {
                 ctx.DestroyDescriptorSet(currFrame.meshUniformsDescriptorSet);
@@ -978,6 +1033,7 @@ void RenderSystem::CreateBatches(FrameContext & context)
                 currFrame.meshIndirect = ctx.CreateBuffer(meshIndirectCreateInfo);
                 currFrame.meshIndirectMapped =
                     (DrawIndirectCommand *)ctx.MapBuffer(currFrame.meshIndirect, 0, currFrame.meshIndirectSize);
+                recreatedIndirect = true;
             }
             if (drawIndexedCommands.size() * sizeof(DrawIndexedIndirectCommand) > currFrame.meshIndexedIndirectSize) {
                 if (currFrame.meshIndexedIndirect) {
@@ -996,64 +1052,9 @@ void RenderSystem::CreateBatches(FrameContext & context)
                 currFrame.meshIndexedIndirect = ctx.CreateBuffer(meshIndexedIndirectCreateInfo);
                 currFrame.meshIndexedIndirectMapped = (DrawIndexedIndirectCommand *)ctx.MapBuffer(
                     currFrame.meshIndexedIndirect, 0, currFrame.meshIndexedIndirectSize);
+                recreatedIndirect = true;
             }
 
-            if (totalBoneSize > currFrame.boneTransformsSize) {
-                for (auto const & descriptorSet : currFrame.boneTransformOffsets) {
-                    ctx.DestroyDescriptorSet(descriptorSet.second);
-                }
-                currFrame.boneTransformOffsets.clear();
-                if (currFrame.boneTransforms) {
-                    ctx.UnmapBuffer(currFrame.boneTransforms);
-                    ctx.DestroyBuffer(currFrame.boneTransforms);
-                }
-                currFrame.boneTransformsSize = totalBoneSize;
-                ResourceCreationContext::BufferCreateInfo boneTransformsCi;
-                boneTransformsCi.memoryProperties =
-                    MemoryPropertyFlagBits::HOST_VISIBLE_BIT | MemoryPropertyFlagBits::HOST_COHERENT_BIT;
-                boneTransformsCi.size = currFrame.boneTransformsSize;
-                boneTransformsCi.usage = BufferUsageFlags::UNIFORM_BUFFER_BIT;
-                currFrame.boneTransforms = ctx.CreateBuffer(boneTransformsCi);
-                currFrame.boneTransformsMapped =
-                    (glm::mat4 *)ctx.MapBuffer(currFrame.boneTransforms, 0, currFrame.boneTransformsSize);
-
-                std::set<size_t> createdOffsets;
-                for (auto const & offset : instanceIdToBoneOffset) {
-                    if (createdOffsets.count(offset.second) > 0) {
-                        continue;
-                    }
-                    ResourceCreationContext::DescriptorSetCreateInfo descriptorSetCi;
-                    ResourceCreationContext::DescriptorSetCreateInfo::BufferDescriptor bufferDescriptor;
-                    bufferDescriptor.buffer = currFrame.boneTransforms;
-                    bufferDescriptor.offset = offset.second;
-                    bufferDescriptor.range = currFrame.boneTransformsSize - offset.second;
-                    ResourceCreationContext::DescriptorSetCreateInfo::Descriptor descriptors[] = {
-                        {DescriptorType::UNIFORM_BUFFER, 0, bufferDescriptor},
-                    };
-                    descriptorSetCi.descriptors = descriptors;
-                    descriptorSetCi.descriptorCount = 1;
-                    descriptorSetCi.layout = skeletalMeshBoneLayout;
-                    auto descriptorSet = ctx.CreateDescriptorSet(descriptorSetCi);
-                    currFrame.boneTransformOffsets[offset.second] = descriptorSet;
-                    createdOffsets.insert(offset.second);
-                }
-            } else if (neededBoneOffsetDescriptorSets.size() > 0) {
-                for (auto const & offset : neededBoneOffsetDescriptorSets) {
-                    ResourceCreationContext::DescriptorSetCreateInfo descriptorSetCi;
-                    ResourceCreationContext::DescriptorSetCreateInfo::BufferDescriptor bufferDescriptor;
-                    bufferDescriptor.buffer = currFrame.boneTransforms;
-                    bufferDescriptor.offset = offset;
-                    bufferDescriptor.range = currFrame.boneTransformsSize - offset;
-                    ResourceCreationContext::DescriptorSetCreateInfo::Descriptor descriptors[] = {
-                        {DescriptorType::UNIFORM_BUFFER, 0, bufferDescriptor},
-                    };
-                    descriptorSetCi.descriptors = descriptors;
-                    descriptorSetCi.descriptorCount = 1;
-                    descriptorSetCi.layout = skeletalMeshBoneLayout;
-                    auto descriptorSet = ctx.CreateDescriptorSet(descriptorSetCi);
-                    currFrame.boneTransformOffsets[offset] = descriptorSet;
-                }
-            }
             uniformCreationDone.Signal();
         });
     } else {
@@ -1062,54 +1063,545 @@ void RenderSystem::CreateBatches(FrameContext & context)
     {
         OPTICK_EVENT("UploadUniformData");
         uniformCreationDone.Wait();
-        if (drawCommands.size() > 0) {
-            memcpy(
-                currFrame.meshIndirectMapped, drawCommands.data(), drawCommands.size() * sizeof(DrawIndirectCommand));
-        }
-        if (drawIndexedCommands.size() > 0) {
-            memcpy(currFrame.meshIndexedIndirectMapped,
-                   drawIndexedCommands.data(),
-                   drawIndexedCommands.size() * sizeof(DrawIndexedIndirectCommand));
+        // The static mesh commands only need to be uploaded if they have changed or if the buffers were recreated.
+        // The skeletal mesh commands after them are uploaded every frame.
+        size_t firstDrawCommand = staticBatchesChanged || recreatedIndirect ? 0 : staticMeshDrawCommands.size();
+        size_t firstDrawIndexedCommand =
+            staticBatchesChanged || recreatedIndirect ? 0 : staticMeshDrawIndexedCommands.size();
+        auto & bytesUploaded = context.renderStats.bytesUploaded;
+        if (drawCommands.size() > firstDrawCommand) {
+            bytesUploaded += (drawCommands.size() - firstDrawCommand) * sizeof(DrawIndirectCommand);
+            memcpy(currFrame.meshIndirectMapped + firstDrawCommand,
+                   drawCommands.data() + firstDrawCommand,
+                   (drawCommands.size() - firstDrawCommand) * sizeof(DrawIndirectCommand));
         }
-        size_t currentNumberOfBones = 0;
-        for (size_t i = 0; i < boneSplits.size(); ++i) {
-            memcpy(((uint8_t *)currFrame.boneTransformsMapped) + boneOffsets[i],
-                   ((uint8_t *)&bones[currentNumberOfBones]),
-                   boneSplits[i] * sizeof(glm::mat4));
-            currentNumberOfBones += boneSplits[i];
+        if (drawIndexedCommands.size() > firstDrawIndexedCommand) {
+            bytesUploaded +=
+                (drawIndexedCommands.size() - firstDrawIndexedCommand) * sizeof(DrawIndexedIndirectCommand);
+            memcpy(currFrame.meshIndexedIndirectMapped + firstDrawIndexedCommand,
+                   drawIndexedCommands.data() + firstDrawIndexedCommand,
+                   (drawIndexedCommands.size() - firstDrawIndexedCommand) * sizeof(DrawIndexedIndirectCommand));
         }
+
         // TODO: If this is moved up above the other memcpys the data in meshUniformsMapped somehow gets corrupted
         // and I don't understand why.
-        memcpy(currFrame.meshUniformsMapped, localToWorlds.data(), localToWorlds.size() * sizeof(glm::mat4));
+        size_t skeletalIndex = 0;
+        for (auto const & mesh : skeletalMeshes) {
+            if (!mesh.isActive) {
+                continue;
+            }
+            currFrame.meshUniformsMapped[skeletalLtwOffset + skeletalIndex] = mesh.localToWorld;
+            skeletalIndex++;
+        }
+        bytesUploaded += skeletalIndex * sizeof(glm::mat4);
+        if (recreatedUniforms || staticBatchesChanged) {
+            // The slots have moved around (or the buffer is new), so everything has to be uploaded
+            for (size_t slot = 0; slot < sortedSubmeshInstances.size(); ++slot) {
+                currFrame.meshUniformsMapped[slot] = staticMeshes[sortedSubmeshInstances[slot].instanceId].localToWorld;
+            }
+            bytesUploaded += sortedSubmeshInstances.size() * sizeof(glm::mat4);
+            for (auto id : dirtyStaticMeshTransforms) {
+                staticMeshes[id].dirtyFrames &= ~currFrameBit;
+            }
+        } else {
+            for (auto id : dirtyStaticMeshTransforms) {
+                auto & mesh = staticMeshes[id];
+                if (mesh.dirtyFrames & currFrameBit) {
+                    for (auto slot : mesh.uniformSlots) {
+                        currFrame.meshUniformsMapped[slot] = mesh.localToWorld;
+                    }
+                    bytesUploaded += mesh.uniformSlots.size() * sizeof(glm::mat4);
+                    mesh.dirtyFrames &= ~currFrameBit;
+                }
+            }
+        }
+        std::erase_if(dirtyStaticMeshTransforms, [this](auto id) { return staticMeshes[id].dirtyFrames == 0; });
     }
 }
 
-void RenderSystem::RenderSprites(FrameContext & context, CameraInstance const & cam)
+// Returns how many pixels tall one unit in the mesh's local space is on screen. Measured at the point of the mesh's
+// bounding sphere closest to the camera so it is never less than the size of any part of the mesh.
+static float ProjectedPixelsPerUnit(glm::mat4 const & view, glm::mat4 const & projection, float resolutionY,
+                                    glm::mat4 const & localToWorld, StaticMesh const * mesh)
+{
+    float scale = std::max({glm::length(glm::vec3(localToWorld[0])),
+                            glm::length(glm::vec3(localToWorld[1])),
+                            glm::length(glm::vec3(localToWorld[2]))});
+    // projection[1][1] is negative when the projection flips Y
+    float pixelsPerUnit = std::abs(projection[1][1]) * 0.5f * resolutionY * scale;
+    bool isPerspective = projection[2][3] != 0.f;
+    if (!isPerspective) {
+        return pixelsPerUnit;
+    }
+    glm::vec3 center = (mesh->GetBoundsMin() + mesh->GetBoundsMax()) * 0.5f;
+    float radius = glm::length(mesh->GetBoundsMax() - mesh->GetBoundsMin()) * 0.5f * scale;
+    float depth = -(view * localToWorld * glm::vec4(center, 1.f)).z - radius;
+    if (depth <= 0.f) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return pixelsPerUnit / depth;
+}
+
+void RenderSystem::CullStaticMeshes()
 {
     OPTICK_EVENT();
-    auto & currFrame = frameInfo[context.currentGpuFrameIndex];
-    auto res = renderer->GetResolution();
+    cameraStaticMeshVisibility.resize(cameras.size());
+    for (auto const & camera : cameras) {
+        auto & visibility = cameraStaticMeshVisibility[camera.id];
+        visibility.clear();
+        if (!camera.isActive || !occlusionCullingEnabled.Get()) {
+            continue;
+        }
+        occlusionCuller.Begin(camera.projection * camera.view);
+        for (auto const & instance : staticMeshes) {
+            if (instance.isActive && instance.isOccluder) {
+                occlusionCuller.AddOccluder(instance.mesh->GetOccluder(), instance.localToWorld);
+            }
+        }
+        occlusionCuller.Rasterize(jobEngine);
+        visibility.resize(staticMeshes.size());
+        for (auto const & instance : staticMeshes) {
+            visibility[instance.id] =
+                instance.isActive && occlusionCuller.IsVisible(instance.mesh->GetBoundsMin(),
+                                                               instance.mesh->GetBoundsMax(),
+                                                               instance.localToWorld);
+        }
+    }
+}
 
-    CommandBuffer::Viewport viewport = {0.f, 0.f, static_cast<float>(res.x), static_cast<float>(res.y), 0.f, 1.f};
-    currFrame.mainCommandBuffer->CmdSetViewport(0, 1, &viewport);
+void RenderSystem::BuildCameraMeshBatches(FrameInfo & frame, std::vector<DrawIndirectCommand> & drawCommands,
+                                          std::vector<DrawIndexedIndirectCommand> & drawIndexedCommands)
+{
+    OPTICK_EVENT();
+    float const resolutionY = static_cast<float>(renderer->GetResolution().y);
+    // In the same order as the skeletal mesh slots in meshUniforms
+    std::vector<glm::vec3> skeletalMeshPositions;
+    for (auto const & mesh : skeletalMeshes) {
+        if (mesh.isActive) {
+            skeletalMeshPositions.push_back(glm::vec3(mesh.localToWorld[3]));
+        }
+    }
+    frame.cameraMeshBatches.resize(cameras.size());
+    frame.cameraTransparentBatches.resize(cameras.size());
+    for (auto const & camera : cameras) {
+        auto & cameraBatches = frame.cameraMeshBatches[camera.id];
+        cameraBatches.clear();
+        frame.cameraTransparentBatches[camera.id].clear();
+        if (!camera.isActive) {
+            continue;
+        }
+        cameraBatches.assign(frame.meshBatches.begin(), frame.meshBatches.end());
+        auto const & visibility = cameraStaticMeshVisibility[camera.id];
+        bool const isCulled = !visibility.empty();
+
+        // Instanced commands are split up where an instance is culled or consecutive instances pick different LODs.
+        // applyLod changes the command to draw the LOD picked for the instance and returns the LOD.
+        auto rebuildCommands = [&](auto & commands, size_t & offset, size_t & count, auto const & applyLod) {
+            size_t const newOffset = commands.size();
+            for (size_t i = 0; i < count; ++i) {
+                // Copied since pushing to commands may reallocate it
+                auto const command = commands[offset + i];
+                bool hasPrevious = false;
+                uint32_t previousSlot = 0;
+                size_t previousLod = 0;
+                for (uint32_t slot = command.firstInstance; slot < command.firstInstance + command.instanceCount;
+                     ++slot) {
+                    auto const & submeshInstance = sortedSubmeshInstances[slot];
+                    if (isCulled && !visibility[submeshInstance.instanceId]) {
+                        continue;
+                    }
+                    auto slotCommand = command;
+                    size_t lod = applyLod(slotCommand, submeshInstance);
+                    if (hasPrevious && previousSlot + 1 == slot && previousLod == lod) {
+                        commands.back().instanceCount++;
+                    } else {
+                        slotCommand.firstInstance = slot;
+                        slotCommand.instanceCount = 1;
+                        commands.push_back(slotCommand);
+                    }
+                    hasPrevious = true;
+                    previousSlot = slot;
+                    previousLod = lod;
+                }
+            }
+            offset = newOffset;
+            count = commands.size() - newOffset;
+        };
 
-    CommandBuffer::Rect2D scissor = {{0, 0}, {res.x, res.y}};
-    currFrame.mainCommandBuffer->CmdSetScissor(0, 1, &scissor);
+        for (size_t b = 0; b < staticMeshBatches.size(); ++b) {
+            if (!staticMeshBatchHasLods[b] && !isCulled) {
+                continue;
+            }
+            auto & batch = cameraBatches[b];
+            rebuildCommands(drawCommands,
+                            batch.drawCommandsOffset,
+                            batch.drawCommandsCount,
+                            [](DrawIndirectCommand &, SubmeshInstance const &) -> size_t { return 0; });
+            rebuildCommands(
+                drawIndexedCommands,
+                batch.drawIndexedCommandsOffset,
+                batch.drawIndexedCommandsCount,
+                [&](DrawIndexedIndirectCommand & command, SubmeshInstance const & submeshInstance) -> size_t {
+                    auto const & instance = staticMeshes[submeshInstance.instanceId];
+                    auto const & lods = instance.mesh->GetLods(submeshInstance.submeshIndex);
+                    if (lods.empty()) {
+                        return 0;
+                    }
+                    float pixelsPerUnit = ProjectedPixelsPerUnit(
+                        camera.view, camera.projection, resolutionY, instance.localToWorld, instance.mesh);
+                    // The coarsest LOD whose error is too small to see
+                    size_t lod = 0;
+                    while (lod < lods.size() && lods[lod].error * pixelsPerUnit <= LOD_MAX_ERROR_PIXELS) {
+                        lod++;
+                    }
+                    if (lod > 0) {
+                        command.firstIndex += lods[lod - 1].firstIndex;
+                        command.indexCount = lods[lod - 1].indexCount;
+                    }
+                    return lod;
+                });
+        }
+        if (isCulled) {
+            std::erase_if(cameraBatches, [](MeshBatch const & batch) {
+                return batch.drawCommandsCount == 0 && batch.drawIndexedCommandsCount == 0;
+            });
+        }
+
+        SortTransparentMeshBatches(frame, camera, skeletalMeshPositions, drawCommands, drawIndexedCommands);
+    }
+}
+
+void RenderSystem::SortTransparentMeshBatches(FrameInfo & frame, CameraInstance const & camera,
+                                              std::span<glm::vec3 const> skeletalMeshPositions,
+                                              std::vector<DrawIndirectCommand> & drawCommands,
+                                              std::vector<DrawIndexedIndirectCommand> & drawIndexedCommands)
+{
+    OPTICK_EVENT();
+    auto & cameraBatches = frame.cameraMeshBatches[camera.id];
+    auto isTransparent = [](MeshBatch const & batch) { return batch.material->GetAlbedo()->HasTransparency(); };
+
+    // Static instances are sorted by the center of their bounds and skeletal instances by their origin
+    auto slotDepthKey = [&](uint32_t slot) {
+        glm::vec3 position;
+        if (slot < sortedSubmeshInstances.size()) {
+            auto const & instance = staticMeshes[sortedSubmeshInstances[slot].instanceId];
+            glm::vec3 center = (instance.mesh->GetBoundsMin() + instance.mesh->GetBoundsMax()) * 0.5f;
+            position = glm::vec3(instance.localToWorld * glm::vec4(center, 1.f));
+        } else {
+            position = skeletalMeshPositions[slot - sortedSubmeshInstances.size()];
+        }
+        float depth = -(camera.view * glm::vec4(position, 1.f)).z;
+        // Inverted so the farthest instances come first
+        return ~FloatToRadixKey(depth);
+    };
+
+    transparentDraws.clear();
+    auto addDraws = [&](auto const & commands, size_t offset, size_t count, uint32_t batchIndex) {
+        for (size_t i = offset; i < offset + count; ++i) {
+            auto const & command = commands[i];
+            for (uint32_t slot = command.firstInstance; slot < command.firstInstance + command.instanceCount;
+                 ++slot) {
+                transparentDraws.push_back({slotDepthKey(slot), batchIndex, static_cast<uint32_t>(i), slot});
+            }
+        }
+    };
+    for (uint32_t b = 0; b < cameraBatches.size(); ++b) {
+        auto const & batch = cameraBatches[b];
+        if (!isTransparent(batch)) {
+            continue;
+        }
+        addDraws(drawCommands, batch.drawCommandsOffset, batch.drawCommandsCount, b);
+        addDraws(drawIndexedCommands, batch.drawIndexedCommandsOffset, batch.drawIndexedCommandsCount, b);
+    }
+    if (transparentDraws.empty()) {
+        return;
+    }
+    // The sort is stable, so instances at the same depth keep the batch order and can still be merged
+    RadixSort(
+        transparentDraws,
+        transparentDrawsScratch,
+        [](TransparentDraw const & draw) { return draw.depthKey; },
+        jobEngine);
+
+    // Every instance is given a draw command of its own after the existing commands. Consecutive instances from the
+    // same batch share a batch, and consecutive slots of the same command are drawn as one instanced command.
+    auto & sortedBatches = frame.cameraTransparentBatches[camera.id];
+    TransparentDraw const * previous = nullptr;
+    for (auto const & draw : transparentDraws) {
+        auto const & batch = cameraBatches[draw.batchIndex];
+        if (previous == nullptr || previous->batchIndex != draw.batchIndex) {
+            auto & sortedBatch = sortedBatches.emplace_back(batch);
+            sortedBatch.drawCommandsOffset = drawCommands.size();
+            sortedBatch.drawCommandsCount = 0;
+            sortedBatch.drawIndexedCommandsOffset = drawIndexedCommands.size();
+            sortedBatch.drawIndexedCommandsCount = 0;
+        } else if (previous->commandIndex == draw.commandIndex && previous->slot + 1 == draw.slot) {
+            if (batch.indexBuffer != nullptr) {
+                drawIndexedCommands.back().instanceCount++;
+            } else {
+                drawCommands.back().instanceCount++;
+            }
+            previous = &draw;
+            continue;
+        }
+        if (batch.indexBuffer != nullptr) {
+            auto command = drawIndexedCommands[draw.commandIndex];
+            command.firstInstance = draw.slot;
+            command.instanceCount = 1;
+            drawIndexedCommands.push_back(command);
+            sortedBatches.back().drawIndexedCommandsCount++;
+        } else {
+            auto command = drawCommands[draw.commandIndex];
+            command.firstInstance = draw.slot;
+            command.instanceCount = 1;
+            drawCommands.push_back(command);
+            sortedBatches.back().drawCommandsCount++;
+        }
+        previous = &draw;
+    }
+
+    std::erase_if(cameraBatches, isTransparent);
+}
 
-    currFrame.mainCommandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
-                                                 passthroughTransformProgram->GetPipeline());
+void RenderSystem::RebuildStaticMeshBatches()
+{
+    OPTICK_EVENT();
+    staticMeshBatches.clear();
+    staticMeshBatchHasLods.clear();
+    staticMeshDrawCommands.clear();
+    staticMeshDrawIndexedCommands.clear();
+
+    size_t drawCommandsOffset = 0;
+    size_t drawIndexedOffset = 0;
+    MeshBatch currentBatch;
+    currentBatch.vertexSize = sizeof(PackedVertexWithNormal);
+    bool currentBatchHasLods = false;
+    auto finishBatch = [&]() {
+        if (currentBatch.material == nullptr) {
+            return;
+        }
+        currentBatch.drawCommandsOffset = drawCommandsOffset;
+        currentBatch.drawCommandsCount = staticMeshDrawCommands.size() - drawCommandsOffset;
+        currentBatch.drawIndexedCommandsOffset = drawIndexedOffset;
+        currentBatch.drawIndexedCommandsCount = staticMeshDrawIndexedCommands.size() - drawIndexedOffset;
+        if (currentBatch.material->GetAlbedo()->HasTransparency()) {
+            currentBatch.shaderProgram = transparentMeshProgram;
+        } else {
+            currentBatch.shaderProgram = meshProgram;
+        }
+        staticMeshBatches.push_back(currentBatch);
+        staticMeshBatchHasLods.push_back(currentBatchHasLods);
+        drawCommandsOffset = staticMeshDrawCommands.size();
+        drawIndexedOffset = staticMeshDrawIndexedCommands.size();
+        currentBatchHasLods = false;
+    };
+
+    sortedSubmeshInstances.clear();
+    for (auto const & submesh : submeshInstances) {
+        if (GetStaticMeshInstance(submesh.instanceId)->isActive) {
+            sortedSubmeshInstances.push_back(submesh);
+        }
+    }
+    RadixSort(
+        sortedSubmeshInstances,
+        sortedSubmeshInstancesScratch,
+        [](SubmeshInstance const & submesh) { return submesh.sortKey; },
+        jobEngine);
+
+    for (auto & mesh : staticMeshes) {
+        mesh.uniformSlots.clear();
+    }
+    for (size_t slot = 0; slot < sortedSubmeshInstances.size(); ++slot) {
+        auto const & submesh = sortedSubmeshInstances[slot];
+        GetStaticMeshInstance(submesh.instanceId)->uniformSlots.push_back(slot);
+        // Instances of the same submesh are next to each other after sorting, so they can be drawn with one
+        // instanced command since their transforms are in consecutive slots
+        bool isSameSubmesh = slot > 0 && sortedSubmeshInstances[slot - 1].submesh == submesh.submesh;
+
+        if (submesh.submesh->GetMaterial() != currentBatch.material ||
+            submesh.submesh->GetVertexBuffer().GetBuffer() != currentBatch.vertexBuffer ||
+            (submesh.submesh->GetIndexBuffer().has_value() ? submesh.submesh->GetIndexBuffer()->GetBuffer()
+                                                           : nullptr) != currentBatch.indexBuffer ||
+            submesh.submesh->GetIndexType() != currentBatch.indexType) {
+            finishBatch();
+            currentBatch.indexBuffer =
+                (submesh.submesh->GetIndexBuffer().has_value() ? submesh.submesh->GetIndexBuffer()->GetBuffer()
+                                                               : nullptr);
+            currentBatch.indexType = submesh.submesh->GetIndexType();
+            currentBatch.material = submesh.submesh->GetMaterial();
+            currentBatch.vertexBuffer = submesh.submesh->GetVertexBuffer().GetBuffer();
+        }
+        if (submesh.submesh->GetIndexBuffer().has_value()) {
+            if (isSameSubmesh) {
+                staticMeshDrawIndexedCommands.back().instanceCount++;
+                continue;
+            }
+            if (!GetStaticMeshInstance(submesh.instanceId)->mesh->GetLods(submesh.submeshIndex).empty()) {
+                currentBatchHasLods = true;
+            }
+            DrawIndexedIndirectCommand command;
+            command.firstIndex = submesh.submesh->GetIndexBuffer()->GetOffset() / submesh.submesh->GetIndexSize();
+            command.firstInstance = slot;
+            command.indexCount = submesh.submesh->GetNumIndexes();
+            command.instanceCount = 1;
+            command.vertexOffset = submesh.submesh->GetVertexBuffer().GetOffset() / sizeof(PackedVertexWithNormal);
+            staticMeshDrawIndexedCommands.push_back(command);
+        } else {
+            if (isSameSubmesh) {
+                staticMeshDrawCommands.back().instanceCount++;
+                continue;
+            }
+            DrawIndirectCommand command;
+            command.firstInstance = slot;
+            command.firstVertex = submesh.submesh->GetVertexBuffer().GetOffset() / sizeof(PackedVertexWithNormal);
+            command.instanceCount = 1;
+            command.vertexCount = submesh.submesh->GetNumVertices();
+            staticMeshDrawCommands.push_back(command);
+        }
+    }
+    finishBatch();
 
-    currFrame.mainCommandBuffer->CmdBindIndexBuffer(quadEbo, 0, CommandBuffer::IndexType::UINT32);
-    currFrame.mainCommandBuffer->CmdBindVertexBuffer(quadVbo, 0, 0, sizeof(VertexWithColorAndUv));
+    staticMeshBatchesDirty = false;
+    staticMeshBatchesVersion++;
+}
 
-    currFrame.mainCommandBuffer->CmdBindDescriptorSets(passthroughTransformPipelineLayout, 0, {cam.descriptorSet});
+void RenderSystem::DrawMeshBatch(FrameInfo const & frame, MeshBatch const & batch, CommandBuffer * commandBuffer,
+                                 RenderStats & stats)
+{
+    // The indirect buffers are copies of these, so the stats are the same whether multi draw indirect is used or not
+    for (size_t i = 0; i < batch.drawCommandsCount; ++i) {
+        auto const & command = frame.meshDrawCommands[batch.drawCommandsOffset + i];
+        stats.numDraws++;
+        stats.numInstances += command.instanceCount;
+        stats.numTriangles += uint64_t(command.vertexCount / 3) * command.instanceCount;
+    }
+    for (size_t i = 0; i < batch.drawIndexedCommandsCount; ++i) {
+        auto const & command = frame.meshDrawIndexedCommands[batch.drawIndexedCommandsOffset + i];
+        stats.numDraws++;
+        stats.numInstances += command.instanceCount;
+        stats.numTriangles += uint64_t(command.indexCount / 3) * command.instanceCount;
+    }
 
-    for (auto const & sprite : sprites) {
-        if (!sprite.isActive) {
-            continue;
+    if (rendererProperties.SupportsMultiDrawIndirect()) {
+        if (batch.drawCommandsCount > 0) {
+            commandBuffer->CmdDrawIndirect(
+                frame.meshIndirect, batch.drawCommandsOffset * sizeof(DrawIndirectCommand), batch.drawCommandsCount);
+        }
+        if (batch.drawIndexedCommandsCount > 0) {
+            commandBuffer->CmdDrawIndexedIndirect(frame.meshIndexedIndirect,
+                                                            batch.drawIndexedCommandsOffset *
+                                                                sizeof(DrawIndexedIndirectCommand),
+                                                            batch.drawIndexedCommandsCount);
         }
-        currFrame.mainCommandBuffer->CmdBindDescriptorSets(
-            passthroughTransformPipelineLayout, 1, {sprite.descriptorSet});
-        currFrame.mainCommandBuffer->CmdDrawIndexed(6, 1, 0, 0, 0);
+        return;
+    }
+
+    for (size_t i = 0; i < batch.drawCommandsCount; ++i) {
+        auto const & command = frame.meshDrawCommands[batch.drawCommandsOffset + i];
+        commandBuffer->CmdDraw(
+            command.vertexCount, command.instanceCount, command.firstVertex, command.firstInstance);
+    }
+    for (size_t i = 0; i < batch.drawIndexedCommandsCount; ++i) {
+        auto const & command = frame.meshDrawIndexedCommands[batch.drawIndexedCommandsOffset + i];
+        commandBuffer->CmdDrawIndexed(
+            command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+    }
+}
+
+void RenderSystem::RenderSprites(FrameContext & context, CameraInstance const & cam, CommandBuffer * commandBuffer,
+                                 RenderStats & stats)
+{
+    OPTICK_EVENT();
+    commandBuffer->CmdBindPipeline(RenderPassHandle::PipelineBindPoint::GRAPHICS,
+                                   passthroughTransformProgram->GetPipeline());
+    stats.numPipelineBinds++;
+
+    commandBuffer->CmdBindIndexBuffer(quadEbo, 0, CommandBuffer::IndexType::UINT32);
+    commandBuffer->CmdBindVertexBuffer(quadVbo, 0, 0, sizeof(VertexWithColorAndUv));
+
+    commandBuffer->CmdBindDescriptorSets(passthroughTransformPipelineLayout, 0, {cam.descriptorSet});
+    stats.numDescriptorSetBinds++;
+
+    auto const & currFrame = frameInfo[context.currentGpuFrameIndex];
+    for (auto const & batch : currFrame.cameraSpriteBatches[cam.id]) {
+        commandBuffer->CmdBindDescriptorSets(passthroughTransformPipelineLayout, 1, {batch.textureDescriptorSet});
+        // The instance data is bound at the start of the batch instead of using firstInstance since OpenGL does not
+        // add the base instance to the instance index
+        commandBuffer->CmdBindVertexBuffer(currFrame.spriteInstanceBuffer,
+                                           1,
+                                           currFrame.spriteInstanceOffset + batch.firstInstance * sizeof(SpriteGpuData),
+                                           sizeof(SpriteGpuData));
+        commandBuffer->CmdDrawIndexed(6, batch.instanceCount, 0, 0, 0);
+        stats.numDescriptorSetBinds++;
+        stats.numDraws++;
+        stats.numInstances += batch.instanceCount;
+        stats.numTriangles += 2 * batch.instanceCount;
+    }
+}
+
+void RenderSystem::WriteTimestamp(FrameInfo const & frame, CommandBuffer * commandBuffer, GpuTimestamp timestamp)
+{
+    if (frame.timestampQueries) {
+        commandBuffer->CmdWriteTimestamp(frame.timestampQueries, timestamp);
+    }
+}
+
+void RenderSystem::ReadGpuTimings(FrameInfo const & frame, RenderStats & stats)
+{
+    // Only called after the frame's fence has been waited on, so the queries written the last time it was used are
+    // available
+    if (!frame.timestampQueries || !frame.hasWrittenTimestamps) {
+        return;
+    }
+    std::array<uint64_t, NUM_GPU_TIMESTAMPS> timestamps;
+    if (!frame.timestampQueries->GetTimestamps(0, NUM_GPU_TIMESTAMPS, timestamps.data())) {
+        return;
+    }
+    auto millisecondsBetween = [&timestamps](GpuTimestamp start, GpuTimestamp end) {
+        return static_cast<float>(timestamps[end] - timestamps[start]) / 1000000.f;
+    };
+    stats.gpuPrepassMs = millisecondsBetween(TIMESTAMP_FRAME_START, TIMESTAMP_PREPASS_END);
+    stats.gpuMainPassMs = millisecondsBetween(TIMESTAMP_PREPASS_END, TIMESTAMP_MAIN_PASS_END);
+    stats.gpuSsaoPassMs = millisecondsBetween(TIMESTAMP_POSTPROCESS_START, TIMESTAMP_SSAO_END);
+    stats.gpuPostProcessPassMs = millisecondsBetween(TIMESTAMP_SSAO_END, TIMESTAMP_POSTPROCESS_END);
+}
+
+CommandBuffer * RenderSystem::BeginSecondaryCommandBuffer(FrameInfo & frame, RenderPassHandle * renderPass,
+                                                          FramebufferHandle * framebuffer)
+{
+    // Command pools can only be used from one thread at a time, so each job thread has its own allocator
+    auto threadIdx = jobEngine->GetCurrentThreadIndex();
+    auto & commandBuffers = frame.secondaryCommandBuffers[threadIdx];
+    auto & numUsed = frame.numUsedSecondaryCommandBuffers[threadIdx];
+    if (numUsed == commandBuffers.size()) {
+        CommandBufferAllocator::CommandBufferCreateInfo createInfo = {};
+        createInfo.level = CommandBufferLevel::SECONDARY;
+        commandBuffers.push_back(frame.secondaryCommandBufferAllocators[threadIdx]->CreateBuffer(createInfo));
     }
+    auto commandBuffer = commandBuffers[numUsed++];
+
+    CommandBuffer::InheritanceInfo inheritanceInfo = {
+        renderPass, 0, framebuffer, CommandBufferUsageFlagBits::RENDER_PASS_CONTINUE_BIT};
+    commandBuffer->BeginRecording(&inheritanceInfo);
+
+    // Dynamic state is not inherited from the primary command buffer
+    auto res = renderer->GetResolution();
+    CommandBuffer::Viewport viewport = {0.f, 0.f, static_cast<float>(res.x), static_cast<float>(res.y), 0.f, 1.f};
+    commandBuffer->CmdSetViewport(0, 1, &viewport);
+    CommandBuffer::Rect2D scissor = {{0, 0}, {res.x, res.y}};
+    commandBuffer->CmdSetScissor(0, 1, &scissor);
+
+    return commandBuffer;
+}
+
+size_t RenderSystem::GetUniformBufferAlignment() const
+{
+    // 256 is the largest minUniformBufferOffsetAlignment Vulkan allows, so it is safe if the renderer does not know
+    return rendererProperties.GetUniformBufferAlignment() > 0 ? rendererProperties.GetUniformBufferAlignment() : 256;
+}
+
+size_t RenderSystem::GetStorageBufferAlignment() const
+{
+    // 256 is also the largest minStorageBufferOffsetAlignment Vulkan allows
+    return rendererProperties.GetStorageBufferAlignment() > 0 ? rendererProperties.GetStorageBufferAlignment() : 256;
 }
@@ -1,21 +1,28 @@
 ﻿#pragma once
 
 #include <array>
-#include <set>
+#include <mutex>
+#include <span>
+#include <unordered_map>
 #include <vector>
 
 #include <ThirdParty/glm/glm/glm.hpp>
 
 #include "Core/Rendering/CameraInstance.h"
+#include "Core/Rendering/FrameRingAllocator.h"
 #include "Core/Rendering/LightInstance.h"
+#include "Core/Rendering/OcclusionCuller.h"
 #include "Core/Rendering/PreRenderCommands.h"
+#include "Core/Rendering/RenderStatsHistory.h"
 #include "Core/Rendering/SkeletalMeshInstance.h"
 #include "Core/Rendering/SpriteInstance.h"
 #include "Core/Rendering/StaticMeshInstance.h"
 #include "Core/Rendering/SubmeshInstance.h"
 #include "Core/Rendering/UiRenderSystem.h"
 #include "Jobs/JobEngine.h"
+#include "RenderingBackend/Abstract/CommandBuffer.h"
 #include "RenderingBackend/Abstract/RendererConfig.h"
+#include "Util/Future.h"
 
 struct FrameContext;
 class Image;
@@ -24,13 +31,13 @@ class Renderer;
 class ShaderProgram;
 
 struct BufferHandle;
-class CommandBuffer;
 class CommandBufferAllocator;
 struct DescriptorSet;
 struct FenceHandle;
 struct FramebufferHandle;
 struct ImageHandle;
 struct ImageViewHandle;
+struct QueryPoolHandle;
 struct RenderPassHandle;
 class RendererProperties;
 class ResourceCreationContext;
@@ -38,6 +45,8 @@ struct SamplerHandle;
 struct SemaphoreHandle;
 
 int constexpr MAX_SSAO_SAMPLES = 64;
+// Must match the size of the bones uniform in mesh_skeletal.vert and prepass_skeletal.vert
+size_t constexpr MAX_BONES_PER_MESH = 256;
 
 struct DrawIndirectCommand {
     uint32_t vertexCount;
@@ -55,18 +64,24 @@ struct DrawIndexedIndirectCommand {
 };
 
 struct MeshBatch {
-    size_t boneTransformsOffset = 0; // Only used by skeletal mesh
+    uint32_t boneTransformsOffset = 0; // Only used by skeletal mesh, the dynamic offset of boneTransformsDescriptorSet
     size_t vertexSize;
     ShaderProgram * shaderProgram;
     BufferHandle * indexBuffer = nullptr;
+    CommandBuffer::IndexType indexType = CommandBuffer::IndexType::UINT32;
     BufferHandle * vertexBuffer = nullptr;
     Material * material = nullptr;
     size_t drawCommandsOffset;
     size_t drawCommandsCount;
     size_t drawIndexedCommandsOffset;
     size_t drawIndexedCommandsCount;
-    std::vector<DrawIndirectCommand> drawCommands;
-    std::vector<DrawIndexedIndirectCommand> drawIndexedCommands;
+};
+
+// A run of sprite instances using the same texture, drawn with one instanced call
+struct SpriteBatch {
+    DescriptorSet * textureDescriptorSet;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
 };
 
 struct GpuSsaoParameters {
@@ -112,12 +127,26 @@ public:
     SpriteInstanceId CreateSpriteInstance(Image * image, bool isActive = true);
     void DestroySpriteInstance(SpriteInstanceId spriteInstance);
 
-    StaticMeshInstanceId CreateStaticMeshInstance(StaticMesh * mesh, bool isActive = true);
+    StaticMeshInstanceId CreateStaticMeshInstance(StaticMesh * mesh, bool isActive = true, bool isOccluder = false);
     void DestroyStaticMeshInstance(StaticMeshInstanceId staticMesh);
 
     void DebugOverrideBackbuffer(ImageViewHandle * image);
 
+    // The stats of the most recently rendered frames, thread safe
+    inline RenderStatsHistory const & GetStatsHistory() const { return statsHistory; }
+
 private:
+    // The timestamp queries written into each frame's query pool
+    enum GpuTimestamp : uint32_t {
+        TIMESTAMP_FRAME_START,
+        TIMESTAMP_PREPASS_END,
+        TIMESTAMP_MAIN_PASS_END,
+        TIMESTAMP_POSTPROCESS_START,
+        TIMESTAMP_SSAO_END,
+        TIMESTAMP_POSTPROCESS_END,
+        NUM_GPU_TIMESTAMPS,
+    };
+
     struct FrameInfo {
         ImageHandle * prepassDepthImage;
         ImageViewHandle * prepassDepthImageView;
@@ -145,11 +174,36 @@ private:
         SemaphoreHandle * mainRenderPassFinished;
         SemaphoreHandle * postprocessFinished;
 
+        // nullptr if the renderer does not support timestamp queries
+        QueryPoolHandle * timestampQueries = nullptr;
+        // The query results are undefined until the frame has been submitted once
+        bool hasWrittenTimestamps = false;
+
         CommandBufferAllocator * commandBufferAllocator;
+        // Secondary command buffers are recorded on the job threads. Command pools can only be used from one thread at
+        // a time, so these are indexed by JobEngine::GetCurrentThreadIndex.
+        std::vector<CommandBufferAllocator *> secondaryCommandBufferAllocators;
+        std::vector<std::vector<CommandBuffer *>> secondaryCommandBuffers;
+        std::vector<size_t> numUsedSecondaryCommandBuffers;
 
         std::vector<JobId> preRenderJobs;
 
+        // The static mesh batches followed by this frame's skeletal mesh batches
         std::vector<MeshBatch> meshBatches;
+        // meshBatches with the static mesh LODs picked and the occluded instances removed for each camera, indexed by
+        // camera ID. Batches that were changed point at draw commands of their own placed after the skeletal mesh
+        // commands. Does not contain the transparent batches.
+        std::vector<std::vector<MeshBatch>> cameraMeshBatches;
+        // The transparent instances of cameraMeshBatches sorted back to front for each camera, indexed by camera ID.
+        // Consecutive instances from the same batch are merged into one batch.
+        std::vector<std::vector<MeshBatch>> cameraTransparentBatches;
+        // CPU side copies of what was written to meshIndirect and meshIndexedIndirect, used when the renderer does not
+        // support multiDrawIndirect
+        std::vector<DrawIndirectCommand> meshDrawCommands;
+        std::vector<DrawIndexedIndirectCommand> meshDrawIndexedCommands;
+        // The value of RenderSystem::staticMeshBatchesVersion when the static batches were last copied to this frame
+        size_t staticMeshBatchesVersion = 0;
+        std::vector<uint32_t> skeletalMeshBoneOffsets;
 
         // Contains per-mesh uniform info (such as localToWorld matrix)
         size_t meshUniformsSize = 0;
@@ -163,24 +217,21 @@ private:
         BufferHandle * meshIndexedIndirect = nullptr;
         DrawIndexedIndirectCommand * meshIndexedIndirectMapped = nullptr;
 
-        size_t boneTransformsSize = 0;
-        // Maps a desired offset in the boneTransforms buffer to a descriptor set with that offset
-        std::unordered_map<size_t, DescriptorSet *> boneTransformOffsets;
-        BufferHandle * boneTransforms = nullptr;
-        glm::mat4 * boneTransformsMapped = nullptr;
+        // Allocated from transientAllocator, every skeletal mesh batch binds it with its own dynamic offset
+        DescriptorSet * boneTransformsDescriptorSet = nullptr;
 
-        size_t lightsSize;
-        BufferHandle * lights = nullptr;
-        LightGpuData * lightsMapped = nullptr;
+        // Allocated from transientAllocator. Binding 0 holds the lights with lightsOffset as its dynamic offset,
+        // binding 1 holds the light clusters of a camera with lightClusterOffsets[cameraId] as its dynamic offset
         DescriptorSet * lightsDescriptorSet = nullptr;
+        uint32_t lightsOffset = 0;
+        std::vector<uint32_t> lightClusterOffsets;
 
-        size_t debugLinesSize = 0;
-        BufferHandle * debugLines;
-        glm::vec3 * debugLinesMapped = nullptr;
-
-        size_t debugPointsSize = 0;
-        BufferHandle * debugPoints;
-        glm::vec3 * debugPointsMapped = nullptr;
+        // Allocated from transientAllocator, the SpriteGpuData of every active sprite once for each active camera.
+        // Each camera's copy is sorted back to front, and by texture where the depth is the same.
+        BufferHandle * spriteInstanceBuffer = nullptr;
+        size_t spriteInstanceOffset = 0;
+        // Indexed by camera ID
+        std::vector<std::vector<SpriteBatch>> cameraSpriteBatches;
 
         ImageHandle * ssaoOutputImage;
         ImageViewHandle * ssaoOutputImageView;
@@ -202,7 +253,8 @@ private:
     void PostProcessFrame(FrameContext & context);
     void SubmitSwap(FrameContext & context);
 
-    void Prepass(FrameContext & context, std::vector<MeshBatch> const & batches);
+    void Prepass(FrameContext & context, CameraInstance const & camera, std::span<MeshBatch const> batches,
+                 CommandBuffer * commandBuffer, RenderStats & stats);
 
     void PreRenderCameras(FrameContext const & context, std::vector<UpdateCamera> const & cameras);
 
@@ -212,18 +264,36 @@ private:
     void PreRenderSkeletalMeshes(std::vector<UpdateSkeletalMeshInstance> const & meshes);
 
     void PreRenderSprites(FrameContext const & context, std::vector<UpdateSpriteInstance> const & sprites);
-    void RenderSprites(FrameContext & context, CameraInstance const & camera);
+    void RenderSprites(FrameContext & context, CameraInstance const & camera, CommandBuffer * commandBuffer,
+                       RenderStats & stats);
 
     void PreRenderMeshes(FrameContext const & context, std::vector<UpdateStaticMeshInstance> const & meshes);
-    void RenderMeshes(FrameContext & context, CameraInstance const & camera, std::vector<MeshBatch> const & batches);
+    void RenderMeshes(FrameContext & context, CameraInstance const & camera, std::span<MeshBatch const> batches,
+                      CommandBuffer * commandBuffer, RenderStats & stats);
     void RenderTransparentMeshes(FrameContext & context, CameraInstance const & camera,
-                                 std::vector<MeshBatch> const & batches);
+                                 std::span<MeshBatch const> batches, CommandBuffer * commandBuffer,
+                                 RenderStats & stats);
 
     void PreRenderSSAO(FrameContext const & context);
 
     void RenderDebugDraws(FrameContext & context, CameraInstance const & camera);
 
     void CreateBatches(FrameContext & context);
+    void RebuildStaticMeshBatches();
+    void CullStaticMeshes();
+    void BuildCameraMeshBatches(FrameInfo & frame, std::vector<DrawIndirectCommand> & drawCommands,
+                                std::vector<DrawIndexedIndirectCommand> & drawIndexedCommands);
+    void SortTransparentMeshBatches(FrameInfo & frame, CameraInstance const & camera,
+                                    std::span<glm::vec3 const> skeletalMeshPositions,
+                                    std::vector<DrawIndirectCommand> & drawCommands,
+                                    std::vector<DrawIndexedIndirectCommand> & drawIndexedCommands);
+    void DrawMeshBatch(FrameInfo const & frame, MeshBatch const & batch, CommandBuffer * commandBuffer,
+                       RenderStats & stats);
+    // Does nothing if the renderer does not support timestamp queries
+    void WriteTimestamp(FrameInfo const & frame, CommandBuffer * commandBuffer, GpuTimestamp timestamp);
+    void ReadGpuTimings(FrameInfo const & frame, RenderStats & stats);
+    CommandBuffer * BeginSecondaryCommandBuffer(FrameInfo & frame, RenderPassHandle * renderPass,
+                                                FramebufferHandle * framebuffer);
 
     std::vector<FrameInfo> frameInfo;
 
@@ -287,10 +357,41 @@ private:
     // lights
     std::vector<LightInstance> lights;
     LightInstance * GetLight(LightInstanceId);
+    // The light indexes of each cluster of each active camera, reused between frames to avoid reallocating
+    std::vector<std::vector<uint32_t>> lightClusterLists;
 
     // sprites
     std::vector<SpriteInstance> sprites;
     SpriteInstance * GetSpriteInstance(SpriteInstanceId);
+    // Every image view used by a sprite gets one descriptor set which is shared by all sprites using it. Sprites with
+    // images in the same texture atlas page use the same view.
+    std::unordered_map<ImageViewHandle const *, uint32_t> spriteTextureIds;
+    std::vector<DescriptorSet *> spriteTextureDescriptorSets;
+    // Indexes in spriteTextureDescriptorSets whose descriptor set has been destroyed, reused before growing it
+    std::vector<uint32_t> freeSpriteTextureIds;
+    Future<DescriptorSet *> CreateSpriteDescriptorSet(ImageViewHandle * imageView);
+    // Destroys the descriptor set of the view if it has one. Must be called before the view could be replaced by a new
+    // view at the same address.
+    void DestroySpriteTexture(ImageViewHandle const * view);
+#if HOT_RELOAD_RESOURCES
+    // The default view of every image a sprite descriptor set was created for, nullptr after the set was destroyed.
+    // Every image in here is subscribed to, since reloading an image destroys its previous default view.
+    std::unordered_map<Image *, ImageViewHandle const *> spriteImageViews;
+    // Filled by the hot reload callbacks and emptied by PreRenderSprites
+    std::mutex reloadedSpriteImagesLock;
+    std::vector<Image *> reloadedSpriteImages;
+#endif
+    struct SortedSprite {
+        uint32_t textureId;
+        uint32_t spriteIdx;
+        glm::vec4 uvRect;
+        // Only set in depthSortedSprites
+        uint32_t depthKey;
+    };
+    std::vector<SortedSprite> sortedSprites;
+    std::vector<SortedSprite> sortedSpritesScratch;
+    // sortedSprites sorted back to front for one camera at a time
+    std::vector<SortedSprite> depthSortedSprites;
 
     // skeletal meshes
     std::vector<SkeletalMeshInstance> skeletalMeshes;
@@ -303,9 +404,45 @@ private:
     void UpdateAnimation(SkeletalMeshInstance * instance, float dt);
 
     // static meshes
-    std::set<SubmeshInstance, SubmeshInstanceComparer> sortedSubmeshInstances;
     std::vector<StaticMeshInstance> staticMeshes;
     StaticMeshInstance * GetStaticMeshInstance(StaticMeshInstanceId);
+    uint64_t CreateSubmeshSortKey(Submesh const * submesh);
+    // Unsorted so that removal can swap in the last element, StaticMeshInstance::submeshInstances holds the indexes
+    std::vector<SubmeshInstance> submeshInstances;
+    // The active submesh instances sorted by key, only rebuilt together with the static mesh batches
+    std::vector<SubmeshInstance> sortedSubmeshInstances;
+    std::vector<SubmeshInstance> sortedSubmeshInstancesScratch;
+    std::unordered_map<void const *, uint32_t> materialSortIds;
+    std::unordered_map<void const *, uint32_t> bufferSortIds;
+    std::unordered_map<void const *, uint32_t> submeshSortIds;
+    void MarkStaticMeshTransformDirty(StaticMeshInstance * instance);
+    // The static mesh batches are only rebuilt when an instance is created, destroyed or toggled.
+    bool staticMeshBatchesDirty = true;
+    size_t staticMeshBatchesVersion = 0;
+    std::vector<MeshBatch> staticMeshBatches;
+    // Whether any submesh drawn by the static mesh batch at the same index has LODs
+    std::vector<bool> staticMeshBatchHasLods;
+    std::vector<DrawIndirectCommand> staticMeshDrawCommands;
+    std::vector<DrawIndexedIndirectCommand> staticMeshDrawIndexedCommands;
+    // Instances that have a localToWorld which has not been uploaded to every frame yet
+    std::vector<StaticMeshInstanceId> dirtyStaticMeshTransforms;
+    // One instance of a transparent mesh batch drawn by one camera
+    struct TransparentDraw {
+        uint32_t depthKey;
+        // Index into the camera's mesh batches
+        uint32_t batchIndex;
+        // Index into the draw commands, or the indexed draw commands if the batch has an index buffer
+        uint32_t commandIndex;
+        // The instance's slot in meshUniforms
+        uint32_t slot;
+    };
+    std::vector<TransparentDraw> transparentDraws;
+    std::vector<TransparentDraw> transparentDrawsScratch;
+
+    // occlusion culling
+    OcclusionCuller occlusionCuller;
+    // Indexed by camera ID and then by static mesh instance ID. Empty for cameras that were not culled this frame.
+    std::vector<std::vector<bool>> cameraStaticMeshVisibility;
 
     // SSAO
     ImageHandle * ssaoNoiseImage;
@@ -316,9 +453,15 @@ private:
     JobEngine * jobEngine;
     Renderer * renderer;
     RendererProperties const & rendererProperties;
+    // Per-frame data that is rewritten every frame is bump allocated from here
+    FrameRingAllocator transientAllocator;
+    size_t GetUniformBufferAlignment() const;
+    size_t GetStorageBufferAlignment() const;
     UiRenderSystem uiRenderSystem;
     ParticleSystem * particleSystem;
 
+    RenderStatsHistory statsHistory;
+
     // Options
     DescriptorSet * backbufferOverride = nullptr;
     std::optional<RendererConfig> queuedConfigUpdate;
@@ -2,6 +2,7 @@
 
 #include "Console/Console.h"
 #include "Core/Rendering/DebugDrawSystem.h"
+#include "Core/Rendering/OcclusionCullerBenchmark.h"
 #include "Core/Resources/ResourceManager.h"
 #include "Core/Resources/ShaderProgram.h"
 #include "Core/physicsworld.h"
@@ -12,8 +13,14 @@
 
 static const auto logger = Logger::Create("RenderSystem");
 
+static constexpr size_t INITIAL_TRANSIENT_BUFFER_SIZE = 1024 * 1024;
+
 RenderSystem::RenderSystem(Renderer * renderer, ParticleSystem * particleSystem)
     : jobEngine(JobEngine::GetInstance()), renderer(renderer), rendererProperties(renderer->GetProperties()),
+      transientAllocator(renderer,
+                         BufferUsageFlags::UNIFORM_BUFFER_BIT | BufferUsageFlags::STORAGE_BUFFER_BIT |
+                             BufferUsageFlags::VERTEX_BUFFER_BIT,
+                         INITIAL_TRANSIENT_BUFFER_SIZE),
       particleSystem(particleSystem), uiRenderSystem(renderer)
 {
     CommandDefinition backbufferOverrideCommand(
@@ -81,6 +88,38 @@ RenderSystem::RenderSystem(Renderer * renderer, ParticleSystem * particleSystem)
         });
     Console::RegisterCommand(presentModeCommand);
 
+    CommandDefinition statsDumpCommand(
+        "render_stats_dump",
+        "render_stats_dump <file> - write percentiles of the render stats of the last "
+        "frames to the given CSV file",
+        1,
+        [this](auto args) {
+            auto path = args[0];
+            if (!statsHistory.WritePercentilesCsv(path)) {
+                logger.Error("Could not write render stats to '{}'", path);
+                return;
+            }
+            logger.Info("Wrote render stats to '{}'", path);
+        });
+    Console::RegisterCommand(statsDumpCommand);
+
+    CommandDefinition occlusionBenchmarkCommand(
+        "occlusion_culler_benchmark",
+        "occlusion_culler_benchmark <iterations> - check the CPU occlusion culler against a synthetic scene with known "
+        "results and log how long rasterizing and testing took on average",
+        1,
+        [this](auto args) {
+            auto iterations = std::strtol(args[0].c_str(), nullptr, 0);
+            if (iterations <= 0) {
+                logger.Error("iterations {} is not a positive number", args[0]);
+                return;
+            }
+            if (!RunOcclusionCullerBenchmark(jobEngine, (uint32_t)iterations)) {
+                logger.Error("The occlusion culler got some boxes wrong, see the log above");
+            }
+        });
+    Console::RegisterCommand(occlusionBenchmarkCommand);
+
     RenderSystem::instance = this;
 }
 
@@ -382,6 +421,12 @@ void RenderSystem::InitSwapchainResources()
             if (fi.commandBufferAllocator) {
                 ctx.DestroyCommandBufferAllocator(fi.commandBufferAllocator);
             }
+            for (size_t i = 0; i < fi.secondaryCommandBufferAllocators.size(); ++i) {
+                for (auto commandBuffer : fi.secondaryCommandBuffers[i]) {
+                    fi.secondaryCommandBufferAllocators[i]->DestroyContext(commandBuffer);
+                }
+                ctx.DestroyCommandBufferAllocator(fi.secondaryCommandBufferAllocators[i]);
+            }
             if (fi.canStartFrame) {
                 ctx.DestroyFence(fi.canStartFrame);
             }
@@ -397,6 +442,9 @@ void RenderSystem::InitSwapchainResources()
             if (fi.postprocessFinished) {
                 ctx.DestroySemaphore(fi.postprocessFinished);
             }
+            if (fi.timestampQueries) {
+                ctx.DestroyQueryPool(fi.timestampQueries);
+            }
         }
 
         auto backbuffers = renderer->GetBackbuffers();
@@ -407,11 +455,20 @@ void RenderSystem::InitSwapchainResources()
         frameInfo.resize(renderer->GetSwapCount());
         for (size_t i = 0; i < frameInfo.size(); ++i) {
             frameInfo[i].commandBufferAllocator = ctx.CreateCommandBufferAllocator();
+            // One more than the number of job threads since the main thread is also registered with the JobEngine
+            for (uint32_t thread = 0; thread < jobEngine->GetNumThreads() + 1; ++thread) {
+                frameInfo[i].secondaryCommandBufferAllocators.push_back(ctx.CreateCommandBufferAllocator());
+            }
+            frameInfo[i].secondaryCommandBuffers.resize(frameInfo[i].secondaryCommandBufferAllocators.size());
+            frameInfo[i].numUsedSecondaryCommandBuffers.resize(frameInfo[i].secondaryCommandBufferAllocators.size());
             frameInfo[i].canStartFrame = ctx.CreateFence(true);
             frameInfo[i].framebufferReady = ctx.CreateSemaphore();
             frameInfo[i].preRenderPassFinished = ctx.CreateSemaphore();
             frameInfo[i].mainRenderPassFinished = ctx.CreateSemaphore();
             frameInfo[i].postprocessFinished = ctx.CreateSemaphore();
+            if (rendererProperties.SupportsTimestampQueries()) {
+                frameInfo[i].timestampQueries = ctx.CreateTimestampQueryPool(NUM_GPU_TIMESTAMPS);
+            }
 
             frameInfo[i].backbuffer = backbuffers[i];
             frameInfo[i].preRenderPassCommandBuffer = frameInfo[i].commandBufferAllocator->CreateBuffer(ctxCreateInfo);
@@ -1,12 +1,143 @@
 #include "RenderSystem.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
 #include <ThirdParty/optick/src/optick.h>
 
 #include "Core/FrameContext.h"
+#include "Jobs/JobEngine.h"
 #include "RenderingBackend/Abstract/RenderResources.h"
 #include "RenderingBackend/Abstract/ResourceCreationContext.h"
+#include "Util/Semaphore.h"
+
+// The lights and cluster buffers are bound with a fixed range, so their sizes are rounded up to a power of two to keep
+// the number of distinct descriptor sets low
+static constexpr size_t MIN_LIGHT_BUFFER_RANGE = 4096;
+
+// The view space ray through a corner of a cluster tile, as the points where it crosses the near and far planes
+struct TileCornerRay {
+    glm::vec3 nearPoint;
+    glm::vec3 farPoint;
+};
+
+struct LightClusterFrustum {
+    LightClusterGpuHeader header;
+    std::array<TileCornerRay, (LIGHT_CLUSTERS_X + 1) * (LIGHT_CLUSTERS_Y + 1)> cornerRays;
+    // xyz: view space position, w: radius
+    std::vector<glm::vec4> viewSpaceLights;
+};
+
+static glm::vec3 Unproject(glm::mat4 const & inverseProjection, glm::vec3 ndc)
+{
+    glm::vec4 p = inverseProjection * glm::vec4(ndc, 1.f);
+    return glm::vec3(p) / p.w;
+}
+
+static glm::vec3 PointAtDepth(TileCornerRay const & ray, float depth)
+{
+    float nearDepth = -ray.nearPoint.z;
+    float farDepth = -ray.farPoint.z;
+    return glm::mix(ray.nearPoint, ray.farPoint, (depth - nearDepth) / (farDepth - nearDepth));
+}
+
+// Must match GetLightCluster in Lights.glsl
+static float SliceDepth(glm::vec4 const & depthParams, uint32_t slice)
+{
+    if (depthParams.w > 0.f) {
+        return depthParams.x * std::exp(slice / depthParams.z);
+    }
+    return depthParams.x + slice / depthParams.z;
+}
+
+static bool SphereIntersectsAabb(glm::vec3 center, float radius, glm::vec3 min, glm::vec3 max)
+{
+    glm::vec3 closest = glm::clamp(center, min, max);
+    glm::vec3 d = center - closest;
+    return glm::dot(d, d) <= radius * radius;
+}
+
+static LightClusterFrustum CreateLightClusterFrustum(CameraInstance const & camera,
+                                                     std::vector<LightGpuData> const & lights)
+{
+    LightClusterFrustum ret;
+    ret.header.view = camera.view;
+    ret.header.projection = camera.projection;
+
+    auto inverseProjection = glm::inverse(camera.projection);
+    bool isPerspective = camera.projection[2][3] != 0.f;
+    float nearDepth = -Unproject(inverseProjection, glm::vec3(0.f, 0.f, 0.f)).z;
+    float farDepth = -Unproject(inverseProjection, glm::vec3(0.f, 0.f, 1.f)).z;
+    if (isPerspective) {
+        ret.header.depthParams = {nearDepth, farDepth, LIGHT_CLUSTERS_Z / std::log(farDepth / nearDepth), 1.f};
+    } else {
+        ret.header.depthParams = {nearDepth, farDepth, LIGHT_CLUSTERS_Z / (farDepth - nearDepth), 0.f};
+    }
+
+    for (uint32_t y = 0; y <= LIGHT_CLUSTERS_Y; ++y) {
+        for (uint32_t x = 0; x <= LIGHT_CLUSTERS_X; ++x) {
+            glm::vec2 ndc(2.f * x / LIGHT_CLUSTERS_X - 1.f, 2.f * y / LIGHT_CLUSTERS_Y - 1.f);
+            ret.cornerRays[x + y * (LIGHT_CLUSTERS_X + 1)] = {Unproject(inverseProjection, glm::vec3(ndc, 0.f)),
+                                                              Unproject(inverseProjection, glm::vec3(ndc, 1.f))};
+        }
+    }
+
+    ret.viewSpaceLights.reserve(lights.size());
+    for (auto const & light : lights) {
+        glm::vec4 viewPosition = camera.view * glm::vec4(glm::vec3(light.positionAndRadius), 1.f);
+        ret.viewSpaceLights.push_back(glm::vec4(glm::vec3(viewPosition), light.positionAndRadius.w));
+    }
+    return ret;
+}
 
-constexpr size_t MAX_LIGHTS = 512;
+// Appends the index of every light touching a cluster in slice to that cluster's list. clusterLists is indexed by
+// cluster index, and different slices never touch the same lists so slices can be binned in parallel.
+static void BinLightsInSlice(LightClusterFrustum const & frustum, uint32_t slice,
+                             std::vector<uint32_t> * clusterLists)
+{
+    float sliceNear = SliceDepth(frustum.header.depthParams, slice);
+    float sliceFar = SliceDepth(frustum.header.depthParams, slice + 1);
+
+    struct Aabb {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+    std::array<Aabb, LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y> tileBounds;
+    for (uint32_t y = 0; y < LIGHT_CLUSTERS_Y; ++y) {
+        for (uint32_t x = 0; x < LIGHT_CLUSTERS_X; ++x) {
+            Aabb bounds = {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+            for (uint32_t corner = 0; corner < 4; ++corner) {
+                uint32_t cornerX = x + (corner & 1);
+                uint32_t cornerY = y + (corner >> 1);
+                auto const & ray = frustum.cornerRays[cornerX + cornerY * (LIGHT_CLUSTERS_X + 1)];
+                for (float depth : {sliceNear, sliceFar}) {
+                    glm::vec3 p = PointAtDepth(ray, depth);
+                    bounds.min = glm::min(bounds.min, p);
+                    bounds.max = glm::max(bounds.max, p);
+                }
+            }
+            tileBounds[x + y * LIGHT_CLUSTERS_X] = bounds;
+        }
+    }
+
+    uint32_t const sliceStart = slice * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y;
+    for (uint32_t lightIdx = 0; lightIdx < frustum.viewSpaceLights.size(); ++lightIdx) {
+        auto const & light = frustum.viewSpaceLights[lightIdx];
+        float depth = -light.z;
+        if (depth + light.w < sliceNear || depth - light.w > sliceFar) {
+            continue;
+        }
+        for (uint32_t tile = 0; tile < tileBounds.size(); ++tile) {
+            if (SphereIntersectsAabb(glm::vec3(light), light.w, tileBounds[tile].min, tileBounds[tile].max)) {
+                clusterLists[sliceStart + tile].push_back(lightIdx);
+            }
+        }
+    }
+}
 
 LightInstanceId RenderSystem::CreatePointLightInstance(bool isActive, glm::vec3 color)
 {
@@ -47,56 +178,95 @@ void RenderSystem::PreRenderLights(std::vector<UpdateLight> const & updates)
 void RenderSystem::UpdateLights(FrameContext const & context)
 {
     OPTICK_EVENT();
-    if (lights.size() == 0) {
-        return;
+    auto & currFrame = frameInfo[context.currentGpuFrameIndex];
+
+    // Only lights which can contribute anything are uploaded, the index of a light in the cluster lists is its index in
+    // activeLights
+    std::vector<LightGpuData> activeLights;
+    for (auto const & light : lights) {
+        float maxIntensity = std::max({light.color.r, light.color.g, light.color.b});
+        if (!light.isActive || maxIntensity <= LIGHT_CUTOFF_INTENSITY) {
+            continue;
+        }
+        float radius = std::sqrt(maxIntensity / LIGHT_CUTOFF_INTENSITY - 1.f);
+        activeLights.push_back({glm::vec4(glm::vec3(light.localToWorld[3]), radius), glm::vec4(light.color, 0.f)});
     }
 
-    auto & currFrame = frameInfo[context.currentGpuFrameIndex];
+    std::vector<CameraInstanceId> activeCameras;
+    std::vector<LightClusterFrustum> frustums;
+    for (auto const & camera : cameras) {
+        if (camera.isActive) {
+            activeCameras.push_back(camera.id);
+            frustums.push_back(CreateLightClusterFrustum(camera, activeLights));
+        }
+    }
 
-    if (currFrame.lightsMapped == nullptr) {
-        Semaphore sem;
-        this->CreateResources([this, &sem, &currFrame](ResourceCreationContext & ctx) {
-            if (currFrame.lights) {
-                ctx.UnmapBuffer(currFrame.lights);
-                ctx.DestroyBuffer(currFrame.lights);
-                ctx.DestroyDescriptorSet(currFrame.lightsDescriptorSet);
-            }
-            currFrame.lightsSize = MAX_LIGHTS * sizeof(LightGpuData);
-            {
-                ResourceCreationContext::BufferCreateInfo ci;
-                ci.size = currFrame.lightsSize;
-                ci.memoryProperties =
-                    MemoryPropertyFlagBits::HOST_VISIBLE_BIT | MemoryPropertyFlagBits::HOST_COHERENT_BIT;
-                ci.usage = BufferUsageFlags::UNIFORM_BUFFER_BIT;
-                currFrame.lights = ctx.CreateBuffer(ci);
-            }
-            {
-                ResourceCreationContext::DescriptorSetCreateInfo::BufferDescriptor uniformDescriptor = {
-                    currFrame.lights, 0, currFrame.lightsSize};
-                ResourceCreationContext::DescriptorSetCreateInfo::Descriptor descriptor[1] = {
-                    {DescriptorType::UNIFORM_BUFFER, 0, uniformDescriptor}};
-                ResourceCreationContext::DescriptorSetCreateInfo ci;
-                ci.descriptorCount = 1;
-                ci.descriptors = descriptor;
-                ci.layout = this->lightsLayout;
-                currFrame.lightsDescriptorSet = ctx.CreateDescriptorSet(ci);
+    lightClusterLists.resize(frustums.size() * LIGHT_CLUSTER_COUNT);
+    for (auto & list : lightClusterLists) {
+        list.clear();
+    }
+    if (activeLights.size() > 0 && frustums.size() > 0) {
+        OPTICK_EVENT("BinLights");
+        std::vector<JobId> sliceJobs;
+        for (size_t i = 0; i < frustums.size(); ++i) {
+            for (uint32_t slice = 0; slice < LIGHT_CLUSTERS_Z; ++slice) {
+                auto sliceJob = jobEngine->CreateJob({}, [this, &frustums, i, slice]() {
+                    OPTICK_EVENT("BinLightsInSlice");
+                    BinLightsInSlice(frustums[i], slice, &lightClusterLists[i * LIGHT_CLUSTER_COUNT]);
+                });
+                jobEngine->ScheduleJob(sliceJob, JobPriority::HIGH);
+                sliceJobs.push_back(sliceJob);
             }
+        }
+        Semaphore done;
+        auto gatherJob = jobEngine->CreateJob(sliceJobs, [&done]() { done.Signal(); });
+        jobEngine->ScheduleJob(gatherJob, JobPriority::HIGH);
+        done.Wait();
+    }
 
-            currFrame.lightsMapped = (LightGpuData *)ctx.MapBuffer(currFrame.lights, 0, currFrame.lightsSize);
+    size_t const clusterTableSize = sizeof(LightClusterGpuHeader) + LIGHT_CLUSTER_COUNT * sizeof(glm::uvec2);
+    size_t maxIndexCount = 0;
+    for (size_t i = 0; i < frustums.size(); ++i) {
+        size_t indexCount = 0;
+        for (size_t cluster = 0; cluster < LIGHT_CLUSTER_COUNT; ++cluster) {
+            indexCount += lightClusterLists[i * LIGHT_CLUSTER_COUNT + cluster].size();
+        }
+        maxIndexCount = std::max(maxIndexCount, indexCount);
+    }
 
-            sem.Signal();
-        });
-        sem.Wait();
+    // Everything goes into one allocation so both bindings are guaranteed to be in the same buffer. The lights come
+    // first followed by the cluster data of each camera.
+    size_t lightsRange = std::bit_ceil(std::max(MIN_LIGHT_BUFFER_RANGE, activeLights.size() * sizeof(LightGpuData)));
+    size_t clustersRange =
+        std::bit_ceil(std::max(MIN_LIGHT_BUFFER_RANGE, clusterTableSize + maxIndexCount * sizeof(uint32_t)));
+    auto allocation =
+        transientAllocator.Allocate(lightsRange + frustums.size() * clustersRange, GetStorageBufferAlignment());
+    currFrame.lightsDescriptorSet = transientAllocator.GetDescriptorSet(
+        allocation.buffer,
+        lightsLayout,
+        {{DescriptorType::STORAGE_BUFFER_DYNAMIC, lightsRange},
+         {DescriptorType::STORAGE_BUFFER_DYNAMIC, clustersRange}});
+    currFrame.lightsOffset = static_cast<uint32_t>(allocation.offset);
+    if (activeLights.size() > 0) {
+        memcpy(allocation.ptr, activeLights.data(), activeLights.size() * sizeof(LightGpuData));
     }
 
-    for (size_t i = 0; i < MAX_LIGHTS; ++i) {
-        if (lights.size() <= i) {
-            currFrame.lightsMapped[i].isActive = 0;
-        } else {
-            auto const & light = lights[i];
-            currFrame.lightsMapped[i].isActive = light.isActive ? 1 : 0;
-            currFrame.lightsMapped[i].color = light.color;
-            currFrame.lightsMapped[i].localToWorld = light.localToWorld;
+    // Cameras without cluster data point at the lights, they are not drawn this frame anyway
+    currFrame.lightClusterOffsets.assign(cameras.size(), currFrame.lightsOffset);
+    for (size_t i = 0; i < frustums.size(); ++i) {
+        size_t clustersOffset = lightsRange + i * clustersRange;
+        currFrame.lightClusterOffsets[activeCameras[i]] = static_cast<uint32_t>(allocation.offset + clustersOffset);
+
+        auto clustersMapped = allocation.ptr + clustersOffset;
+        memcpy(clustersMapped, &frustums[i].header, sizeof(LightClusterGpuHeader));
+        auto rangesMapped = (glm::uvec2 *)(clustersMapped + sizeof(LightClusterGpuHeader));
+        auto indexesMapped = (uint32_t *)(clustersMapped + clusterTableSize);
+        uint32_t indexOffset = 0;
+        for (uint32_t cluster = 0; cluster < LIGHT_CLUSTER_COUNT; ++cluster) {
+            auto const & list = lightClusterLists[i * LIGHT_CLUSTER_COUNT + cluster];
+            rangesMapped[cluster] = glm::uvec2(indexOffset, static_cast<uint32_t>(list.size()));
+            std::copy(list.begin(), list.end(), indexesMapped + indexOffset);
+            indexOffset += static_cast<uint32_t>(list.size());
         }
     }
 }
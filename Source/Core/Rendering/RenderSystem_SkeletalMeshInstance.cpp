@@ -25,6 +25,13 @@ SkeletalMeshInstanceId RenderSystem::CreateSkeletalMeshInstance(SkeletalMesh * m
     instance.isActive = isActive;
     instance.mesh = mesh;
 
+    if (mesh->GetBones().size() > MAX_BONES_PER_MESH) {
+        logger.Warn("Skeletal mesh '{}' has {} bones but only {} will be uploaded",
+                    mesh->GetName(),
+                    mesh->GetBones().size(),
+                    MAX_BONES_PER_MESH);
+    }
+
     for (auto const & bone : mesh->GetBones()) {
         SkeletalBoneInstance instance;
         instance.bone = &bone;
@@ -1,47 +1,29 @@
 #include "RenderSystem.h"
 
-#include <ThirdParty/glm/glm/gtc/type_ptr.hpp>
 #include <ThirdParty/optick/src/optick.h>
 
 #include "Core/FrameContext.h"
+#include "Core/Rendering/TextureAtlas.h"
 #include "Core/Resources/Image.h"
 #include "Core/Resources/ResourceManager.h"
 #include "RenderingBackend/Abstract/RenderResources.h"
 #include "RenderingBackend/Abstract/ResourceCreationContext.h"
-#include "Util/Semaphore.h"
+#include "RenderingBackend/Renderer.h"
+#include "Util/Future.h"
+#include "Util/RadixSort.h"
 
 SpriteInstanceId RenderSystem::CreateSpriteInstance(Image * image, bool isActive)
 {
+    // Only images used by sprites go in the atlas, most other images are never drawn in a way that could use it
+    if (image != nullptr) {
+        image->AddToAtlas();
+    }
     sprites.emplace_back();
     auto id = sprites.size() - 1;
     sprites[id].id = id;
+    sprites[id].image = image;
+    sprites[id].localToWorld = glm::mat4(1.f);
     sprites[id].isActive = isActive;
-
-    Semaphore sem;
-    this->CreateResources([this, &sem, id, image](ResourceCreationContext & ctx) {
-        auto layout =
-            ResourceManager::GetResource<DescriptorSetLayoutHandle>("_Primitives/DescriptorSetLayouts/spritePt.layout");
-        this->sprites[id].uniformBuffer =
-            ctx.CreateBuffer({sizeof(glm::mat4),
-                              BufferUsageFlags::UNIFORM_BUFFER_BIT | BufferUsageFlags::TRANSFER_DST_BIT,
-                              DEVICE_LOCAL_BIT});
-
-        ResourceCreationContext::DescriptorSetCreateInfo::BufferDescriptor uvDescriptor = {
-            this->sprites[id].uniformBuffer, 0, sizeof(glm::mat4)};
-
-        auto sampler = ResourceManager::GetResource<SamplerHandle>("_Primitives/Samplers/Default.sampler");
-
-        ResourceCreationContext::DescriptorSetCreateInfo::ImageDescriptor imgDescriptor = {sampler,
-                                                                                           image->GetDefaultView()};
-
-        ResourceCreationContext::DescriptorSetCreateInfo::Descriptor descriptors[] = {
-            {DescriptorType::UNIFORM_BUFFER, 0, uvDescriptor},
-            {DescriptorType::COMBINED_IMAGE_SAMPLER, 1, imgDescriptor}};
-
-        this->sprites[id].descriptorSet = ctx.CreateDescriptorSet({2, descriptors, layout});
-        sem.Signal();
-    });
-    sem.Wait();
     return id;
 }
 
@@ -49,12 +31,6 @@ void RenderSystem::DestroySpriteInstance(SpriteInstanceId spriteInstance)
 {
     auto sprite = GetSpriteInstance(spriteInstance);
     sprite->isActive = false;
-    auto descriptorSet = sprite->descriptorSet;
-    auto uniforms = sprite->uniformBuffer;
-    this->DestroyResources([descriptorSet, uniforms](ResourceCreationContext & ctx) {
-        ctx.DestroyDescriptorSet(descriptorSet);
-        ctx.DestroyBuffer(uniforms);
-    });
 }
 
 SpriteInstance * RenderSystem::GetSpriteInstance(SpriteInstanceId id)
@@ -62,6 +38,35 @@ SpriteInstance * RenderSystem::GetSpriteInstance(SpriteInstanceId id)
     return &sprites[id];
 }
 
+Future<DescriptorSet *> RenderSystem::CreateSpriteDescriptorSet(ImageViewHandle * imageView)
+{
+    return renderer->CreateResourcesAsync([imageView](ResourceCreationContext & ctx) {
+        auto layout =
+            ResourceManager::GetResource<DescriptorSetLayoutHandle>("_Primitives/DescriptorSetLayouts/spritePt.layout");
+        auto sampler = ResourceManager::GetResource<SamplerHandle>("_Primitives/Samplers/Default.sampler");
+
+        ResourceCreationContext::DescriptorSetCreateInfo::ImageDescriptor imgDescriptor = {sampler, imageView};
+
+        ResourceCreationContext::DescriptorSetCreateInfo::Descriptor descriptors[] = {
+            {DescriptorType::COMBINED_IMAGE_SAMPLER, 0, imgDescriptor}};
+
+        return ctx.CreateDescriptorSet({1, descriptors, layout});
+    });
+}
+
+void RenderSystem::DestroySpriteTexture(ImageViewHandle const * view)
+{
+    auto it = spriteTextureIds.find(view);
+    if (it == spriteTextureIds.end()) {
+        return;
+    }
+    auto descriptorSet = spriteTextureDescriptorSets[it->second];
+    spriteTextureDescriptorSets[it->second] = nullptr;
+    freeSpriteTextureIds.push_back(it->second);
+    spriteTextureIds.erase(it);
+    this->DestroyResources([descriptorSet](ResourceCreationContext & ctx) { ctx.DestroyDescriptorSet(descriptorSet); });
+}
+
 void RenderSystem::PreRenderSprites(FrameContext const & context, std::vector<UpdateSpriteInstance> const & sprites)
 {
     OPTICK_EVENT();
@@ -70,34 +75,140 @@ void RenderSystem::PreRenderSprites(FrameContext const & context, std::vector<Up
     for (auto const & sprite : sprites) {
         auto spriteInstance = GetSpriteInstance(sprite.spriteInstance);
         spriteInstance->isActive = sprite.isActive;
-        currFrame.preRenderPassCommandBuffer->CmdUpdateBuffer(
-            spriteInstance->uniformBuffer, 0, sizeof(glm::mat4), (uint32_t *)glm::value_ptr(sprite.localToWorld));
+        spriteInstance->localToWorld = sprite.localToWorld;
         if (sprite.newImage) {
-            auto oldDescriptorSet = spriteInstance->descriptorSet;
-            Semaphore sem;
-            this->CreateResources([spriteInstance, &sprite, &sem](ResourceCreationContext & ctx) {
-                ResourceCreationContext::DescriptorSetCreateInfo::BufferDescriptor uvDescriptor = {
-                    spriteInstance->uniformBuffer, 0, sizeof(glm::mat4)};
-
-                auto layout = ResourceManager::GetResource<DescriptorSetLayoutHandle>(
-                    "_Primitives/DescriptorSetLayouts/spritePt.layout");
-                auto sampler = ResourceManager::GetResource<SamplerHandle>("_Primitives/Samplers/Default.sampler");
-
-                ResourceCreationContext::DescriptorSetCreateInfo::ImageDescriptor imgDescriptor = {
-                    sampler, sprite.newImage->GetDefaultView()};
-
-                ResourceCreationContext::DescriptorSetCreateInfo::Descriptor descriptors[] = {
-                    {DescriptorType::UNIFORM_BUFFER, 0, uvDescriptor},
-                    {DescriptorType::COMBINED_IMAGE_SAMPLER, 1, imgDescriptor}};
-
-                spriteInstance->descriptorSet = ctx.CreateDescriptorSet({2, descriptors, layout});
-                sem.Signal();
-            });
-            sem.Wait();
-            if (oldDescriptorSet) {
-                this->DestroyResources(
-                    [oldDescriptorSet](ResourceCreationContext & ctx) { ctx.DestroyDescriptorSet(oldDescriptorSet); });
+            spriteInstance->image = sprite.newImage;
+        }
+    }
+
+    // Views are only looked up in spriteTextureIds further down, so destroying the sets of replaced views here means a
+    // new view at the same address never gets the old view's set
+    auto atlas = TextureAtlas::GetInstance();
+    auto replacedAtlasViews = atlas->Flush();
+    for (auto replacedView : replacedAtlasViews) {
+        DestroySpriteTexture(replacedView);
+    }
+#if HOT_RELOAD_RESOURCES
+    std::vector<Image *> reloadedImages;
+    {
+        std::lock_guard<std::mutex> guard(reloadedSpriteImagesLock);
+        reloadedImages.swap(reloadedSpriteImages);
+    }
+    for (auto image : reloadedImages) {
+        auto & view = spriteImageViews.at(image);
+        if (view != nullptr) {
+            DestroySpriteTexture(view);
+            view = nullptr;
+        }
+    }
+#endif
+
+    // Sorting by texture lets every run of sprites sharing a texture be drawn with one instanced call. The sort is
+    // stable so sprites with the same texture keep their creation order. Each camera sorts these by depth below.
+    sortedSprites.clear();
+    std::vector<ImageViewHandle *> spriteViews;
+    // Descriptor sets for every view without one are requested before waiting for any of them, so a frame where many
+    // new textures appear only waits for the renderer once
+    std::unordered_map<ImageViewHandle *, Future<DescriptorSet *>> newDescriptorSets;
+    for (auto const & sprite : this->sprites) {
+        if (!sprite.isActive || !sprite.image) {
+            continue;
+        }
+        auto atlasEntry = atlas->GetEntry(sprite.image);
+        ImageViewHandle * view;
+        if (atlasEntry.has_value()) {
+            view = atlas->GetPageView(atlasEntry->page);
+            sortedSprites.push_back({0, static_cast<uint32_t>(sprite.id), atlasEntry->uvRect, 0});
+        } else {
+            view = sprite.image->GetDefaultView();
+            sortedSprites.push_back({0, static_cast<uint32_t>(sprite.id), glm::vec4(0.f, 0.f, 1.f, 1.f), 0});
+        }
+        spriteViews.push_back(view);
+        if (!spriteTextureIds.contains(view) && !newDescriptorSets.contains(view)) {
+            newDescriptorSets.emplace(view, CreateSpriteDescriptorSet(view));
+#if HOT_RELOAD_RESOURCES
+            if (!atlasEntry.has_value()) {
+                auto image = sprite.image;
+                if (!spriteImageViews.contains(image)) {
+                    image->SubscribeToChanges([this](Image * reloaded) {
+                        std::lock_guard<std::mutex> guard(reloadedSpriteImagesLock);
+                        reloadedSpriteImages.push_back(reloaded);
+                    });
+                }
+                spriteImageViews[image] = view;
             }
+#endif
         }
     }
-}
\ No newline at end of file
+    for (auto const & [view, descriptorSet] : newDescriptorSets) {
+        uint32_t textureId;
+        if (freeSpriteTextureIds.empty()) {
+            textureId = static_cast<uint32_t>(spriteTextureDescriptorSets.size());
+            spriteTextureDescriptorSets.push_back(descriptorSet.Get());
+        } else {
+            textureId = freeSpriteTextureIds.back();
+            freeSpriteTextureIds.pop_back();
+            spriteTextureDescriptorSets[textureId] = descriptorSet.Get();
+        }
+        spriteTextureIds.emplace(view, textureId);
+    }
+    for (size_t i = 0; i < sortedSprites.size(); ++i) {
+        sortedSprites[i].textureId = spriteTextureIds.at(spriteViews[i]);
+    }
+    RadixSort(
+        sortedSprites,
+        sortedSpritesScratch,
+        [](SortedSprite const & sprite) { return sprite.textureId; },
+        jobEngine);
+
+    currFrame.cameraSpriteBatches.resize(cameras.size());
+    size_t numActiveCameras = 0;
+    for (auto const & camera : cameras) {
+        currFrame.cameraSpriteBatches[camera.id].clear();
+        if (camera.isActive) {
+            numActiveCameras++;
+        }
+    }
+    currFrame.spriteInstanceBuffer = nullptr;
+    if (sortedSprites.size() == 0 || numActiveCameras == 0) {
+        return;
+    }
+
+    auto allocation = transientAllocator.Allocate(numActiveCameras * sortedSprites.size() * sizeof(SpriteGpuData),
+                                                  sizeof(glm::vec4));
+    currFrame.spriteInstanceBuffer = allocation.buffer;
+    currFrame.spriteInstanceOffset = allocation.offset;
+    auto instancesMapped = (SpriteGpuData *)allocation.ptr;
+    uint32_t firstInstance = 0;
+    for (auto const & camera : cameras) {
+        if (!camera.isActive) {
+            continue;
+        }
+        // Sorting the texture sorted sprites again by depth draws them back to front. Since the sort is stable,
+        // sprites at the same depth stay sorted by texture and are still drawn together.
+        depthSortedSprites.assign(sortedSprites.begin(), sortedSprites.end());
+        for (auto & sorted : depthSortedSprites) {
+            float depth = -(camera.view * this->sprites[sorted.spriteIdx].localToWorld[3]).z;
+            // Inverted so the farthest sprites come first
+            sorted.depthKey = ~FloatToRadixKey(depth);
+        }
+        RadixSort(
+            depthSortedSprites,
+            sortedSpritesScratch,
+            [](SortedSprite const & sprite) { return sprite.depthKey; },
+            jobEngine);
+
+        auto & batches = currFrame.cameraSpriteBatches[camera.id];
+        for (uint32_t i = firstInstance; i < firstInstance + depthSortedSprites.size(); ++i) {
+            auto const & sorted = depthSortedSprites[i - firstInstance];
+            instancesMapped[i] = {this->sprites[sorted.spriteIdx].localToWorld, sorted.uvRect};
+
+            auto descriptorSet = spriteTextureDescriptorSets[sorted.textureId];
+            if (batches.size() == 0 || batches.back().textureDescriptorSet != descriptorSet) {
+                batches.push_back({descriptorSet, i, 0});
+            }
+            batches.back().instanceCount++;
+        }
+        firstInstance += static_cast<uint32_t>(depthSortedSprites.size());
+    }
+}
@@ -2,9 +2,23 @@
 
 #include <ThirdParty/optick/src/optick.h>
 
+#include "Core/Resources/Image.h"
+#include "Core/Resources/Material.h"
 #include "Core/Resources/StaticMesh.h"
 
-StaticMeshInstanceId RenderSystem::CreateStaticMeshInstance(StaticMesh * mesh, bool isActive)
+static uint32_t GetSortId(std::unordered_map<void const *, uint32_t> & ids, void const * ptr)
+{
+    auto existing = ids.find(ptr);
+    if (existing != ids.end()) {
+        return existing->second;
+    }
+    // 0 is left for "no buffer"
+    uint32_t id = static_cast<uint32_t>(ids.size()) + 1;
+    ids.insert({ptr, id});
+    return id;
+}
+
+StaticMeshInstanceId RenderSystem::CreateStaticMeshInstance(StaticMesh * mesh, bool isActive, bool isOccluder)
 {
     OPTICK_EVENT();
     staticMeshes.emplace_back();
@@ -12,10 +26,15 @@ StaticMeshInstanceId RenderSystem::CreateStaticMeshInstance(StaticMesh * mesh, b
     staticMeshes[id].id = id;
     staticMeshes[id].mesh = mesh;
     staticMeshes[id].isActive = isActive;
+    staticMeshes[id].isOccluder = isOccluder;
 
-    for (auto const & submesh : mesh->GetSubmeshes()) {
-        sortedSubmeshInstances.insert({&submesh, id});
+    auto const & submeshes = mesh->GetSubmeshes();
+    for (uint32_t i = 0; i < submeshes.size(); ++i) {
+        staticMeshes[id].submeshInstances.push_back(submeshInstances.size());
+        submeshInstances.push_back({CreateSubmeshSortKey(&submeshes[i]), &submeshes[i], id, i});
     }
+    staticMeshBatchesDirty = true;
+    MarkStaticMeshTransformDirty(&staticMeshes[id]);
     return id;
 }
 
@@ -25,16 +44,49 @@ void RenderSystem::DestroyStaticMeshInstance(StaticMeshInstanceId id)
     // TODO: Do this properly
     staticMeshes[id].isActive = false;
 
-    for (auto i = sortedSubmeshInstances.begin(); i != sortedSubmeshInstances.end();) {
-        if (i->instanceId == id) {
-            sortedSubmeshInstances.erase(i++);
-        } else {
-            ++i;
+    for (auto index : staticMeshes[id].submeshInstances) {
+        // Move the last submesh instance into the removed one's place and point its owner at the new index
+        auto lastIndex = submeshInstances.size() - 1;
+        if (index != lastIndex) {
+            auto const & last = submeshInstances[lastIndex];
+            for (auto & ownerIndex : staticMeshes[last.instanceId].submeshInstances) {
+                if (ownerIndex == lastIndex) {
+                    ownerIndex = index;
+                    break;
+                }
+            }
+            submeshInstances[index] = last;
         }
+        submeshInstances.pop_back();
     }
+    staticMeshes[id].submeshInstances.clear();
+    staticMeshBatchesDirty = true;
 }
 
 StaticMeshInstance * RenderSystem::GetStaticMeshInstance(StaticMeshInstanceId id)
 {
     return &staticMeshes[id];
 }
+
+uint64_t RenderSystem::CreateSubmeshSortKey(Submesh const * submesh)
+{
+    uint64_t transparent = submesh->GetMaterial()->GetAlbedo()->HasTransparency() ? 1 : 0;
+    uint64_t material = GetSortId(materialSortIds, submesh->GetMaterial()) & 0x7FFFF;
+    uint64_t vertexBuffer = GetSortId(bufferSortIds, submesh->GetVertexBuffer().GetBuffer()) & 0xFFF;
+    uint64_t indexBuffer =
+        submesh->GetIndexBuffer().has_value() ? GetSortId(bufferSortIds, submesh->GetIndexBuffer()->GetBuffer()) & 0x7FF
+                                              : 0;
+    // 16 and 32 bit indices can share an index buffer but have to be drawn in separate batches
+    uint64_t indexType = submesh->GetIndexType() == CommandBuffer::IndexType::UINT16 ? 1 : 0;
+    uint64_t submeshId = GetSortId(submeshSortIds, submesh) & 0xFFFFF;
+    return (transparent << 63) | (material << 44) | (vertexBuffer << 32) | (indexType << 31) | (indexBuffer << 20) |
+           submeshId;
+}
+
+void RenderSystem::MarkStaticMeshTransformDirty(StaticMeshInstance * instance)
+{
+    if (instance->dirtyFrames == 0) {
+        dirtyStaticMeshTransforms.push_back(instance->id);
+    }
+    instance->dirtyFrames = (1 << frameInfo.size()) - 1;
+}
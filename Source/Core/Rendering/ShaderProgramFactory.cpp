@@ -1,21 +1,56 @@
 #include "ShaderProgramFactory.h"
 
+#include <chrono>
+#include <vector>
+
+#include <ThirdParty/optick/src/optick.h>
+
 #include "Core/Resources/ResourceManager.h"
 #include "Core/Resources/ShaderProgram.h"
+#include "Jobs/JobEngine.h"
+#include "Logging/Logger.h"
+#include "Util/Semaphore.h"
+
+static const auto logger = Logger::Create("ShaderProgramFactory");
 
 void ShaderProgramFactory::CreateResources()
 {
-    CreateDebugDrawShaderProgram();
-    CreatePassthroughTransformShaderProgram();
-    CreateMeshShaderProgram();
-    CreateSkeletalMeshShaderProgram();
-    CreateTransparentMeshShaderProgram();
-    CreateAmbientOcclusionProgram();
-    CreateAmbientOcclusionBlurProgram();
-    CreateParticleRenderingProgram();
-    CreateTonemapProgram();
-    CreateUiShaderProgram();
-    CreatePostprocessShaderProgram();
+    OPTICK_EVENT();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // The programs don't depend on each other, so each one is compiled and has its pipeline created in its own job.
+    // On Vulkan pipelines are created on the job threads as well, on OpenGL only the compilation runs in parallel
+    // since resource creation is serialized on the render thread.
+    std::vector<void (*)()> creators = {
+        &CreateDebugDrawShaderProgram,
+        &CreatePassthroughTransformShaderProgram,
+        &CreateMeshShaderProgram,
+        &CreateSkeletalMeshShaderProgram,
+        &CreateTransparentMeshShaderProgram,
+        &CreateAmbientOcclusionProgram,
+        &CreateAmbientOcclusionBlurProgram,
+        &CreateParticleRenderingProgram,
+        &CreateTonemapProgram,
+        &CreateUiShaderProgram,
+        &CreatePostprocessShaderProgram,
+    };
+    auto jobEngine = JobEngine::GetInstance();
+    std::vector<JobId> creatorJobs;
+    for (auto creator : creators) {
+        auto job = jobEngine->CreateJob({}, creator);
+        jobEngine->ScheduleJob(job, JobPriority::HIGH);
+        creatorJobs.push_back(job);
+    }
+
+    Semaphore sem;
+    auto gatherJob = jobEngine->CreateJob(creatorJobs, [&sem]() { sem.Signal(); });
+    jobEngine->ScheduleJob(gatherJob, JobPriority::HIGH);
+    sem.Wait();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    logger.Info("Created shader programs in {}ms using {} job threads",
+                std::chrono::duration<float, std::milli>(end - start).count(),
+                jobEngine->GetNumThreads());
 }
 void ShaderProgramFactory::CreateDebugDrawShaderProgram()
 {
@@ -68,8 +103,7 @@ void ShaderProgramFactory::CreatePassthroughTransformShaderProgram()
     ShaderProgram::Create(
         "_Primitives/ShaderPrograms/passthrough-transform.program",
         {"shaders/passthrough-transform.vert", "shaders/passthrough-transform.frag"},
-        ResourceManager::GetResource<VertexInputStateHandle>(
-            "_Primitives/VertexInputStates/passthrough-transform.state"),
+        ResourceManager::GetResource<VertexInputStateHandle>("_Primitives/VertexInputStates/sprite.state"),
         ResourceManager::GetResource<PipelineLayoutHandle>("_Primitives/PipelineLayouts/pt.pipelinelayout"),
         ResourceManager::GetResource<RenderPassHandle>("_Primitives/Renderpasses/main.pass"),
         CullMode::BACK,
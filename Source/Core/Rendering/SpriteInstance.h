@@ -1,7 +1,10 @@
 #pragma once
 
-class BufferHandle;
-class DescriptorSet;
+#include <cstdint>
+
+#include <ThirdParty/glm/glm/glm.hpp>
+
+class Image;
 class RenderSystem;
 
 using SpriteInstanceId = size_t;
@@ -12,7 +15,14 @@ class SpriteInstance
 
 private:
     SpriteInstanceId id;
-    BufferHandle * uniformBuffer;
-    DescriptorSet * descriptorSet;
+    Image * image;
+    glm::mat4 localToWorld;
     bool isActive;
-};
\ No newline at end of file
+};
+
+// Per instance vertex data for the sprite shader. Must match the instance attributes in passthrough-transform.vert
+struct SpriteGpuData {
+    glm::mat4 localToWorld;
+    // xy: offset, zw: scale of the texture coordinates
+    glm::vec4 uvRect;
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include <ThirdParty/glm/glm/glm.hpp>
 
 class RenderSystem;
@@ -15,5 +18,13 @@ private:
     StaticMeshInstanceId id;
     StaticMesh * mesh;
     bool isActive;
+    // Occluders are rasterized into the occlusion culler's depth buffer when occlusion culling is enabled
+    bool isOccluder;
     glm::mat4 localToWorld;
+    // Indexes into RenderSystem::submeshInstances
+    std::vector<size_t> submeshInstances;
+    // Indexes of this instance's transform in the mesh uniforms, one per submesh. Empty while inactive.
+    std::vector<uint32_t> uniformSlots;
+    // Bit N is set if localToWorld has not yet been uploaded to frame N's mesh uniforms
+    uint32_t dirtyFrames = 0;
 };
\ No newline at end of file
@@ -1,75 +1,23 @@
 #pragma once
 
+#include <cstdint>
+
 #include "Core/Rendering/StaticMeshInstance.h"
 #include "Core/Resources/Material.h"
 #include "Core/Resources/StaticMesh.h"
 
+/*
+ * The sort key is packed so that submesh instances which can go in the same batch end up next to each other when
+ * sorted:
+ *     [63] transparent | [44, 62] material | [32, 43] vertex buffer | [31] 16 bit indices |
+ *     [20, 30] index buffer | [0, 19] submesh
+ * The ids are handed out by RenderSystem the first time it sees a material/buffer/submesh and are truncated to fit.
+ * A collision only makes batching worse since batches are still split on the actual pointers.
+ */
 struct SubmeshInstance {
+    uint64_t sortKey;
     Submesh const * submesh;
     StaticMeshInstanceId instanceId;
+    // Index of submesh in its StaticMesh, used to look up its LODs
+    uint32_t submeshIndex;
 };
-
-struct SubmeshInstanceComparer {
-    bool operator()(SubmeshInstance const & lhs, SubmeshInstance const & rhs) const
-    {
-        if (lhs.submesh->GetMaterial()->GetDescriptorSet() < rhs.submesh->GetMaterial()->GetDescriptorSet()) {
-            return true;
-        }
-        if (lhs.submesh->GetMaterial()->GetDescriptorSet() > rhs.submesh->GetMaterial()->GetDescriptorSet()) {
-            return false;
-        }
-        // Same material
-        if (lhs.submesh->GetVertexBuffer().GetBuffer() < rhs.submesh->GetVertexBuffer().GetBuffer()) {
-            return true;
-        }
-        if (lhs.submesh->GetVertexBuffer().GetBuffer() > rhs.submesh->GetVertexBuffer().GetBuffer()) {
-            return false;
-        }
-        // Same material, same vertex buffer
-        if (!lhs.submesh->GetIndexBuffer().has_value() && !rhs.submesh->GetIndexBuffer().has_value()) {
-            // Same material, same vertex buffer, no index buffers
-            if (lhs.submesh->GetVertexBuffer().GetOffset() < rhs.submesh->GetVertexBuffer().GetOffset()) {
-                return true;
-            }
-            if (lhs.submesh->GetVertexBuffer().GetOffset() > rhs.submesh->GetVertexBuffer().GetOffset()) {
-                return false;
-            }
-            if (lhs.instanceId < rhs.instanceId) {
-                return true;
-            }
-            if (lhs.instanceId > rhs.instanceId) {
-                return false;
-            }
-            // Same material, same vertex buffer, no index buffers, same offset, same id
-            return lhs.submesh->GetNumVertices() < rhs.submesh->GetNumVertices();
-        }
-        if (lhs.submesh->GetIndexBuffer().has_value() && !rhs.submesh->GetIndexBuffer().has_value()) {
-            return true;
-        }
-        if (!lhs.submesh->GetIndexBuffer().has_value() && rhs.submesh->GetIndexBuffer().has_value()) {
-            return false;
-        }
-        // Same material, same vertex buffer, both have index buffer
-        if (lhs.submesh->GetIndexBuffer().value().GetBuffer() < rhs.submesh->GetIndexBuffer().value().GetBuffer()) {
-            return true;
-        }
-        if (lhs.submesh->GetIndexBuffer().value().GetBuffer() > rhs.submesh->GetIndexBuffer().value().GetBuffer()) {
-            return false;
-        }
-        // Same material, same vertex buffer, same index buffer
-        if (lhs.submesh->GetIndexBuffer().value().GetOffset() < rhs.submesh->GetIndexBuffer().value().GetOffset()) {
-            return true;
-        }
-        if (lhs.submesh->GetIndexBuffer().value().GetOffset() > rhs.submesh->GetIndexBuffer().value().GetOffset()) {
-            return false;
-        }
-        if (lhs.instanceId < rhs.instanceId) {
-            return true;
-        }
-        if (lhs.instanceId > rhs.instanceId) {
-            return false;
-        }
-        // Same material, same vertex buffer, same index buffer, same index offset, same id
-        return lhs.submesh->GetNumIndexes() < rhs.submesh->GetNumIndexes();
-    }
-};
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+#include <ThirdParty/optick/src/optick.h>
+
+#include "Core/Resources/ResourceManager.h"
+#include "Logging/Logger.h"
+#include "RenderingBackend/Abstract/RenderResources.h"
+#include "RenderingBackend/Abstract/ResourceCreationContext.h"
+#include "Util/Future.h"
+
+static const auto logger = Logger::Create("TextureAtlas");
+
+// rect includes the padding, the returned rect does not
+static glm::vec4 GetUvRect(AtlasRect const & rect)
+{
+    float const pageSize = static_cast<float>(TextureAtlas::PAGE_SIZE);
+    return glm::vec4((rect.x + TextureAtlas::PADDING) / pageSize,
+                     (rect.y + TextureAtlas::PADDING) / pageSize,
+                     (rect.width - 2 * TextureAtlas::PADDING) / pageSize,
+                     (rect.height - 2 * TextureAtlas::PADDING) / pageSize);
+}
+
+static std::pair<ImageHandle *, ImageViewHandle *> CreatePageImage(ResourceCreationContext & ctx,
+                                                                   std::vector<uint8_t> const & pixels)
+{
+    ResourceCreationContext::ImageCreateInfo ic = {Format::RGBA8,
+                                                   ImageHandle::Type::TYPE_2D,
+                                                   TextureAtlas::PAGE_SIZE,
+                                                   TextureAtlas::PAGE_SIZE,
+                                                   1,
+                                                   1,
+                                                   IMAGE_USAGE_FLAG_SAMPLED_BIT |
+                                                       IMAGE_USAGE_FLAG_TRANSFER_DST_BIT};
+    auto image = ctx.CreateImage(ic);
+    ctx.ImageData(image, pixels);
+
+    ResourceCreationContext::ImageViewCreateInfo ivc = {};
+    ivc.components.r = ComponentSwizzle::R;
+    ivc.components.g = ComponentSwizzle::G;
+    ivc.components.b = ComponentSwizzle::B;
+    ivc.components.a = ComponentSwizzle::A;
+    ivc.format = Format::RGBA8;
+    ivc.image = image;
+    ivc.subresourceRange.aspectMask = ImageViewHandle::ImageAspectFlagBits::COLOR_BIT;
+    ivc.subresourceRange.baseArrayLayer = 0;
+    ivc.subresourceRange.baseMipLevel = 0;
+    ivc.subresourceRange.layerCount = 1;
+    ivc.subresourceRange.levelCount = 1;
+    ivc.viewType = ImageViewHandle::Type::TYPE_2D;
+    return std::make_pair(image, ctx.CreateImageView(ivc));
+}
+
+TextureAtlas * TextureAtlas::GetInstance()
+{
+    static TextureAtlas instance;
+    return &instance;
+}
+
+bool TextureAtlas::AddImage(Image const * image, uint32_t width, uint32_t height, std::vector<uint8_t> const & data)
+{
+    OPTICK_EVENT();
+    if (width == 0 || height == 0 || width > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE) {
+        return false;
+    }
+    if (data.size() < static_cast<size_t>(width) * height * 4) {
+        logger.Error("AddImage called with width={} height={} but only {} bytes of data", width, height, data.size());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (entries.contains(image)) {
+        return true;
+    }
+    uint32_t paddedWidth = width + 2 * PADDING;
+    uint32_t paddedHeight = height + 2 * PADDING;
+    std::optional<AtlasRect> rect;
+    uint32_t pageIdx = 0;
+    for (; pageIdx < pages.size(); ++pageIdx) {
+        rect = pages[pageIdx].packer.Pack(paddedWidth, paddedHeight);
+        if (rect.has_value()) {
+            break;
+        }
+    }
+    if (!rect.has_value()) {
+        pages.emplace_back();
+        pageIdx = static_cast<uint32_t>(pages.size() - 1);
+        rect = pages[pageIdx].packer.Pack(paddedWidth, paddedHeight);
+        logger.Info("Created atlas page {}", pageIdx);
+    }
+    assert(rect.has_value());
+
+    auto & page = pages[pageIdx];
+    if (page.pixels.empty()) {
+        page.pixels.resize(PAGE_SIZE * PAGE_SIZE * 4, 0);
+    }
+    CopyToPage(page, rect.value(), width, height, data);
+    page.isDirty = true;
+    ++page.revision;
+
+    entries[image] = {{pageIdx, GetUvRect(rect.value())}, rect.value()};
+    return true;
+}
+
+bool TextureAtlas::RemoveImage(Image const * image)
+{
+    OPTICK_EVENT();
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = entries.find(image);
+    if (it == entries.end()) {
+        return false;
+    }
+    auto pageIdx = it->second.entry.page;
+    auto & page = pages[pageIdx];
+    page.removedArea += static_cast<uint64_t>(it->second.rect.width) * it->second.rect.height;
+    entries.erase(it);
+    // The packer can not free single rectangles, so the space of removed images is only reclaimed by repacking
+    if (page.removedArea * 2 >= page.packer.GetUsedArea()) {
+        RepackPage(pageIdx);
+    }
+    return true;
+}
+
+std::optional<TextureAtlasEntry> TextureAtlas::GetEntry(Image const * image)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = entries.find(image);
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+    // Until the next Flush the page's view does not contain the image yet, so the caller should use its own view
+    auto const & page = pages[it->second.entry.page];
+    if (page.isDirty || page.imageView == nullptr) {
+        return std::nullopt;
+    }
+    return it->second.entry;
+}
+
+bool TextureAtlas::Contains(Image const * image)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return entries.contains(image);
+}
+
+ImageViewHandle * TextureAtlas::GetPageView(uint32_t page)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return page < pages.size() ? pages[page].imageView : nullptr;
+}
+
+std::vector<ImageViewHandle *> TextureAtlas::Flush()
+{
+    OPTICK_EVENT();
+    struct Upload {
+        uint32_t page;
+        uint32_t revision;
+        std::vector<uint8_t> pixels;
+    };
+    std::vector<Upload> uploads;
+    std::vector<ImageViewHandle *> replacedViews;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (uint32_t i = 0; i < pages.size(); ++i) {
+            auto & page = pages[i];
+            if (!page.isDirty) {
+                continue;
+            }
+            if (!page.pixels.empty()) {
+                uploads.push_back({i, page.revision, page.pixels});
+                continue;
+            }
+            // The page was released, so its GPU image is destroyed instead of being uploaded again
+            if (page.image != nullptr) {
+                auto image = page.image;
+                auto imageView = page.imageView;
+                replacedViews.push_back(imageView);
+                ResourceManager::DestroyResources([image, imageView](ResourceCreationContext & ctx) {
+                    ctx.DestroyImageView(imageView);
+                    ctx.DestroyImage(image);
+                });
+                page.image = nullptr;
+                page.imageView = nullptr;
+            }
+            page.isDirty = false;
+        }
+    }
+    if (uploads.empty()) {
+        return replacedViews;
+    }
+
+    // The pixels are captured by reference since the futures are waited on before uploads goes out of scope
+    std::vector<Future<std::pair<ImageHandle *, ImageViewHandle *>>> futures;
+    futures.reserve(uploads.size());
+    for (auto const & upload : uploads) {
+        futures.push_back(ResourceManager::CreateResourcesAsync(
+            [&pixels = upload.pixels](ResourceCreationContext & ctx) { return CreatePageImage(ctx, pixels); }));
+    }
+    WaitAll(futures);
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < uploads.size(); ++i) {
+        auto & page = pages[uploads[i].page];
+        if (page.image != nullptr) {
+            auto image = page.image;
+            auto imageView = page.imageView;
+            replacedViews.push_back(imageView);
+            ResourceManager::DestroyResources([image, imageView](ResourceCreationContext & ctx) {
+                ctx.DestroyImageView(imageView);
+                ctx.DestroyImage(image);
+            });
+        }
+        std::tie(page.image, page.imageView) = futures[i].Get();
+        // If images were added while uploading, the page stays dirty and is uploaded again in the next Flush
+        page.isDirty = page.revision != uploads[i].revision;
+        logger.Info("Uploaded atlas page with occupancy={}", page.packer.GetOccupancy());
+    }
+    return replacedViews;
+}
+
+void TextureAtlas::CopyToPage(Page & page, AtlasRect const & rect, uint32_t width, uint32_t height,
+                              std::vector<uint8_t> const & data)
+{
+    // Every pixel of the padded rect takes the value of the closest pixel in the image, which extends the edges into
+    // the padding
+    for (uint32_t y = 0; y < rect.height; ++y) {
+        uint32_t srcY = std::min(std::max(y, PADDING) - PADDING, height - 1);
+        uint8_t * dst = &page.pixels[((rect.y + y) * PAGE_SIZE + rect.x) * 4];
+        uint8_t const * srcRow = &data[srcY * width * 4];
+        for (uint32_t x = 0; x < rect.width; ++x) {
+            uint32_t srcX = std::min(std::max(x, PADDING) - PADDING, width - 1);
+            memcpy(dst + x * 4, srcRow + srcX * 4, 4);
+        }
+    }
+}
+
+void TextureAtlas::RepackPage(uint32_t pageIdx)
+{
+    OPTICK_EVENT();
+    auto & page = pages[pageIdx];
+    std::vector<std::pair<Image const *, Placement *>> placements;
+    for (auto & [image, placement] : entries) {
+        if (placement.entry.page == pageIdx) {
+            placements.push_back({image, &placement});
+        }
+    }
+    page.packer.Clear();
+    page.removedArea = 0;
+    page.isDirty = true;
+    ++page.revision;
+    if (placements.empty()) {
+        // Flush destroys the page's GPU image once it sees the pixels are gone
+        std::vector<uint8_t>().swap(page.pixels);
+        logger.Info("Released atlas page {}", pageIdx);
+        return;
+    }
+
+    // Packing the tallest images first wastes less space
+    std::sort(placements.begin(), placements.end(), [](auto const & a, auto const & b) {
+        return a.second->rect.height > b.second->rect.height;
+    });
+    std::vector<uint8_t> pixels(PAGE_SIZE * PAGE_SIZE * 4, 0);
+    std::vector<Image const *> dropped;
+    for (auto & [image, placement] : placements) {
+        auto const & oldRect = placement->rect;
+        auto rect = page.packer.Pack(oldRect.width, oldRect.height);
+        if (!rect.has_value()) {
+            // Can only happen if the new order packs worse than the old one. The image is drawn from its own view.
+            dropped.push_back(image);
+            continue;
+        }
+        for (uint32_t y = 0; y < rect->height; ++y) {
+            memcpy(&pixels[((rect->y + y) * PAGE_SIZE + rect->x) * 4],
+                   &page.pixels[((oldRect.y + y) * PAGE_SIZE + oldRect.x) * 4],
+                   rect->width * 4);
+        }
+        placement->rect = rect.value();
+        placement->entry.uvRect = GetUvRect(rect.value());
+    }
+    page.pixels.swap(pixels);
+    for (auto image : dropped) {
+        entries.erase(image);
+    }
+    logger.Info("Repacked atlas page {} with images={}, occupancy={}",
+                pageIdx,
+                placements.size() - dropped.size(),
+                page.packer.GetOccupancy());
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <ThirdParty/glm/glm/glm.hpp>
+
+#include "Core/Rendering/TextureAtlasPacker.h"
+
+class Image;
+struct ImageHandle;
+struct ImageViewHandle;
+
+struct TextureAtlasEntry {
+    uint32_t page;
+    // xy: offset, zw: scale of the texture coordinates within the page
+    glm::vec4 uvRect;
+};
+
+/**
+ * TextureAtlas copies small images into shared RGBA8 atlas pages so that everything drawn from the same page can be
+ * batched together. Images keep their own GPU image as well, and are only added to the atlas when something that
+ * batches by page, like a sprite, uses them.
+ * Pages are uploaded to the GPU in Flush. Since an uploaded image can not be written to again, a page which gets new
+ * images after being uploaded is uploaded again as a new image. Pages are repacked once enough of their images have
+ * been removed, and released when all of them have.
+ */
+class TextureAtlas
+{
+public:
+    static constexpr uint32_t PAGE_SIZE = 2048;
+    // Images larger than this in either dimension are not added to the atlas
+    static constexpr uint32_t MAX_IMAGE_SIZE = 256;
+    // Every image is surrounded by a border of its edge pixels to avoid bleeding when filtering
+    static constexpr uint32_t PADDING = 1;
+
+    static TextureAtlas * GetInstance();
+
+    /**
+     * Copies the RGBA8 pixels of image into an atlas page. Returns false if the image is too large for the atlas.
+     * Does nothing if the image is already in the atlas. Thread safe.
+     */
+    bool AddImage(Image const * image, uint32_t width, uint32_t height, std::vector<uint8_t> const & data);
+
+    /**
+     * Removes image from the atlas. Once half of the packed area of a page belongs to removed images the page is
+     * repacked, which moves the remaining images. Returns false if the image was not in the atlas. Thread safe.
+     */
+    bool RemoveImage(Image const * image);
+
+    /**
+     * Returns where image is in the atlas, or nullopt if it is not in the atlas or its page has changed since it was
+     * last uploaded. Thread safe.
+     */
+    std::optional<TextureAtlasEntry> GetEntry(Image const * image);
+
+    /**
+     * Returns true if image is in the atlas, even if its page has not been uploaded yet. Thread safe.
+     */
+    bool Contains(Image const * image);
+
+    /**
+     * Returns the view of the uploaded page, or nullptr if the page has not been uploaded yet. Thread safe.
+     */
+    ImageViewHandle * GetPageView(uint32_t page);
+
+    /**
+     * Uploads every page which has changed since the last call. Returns the views which were replaced by a new upload
+     * so that any descriptor sets using them can be destroyed. The replaced images and views are destroyed through
+     * ResourceManager::DestroyResources so they stay valid until the frames using them have finished. The lock is not
+     * held while waiting for the upload, so the other functions may be called from other threads in the meantime.
+     */
+    std::vector<ImageViewHandle *> Flush();
+
+private:
+    struct Page {
+        Page() : packer(PAGE_SIZE, PAGE_SIZE), pixels(PAGE_SIZE * PAGE_SIZE * 4, 0) {}
+
+        TextureAtlasPacker packer;
+        // Empty once every image in the page has been removed, until an image is added to it again
+        std::vector<uint8_t> pixels;
+        // The part of packer's used area that belongs to removed images
+        uint64_t removedArea = 0;
+        bool isDirty = false;
+        // Incremented whenever pixels changes so that Flush can tell whether the page changed during an upload
+        uint32_t revision = 0;
+        ImageHandle * image = nullptr;
+        ImageViewHandle * imageView = nullptr;
+    };
+
+    struct Placement {
+        TextureAtlasEntry entry;
+        // Includes the padding
+        AtlasRect rect;
+    };
+
+    void CopyToPage(Page & page, AtlasRect const & rect, uint32_t width, uint32_t height,
+                    std::vector<uint8_t> const & data);
+    void RepackPage(uint32_t pageIdx);
+
+    std::mutex lock;
+    std::vector<Page> pages;
+    std::unordered_map<Image const *, Placement> entries;
+};
@@ -0,0 +1,100 @@
+#include "TextureAtlasPacker.h"
+
+#include <algorithm>
+#include <limits>
+
+TextureAtlasPacker::TextureAtlasPacker(uint32_t width, uint32_t height) : width(width), height(height)
+{
+    Clear();
+}
+
+std::optional<AtlasRect> TextureAtlasPacker::Pack(uint32_t rectWidth, uint32_t rectHeight)
+{
+    if (rectWidth == 0 || rectHeight == 0) {
+        return std::nullopt;
+    }
+
+    // Pick the position with the lowest top edge, preferring the narrowest node on ties to waste less space
+    size_t bestIdx = skyline.size();
+    uint32_t bestTop = std::numeric_limits<uint32_t>::max();
+    uint32_t bestWidth = std::numeric_limits<uint32_t>::max();
+    uint32_t bestY = 0;
+    for (size_t i = 0; i < skyline.size(); ++i) {
+        auto y = FitAt(i, rectWidth, rectHeight);
+        if (!y.has_value()) {
+            continue;
+        }
+        uint32_t top = y.value() + rectHeight;
+        if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth)) {
+            bestIdx = i;
+            bestTop = top;
+            bestWidth = skyline[i].width;
+            bestY = y.value();
+        }
+    }
+    if (bestIdx == skyline.size()) {
+        return std::nullopt;
+    }
+
+    AtlasRect ret = {skyline[bestIdx].x, bestY, rectWidth, rectHeight};
+    skyline.insert(skyline.begin() + bestIdx, {ret.x, bestTop, rectWidth});
+
+    // Cut the nodes which are now covered by the new one
+    uint32_t const newEnd = ret.x + rectWidth;
+    size_t i = bestIdx + 1;
+    while (i < skyline.size() && skyline[i].x < newEnd) {
+        uint32_t nodeEnd = skyline[i].x + skyline[i].width;
+        if (nodeEnd <= newEnd) {
+            skyline.erase(skyline.begin() + i);
+        } else {
+            skyline[i].width = nodeEnd - newEnd;
+            skyline[i].x = newEnd;
+            break;
+        }
+    }
+
+    // Merge neighbours at the same height
+    for (size_t j = 0; j + 1 < skyline.size();) {
+        if (skyline[j].y == skyline[j + 1].y) {
+            skyline[j].width += skyline[j + 1].width;
+            skyline.erase(skyline.begin() + j + 1);
+        } else {
+            ++j;
+        }
+    }
+
+    usedArea += static_cast<uint64_t>(rectWidth) * rectHeight;
+    return ret;
+}
+
+void TextureAtlasPacker::Clear()
+{
+    skyline.clear();
+    skyline.push_back({0, 0, width});
+    usedArea = 0;
+}
+
+float TextureAtlasPacker::GetOccupancy() const
+{
+    uint64_t totalArea = static_cast<uint64_t>(width) * height;
+    return totalArea > 0 ? static_cast<float>(usedArea) / totalArea : 0.f;
+}
+
+std::optional<uint32_t> TextureAtlasPacker::FitAt(size_t nodeIdx, uint32_t rectWidth, uint32_t rectHeight) const
+{
+    uint32_t x = skyline[nodeIdx].x;
+    if (x + rectWidth > width) {
+        return std::nullopt;
+    }
+    // The rectangle has to sit on top of the highest node it spans
+    uint32_t y = 0;
+    uint32_t remaining = rectWidth;
+    for (size_t i = nodeIdx; remaining > 0; ++i) {
+        y = std::max(y, skyline[i].y);
+        if (y + rectHeight > height) {
+            return std::nullopt;
+        }
+        remaining -= std::min(remaining, skyline[i].width);
+    }
+    return y;
+}
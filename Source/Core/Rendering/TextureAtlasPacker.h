@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct AtlasRect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+/**
+ * TextureAtlasPacker decides where rectangles go in a fixed size atlas page using the skyline bottom-left heuristic.
+ * It only does the bookkeeping and never touches pixels or GPU resources.
+ */
+class TextureAtlasPacker
+{
+public:
+    TextureAtlasPacker(uint32_t width, uint32_t height);
+
+    /**
+     * Finds room for a width x height rectangle and marks it as used. Returns nullopt if the rectangle does not fit
+     * anywhere in the page.
+     */
+    std::optional<AtlasRect> Pack(uint32_t width, uint32_t height);
+
+    /**
+     * Forgets every packed rectangle.
+     */
+    void Clear();
+
+    uint32_t GetWidth() const { return width; }
+    uint32_t GetHeight() const { return height; }
+
+    /**
+     * The fraction of the page covered by packed rectangles.
+     */
+    float GetOccupancy() const;
+    /**
+     * The area of the page covered by packed rectangles, in pixels.
+     */
+    uint64_t GetUsedArea() const { return usedArea; }
+
+private:
+    // The top edge of the used area from x to x + width
+    struct SkylineNode {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    // Returns the y a width x height rectangle would be placed at if it started at skyline[nodeIdx], or nullopt if it
+    // does not fit there
+    std::optional<uint32_t> FitAt(size_t nodeIdx, uint32_t width, uint32_t height) const;
+
+    uint32_t width;
+    uint32_t height;
+    uint64_t usedArea = 0;
+    std::vector<SkylineNode> skyline;
+};
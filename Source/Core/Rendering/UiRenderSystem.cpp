@@ -178,6 +178,11 @@ void UiRenderSystem::RenderUi(FrameContext & context, CommandBuffer * commandBuf
     commandBuffer->CmdBindDescriptorSets(pipelineLayout, 0, {descriptorSet});
     commandBuffer->CmdBindIndexBuffer(fd.indexBuffer, 0, CommandBuffer::IndexType::UINT16);
     commandBuffer->CmdBindVertexBuffer(fd.vertexBuffer, 0, 0, sizeof(ImDrawVert));
+    auto & stats = context.renderStats;
+    stats.numPipelineBinds++;
+    stats.numDescriptorSetBinds++;
+    // The buffers were filled in PreRenderUi, which can not write to the stats
+    stats.bytesUploaded += data->TotalIdxCount * sizeof(ImDrawIdx) + data->TotalVtxCount * sizeof(ImDrawVert);
     // TODO: translation
     size_t currIndexPos = 0;
     size_t currVertexPos = 0;
@@ -200,6 +205,9 @@ void UiRenderSystem::RenderUi(FrameContext & context, CommandBuffer * commandBuf
                 scissor.extent.height = imCmdBuf->ClipRect.w - imCmdBuf->ClipRect.y; //+1;
                 commandBuffer->CmdSetScissor(0, 1, &scissor);
                 commandBuffer->CmdDrawIndexed(imCmdBuf->ElemCount, 1, currIndexPos, currVertexPos, 0);
+                stats.numDraws++;
+                stats.numInstances++;
+                stats.numTriangles += imCmdBuf->ElemCount / 3;
             }
             currIndexPos += imCmdBuf->ElemCount;
         }
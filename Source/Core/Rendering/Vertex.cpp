@@ -0,0 +1,94 @@
+#include "Vertex.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <ThirdParty/glm/glm/gtc/packing.hpp>
+
+#include "Logging/Logger.h"
+
+static const auto logger = Logger::Create("Vertex");
+
+static int16_t PackSnorm16(float value)
+{
+    return (int16_t)std::round(std::clamp(value, -1.f, 1.f) * 32767.f);
+}
+
+static uint16_t PackUnorm16(float value)
+{
+    return (uint16_t)std::round(std::clamp(value, 0.f, 1.f) * 65535.f);
+}
+
+static uint8_t PackUnorm8(float value)
+{
+    return (uint8_t)std::round(std::clamp(value, 0.f, 1.f) * 255.f);
+}
+
+// Maps the unit sphere onto an octahedron and unfolds it into the [-1, 1] square, see "A Survey of Efficient
+// Representations for Independent Unit Vectors" (Cigolle et al. 2014). Decoded by OctahedralDecode in Normals.glsl.
+static glm::vec2 OctahedralEncode(glm::vec3 n)
+{
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 == 0.f) {
+        // OBJ files without normals give us zero vectors, these are encoded as +Z instead of dividing by zero
+        return glm::vec2(0.f);
+    }
+    glm::vec2 ret(n.x / l1, n.y / l1);
+    if (n.z < 0.f) {
+        float x = (1.f - std::abs(ret.y)) * (ret.x >= 0.f ? 1.f : -1.f);
+        float y = (1.f - std::abs(ret.x)) * (ret.y >= 0.f ? 1.f : -1.f);
+        ret = glm::vec2(x, y);
+    }
+    return ret;
+}
+
+template <typename Packed, typename Unpacked>
+static void PackCommon(Unpacked const & vertex, Packed & ret)
+{
+    ret.pos = vertex.pos;
+    auto normal = OctahedralEncode(vertex.normal);
+    ret.normal[0] = PackSnorm16(normal.x);
+    ret.normal[1] = PackSnorm16(normal.y);
+    ret.uv[0] = glm::packHalf1x16(vertex.uv.x);
+    ret.uv[1] = glm::packHalf1x16(vertex.uv.y);
+    ret.color[0] = PackUnorm8(vertex.color.r);
+    ret.color[1] = PackUnorm8(vertex.color.g);
+    ret.color[2] = PackUnorm8(vertex.color.b);
+    ret.color[3] = 255;
+}
+
+PackedVertexWithNormal PackVertex(VertexWithNormal const & vertex)
+{
+    PackedVertexWithNormal ret;
+    PackCommon(vertex, ret);
+    return ret;
+}
+
+PackedVertexWithSkinning PackVertex(VertexWithSkinning const & vertex)
+{
+    PackedVertexWithSkinning ret;
+    PackCommon(vertex, ret);
+
+    float weightSum = 0.f;
+    for (size_t i = 0; i < MAX_VERTEX_WEIGHTS; ++i) {
+        if (vertex.bones[i] != UINT32_MAX) {
+            weightSum += vertex.weights[i];
+        }
+    }
+    for (size_t i = 0; i < MAX_VERTEX_WEIGHTS; ++i) {
+        if (vertex.bones[i] == UINT32_MAX || weightSum <= 0.f) {
+            ret.bones[i] = 0;
+            ret.weights[i] = 0;
+            continue;
+        }
+        if (vertex.bones[i] > UINT8_MAX) {
+            logger.Warn("Bone index {} does not fit in a packed vertex, the vertex will use bone {} instead",
+                        vertex.bones[i],
+                        UINT8_MAX);
+        }
+        ret.bones[i] = (uint8_t)std::min(vertex.bones[i], (uint32_t)UINT8_MAX);
+        // Normalized here since quantizing would otherwise make the weights add up to slightly less than 1
+        ret.weights[i] = PackUnorm16(vertex.weights[i] / weightSum);
+    }
+    return ret;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include <ThirdParty/glm/glm/glm.hpp>
 
 constexpr size_t MAX_VERTEX_WEIGHTS = 4;
@@ -30,3 +32,32 @@ struct VertexWithSkinning {
     uint32_t bones[MAX_VERTEX_WEIGHTS];
     float weights[MAX_VERTEX_WEIGHTS];
 };
+
+/**
+ * The format static meshes are stored in on the GPU. The normal is octahedral encoded into two snorm16 components and
+ * decoded in the vertex shader, the UV is two half floats and the color is unorm8. Use PackVertex to create one.
+ */
+struct PackedVertexWithNormal {
+    glm::vec3 pos;
+    int16_t normal[2];
+    uint16_t uv[2];
+    uint8_t color[4];
+};
+static_assert(sizeof(PackedVertexWithNormal) == 24);
+
+/**
+ * The format skeletal meshes are stored in on the GPU. Same as PackedVertexWithNormal with uint8 bone indices and
+ * unorm16 weights added. Unused weights have bone index 0 and weight 0.
+ */
+struct PackedVertexWithSkinning {
+    glm::vec3 pos;
+    int16_t normal[2];
+    uint16_t uv[2];
+    uint8_t color[4];
+    uint8_t bones[MAX_VERTEX_WEIGHTS];
+    uint16_t weights[MAX_VERTEX_WEIGHTS];
+};
+static_assert(sizeof(PackedVertexWithSkinning) == 36);
+
+PackedVertexWithNormal PackVertex(VertexWithNormal const & vertex);
+PackedVertexWithSkinning PackVertex(VertexWithSkinning const & vertex);
@@ -1,14 +1,17 @@
 ﻿#include "Image.h"
 
+#include <memory>
+
 #include <ThirdParty/optick/src/optick.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <ThirdParty/stb/stb_image.h>
 
+#include "Core/Rendering/TextureAtlas.h"
 #include "Core/Resources/ResourceManager.h"
 #include "Logging/Logger.h"
 #include "RenderingBackend/Abstract/RenderResources.h"
 #include "RenderingBackend/Abstract/ResourceCreationContext.h"
-#include "Util/Semaphore.h"
+#include "Util/Future.h"
 
 #if HOT_RELOAD_RESOURCES
 #include "Util/WatchFile.h"
@@ -21,12 +24,12 @@ struct ImageAndView {
     ImageViewHandle * imageView;
 };
 
-static ImageAndView CreateImageResources(std::vector<uint8_t> const & data, uint32_t width, uint32_t height)
+// data is shared with the renderer since the caller is free to keep using it while the image is being created
+static Future<ImageAndView> CreateImageResources(std::shared_ptr<std::vector<uint8_t> const> data, uint32_t width,
+                                                 uint32_t height)
 {
     OPTICK_EVENT();
-    ImageAndView ret;
-    Semaphore sem;
-    ResourceManager::CreateResources([&ret, &sem, &data, width, height](ResourceCreationContext & ctx) {
+    return ResourceManager::CreateResourcesAsync([data, width, height](ResourceCreationContext & ctx) {
         ResourceCreationContext::ImageCreateInfo ic = {Format::RGBA8,
                                                        ImageHandle::Type::TYPE_2D,
                                                        width,
@@ -36,7 +39,7 @@ static ImageAndView CreateImageResources(std::vector<uint8_t> const & data, uint
                                                        IMAGE_USAGE_FLAG_SAMPLED_BIT |
                                                            IMAGE_USAGE_FLAG_TRANSFER_DST_BIT};
         auto img = ctx.CreateImage(ic);
-        ctx.ImageData(img, data);
+        ctx.ImageData(img, *data);
 
         ResourceCreationContext::ImageViewCreateInfo ivc = {};
         ivc.components.r = ComponentSwizzle::R;
@@ -53,12 +56,8 @@ static ImageAndView CreateImageResources(std::vector<uint8_t> const & data, uint
         ivc.viewType = ImageViewHandle::Type::TYPE_2D;
         auto defaultView = ctx.CreateImageView(ivc);
 
-        ret = {img, defaultView};
-        // TODO: This should actually be async and return a future
-        sem.Signal();
+        return ImageAndView{img, defaultView};
     });
-    sem.Wait();
-    return ret;
 }
 
 bool CheckForTransparency(std::vector<uint8_t> const & data)
@@ -107,6 +106,7 @@ Image::Image(std::string const & fileName, uint32_t width, uint32_t height, bool
 
 Image::~Image()
 {
+    TextureAtlas::GetInstance()->RemoveImage(this);
     auto defaultView = this->defaultView;
     auto img = this->img;
     ResourceManager::DestroyResources([defaultView, img](ResourceCreationContext & ctx) {
@@ -118,9 +118,12 @@ Image::~Image()
 Image * Image::FromData(std::string const & filename, uint32_t width, uint32_t height, std::vector<uint8_t> data)
 {
     OPTICK_EVENT();
-    auto imageAndView = CreateImageResources(data, width, height);
-    auto ret =
-        new Image(filename, width, height, CheckForTransparency(data), imageAndView.image, imageAndView.imageView);
+    auto sharedData = std::make_shared<std::vector<uint8_t> const>(std::move(data));
+    auto imageAndViewFuture = CreateImageResources(sharedData, width, height);
+    // Scanning for transparency overlaps with the renderer creating the image
+    auto hasTransparency = CheckForTransparency(*sharedData);
+    auto imageAndView = imageAndViewFuture.Get();
+    auto ret = new Image(filename, width, height, hasTransparency, imageAndView.image, imageAndView.imageView);
     ResourceManager::AddResource(filename, ret);
     ResourceManager::AddResource(filename + "/defaultView.imageview", ret->defaultView);
     return ret;
@@ -138,12 +141,15 @@ Image * Image::FromFile(std::string const & fileName, bool forceReload)
     if (!dataOpt.has_value()) {
         return nullptr;
     }
-    auto data = dataOpt.value();
+    auto data = std::make_shared<std::vector<uint8_t> const>(std::move(dataOpt.value()));
 
-    auto imageAndView = CreateImageResources(data, width, height);
+    auto imageAndViewFuture = CreateImageResources(data, width, height);
+    // Scanning for transparency overlaps with the renderer creating the image
+    auto hasTransparency = CheckForTransparency(*data);
+    auto imageAndView = imageAndViewFuture.Get();
     logger.Info("Initial load '{}' image={}, imageView={}", fileName, imageAndView.image, imageAndView.imageView);
-    auto ret =
-        new Image(fileName, width, height, CheckForTransparency(data), imageAndView.image, imageAndView.imageView);
+    auto ret = new Image(fileName, width, height, hasTransparency, imageAndView.image, imageAndView.imageView);
+    ret->isFromFile = true;
     ResourceManager::AddResource(fileName, ret);
     ResourceManager::AddResource(fileName + "/defaultView.imageview", ret->defaultView);
 
@@ -161,14 +167,18 @@ Image * Image::FromFile(std::string const & fileName, bool forceReload)
             logger.Warn("Failed to read image file '{}'", fileName);
             return;
         }
-        auto data = dataOpt.value();
+        auto data = std::make_shared<std::vector<uint8_t> const>(std::move(dataOpt.value()));
         auto previousImage = image->img;
         auto previousView = image->defaultView;
-        auto imageAndView = CreateImageResources(data, width, height);
+        auto imageAndView = CreateImageResources(data, width, height).Get();
         image->width = width;
         image->height = height;
         image->img = imageAndView.image;
         image->defaultView = imageAndView.imageView;
+        auto atlas = TextureAtlas::GetInstance();
+        if (atlas->RemoveImage(image)) {
+            atlas->AddImage(image, width, height, *data);
+        }
         logger.Info("Reload '{}' image={}, imageView={}", fileName, imageAndView.image, imageAndView.imageView);
         for (auto cb : image->hotReloadCallbacks) {
             cb.second(image);
@@ -184,6 +194,24 @@ Image * Image::FromFile(std::string const & fileName, bool forceReload)
     return ret;
 }
 
+void Image::AddToAtlas()
+{
+    OPTICK_EVENT();
+    if (!isFromFile || width > TextureAtlas::MAX_IMAGE_SIZE || height > TextureAtlas::MAX_IMAGE_SIZE) {
+        return;
+    }
+    auto atlas = TextureAtlas::GetInstance();
+    if (atlas->Contains(this)) {
+        return;
+    }
+    uint32_t fileWidth, fileHeight;
+    auto data = ReadImageFile(fileName, &fileWidth, &fileHeight);
+    if (!data.has_value()) {
+        return;
+    }
+    atlas->AddImage(this, fileWidth, fileHeight, data.value());
+}
+
 uint32_t Image::GetHeight() const
 {
     return height;
@@ -29,6 +29,13 @@ public:
     ImageViewHandle * GetDefaultView() const { return defaultView; }
     ImageHandle * GetImage() const;
 
+    /**
+     * Copies the image into the TextureAtlas so it can be batched with other atlas images. Only images loaded with
+     * FromFile can be added since the pixels are read from the file again, images are not kept on the CPU otherwise.
+     * Does nothing if the image is too large for the atlas or already in it.
+     */
+    void AddToAtlas();
+
 #if HOT_RELOAD_RESOURCES
     int SubscribeToChanges(std::function<void(Image *)> cb);
     void Unsubscribe(int subscriptionId);
@@ -42,6 +49,7 @@ private:
     ImageHandle * img;
 
     ImageViewHandle * defaultView;
+    bool isFromFile = false;
 
 #if HOT_RELOAD_RESOURCES
     int hotReloadSubscriberId = 0;
@@ -0,0 +1,672 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+#include <ThirdParty/optick/src/optick.h>
+
+// Constants from Forsyth's article. The cache size used for scoring is larger than VERTEX_CACHE_SIZE since the
+// ordering still helps GPUs with larger caches and doesn't hurt ones with smaller caches much.
+static constexpr size_t FORSYTH_CACHE_SIZE = 32;
+static constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.f;
+static constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+// Border edges add a plane perpendicular to their triangle so collapses that move the border are penalized. The weight
+// is relative to the planes of the triangles themselves.
+static constexpr float SIMPLIFY_BORDER_WEIGHT = 10.f;
+// GenerateLods stops once a level would keep more than this fraction of the previous level's triangles
+static constexpr float LOD_MIN_REDUCTION = 0.8f;
+
+struct PackedVertexHash {
+    size_t operator()(PackedVertexWithNormal const & vertex) const
+    {
+        return std::hash<std::string_view>()(std::string_view((char const *)&vertex, sizeof(vertex)));
+    }
+};
+
+struct PackedVertexEqual {
+    bool operator()(PackedVertexWithNormal const & a, PackedVertexWithNormal const & b) const
+    {
+        return std::memcmp(&a, &b, sizeof(PackedVertexWithNormal)) == 0;
+    }
+};
+
+struct PositionHash {
+    size_t operator()(glm::vec3 const & pos) const
+    {
+        return std::hash<std::string_view>()(std::string_view((char const *)&pos, sizeof(pos)));
+    }
+};
+
+struct PositionEqual {
+    bool operator()(glm::vec3 const & a, glm::vec3 const & b) const
+    {
+        return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+    }
+};
+
+// The sum of squared distances to a set of planes, Q(v) = v^T A v + 2 b^T v + c where A is symmetric. Every plane is
+// scaled by its weight so dividing by the total weight gives the weighted mean squared distance.
+struct Quadric {
+    float a00 = 0.f, a11 = 0.f, a22 = 0.f, a01 = 0.f, a02 = 0.f, a12 = 0.f;
+    float b0 = 0.f, b1 = 0.f, b2 = 0.f;
+    float c = 0.f;
+    float weight = 0.f;
+
+    static Quadric FromPlane(glm::vec3 normal, float d, float weight)
+    {
+        Quadric ret;
+        ret.a00 = weight * normal.x * normal.x;
+        ret.a11 = weight * normal.y * normal.y;
+        ret.a22 = weight * normal.z * normal.z;
+        ret.a01 = weight * normal.x * normal.y;
+        ret.a02 = weight * normal.x * normal.z;
+        ret.a12 = weight * normal.y * normal.z;
+        ret.b0 = weight * normal.x * d;
+        ret.b1 = weight * normal.y * d;
+        ret.b2 = weight * normal.z * d;
+        ret.c = weight * d * d;
+        ret.weight = weight;
+        return ret;
+    }
+
+    Quadric & operator+=(Quadric const & other)
+    {
+        a00 += other.a00;
+        a11 += other.a11;
+        a22 += other.a22;
+        a01 += other.a01;
+        a02 += other.a02;
+        a12 += other.a12;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+        return *this;
+    }
+
+    // The weighted mean squared distance from v to the planes
+    float Error(glm::vec3 v) const
+    {
+        float rx = a00 * v.x + a01 * v.y + a02 * v.z;
+        float ry = a01 * v.x + a11 * v.y + a12 * v.z;
+        float rz = a02 * v.x + a12 * v.y + a22 * v.z;
+        float q = rx * v.x + ry * v.y + rz * v.z + 2.f * (b0 * v.x + b1 * v.y + b2 * v.z) + c;
+        return weight > 0.f ? std::abs(q) / weight : 0.f;
+    }
+};
+
+void WeldVertices(std::vector<PackedVertexWithNormal> const & corners, std::vector<PackedVertexWithNormal> & vertices,
+                  std::vector<uint32_t> & indices)
+{
+    OPTICK_EVENT();
+    vertices.clear();
+    indices.clear();
+    indices.reserve(corners.size());
+
+    std::unordered_map<PackedVertexWithNormal, uint32_t, PackedVertexHash, PackedVertexEqual> vertexToIndex;
+    vertexToIndex.reserve(corners.size());
+    for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+        uint32_t triangle[3];
+        for (size_t k = 0; k < 3; ++k) {
+            auto [it, inserted] = vertexToIndex.try_emplace(corners[i + k], (uint32_t)vertices.size());
+            if (inserted) {
+                vertices.push_back(corners[i + k]);
+            }
+            triangle[k] = it->second;
+        }
+        // Triangles that had two corners merged have no area and would never produce any fragments
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+            continue;
+        }
+        indices.insert(indices.end(), triangle, triangle + 3);
+    }
+}
+
+float ComputeAcmr(std::vector<uint32_t> const & indices, size_t numVertices, size_t cacheSize)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0) {
+        return 0.f;
+    }
+    // A vertex is in the FIFO cache if fewer than cacheSize vertices have been added to the cache since it was added
+    std::vector<size_t> cacheTimestamps(numVertices, 0);
+    size_t timestamp = cacheSize + 1;
+    size_t misses = 0;
+    for (auto index : indices) {
+        if (timestamp - cacheTimestamps[index] > cacheSize) {
+            cacheTimestamps[index] = timestamp++;
+            misses++;
+        }
+    }
+    return (float)misses / numTriangles;
+}
+
+static float ForsythVertexScore(int cachePosition, uint32_t remainingValence)
+{
+    if (remainingValence == 0) {
+        return -1.f;
+    }
+    float score = 0.f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The vertices of the last triangle get a fixed score so the next triangle isn't always a neighbour
+            // sharing two of them, which would walk the mesh in thin strips
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        } else {
+            float scale = 1.f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scale, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+    // Vertices with few triangles left are boosted so they are finished off instead of being left as lone triangles
+    score += FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)remainingValence, -FORSYTH_VALENCE_BOOST_POWER);
+    return score;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t> & indices, size_t numVertices)
+{
+    OPTICK_EVENT();
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0) {
+        return;
+    }
+
+    // The triangles using each vertex are stored in one array, starting at adjacencyOffsets[v] for vertex v. The first
+    // remainingValence[v] of them are the ones that have not been emitted yet.
+    std::vector<uint32_t> remainingValence(numVertices, 0);
+    for (auto index : indices) {
+        remainingValence[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+    for (size_t v = 0; v < numVertices; ++v) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingValence[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    std::vector<float> vertexScores(numVertices);
+    for (size_t v = 0; v < numVertices; ++v) {
+        vertexScores[v] = ForsythVertexScore(-1, remainingValence[v]);
+    }
+    std::vector<float> triangleScores(numTriangles);
+    for (size_t t = 0; t < numTriangles; ++t) {
+        triangleScores[t] =
+            vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+    }
+    std::vector<bool> isEmitted(numTriangles, false);
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    size_t nextUnemitted = 0;
+    int64_t bestTriangle = -1;
+    while (result.size() < indices.size()) {
+        if (bestTriangle < 0) {
+            // None of the vertices in the cache have triangles left. Forsyth searches every triangle for the best
+            // score here, starting from the first remaining triangle instead keeps the whole thing linear.
+            while (isEmitted[nextUnemitted]) {
+                nextUnemitted++;
+            }
+            bestTriangle = (int64_t)nextUnemitted;
+        }
+
+        isEmitted[bestTriangle] = true;
+        uint32_t const * triangle = &indices[bestTriangle * 3];
+        newCache.clear();
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t v = triangle[k];
+            result.push_back(v);
+            newCache.push_back(v);
+            auto begin = adjacency.begin() + adjacencyOffsets[v];
+            auto end = begin + remainingValence[v];
+            std::iter_swap(std::find(begin, end, (uint32_t)bestTriangle), end - 1);
+            remainingValence[v]--;
+        }
+        for (auto v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache.push_back(v);
+            }
+        }
+
+        // Vertices past FORSYTH_CACHE_SIZE have just been pushed out of the cache and are rescored as uncached
+        for (size_t i = 0; i < newCache.size(); ++i) {
+            uint32_t v = newCache[i];
+            float score = ForsythVertexScore(i < FORSYTH_CACHE_SIZE ? (int)i : -1, remainingValence[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+            for (uint32_t j = adjacencyOffsets[v]; j < adjacencyOffsets[v] + remainingValence[v]; ++j) {
+                triangleScores[adjacency[j]] += delta;
+            }
+        }
+        if (newCache.size() > FORSYTH_CACHE_SIZE) {
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        std::swap(cache, newCache);
+
+        // Only triangles using a cached vertex had their score changed, so the best triangle is one of them
+        bestTriangle = -1;
+        float bestScore = -1.f;
+        for (auto v : cache) {
+            for (uint32_t j = adjacencyOffsets[v]; j < adjacencyOffsets[v] + remainingValence[v]; ++j) {
+                uint32_t t = adjacency[j];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+    indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t> & indices, std::vector<PackedVertexWithNormal> const & vertices,
+                      float threshold)
+{
+    OPTICK_EVENT();
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles < 2) {
+        return;
+    }
+
+    // Hard boundaries are where the cache simulation misses every vertex of a triangle. Reordering the clusters
+    // between them can't make the ACMR any worse since nothing is reused across the boundary anyway.
+    std::vector<size_t> cacheTimestamps(vertices.size(), 0);
+    size_t timestamp = VERTEX_CACHE_SIZE + 1;
+    auto isCacheMiss = [&](uint32_t index) {
+        if (timestamp - cacheTimestamps[index] > VERTEX_CACHE_SIZE) {
+            cacheTimestamps[index] = timestamp++;
+            return true;
+        }
+        return false;
+    };
+    std::vector<uint8_t> triangleMisses(numTriangles);
+    std::vector<size_t> hardBoundaries;
+    for (size_t t = 0; t < numTriangles; ++t) {
+        triangleMisses[t] = isCacheMiss(indices[t * 3]) + isCacheMiss(indices[t * 3 + 1]) +
+                            isCacheMiss(indices[t * 3 + 2]);
+        if (t == 0 || triangleMisses[t] == 3) {
+            hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(numTriangles);
+
+    // Hard clusters are split further at points where the part so far has an ACMR within the threshold of the whole
+    // cluster's. The cache is flushed at the start of each part since it may be drawn after anything.
+    std::vector<size_t> clusterStarts;
+    for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c) {
+        size_t hardStart = hardBoundaries[c];
+        size_t hardEnd = hardBoundaries[c + 1];
+        size_t hardMisses = 0;
+        for (size_t t = hardStart; t < hardEnd; ++t) {
+            hardMisses += triangleMisses[t];
+        }
+        float hardAcmr = (float)hardMisses / (hardEnd - hardStart);
+
+        clusterStarts.push_back(hardStart);
+        timestamp += VERTEX_CACHE_SIZE + 1;
+        size_t start = hardStart;
+        size_t misses = 0;
+        for (size_t t = hardStart; t + 1 < hardEnd; ++t) {
+            misses += isCacheMiss(indices[t * 3]) + isCacheMiss(indices[t * 3 + 1]) + isCacheMiss(indices[t * 3 + 2]);
+            if (misses <= threshold * hardAcmr * (t + 1 - start)) {
+                clusterStarts.push_back(t + 1);
+                timestamp += VERTEX_CACHE_SIZE + 1;
+                start = t + 1;
+                misses = 0;
+            }
+        }
+    }
+    clusterStarts.push_back(numTriangles);
+    size_t numClusters = clusterStarts.size() - 1;
+    if (numClusters < 2) {
+        return;
+    }
+
+    // Clusters on the outside of the mesh facing away from its center are the most likely to occlude other clusters
+    std::vector<glm::vec3> clusterCentroids(numClusters, glm::vec3(0.f));
+    std::vector<glm::vec3> clusterNormals(numClusters, glm::vec3(0.f));
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t c = 0; c < numClusters; ++c) {
+        float clusterArea = 0.f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            auto p0 = vertices[indices[t * 3]].pos;
+            auto p1 = vertices[indices[t * 3 + 1]].pos;
+            auto p2 = vertices[indices[t * 3 + 2]].pos;
+            // The length of the cross product is twice the triangle's area, so summing them weighs by area
+            auto normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal) * 0.5f;
+            clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.f);
+            clusterNormals[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += clusterCentroids[c];
+        meshArea += clusterArea;
+        clusterCentroids[c] = clusterArea > 0.f ? clusterCentroids[c] / clusterArea : glm::vec3(0.f);
+    }
+    if (meshArea > 0.f) {
+        meshCentroid /= meshArea;
+    }
+
+    std::vector<float> clusterSortKeys(numClusters);
+    for (size_t c = 0; c < numClusters; ++c) {
+        float normalLength = glm::length(clusterNormals[c]);
+        clusterSortKeys[c] =
+            normalLength > 0.f ? glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength) : 0.f;
+    }
+    std::vector<size_t> clusterOrder(numClusters);
+    for (size_t c = 0; c < numClusters; ++c) {
+        clusterOrder[c] = c;
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterSortKeys](size_t a, size_t b) {
+        return clusterSortKeys[a] > clusterSortKeys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (auto c : clusterOrder) {
+        result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+void OptimizeVertexFetch(std::vector<uint32_t> & indices, std::vector<PackedVertexWithNormal> & vertices)
+{
+    OPTICK_EVENT();
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<PackedVertexWithNormal> result;
+    result.reserve(vertices.size());
+    for (auto & index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = (uint32_t)result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(result);
+}
+
+enum class SimplifyVertexKind : uint8_t {
+    MANIFOLD,
+    // On an edge used by only one triangle, may only collapse along such edges
+    BORDER,
+    // On a UV or normal seam, a non-manifold edge or where borders meet, never collapsed
+    LOCKED,
+};
+
+static uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+std::vector<uint32_t> SimplifyMesh(std::vector<uint32_t> const & indices,
+                                   std::vector<PackedVertexWithNormal> const & vertices, size_t targetIndexCount,
+                                   float & error)
+{
+    OPTICK_EVENT();
+    error = 0.f;
+    size_t const numVertices = vertices.size();
+
+    // Vertices that only differ by their normal or UV are different vertices in the index buffer but the same point on
+    // the surface. The topology is worked out on the first vertex at each position so seams don't look like holes.
+    std::vector<uint32_t> positionIds(numVertices);
+    std::vector<uint32_t> verticesAtPosition(numVertices, 0);
+    {
+        std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> positionToId;
+        positionToId.reserve(numVertices);
+        for (uint32_t v = 0; v < numVertices; ++v) {
+            positionIds[v] = positionToId.try_emplace(vertices[v].pos, v).first->second;
+            verticesAtPosition[positionIds[v]]++;
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    edgeUses.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            edgeUses[EdgeKey(positionIds[indices[i + k]], positionIds[indices[i + (k + 1) % 3]])]++;
+        }
+    }
+
+    std::vector<Quadric> quadrics(numVertices);
+    std::vector<SimplifyVertexKind> kinds(numVertices, SimplifyVertexKind::MANIFOLD);
+    std::vector<uint8_t> borderEdgeCounts(numVertices, 0);
+    for (uint32_t v = 0; v < numVertices; ++v) {
+        if (verticesAtPosition[v] > 1) {
+            kinds[v] = SimplifyVertexKind::LOCKED;
+        }
+    }
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        uint32_t p[3] = {positionIds[indices[i]], positionIds[indices[i + 1]], positionIds[indices[i + 2]]};
+        auto normal = glm::cross(vertices[p[1]].pos - vertices[p[0]].pos, vertices[p[2]].pos - vertices[p[0]].pos);
+        float length = glm::length(normal);
+        if (length == 0.f) {
+            continue;
+        }
+        normal /= length;
+        auto quadric = Quadric::FromPlane(normal, -glm::dot(normal, vertices[p[0]].pos), length * 0.5f);
+        for (size_t k = 0; k < 3; ++k) {
+            quadrics[p[k]] += quadric;
+        }
+
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t a = p[k];
+            uint32_t b = p[(k + 1) % 3];
+            uint32_t uses = edgeUses[EdgeKey(a, b)];
+            if (uses > 2) {
+                kinds[a] = SimplifyVertexKind::LOCKED;
+                kinds[b] = SimplifyVertexKind::LOCKED;
+            } else if (uses == 1) {
+                auto edge = vertices[b].pos - vertices[a].pos;
+                float edgeLength = glm::length(edge);
+                if (edgeLength == 0.f) {
+                    continue;
+                }
+                auto borderNormal = glm::cross(edge / edgeLength, normal);
+                auto borderQuadric = Quadric::FromPlane(borderNormal,
+                                                        -glm::dot(borderNormal, vertices[a].pos),
+                                                        edgeLength * edgeLength * SIMPLIFY_BORDER_WEIGHT);
+                quadrics[a] += borderQuadric;
+                quadrics[b] += borderQuadric;
+                borderEdgeCounts[a]++;
+                borderEdgeCounts[b]++;
+            }
+        }
+    }
+    for (uint32_t v = 0; v < numVertices; ++v) {
+        if (borderEdgeCounts[v] > 0 && kinds[v] == SimplifyVertexKind::MANIFOLD) {
+            // More than two border edges means several borders meet here and moving it would tear one of them
+            kinds[v] = borderEdgeCounts[v] == 2 ? SimplifyVertexKind::BORDER : SimplifyVertexKind::LOCKED;
+        }
+    }
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+    auto canCollapse = [&](uint32_t from, uint32_t to) {
+        // verticesAtPosition is 0 for vertices that aren't the first at their position, which are all on seams
+        if (verticesAtPosition[from] != 1 || verticesAtPosition[to] != 1 || kinds[from] == SimplifyVertexKind::LOCKED) {
+            return false;
+        }
+        if (kinds[from] == SimplifyVertexKind::BORDER) {
+            auto uses = edgeUses.find(EdgeKey(from, to));
+            return uses != edgeUses.end() && uses->second == 1;
+        }
+        return true;
+    };
+
+    // Only vertices that are alone at their position are collapsed or collapsed onto, so the collapses can be done on
+    // the indices directly without mixing up the normals and UVs of seam vertices
+    std::vector<uint32_t> result = indices;
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint8_t> isCollapsing(numVertices);
+    std::vector<uint32_t> remap(numVertices);
+    // Every pass collapses an independent set of edges, picking the cheapest ones first. No vertex in the one-ring of
+    // an accepted collapse is moved by another collapse in the same pass, so the triangles flipsTriangle checked keep
+    // their shape until the pass is applied
+    while (result.size() > targetIndexCount) {
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (auto v : result) {
+            adjacencyOffsets[v + 1]++;
+        }
+        for (size_t v = 0; v < numVertices; ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); ++i) {
+                adjacency[fill[result[i]]++] = (uint32_t)(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                uint32_t a = result[i + k];
+                uint32_t b = result[i + (k + 1) % 3];
+                for (auto [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+                    if (canCollapse(from, to)) {
+                        Quadric combined = quadrics[from];
+                        combined += quadrics[to];
+                        collapses.push_back({from, to, combined.Error(vertices[to].pos)});
+                    }
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](Collapse const & a, Collapse const & b) {
+            return a.error < b.error;
+        });
+
+        // Collapses that would flip a triangle around the collapsed vertex are skipped
+        auto flipsTriangle = [&](uint32_t from, uint32_t to) {
+            for (uint32_t j = adjacencyOffsets[from]; j < adjacencyOffsets[from + 1]; ++j) {
+                uint32_t const * triangle = &result[adjacency[j] * 3];
+                if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                    continue;
+                }
+                glm::vec3 before[3] = {vertices[triangle[0]].pos, vertices[triangle[1]].pos, vertices[triangle[2]].pos};
+                glm::vec3 after[3] = {before[0], before[1], before[2]};
+                for (size_t k = 0; k < 3; ++k) {
+                    if (triangle[k] == from) {
+                        after[k] = vertices[to].pos;
+                    }
+                }
+                auto normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                auto normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(normalBefore, normalAfter) <= 0.f) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        std::fill(isCollapsing.begin(), isCollapsing.end(), 0);
+        for (uint32_t v = 0; v < numVertices; ++v) {
+            remap[v] = v;
+        }
+        // A manifold collapse removes two triangles and a border collapse removes one
+        size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t trianglesRemoved = 0;
+        for (auto const & collapse : collapses) {
+            if (trianglesRemoved >= trianglesToRemove) {
+                break;
+            }
+            if (isCollapsing[collapse.from] || isCollapsing[collapse.to] || flipsTriangle(collapse.from, collapse.to)) {
+                continue;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            for (uint32_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; ++j) {
+                uint32_t const * triangle = &result[adjacency[j] * 3];
+                isCollapsing[triangle[0]] = 1;
+                isCollapsing[triangle[1]] = 1;
+                isCollapsing[triangle[2]] = 1;
+            }
+            trianglesRemoved += kinds[collapse.from] == SimplifyVertexKind::BORDER ? 1 : 2;
+            error = std::max(error, collapse.error);
+        }
+        if (trianglesRemoved == 0) {
+            break;
+        }
+
+        size_t numIndices = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = remap[result[i]];
+            uint32_t b = remap[result[i + 1]];
+            uint32_t c = remap[result[i + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            result[numIndices++] = a;
+            result[numIndices++] = b;
+            result[numIndices++] = c;
+        }
+        result.resize(numIndices);
+    }
+    error = std::sqrt(error);
+    return result;
+}
+
+std::vector<MeshLod> GenerateLods(std::vector<uint32_t> const & indices,
+                                  std::vector<PackedVertexWithNormal> const & vertices)
+{
+    OPTICK_EVENT();
+    std::vector<MeshLod> ret;
+    size_t previousIndexCount = indices.size();
+    float previousError = 0.f;
+    for (size_t lod = 1; lod < MAX_MESH_LODS; ++lod) {
+        size_t targetIndexCount = (indices.size() / 3 >> lod) * 3;
+        if (targetIndexCount == 0) {
+            break;
+        }
+        // Every level is simplified from the full detail mesh so its error is measured against the full detail mesh
+        MeshLod level;
+        level.indices = SimplifyMesh(indices, vertices, targetIndexCount, level.error);
+        if (level.indices.empty() || level.indices.size() > previousIndexCount * LOD_MIN_REDUCTION) {
+            break;
+        }
+        // Selecting a level assumes that the error never goes down as the levels get coarser
+        level.error = std::max(level.error, previousError);
+        OptimizeVertexCache(level.indices, vertices.size());
+        previousIndexCount = level.indices.size();
+        previousError = level.error;
+        ret.push_back(std::move(level));
+    }
+    return ret;
+}
+
+MeshOptimizationResult OptimizeMesh(std::vector<PackedVertexWithNormal> const & corners)
+{
+    OPTICK_EVENT();
+    MeshOptimizationResult ret;
+    ret.inputVertexCount = corners.size();
+    WeldVertices(corners, ret.vertices, ret.indices);
+    ret.acmrBefore = ComputeAcmr(ret.indices, ret.vertices.size());
+    OptimizeVertexCache(ret.indices, ret.vertices.size());
+    OptimizeOverdraw(ret.indices, ret.vertices);
+    OptimizeVertexFetch(ret.indices, ret.vertices);
+    ret.acmrAfter = ComputeAcmr(ret.indices, ret.vertices.size());
+    return ret;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Core/Rendering/Vertex.h"
+
+// Size of the FIFO post-transform cache that ComputeAcmr simulates. Most GPUs have a cache of at least this size.
+size_t constexpr VERTEX_CACHE_SIZE = 16;
+// The most levels of detail GenerateLods creates, including the full detail mesh
+size_t constexpr MAX_MESH_LODS = 4;
+
+struct MeshOptimizationResult {
+    std::vector<PackedVertexWithNormal> vertices;
+    std::vector<uint32_t> indices;
+
+    // Number of vertices before welding, one per triangle corner
+    size_t inputVertexCount = 0;
+    // Average cache miss ratio of the welded mesh with the triangles in the order they were in the file
+    float acmrBefore = 0.f;
+    // Average cache miss ratio after the triangles have been reordered
+    float acmrAfter = 0.f;
+};
+
+/**
+ * Turns a triangle list where every corner has its own vertex into an indexed mesh with identical vertices merged. The
+ * vertices are compared after packing so vertices that only differ by less than the packed precision are merged too.
+ */
+void WeldVertices(std::vector<PackedVertexWithNormal> const & corners, std::vector<PackedVertexWithNormal> & vertices,
+                  std::vector<uint32_t> & indices);
+
+/**
+ * Returns the average number of vertex shader invocations per triangle when drawing indices on a GPU with a FIFO
+ * post-transform cache of cacheSize vertices. 3 is the worst case and 0.5 is the best possible for large grids.
+ */
+float ComputeAcmr(std::vector<uint32_t> const & indices, size_t numVertices, size_t cacheSize = VERTEX_CACHE_SIZE);
+
+/**
+ * Reorders triangles so vertices are reused while they are still in the post-transform cache. Uses the algorithm from
+ * Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+ */
+void OptimizeVertexCache(std::vector<uint32_t> & indices, size_t numVertices);
+
+/**
+ * Reorders clusters of triangles so that clusters facing away from the center of the mesh are drawn first, which
+ * makes them more likely to occlude the rest of the mesh. Should run after OptimizeVertexCache. Clusters are only
+ * split where doing so keeps the ACMR within threshold times the ACMR of the input. See "Fast Triangle Reordering for
+ * Vertex Locality and Reduced Overdraw" (Sander et al. 2007).
+ */
+void OptimizeOverdraw(std::vector<uint32_t> & indices, std::vector<PackedVertexWithNormal> const & vertices,
+                      float threshold = 1.05f);
+
+/**
+ * Reorders vertices into the order the indices first use them so vertex fetches read memory linearly, and removes
+ * vertices that no triangle uses. The indices are rewritten to match.
+ */
+void OptimizeVertexFetch(std::vector<uint32_t> & indices, std::vector<PackedVertexWithNormal> & vertices);
+
+/**
+ * Runs all of the above on a triangle list where every corner has its own vertex.
+ */
+MeshOptimizationResult OptimizeMesh(std::vector<PackedVertexWithNormal> const & corners);
+
+struct MeshLod {
+    std::vector<uint32_t> indices;
+    // The largest quadric error of the collapses that produced the simplified mesh, in the mesh's units. This is the
+    // area weighted RMS distance from the collapsed vertex to the planes of the triangles that were merged into it, an
+    // estimate of how far the simplified surface strays from the full detail one which can underestimate the largest
+    // distance
+    float error;
+};
+
+/**
+ * Simplifies the mesh by collapsing edges in the order of least quadric error until at most targetIndexCount indices
+ * are left or no more edges can be collapsed. See "Surface Simplification Using Quadric Error Metrics" (Garland and
+ * Heckbert 1997). Edges are collapsed onto one of their existing vertices, so the simplified indices use the same
+ * vertices as the input. Vertices on UV or normal seams are never moved, and vertices on the border of the mesh only
+ * move along the border. error is set to the largest quadric error of the collapses, see MeshLod::error.
+ */
+std::vector<uint32_t> SimplifyMesh(std::vector<uint32_t> const & indices,
+                                   std::vector<PackedVertexWithNormal> const & vertices, size_t targetIndexCount,
+                                   float & error);
+
+/**
+ * Returns up to MAX_MESH_LODS - 1 levels of detail after the full detail mesh, each with about half the triangles of
+ * the one before. Stops early once simplifying no longer removes a meaningful number of triangles. The indices of
+ * each level are optimized for the vertex cache.
+ */
+std::vector<MeshLod> GenerateLods(std::vector<uint32_t> const & indices,
+                                  std::vector<PackedVertexWithNormal> const & vertices);
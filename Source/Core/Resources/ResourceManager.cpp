@@ -8,7 +8,9 @@ namespace ResourceManager
 {
 Logger logger = Logger::Create("ResourceManager");
 RenderSystem * renderSystem;
+IRenderer * renderer;
 std::unordered_map<std::string, void *> resources;
+std::mutex resourcesLock;
 
 void CreateResources(std::function<void(ResourceCreationContext &)> && fun)
 {
@@ -22,8 +24,9 @@ void DestroyResources(std::function<void(ResourceCreationContext &)> && fun)
     renderSystem->DestroyResources(std::move(fun));
 }
 
-void Init(RenderSystem * inRenderSystem)
+void Init(RenderSystem * inRenderSystem, IRenderer * inRenderer)
 {
     renderSystem = inRenderSystem;
+    renderer = inRenderer;
 }
 }
@@ -2,28 +2,44 @@
 #include <filesystem>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include "Logging/Logger.h"
+#include "RenderingBackend/Abstract/AbstractRenderer.h"
 
 class RenderSystem;
-class ResourceCreationContext;
 
 namespace ResourceManager
 {
 extern Logger logger;
 extern std::unordered_map<std::string, void *> resources;
+// Guards resources, resources may be added from job threads while other jobs are looking resources up
+extern std::mutex resourcesLock;
+extern IRenderer * renderer;
 
 void CreateResources(std::function<void(ResourceCreationContext &)> && fun);
 void DestroyResources(std::function<void(ResourceCreationContext &)> && fun);
-void Init(RenderSystem * renderSystem);
+void Init(RenderSystem * renderSystem, IRenderer * renderer);
+
+/**
+ * Same as IRenderer::CreateResourcesAsync, returns a future which is completed with fun's return value once the
+ * renderer has ran it.
+ */
+template <typename Fun>
+auto CreateResourcesAsync(Fun && fun)
+{
+    return renderer->CreateResourcesAsync(std::forward<Fun>(fun));
+}
 
 template <typename T>
 void AddResource(std::string const & name, T * resource)
 {
     auto newName = std::filesystem::path(name).make_preferred().string();
     logger.Info("Adding resource '{}' = {}", newName, resource);
+    std::lock_guard<std::mutex> guard(resourcesLock);
     resources.insert_or_assign(newName, resource);
 }
 
@@ -31,10 +47,12 @@ template <typename T>
 T * GetResource(std::string const & name)
 {
     auto newName = std::filesystem::path(name).make_preferred().string();
-    if (resources.find(newName) == resources.end()) {
+    std::lock_guard<std::mutex> guard(resourcesLock);
+    auto it = resources.find(newName);
+    if (it == resources.end()) {
         logger.Info("Resource '{}' not found", newName);
         return nullptr;
     }
-    return (T *)resources.at(newName);
+    return (T *)it->second;
 }
 }
@@ -1,8 +1,11 @@
 #include "ShaderProgram.h"
 
 #include <cassert>
+#include <chrono>
 #include <filesystem>
 
+#include <ThirdParty/optick/src/optick.h>
+
 #include "Core/Rendering/GlslToSpirvShaderCompiler.h"
 #include "Core/Resources/ResourceManager.h"
 #include "Logging/Logger.h"
@@ -40,24 +43,41 @@ static ShaderStageFlagBits ToFlagBit(ResourceCreationContext::ShaderModuleCreate
     }
 }
 
-std::vector<ShaderProgram::ShaderStage> ShaderProgram::ReadShaderStages(std::vector<std::string> const & fileNames,
-                                                                        ResourceCreationContext & ctx)
+std::vector<std::optional<std::vector<uint32_t>>>
+ShaderProgram::CompileShaderStages(std::vector<std::string> const & fileNames)
 {
+    OPTICK_EVENT();
     GlslToSpirvShaderCompiler glslCompiler(std::make_shared<DefaultFileSlurper>());
-    std::vector<ShaderStage> stages(fileNames.size());
+    std::vector<std::optional<std::vector<uint32_t>>> ret(fileNames.size());
     for (size_t i = 0; i < fileNames.size(); ++i) {
-        stages[i].stage = GetShaderStage(fileNames[i]);
-        stages[i].fileName = fileNames[i];
         auto compileResult = glslCompiler.CompileGlslFile(fileNames[i]);
         if (!compileResult.IsSuccessful()) {
             logger.Error("GLSL compilation failed, error message: {}", compileResult.GetErrorMessage().value());
+            continue;
+        }
+        ret[i] = compileResult.GetCompiledCode();
+    }
+    return ret;
+}
+
+std::vector<ShaderProgram::ShaderStage>
+ShaderProgram::CreateShaderStages(std::vector<std::string> const & fileNames,
+                                  std::vector<std::optional<std::vector<uint32_t>>> const & code,
+                                  ResourceCreationContext & ctx)
+{
+    assert(fileNames.size() == code.size());
+    std::vector<ShaderStage> stages(fileNames.size());
+    for (size_t i = 0; i < fileNames.size(); ++i) {
+        stages[i].stage = GetShaderStage(fileNames[i]);
+        stages[i].fileName = fileNames[i];
+        if (!code[i].has_value()) {
             stages[i].compiledSuccessfully = false;
             continue;
         }
         stages[i].compiledSuccessfully = true;
 
         ResourceCreationContext::ShaderModuleCreateInfo shaderCreateInfo;
-        shaderCreateInfo.code = compileResult.GetCompiledCode();
+        shaderCreateInfo.code = code[i].value();
         shaderCreateInfo.type = stages[i].stage;
         stages[i].shaderModule = ctx.CreateShaderModule(shaderCreateInfo);
     }
@@ -133,12 +153,18 @@ ShaderProgram * ShaderProgram::Create(
     ResourceCreationContext::GraphicsPipelineCreateInfo::PipelineDepthStencilStateCreateInfo depthStencil,
     std::unordered_map<uint32_t, uint32_t> specializationConstants)
 {
+    OPTICK_EVENT();
     assert(fileNames.size() > 0);
 
+    auto compileStart = std::chrono::high_resolution_clock::now();
+    auto code = CompileShaderStages(fileNames);
+    auto pipelineStart = std::chrono::high_resolution_clock::now();
+
     ShaderProgram * ret;
     Semaphore sem;
     ResourceManager::CreateResources([&ret,
                                       &sem,
+                                      &code,
                                       depthStencil,
                                       name,
                                       fileNames,
@@ -151,9 +177,7 @@ ShaderProgram * ShaderProgram::Create(
                                       inputAssembly,
                                       vertexInputState,
                                       specializationConstants](ResourceCreationContext & ctx) {
-        GlslToSpirvShaderCompiler glslCompiler(std::make_shared<DefaultFileSlurper>());
-
-        auto stages = ReadShaderStages(fileNames, ctx);
+        auto stages = CreateShaderStages(fileNames, code, ctx);
         for (size_t i = 0; i < stages.size(); ++i) {
             auto const & stage = stages[i];
             if (!stage.compiledSuccessfully) {
@@ -197,6 +221,13 @@ ShaderProgram * ShaderProgram::Create(
     sem.Wait();
     ResourceManager::AddResource(name, ret);
 
+    auto end = std::chrono::high_resolution_clock::now();
+    logger.Info("Created shader program '{}' in {}ms (compile={}ms, pipeline={}ms)",
+                name,
+                std::chrono::duration<float, std::milli>(end - compileStart).count(),
+                std::chrono::duration<float, std::milli>(pipelineStart - compileStart).count(),
+                std::chrono::duration<float, std::milli>(end - pipelineStart).count());
+
 #if HOT_RELOAD_RESOURCES
     for (auto fileName : fileNames) {
         WatchFile(fileName, [name, fileName]() {
@@ -207,13 +238,14 @@ ShaderProgram * ShaderProgram::Create(
                     "fileName='{}' changed, but ResourceManager had no reference to program '{}'", fileName, name);
                 return;
             }
-            ResourceManager::CreateResources([program](ResourceCreationContext & ctx) {
-                std::vector<std::string> fileNames(program->stages.size());
-                for (size_t i = 0; i < fileNames.size(); ++i) {
-                    fileNames[i] = program->stages[i].fileName;
-                }
+            std::vector<std::string> fileNames(program->stages.size());
+            for (size_t i = 0; i < fileNames.size(); ++i) {
+                fileNames[i] = program->stages[i].fileName;
+            }
+            auto code = CompileShaderStages(fileNames);
+            ResourceManager::CreateResources([program, fileNames, code](ResourceCreationContext & ctx) {
                 auto oldStages = program->stages;
-                auto newStages = ReadShaderStages(fileNames, ctx);
+                auto newStages = CreateShaderStages(fileNames, code, ctx);
                 for (size_t i = 0; i < newStages.size(); ++i) {
                     if (!newStages[i].compiledSuccessfully) {
                         logger.Error("Shader stage {} ({}) failed to compile for shader program '{}', will not reload.",
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -52,8 +54,15 @@ private:
         ResourceCreationContext::GraphicsPipelineCreateInfo::PipelineDepthStencilStateCreateInfo depthStencil,
         std::unordered_map<uint32_t, uint32_t> specializationConstants);
 
-    static std::vector<ShaderStage> ReadShaderStages(std::vector<std::string> const & fileNames,
-                                                     ResourceCreationContext & ctx);
+    /**
+     * Compiles the GLSL files to SPIR-V. This does not touch the renderer so it can run on any thread, outside of
+     * CreateResources. Stages that failed to compile are nullopt.
+     */
+    static std::vector<std::optional<std::vector<uint32_t>>>
+    CompileShaderStages(std::vector<std::string> const & fileNames);
+    static std::vector<ShaderStage> CreateShaderStages(std::vector<std::string> const & fileNames,
+                                                       std::vector<std::optional<std::vector<uint32_t>>> const & code,
+                                                       ResourceCreationContext & ctx);
     static PipelineHandle * CreatePipeline(
         std::vector<ShaderStage>, VertexInputStateHandle * vertexInputState, PipelineLayoutHandle * pipelineLayout,
         RenderPassHandle * renderPass, CullMode cullMode, FrontFace frontFace, uint32_t subpass,
@@ -124,7 +124,7 @@ struct BoneBuilder {
 struct SubmeshBuilder {
     std::string name;
     std::optional<std::vector<uint32_t>> indices;
-    std::vector<VertexWithSkinning> vertices;
+    std::vector<PackedVertexWithSkinning> vertices;
     Material * material;
 };
 
@@ -289,7 +289,7 @@ SkeletalMesh * SkeletalMeshLoaderAssimp::LoadFile(std::string const & filename)
             }
         }
 
-        std::vector<VertexWithSkinning> vertices;
+        std::vector<PackedVertexWithSkinning> vertices;
         vertices.reserve(mesh->mNumVertices);
         for (uint32_t j = 0; j < mesh->mNumVertices; ++j) {
             auto vert = mesh->mVertices[j];
@@ -320,7 +320,7 @@ SkeletalMesh * SkeletalMeshLoaderAssimp::LoadFile(std::string const & filename)
                     ++weightIdx;
                 }
             }
-            vertices.push_back(vertex);
+            vertices.push_back(PackVertex(vertex));
         }
 
         std::optional<std::vector<uint32_t>> indices;
@@ -344,7 +344,7 @@ SkeletalMesh * SkeletalMeshLoaderAssimp::LoadFile(std::string const & filename)
         if (indices.has_value()) {
             totalEboSize += indices.value().size() * sizeof(uint32_t);
         }
-        totalVboSize += vertices.size() * sizeof(VertexWithSkinning);
+        totalVboSize += vertices.size() * sizeof(PackedVertexWithSkinning);
         submeshBuilders.push_back({mesh->mName.C_Str(), indices, vertices, material});
     }
 
@@ -364,7 +364,8 @@ SkeletalMesh * SkeletalMeshLoaderAssimp::LoadFile(std::string const & filename)
     auto vertexBufferSlice = BufferAllocator::GetInstance()->AllocateBuffer(totalVboSize,
                                                                             BufferUsageFlags::VERTEX_BUFFER_BIT |
                                                                                 BufferUsageFlags::TRANSFER_DST_BIT,
-                                                                            MemoryPropertyFlagBits::DEVICE_LOCAL_BIT);
+                                                                            MemoryPropertyFlagBits::DEVICE_LOCAL_BIT,
+                                                                            sizeof(PackedVertexWithSkinning));
 
     std::vector<Submesh> submeshes;
     submeshes.reserve(scene->mNumMeshes);
@@ -387,7 +388,7 @@ SkeletalMesh * SkeletalMeshLoaderAssimp::LoadFile(std::string const & filename)
                     submeshIndexBuffer = BufferSlice(indexBufferSlice.value().GetBuffer(), totalOffset, totalSize);
                 }
                 size_t totalOffset = vertexBufferSlice.GetOffset() + vboOffset;
-                size_t totalSize = builder.vertices.size() * sizeof(VertexWithSkinning);
+                size_t totalSize = builder.vertices.size() * sizeof(PackedVertexWithSkinning);
                 ctx.BufferSubData(
                     vertexBufferSlice.GetBuffer(), (uint8_t *)builder.vertices.data(), totalOffset, totalSize);
                 vboOffset += totalSize;
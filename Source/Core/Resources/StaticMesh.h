@@ -1,16 +1,55 @@
 #pragma once
 
+#include <cstdint>
+#include <utility>
 #include <vector>
 
+#include <ThirdParty/glm/glm/glm.hpp>
+
 #include "Submesh.h"
 
+// A simplified version of a submesh, stored in the submesh's index buffer after the full detail indices
+struct SubmeshLod {
+    // In indices from the start of the submesh's index buffer slice
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // The largest quadric error of the collapses that produced the LOD, in the mesh's units. An estimate of how far
+    // the simplified surface strays from the full detail one, see MeshLod::error
+    float error;
+};
+
+// The full detail triangles of the mesh kept on the CPU for occlusion culling, in the mesh's local space
+struct OccluderMesh {
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+};
+
 class StaticMesh
 {
 public:
-    StaticMesh(std::vector<Submesh> const & submeshes) : submeshes(submeshes) {}
+    StaticMesh(std::vector<Submesh> const & submeshes, glm::vec3 boundsMin, glm::vec3 boundsMax,
+               std::vector<std::vector<SubmeshLod>> const & lods = {}, OccluderMesh occluder = {})
+        : submeshes(submeshes), boundsMin(boundsMin), boundsMax(boundsMax), lods(lods), occluder(std::move(occluder))
+    {
+        this->lods.resize(submeshes.size());
+    }
 
     inline std::vector<Submesh> const & GetSubmeshes() const { return submeshes; }
+    inline glm::vec3 GetBoundsMin() const { return boundsMin; }
+    inline glm::vec3 GetBoundsMax() const { return boundsMax; }
+    /**
+     * Returns the simplified versions of the submesh at submeshIndex, from most to least detailed. Does not include
+     * the full detail submesh, so it is empty for submeshes without LODs.
+     */
+    inline std::vector<SubmeshLod> const & GetLods(size_t submeshIndex) const { return lods[submeshIndex]; }
+    // Empty if the mesh has no CPU side triangles, in which case it can not be used as an occluder
+    inline OccluderMesh const & GetOccluder() const { return occluder; }
 
 private:
     std::vector<Submesh> submeshes;
+    // Axis aligned bounding box of every submesh in the mesh's local space
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    std::vector<std::vector<SubmeshLod>> lods;
+    OccluderMesh occluder;
 };
@@ -1,6 +1,8 @@
 #include "StaticMeshLoaderObj.h"
 
+#include <cstring>
 #include <filesystem>
+#include <limits>
 #include <unordered_map>
 
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -13,6 +15,7 @@
 #include "Core/Rendering/Vertex.h"
 #include "Core/Resources/Image.h"
 #include "Core/Resources/Material.h"
+#include "Core/Resources/MeshOptimizer.h"
 #include "Core/Resources/ResourceManager.h"
 #include "Core/Resources/StaticMesh.h"
 #include "Jobs/JobEngine.h"
@@ -25,7 +28,13 @@ static const auto logger = Logger::Create("StaticMeshLoaderObj");
 struct CpuSubmesh {
     std::string name;
     Material * material;
-    std::vector<VertexWithNormal> vertices;
+    std::vector<PackedVertexWithNormal> vertices;
+    // Either uint16_t or uint32_t indices depending on indexType. The full detail indices come first, followed by
+    // the indices of each LOD.
+    std::vector<uint8_t> indices;
+    size_t numIndexes;
+    CommandBuffer::IndexType indexType;
+    std::vector<SubmeshLod> lods;
 };
 
 void StaticMeshLoaderObj::LoadFile(std::string const & filename, std::function<void(StaticMesh *)> callback)
@@ -139,9 +148,15 @@ void StaticMeshLoaderObj::LoadFile(std::string const & filename, std::function<v
             std::vector<Submesh> submeshes;
             std::vector<CpuSubmesh> cpuSubmeshes;
             size_t totalVboSize = 0;
+            size_t totalEboSize = 0;
+            glm::vec3 boundsMin(std::numeric_limits<float>::max());
+            glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+            OccluderMesh occluder;
             for (size_t s = 0; s < loadContext->shapes.size(); ++s) {
                 auto & shape = loadContext->shapes[s];
-                std::vector<VertexWithNormal> vertices;
+                // tinyobjloader triangulates faces, so every three corners are a triangle
+                std::vector<PackedVertexWithNormal> corners;
+                corners.reserve(shape.mesh.indices.size());
                 size_t indexOffset = 0;
                 for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); ++f) {
                     auto numFaceVerts = shape.mesh.num_face_vertices[f];
@@ -160,8 +175,8 @@ void StaticMeshLoaderObj::LoadFile(std::string const & filename, std::function<v
                         auto ty =
                             idx.texcoord_index > -1 ? loadContext->attrib.texcoords[2 * idx.texcoord_index + 1] : 0.f;
 
-                        vertices.push_back(
-                            {glm::vec3(vx, vy, vz), glm::vec3(1.f), glm::vec3(nx, ny, nz), glm::vec2(tx, ty)});
+                        corners.push_back(PackVertex(VertexWithNormal{
+                            glm::vec3(vx, vy, vz), glm::vec3(1.f), glm::vec3(nx, ny, nz), glm::vec2(tx, ty)}));
                     }
                     indexOffset += numFaceVerts;
                 }
@@ -180,13 +195,7 @@ void StaticMeshLoaderObj::LoadFile(std::string const & filename, std::function<v
                     }
                 }
 
-                std::vector<size_t> indices(shape.mesh.indices.size());
-                for (size_t i = 0; i < shape.mesh.indices.size(); ++i) {
-                    indices[i] = shape.mesh.indices[i].vertex_index;
-                }
-
                 auto name = shape.name;
-                auto numVtx = vertices.size();
                 Material * material;
                 if (mtlId < 0 || mtlId >= loadContext->materialIdToMaterial.size()) {
                     logger.Warn(
@@ -199,42 +208,127 @@ void StaticMeshLoaderObj::LoadFile(std::string const & filename, std::function<v
                     material = loadContext->materialIdToMaterial.at(mtlId);
                 }
 
-                logger.Info("shape={}, mtlId={}, material={}", shape.name, mtlId, material);
+                auto optimized = OptimizeMesh(corners);
+                if (optimized.indices.empty()) {
+                    logger.Warn("Skipping shape '{}' in OBJ file '{}' since it has no triangles", shape.name, filename);
+                    continue;
+                }
+                auto lods = GenerateLods(optimized.indices, optimized.vertices);
+                logger.Info("shape={}, mtlId={}, material={}, vertices={} -> {}, ACMR={:.3f} -> {:.3f}, lods={}",
+                            shape.name,
+                            mtlId,
+                            material,
+                            optimized.inputVertexCount,
+                            optimized.vertices.size(),
+                            optimized.acmrBefore,
+                            optimized.acmrAfter,
+                            lods.size());
+
+                // The full detail triangles are kept on the CPU in case the mesh is used as an occluder. A simplified
+                // level of detail can not be used since simplification may fill in concavities, which would make the
+                // occluder cover pixels the real surface does not and hide objects that are visible.
+                std::vector<uint32_t> occluderVertexIndex(optimized.vertices.size(), UINT32_MAX);
+                for (auto index : optimized.indices) {
+                    if (occluderVertexIndex[index] == UINT32_MAX) {
+                        occluderVertexIndex[index] = (uint32_t)occluder.vertices.size();
+                        occluder.vertices.push_back(optimized.vertices[index].pos);
+                    }
+                    occluder.indices.push_back(occluderVertexIndex[index]);
+                }
 
                 CpuSubmesh cpuSubmesh;
                 cpuSubmesh.name = name;
                 cpuSubmesh.material = material;
-                cpuSubmesh.vertices = vertices;
-                cpuSubmeshes.push_back(cpuSubmesh);
-                totalVboSize += vertices.size() * sizeof(VertexWithNormal);
+                cpuSubmesh.vertices = std::move(optimized.vertices);
+                cpuSubmesh.numIndexes = optimized.indices.size();
+                auto allIndices = std::move(optimized.indices);
+                for (auto & lod : lods) {
+                    logger.Info("shape={}, lod={}, triangles={}, error={}",
+                                shape.name,
+                                cpuSubmesh.lods.size() + 1,
+                                lod.indices.size() / 3,
+                                lod.error);
+                    cpuSubmesh.lods.push_back({(uint32_t)allIndices.size(), (uint32_t)lod.indices.size(), lod.error});
+                    allIndices.insert(allIndices.end(), lod.indices.begin(), lod.indices.end());
+                }
+                for (auto const & vertex : cpuSubmesh.vertices) {
+                    boundsMin = glm::min(boundsMin, vertex.pos);
+                    boundsMax = glm::max(boundsMax, vertex.pos);
+                }
+                // The indices are relative to the submesh's first vertex, so 16 bits are enough for most submeshes
+                if (cpuSubmesh.vertices.size() <= UINT16_MAX) {
+                    cpuSubmesh.indexType = CommandBuffer::IndexType::UINT16;
+                    cpuSubmesh.indices.resize(allIndices.size() * sizeof(uint16_t));
+                    auto indices16 = (uint16_t *)cpuSubmesh.indices.data();
+                    for (size_t i = 0; i < allIndices.size(); ++i) {
+                        indices16[i] = (uint16_t)allIndices[i];
+                    }
+                } else {
+                    cpuSubmesh.indexType = CommandBuffer::IndexType::UINT32;
+                    cpuSubmesh.indices.resize(allIndices.size() * sizeof(uint32_t));
+                    memcpy(cpuSubmesh.indices.data(), allIndices.data(), cpuSubmesh.indices.size());
+                }
+                totalVboSize += cpuSubmesh.vertices.size() * sizeof(PackedVertexWithNormal);
+                // Rounded up so that 32 bit indices following 16 bit ones are still aligned to their size
+                totalEboSize += (cpuSubmesh.indices.size() + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+                cpuSubmeshes.push_back(std::move(cpuSubmesh));
+            }
+            if (cpuSubmeshes.empty()) {
+                logger.Error("Error when loading OBJ file '{}', it does not contain any triangles", filename);
+                callback(nullptr);
+                delete loadContext;
+                return;
             }
             auto bufferAllocator = BufferAllocator::GetInstance();
             auto buffer = bufferAllocator->AllocateBuffer(totalVboSize,
                                                           BufferUsageFlags::TRANSFER_DST_BIT |
                                                               BufferUsageFlags::VERTEX_BUFFER_BIT,
-                                                          MemoryPropertyFlagBits::DEVICE_LOCAL_BIT);
-
-            ResourceManager::CreateResources(
-                [loadContext, callback, &cpuSubmeshes, filename, &submeshes, &buffer](ResourceCreationContext & ctx) {
-                    size_t offset = 0;
-                    for (auto & submesh : cpuSubmeshes) {
-                        size_t size = submesh.vertices.size() * sizeof(VertexWithNormal);
-                        size_t totalOffset = buffer.GetOffset() + offset;
-                        ctx.BufferSubData(buffer.GetBuffer(),
-                                          (uint8_t *)&submesh.vertices[0],
-                                          totalOffset,
-                                          submesh.vertices.size() * sizeof(VertexWithNormal));
-                        submeshes.emplace_back(submesh.name,
-                                               submesh.material,
-                                               submesh.vertices.size(),
-                                               BufferSlice(buffer.GetBuffer(), totalOffset, size));
-                        offset += size;
-                    }
-                    auto ret = new StaticMesh(submeshes);
-                    ResourceManager::AddResource(filename, ret);
-                    callback(ret);
-                    delete loadContext;
-                });
+                                                          MemoryPropertyFlagBits::DEVICE_LOCAL_BIT,
+                                                          sizeof(PackedVertexWithNormal));
+            auto indexBuffer = bufferAllocator->AllocateBuffer(totalEboSize,
+                                                               BufferUsageFlags::TRANSFER_DST_BIT |
+                                                                   BufferUsageFlags::INDEX_BUFFER_BIT,
+                                                               MemoryPropertyFlagBits::DEVICE_LOCAL_BIT,
+                                                               sizeof(uint32_t));
+
+            ResourceManager::CreateResources([loadContext,
+                                              callback,
+                                              &cpuSubmeshes,
+                                              filename,
+                                              &submeshes,
+                                              &buffer,
+                                              &indexBuffer,
+                                              boundsMin,
+                                              boundsMax,
+                                              &occluder](ResourceCreationContext & ctx) {
+                size_t offset = 0;
+                size_t indexOffset = 0;
+                for (auto & submesh : cpuSubmeshes) {
+                    size_t size = submesh.vertices.size() * sizeof(PackedVertexWithNormal);
+                    size_t totalOffset = buffer.GetOffset() + offset;
+                    ctx.BufferSubData(buffer.GetBuffer(), (uint8_t *)&submesh.vertices[0], totalOffset, size);
+                    size_t indexSize = submesh.indices.size();
+                    size_t totalIndexOffset = indexBuffer.GetOffset() + indexOffset;
+                    ctx.BufferSubData(indexBuffer.GetBuffer(), &submesh.indices[0], totalIndexOffset, indexSize);
+                    submeshes.emplace_back(submesh.name,
+                                           submesh.material,
+                                           submesh.numIndexes,
+                                           BufferSlice(indexBuffer.GetBuffer(), totalIndexOffset, indexSize),
+                                           submesh.vertices.size(),
+                                           BufferSlice(buffer.GetBuffer(), totalOffset, size),
+                                           submesh.indexType);
+                    offset += size;
+                    indexOffset += (indexSize + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+                }
+                std::vector<std::vector<SubmeshLod>> lods;
+                for (auto & submesh : cpuSubmeshes) {
+                    lods.push_back(std::move(submesh.lods));
+                }
+                auto ret = new StaticMesh(submeshes, boundsMin, boundsMax, lods, std::move(occluder));
+                ResourceManager::AddResource(filename, ret);
+                callback(ret);
+                delete loadContext;
+            });
         });
         jobEngine->ScheduleJob(submeshJob, JobPriority::LOW);
     });
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "Core/Rendering/BufferSlice.h"
+#include "RenderingBackend/Abstract/CommandBuffer.h"
 
 class Material;
 
@@ -15,9 +16,10 @@ public:
     {
     }
     Submesh(std::string const & name, Material * material, size_t numIndexes, BufferSlice indexBuffer,
-            size_t numVertices, BufferSlice vertexBuffer)
-        : name(name), material(material), numIndexes(numIndexes), indexBuffer(indexBuffer), numVertices(numVertices),
-          vertexBuffer(vertexBuffer)
+            size_t numVertices, BufferSlice vertexBuffer,
+            CommandBuffer::IndexType indexType = CommandBuffer::IndexType::UINT32)
+        : name(name), material(material), numIndexes(numIndexes), indexBuffer(indexBuffer), indexType(indexType),
+          numVertices(numVertices), vertexBuffer(vertexBuffer)
     {
     }
 
@@ -25,6 +27,11 @@ public:
     inline Material * GetMaterial() const { return material; }
     inline size_t GetNumIndexes() const { return numIndexes; }
     inline std::optional<BufferSlice> GetIndexBuffer() const { return indexBuffer; }
+    inline CommandBuffer::IndexType GetIndexType() const { return indexType; }
+    inline size_t GetIndexSize() const
+    {
+        return indexType == CommandBuffer::IndexType::UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
     inline size_t GetNumVertices() const { return numVertices; }
     inline BufferSlice GetVertexBuffer() const { return vertexBuffer; }
 
@@ -35,6 +42,7 @@ private:
 
     size_t numIndexes;
     std::optional<BufferSlice> indexBuffer;
+    CommandBuffer::IndexType indexType = CommandBuffer::IndexType::UINT32;
     size_t numVertices;
     BufferSlice vertexBuffer;
 };
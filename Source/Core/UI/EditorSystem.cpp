@@ -182,6 +182,7 @@ struct MenuBarResult {
 ImGuizmo::OPERATION currentGizmoOperation = ImGuizmo::OPERATION::TRANSLATE;
 
 bool isGamepadStateViewerOpen = false;
+bool isRenderStatsOverlayOpen = false;
 
 EditProjectDialog editProjectDialog;
 
@@ -190,6 +191,7 @@ ImGui::FileBrowser openProjectBrowser;
 
 bool DrawEntityEditor();
 void DrawGamepadStateViewer();
+void DrawRenderStatsOverlay();
 MenuBarResult DrawMenuBar();
 void DrawNewSceneDialog(bool openedThisFrame);
 std::filesystem::path GetSceneWorkingDirectory();
@@ -437,6 +439,7 @@ void OnGui()
         }
 
         DrawGamepadStateViewer();
+        DrawRenderStatsOverlay();
     }
 }
 
@@ -573,6 +576,7 @@ MenuBarResult DrawMenuBar()
         }
         if (ImGui::BeginMenu("Utilities")) {
             ImGui::MenuItem("Gamepad state viewer", nullptr, &isGamepadStateViewerOpen);
+            ImGui::MenuItem("Render stats", nullptr, &isRenderStatsOverlayOpen);
             ImGui::EndMenu();
         }
         if (isWorldPaused && ImGui::MenuItem("Play", nullptr, nullptr, activeScene.has_value())) {
@@ -710,6 +714,42 @@ void DrawGamepadStateViewer()
     }
 }
 
+void DrawRenderStatsOverlay()
+{
+    if (isRenderStatsOverlayOpen &&
+        ImGui::Begin("Render stats", &isRenderStatsOverlayOpen, ImGuiWindowFlags_AlwaysAutoResize)) {
+        // The latest frame is the one rendered before this one, since the stats are only complete after rendering
+        auto stats = RenderSystem::GetInstance()->GetStatsHistory().GetLatest();
+        ImGui::Text("Mesh batches: %u (transparent: %u)", stats.numMeshBatches, stats.numTransparentMeshBatches);
+        ImGui::Text("Draws: %u", stats.numDraws);
+        ImGui::Text("Instances: %u", stats.numInstances);
+        ImGui::Text("Triangles: %llu", (unsigned long long)stats.numTriangles);
+        ImGui::Text("Bytes uploaded: %llu", (unsigned long long)stats.bytesUploaded);
+        ImGui::Text("Descriptor set binds: %u", stats.numDescriptorSetBinds);
+        ImGui::Text("Pipeline binds: %u", stats.numPipelineBinds);
+
+        ImGui::Separator();
+        ImGui::Text("CPU StartFrame: %.3f ms", stats.startFrameMs);
+        ImGui::Text("CPU CreateBatches: %.3f ms", stats.createBatchesMs);
+        ImGui::Text("CPU MainRenderFrame: %.3f ms", stats.mainRenderFrameMs);
+        ImGui::Text("CPU PostProcessFrame: %.3f ms", stats.postProcessFrameMs);
+
+        ImGui::Separator();
+        auto gpuTiming = [](char const * name, float ms) {
+            if (ms < 0.f) {
+                ImGui::Text("GPU %s: n/a", name);
+            } else {
+                ImGui::Text("GPU %s: %.3f ms", name, ms);
+            }
+        };
+        gpuTiming("prepass", stats.gpuPrepassMs);
+        gpuTiming("main pass", stats.gpuMainPassMs);
+        gpuTiming("SSAO", stats.gpuSsaoPassMs);
+        gpuTiming("post process", stats.gpuPostProcessPassMs);
+        ImGui::End();
+    }
+}
+
 void DrawNewSceneDialog(bool openedThisFrame)
 {
     if (openedThisFrame) {
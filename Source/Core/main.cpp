@@ -58,7 +58,12 @@ int main(int argc, char * argv[])
     srand(time(0));
 #endif
     ImGui::CreateContext();
+#ifdef USE_NULL_RENDERER
+    // The null renderer never opens a window, so don't require a video device when running headless
+    SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS);
+#else
     SDL_Init(SDL_INIT_EVERYTHING);
+#endif
     Config::Init();
     int numJobThreads = 5;
     JobEngine jobEngine(numJobThreads);
@@ -73,7 +78,7 @@ int main(int argc, char * argv[])
     BufferAllocator bufferAllocator(&renderer);
     ParticleSystem particleSystem(&renderer, &bufferAllocator, DebugDrawSystem::GetInstance());
     RenderSystem renderSystem(&renderer, &particleSystem);
-    ResourceManager::Init(&renderSystem);
+    ResourceManager::Init(&renderSystem, &renderer);
     renderPrimitiveFactory.LateCreatePrimitives();
     ShaderProgramFactory::CreateResources();
     particleSystem.Init();
@@ -129,6 +129,11 @@ uint32_t JobEngine::GetCurrentThreadIndex()
     return find->second;
 }
 
+uint32_t JobEngine::GetNumThreads() const
+{
+    return static_cast<uint32_t>(threads.size());
+}
+
 void JobEngine::RegisterMainThread()
 {
     auto thisIdx = threads.size();
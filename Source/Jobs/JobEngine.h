@@ -43,6 +43,7 @@ public:
     void ScheduleJob(JobId id, JobPriority priority);
 
     uint32_t GetCurrentThreadIndex();
+    uint32_t GetNumThreads() const;
     void RegisterMainThread();
 
 private:
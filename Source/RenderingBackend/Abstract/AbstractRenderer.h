@@ -2,11 +2,13 @@
 
 #include <cstdint>
 #include <functional>
+#include <type_traits>
 
 #include "RenderResources.h"
 #include "RendererConfig.h"
 #include "RendererProperties.h"
 #include "ResourceCreationContext.h"
+#include "Util/Future.h"
 
 /**
  * Interface that a rendering backend (like OpenGL, DirectX, Vulkan) should implement.
@@ -35,6 +37,35 @@ public:
      * function has ran.
      */
     virtual void CreateResources(std::function<void(ResourceCreationContext &)> fun) = 0;
+    /**
+     * Runs fun using CreateResources and returns a future which is completed with fun's return value once it has ran.
+     * Callers can queue up many resource creations and wait for all of them at once, or chain work onto them using
+     * Future::Then, instead of waiting for the renderer once per resource.
+     */
+    template <typename Fun>
+    auto CreateResourcesAsync(Fun && fun) -> Future<std::invoke_result_t<Fun &, ResourceCreationContext &>>
+    {
+        using Result = std::invoke_result_t<Fun &, ResourceCreationContext &>;
+        Promise<Result> promise;
+        auto ret = promise.GetFuture();
+        CreateResources([promise, fun = std::forward<Fun>(fun)](ResourceCreationContext & ctx) mutable {
+            if constexpr (std::is_void_v<Result>) {
+                fun(ctx);
+                promise.Set();
+            } else {
+                promise.Set(fun(ctx));
+            }
+        });
+        return ret;
+    }
+    /**
+     * Returns true if the upload identified by the token has finished on the GPU.
+     */
+    virtual bool IsUploadComplete(UploadToken token) = 0;
+    /**
+     * Blocks until the upload identified by the token has finished on the GPU.
+     */
+    virtual void WaitForUpload(UploadToken token) = 0;
     /**
      * Gets the backbuffers in the swapchain. The returned ImageViews should be suitable for using as color output
      * attachments in a renderpass/framebuffer. This should be called after calling RecreateSwapchain. The returned
@@ -70,6 +70,12 @@ public:
     virtual void CmdBeginRenderPass(RenderPassBeginInfo * pRenderPassBegin, SubpassContents contents) = 0;
     virtual void CmdBindDescriptorSets(PipelineLayoutHandle * layout, uint32_t offset,
                                        std::vector<DescriptorSet *>) = 0;
+    /*
+            dynamicOffsets are added to the offsets of the UNIFORM_BUFFER_DYNAMIC and STORAGE_BUFFER_DYNAMIC descriptors in
+            the sets, in set and binding order
+    */
+    virtual void CmdBindDescriptorSets(PipelineLayoutHandle * layout, uint32_t offset, std::vector<DescriptorSet *>,
+                                       std::vector<uint32_t> dynamicOffsets) = 0;
     /*
             OpenGL: glBindBuffer, state tracker saves offset and index type until glDrawElements is issued
     */
@@ -82,15 +88,20 @@ public:
     virtual void CmdDrawIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount) = 0;
     virtual void CmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset,
                                 uint32_t firstInstance) = 0;
+    virtual void CmdDrawIndexedIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount) = 0;
     virtual void CmdEndRenderPass() = 0;
     virtual void CmdExecuteCommands(uint32_t commandBufferCount, CommandBuffer ** pCommandBuffers) = 0;
     // TODO:
     virtual void CmdExecuteCommands(std::vector<CommandBuffer *> && commandBuffers) = 0;
     virtual void CmdNextSubpass(SubpassContents subpassContents) = 0;
+    // Queries must be reset before they are written again
+    virtual void CmdResetQueryPool(QueryPoolHandle * queryPool, uint32_t firstQuery, uint32_t queryCount) = 0;
     virtual void CmdSetScissor(uint32_t firstScissor, uint32_t scissorCount, Rect2D const * pScissors) = 0;
     virtual void CmdSetViewport(uint32_t firstViewport, uint32_t viewportCount, Viewport const * pViewports) = 0;
 
     virtual void CmdUpdateBuffer(BufferHandle * buffer, size_t offset, size_t size, uint32_t const * pData) = 0;
+    // Writes the GPU time at which all previous commands have finished. Must be called outside of render passes.
+    virtual void CmdWriteTimestamp(QueryPoolHandle * queryPool, uint32_t query) = 0;
 
 protected:
     virtual void Execute(Renderer *, std::vector<SemaphoreHandle *> waitSem, std::vector<SemaphoreHandle *> signalSem,
@@ -63,10 +63,8 @@ enum class DescriptorType {
     */
     UNIFORM_BUFFER = 6,
     STORAGE_BUFFER = 7,
-    /*
     UNIFORM_BUFFER_DYNAMIC = 8,
     STORAGE_BUFFER_DYNAMIC = 9,
-    */
     INPUT_ATTACHMENT = 10,
 };
 
@@ -168,6 +166,8 @@ enum ShaderStageFlagBits {
 // TODO: Will be changed in the future when API converges with Vulkan more
 enum class VertexComponentType { BYTE, SHORT, INT, FLOAT, HALF_FLOAT, DOUBLE, UBYTE, USHORT, UINT };
 
+enum class VertexInputRate { VERTEX, INSTANCE };
+
 struct BufferHandle {
 };
 
@@ -219,6 +219,14 @@ struct PipelineHandle {
     VertexInputStateHandle * vertexInputState;
 };
 
+struct QueryPoolHandle {
+    /**
+     * Copies the results of count timestamp queries starting at firstQuery into results, converted to nanoseconds.
+     * Does not wait for the GPU: returns false without writing anything if any of the queries is not available yet.
+     */
+    virtual bool GetTimestamps(uint32_t firstQuery, uint32_t count, uint64_t * results) = 0;
+};
+
 struct RenderPassHandle {
     enum class PipelineBindPoint { GRAPHICS, COMPUTE };
     struct AttachmentDescription {
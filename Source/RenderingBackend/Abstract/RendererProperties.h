@@ -3,8 +3,17 @@
 class RendererProperties
 {
 public:
-    RendererProperties() : uniformBufferAlignment(0) {}
-    RendererProperties(size_t uniformBufferAlignment) : uniformBufferAlignment(uniformBufferAlignment) {}
+    RendererProperties()
+        : uniformBufferAlignment(0), storageBufferAlignment(0), supportsMultiDrawIndirect(false),
+          supportsTimestampQueries(false)
+    {
+    }
+    RendererProperties(size_t uniformBufferAlignment, size_t storageBufferAlignment, bool supportsMultiDrawIndirect,
+                       bool supportsTimestampQueries)
+        : uniformBufferAlignment(uniformBufferAlignment), storageBufferAlignment(storageBufferAlignment),
+          supportsMultiDrawIndirect(supportsMultiDrawIndirect), supportsTimestampQueries(supportsTimestampQueries)
+    {
+    }
 
     /**
      * Gets the uniform buffer alignment requirement for this renderer. All offsets in uniform buffer descriptor sets
@@ -12,6 +21,27 @@ public:
      */
     inline size_t GetUniformBufferAlignment() const { return uniformBufferAlignment; }
 
+    /**
+     * Gets the storage buffer alignment requirement for this renderer. All offsets in storage buffer descriptor sets
+     * must be divisible by this.
+     */
+    inline size_t GetStorageBufferAlignment() const { return storageBufferAlignment; }
+
+    /**
+     * Whether CmdDrawIndirect and CmdDrawIndexedIndirect can be called with a drawCount larger than 1. If this is false
+     * the caller has to issue one indirect (or direct) draw per command.
+     */
+    inline bool SupportsMultiDrawIndirect() const { return supportsMultiDrawIndirect; }
+
+    /**
+     * Whether timestamp query pools can be created and CmdWriteTimestamp can be used on the graphics queue. If this is
+     * false no GPU timings are available.
+     */
+    inline bool SupportsTimestampQueries() const { return supportsTimestampQueries; }
+
 private:
     size_t uniformBufferAlignment;
+    size_t storageBufferAlignment;
+    bool supportsMultiDrawIndirect;
+    bool supportsTimestampQueries;
 };
@@ -9,13 +9,25 @@
 #include "CommandBufferAllocator.h"
 #include "RenderResources.h"
 
+/**
+ * Identifies an upload started by BufferSubData or ImageData. Uploads may still be running on the GPU after those
+ * functions return, but every command buffer executed after the upload was started will see the uploaded data. Pass
+ * the token to IRenderer::IsUploadComplete or IRenderer::WaitForUpload to find out when the upload has finished.
+ * UPLOAD_COMPLETE is returned by renderers that upload synchronously.
+ */
+using UploadToken = uint64_t;
+static constexpr UploadToken UPLOAD_COMPLETE = 0;
+
 class ResourceCreationContext
 {
 public:
     virtual CommandBufferAllocator * CreateCommandBufferAllocator() = 0;
     virtual void DestroyCommandBufferAllocator(CommandBufferAllocator *) = 0;
 
-    virtual void BufferSubData(BufferHandle *, uint8_t *, size_t offset, size_t size) = 0;
+    /*
+            Copies data into the buffer. The data is copied before this returns, so the caller may free it right away.
+    */
+    virtual UploadToken BufferSubData(BufferHandle *, uint8_t *, size_t offset, size_t size) = 0;
     /*
             OpenGL: glGenBuffers + glBufferData
             Vulkan: vkCreateBuffer (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) + vkAllocateMemory + vkBindBufferMemory
@@ -37,6 +49,13 @@ public:
     */
     virtual uint8_t * MapBuffer(BufferHandle *, size_t offset, size_t size) = 0;
     virtual void UnmapBuffer(BufferHandle *) = 0;
+    /*
+            Makes host writes to a mapped range of a buffer without HOST_COHERENT_BIT visible to the device. Does
+            nothing for coherent buffers.
+            OpenGL: glFlushMappedNamedBufferRange
+            Vulkan: vkFlushMappedMemoryRanges
+    */
+    virtual void FlushBuffer(BufferHandle *, size_t offset, size_t size) = 0;
 
     struct DescriptorSetCreateInfo {
         struct BufferDescriptor {
@@ -105,9 +124,9 @@ public:
     virtual void AllocateImage(ImageHandle *) = 0;
     /*
             OpenGL: glTexSubImage
-            Vulkan: vkMapMemory + memcpy + vkUnmapMemory
+            Vulkan: memcpy into the staging ring + vkCmdCopyBufferToImage on the transfer queue
     */
-    virtual void ImageData(ImageHandle *, std::vector<uint8_t> const &) = 0;
+    virtual UploadToken ImageData(ImageHandle *, std::vector<uint8_t> const &) = 0;
 
     struct ImageViewCreateInfo {
         ImageHandle * image;
@@ -172,6 +191,14 @@ public:
     virtual PipelineLayoutHandle * CreatePipelineLayout(PipelineLayoutCreateInfo const &) = 0;
     virtual void DestroyPipelineLayout(PipelineLayoutHandle *) = 0;
 
+    /*
+            Only usable if RendererProperties::SupportsTimestampQueries is true.
+            OpenGL: Not supported
+            Vulkan: vkCreateQueryPool (VK_QUERY_TYPE_TIMESTAMP)
+    */
+    virtual QueryPoolHandle * CreateTimestampQueryPool(uint32_t queryCount) = 0;
+    virtual void DestroyQueryPool(QueryPoolHandle *) = 0;
+
     struct RenderPassCreateInfo {
         std::vector<RenderPassHandle::AttachmentDescription> attachments;
         std::vector<RenderPassHandle::SubpassDescription> subpasses;
@@ -201,6 +228,7 @@ public:
 
     struct VertexInputStateCreateInfo {
         // TODO: Use Format instead of Type + size + normalized
+        // Integer types that are not normalized are read as integers by the shader, normalized ones as floats
         struct VertexAttributeDescription {
             uint32_t binding;
             uint32_t location;
@@ -212,6 +240,7 @@ public:
         struct VertexBindingDescription {
             uint32_t binding;
             uint32_t stride;
+            VertexInputRate inputRate = VertexInputRate::VERTEX;
         };
 
         std::vector<VertexAttributeDescription> vertexAttributeDescriptions;
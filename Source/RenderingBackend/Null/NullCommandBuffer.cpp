@@ -0,0 +1,177 @@
+#ifdef USE_NULL_RENDERER
+#include "NullCommandBuffer.h"
+
+#include <cassert>
+#include <cstring>
+
+#include <ThirdParty/optick/src/optick.h>
+
+#include "NullRenderer.h"
+
+NullCommandCounts & NullCommandCounts::operator+=(NullCommandCounts const & other)
+{
+    renderPasses += other.renderPasses;
+    subpasses += other.subpasses;
+    descriptorSetBinds += other.descriptorSetBinds;
+    indexBufferBinds += other.indexBufferBinds;
+    pipelineBinds += other.pipelineBinds;
+    vertexBufferBinds += other.vertexBufferBinds;
+    draws += other.draws;
+    drawsIndexed += other.drawsIndexed;
+    drawsIndirect += other.drawsIndirect;
+    drawsIndexedIndirect += other.drawsIndexedIndirect;
+    executeCommands += other.executeCommands;
+    scissors += other.scissors;
+    viewports += other.viewports;
+    bufferUpdates += other.bufferUpdates;
+    bufferUpdateBytes += other.bufferUpdateBytes;
+    queryResets += other.queryResets;
+    timestamps += other.timestamps;
+    vertices += other.vertices;
+    instances += other.instances;
+    return *this;
+}
+
+void NullCommandBuffer::BeginRecording(InheritanceInfo *)
+{
+    Reset();
+}
+
+void NullCommandBuffer::EndRecording() {}
+
+void NullCommandBuffer::Reset()
+{
+    counts = {};
+    bufferUpdates.clear();
+}
+
+void NullCommandBuffer::CmdBeginRenderPass(CommandBuffer::RenderPassBeginInfo * pRenderPassBegin,
+                                           CommandBuffer::SubpassContents contents)
+{
+    counts.renderPasses++;
+    counts.subpasses++;
+}
+
+void NullCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle *, uint32_t offset,
+                                              std::vector<DescriptorSet *> sets)
+{
+    counts.descriptorSetBinds += sets.size();
+}
+
+void NullCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle *, uint32_t offset,
+                                              std::vector<DescriptorSet *> sets, std::vector<uint32_t> dynamicOffsets)
+{
+    counts.descriptorSetBinds += sets.size();
+}
+
+void NullCommandBuffer::CmdBindIndexBuffer(BufferHandle * buffer, size_t offset, CommandBuffer::IndexType indexType)
+{
+    counts.indexBufferBinds++;
+}
+
+void NullCommandBuffer::CmdBindPipeline(RenderPassHandle::PipelineBindPoint, PipelineHandle *)
+{
+    counts.pipelineBinds++;
+}
+
+void NullCommandBuffer::CmdBindVertexBuffer(BufferHandle * buffer, uint32_t binding, size_t offset, uint32_t stride)
+{
+    counts.vertexBufferBinds++;
+}
+
+void NullCommandBuffer::CmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex,
+                                uint32_t firstInstance)
+{
+    counts.draws++;
+    counts.vertices += (uint64_t)vertexCount * instanceCount;
+    counts.instances += instanceCount;
+}
+
+void NullCommandBuffer::CmdDrawIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount)
+{
+    counts.drawsIndirect += drawCount;
+}
+
+void NullCommandBuffer::CmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,
+                                       int32_t vertexOffset, uint32_t firstInstance)
+{
+    counts.drawsIndexed++;
+    counts.vertices += (uint64_t)indexCount * instanceCount;
+    counts.instances += instanceCount;
+}
+
+void NullCommandBuffer::CmdDrawIndexedIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount)
+{
+    counts.drawsIndexedIndirect += drawCount;
+}
+
+void NullCommandBuffer::CmdEndRenderPass() {}
+
+void NullCommandBuffer::CmdExecuteCommands(uint32_t commandBufferCount, CommandBuffer ** pCommandBuffers)
+{
+    // Secondary command buffers are recorded before they are executed, so their contents can be folded into this
+    // buffer right away
+    for (uint32_t i = 0; i < commandBufferCount; ++i) {
+        auto secondary = (NullCommandBuffer *)pCommandBuffers[i];
+        assert(secondary != nullptr);
+        counts += secondary->counts;
+        bufferUpdates.insert(bufferUpdates.end(), secondary->bufferUpdates.begin(), secondary->bufferUpdates.end());
+    }
+    counts.executeCommands++;
+}
+
+void NullCommandBuffer::CmdExecuteCommands(std::vector<CommandBuffer *> && commandBuffers)
+{
+    CmdExecuteCommands(commandBuffers.size(), commandBuffers.data());
+}
+
+void NullCommandBuffer::CmdNextSubpass(SubpassContents subpassContents)
+{
+    counts.subpasses++;
+}
+
+void NullCommandBuffer::CmdResetQueryPool(QueryPoolHandle * queryPool, uint32_t firstQuery, uint32_t queryCount)
+{
+    counts.queryResets++;
+}
+
+void NullCommandBuffer::CmdSetScissor(uint32_t firstScissor, uint32_t scissorCount,
+                                      CommandBuffer::Rect2D const * pScissors)
+{
+    counts.scissors += scissorCount;
+}
+
+void NullCommandBuffer::CmdSetViewport(uint32_t firstViewport, uint32_t viewportCount,
+                                       CommandBuffer::Viewport const * pViewports)
+{
+    counts.viewports += viewportCount;
+}
+
+void NullCommandBuffer::CmdUpdateBuffer(BufferHandle * buffer, size_t offset, size_t size, uint32_t const * pData)
+{
+    auto bytes = (uint8_t const *)pData;
+    bufferUpdates.push_back({(NullBufferHandle *)buffer, offset, std::vector<uint8_t>(bytes, bytes + size)});
+    counts.bufferUpdates++;
+    counts.bufferUpdateBytes += size;
+}
+
+void NullCommandBuffer::CmdWriteTimestamp(QueryPoolHandle * queryPool, uint32_t query)
+{
+    counts.timestamps++;
+}
+
+void NullCommandBuffer::Execute(Renderer * renderer, std::vector<SemaphoreHandle *> waitSem,
+                                std::vector<SemaphoreHandle *> signalSem, FenceHandle * signalFence)
+{
+    OPTICK_EVENT();
+    for (auto const & update : bufferUpdates) {
+        assert(update.offset + update.data.size() <= update.buffer->data.size());
+        memcpy(update.buffer->data.data() + update.offset, update.data.data(), update.data.size());
+    }
+
+    std::lock_guard<std::mutex> guard(renderer->statsLock);
+    renderer->currentFrameCommands += counts;
+    renderer->totalCommands += counts;
+}
+
+#endif
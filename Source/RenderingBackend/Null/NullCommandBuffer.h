@@ -0,0 +1,69 @@
+#pragma once
+#ifdef USE_NULL_RENDERER
+#include "../Abstract/CommandBuffer.h"
+
+#include <vector>
+
+#include "NullContextStructs.h"
+
+/**
+ * Command buffer which does not render anything. Recorded commands only increment counters, which are handed to the
+ * renderer when the buffer is executed. CmdUpdateBuffer is the exception, its data is written into the buffer's host
+ * memory on execution so that reading the buffer back behaves like it would on a GPU.
+ */
+class NullCommandBuffer : public CommandBuffer
+{
+    friend class Renderer;
+
+public:
+    NullCommandBuffer(std::allocator<uint8_t> * allocator = new std::allocator<uint8_t>) : CommandBuffer(allocator) {}
+
+    ~NullCommandBuffer() final override { delete allocator; }
+
+    void BeginRecording(InheritanceInfo *) final override;
+    void EndRecording() final override;
+    void Reset() final override;
+
+    void CmdBeginRenderPass(CommandBuffer::RenderPassBeginInfo * pRenderPassBegin,
+                            CommandBuffer::SubpassContents contents) final override;
+    void CmdBindDescriptorSets(PipelineLayoutHandle *, uint32_t offset,
+                               std::vector<DescriptorSet *> sets) final override;
+    void CmdBindDescriptorSets(PipelineLayoutHandle *, uint32_t offset, std::vector<DescriptorSet *> sets,
+                               std::vector<uint32_t> dynamicOffsets) final override;
+    void CmdBindIndexBuffer(BufferHandle * buffer, size_t offset, CommandBuffer::IndexType indexType) final override;
+    void CmdBindPipeline(RenderPassHandle::PipelineBindPoint, PipelineHandle *) final override;
+    void CmdBindVertexBuffer(BufferHandle * buffer, uint32_t binding, size_t offset, uint32_t stride) final override;
+    void CmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex,
+                 uint32_t firstInstance) final override;
+    void CmdDrawIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount) final override;
+    void CmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset,
+                        uint32_t firstInstance) final override;
+    void CmdDrawIndexedIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount) final override;
+    void CmdEndRenderPass() final override;
+    void CmdExecuteCommands(uint32_t commandBufferCount, CommandBuffer ** pCommandBuffers) final override;
+    void CmdExecuteCommands(std::vector<CommandBuffer *> && commandBuffers) final override;
+    void CmdNextSubpass(SubpassContents subpassContents) final override;
+    void CmdResetQueryPool(QueryPoolHandle * queryPool, uint32_t firstQuery, uint32_t queryCount) final override;
+    void CmdSetScissor(uint32_t firstScissor, uint32_t scissorCount,
+                       CommandBuffer::Rect2D const * pScissors) final override;
+    void CmdSetViewport(uint32_t firstViewport, uint32_t viewportCount,
+                        CommandBuffer::Viewport const * pViewports) final override;
+    void CmdUpdateBuffer(BufferHandle * buffer, size_t offset, size_t size, uint32_t const * pData) final override;
+    void CmdWriteTimestamp(QueryPoolHandle * queryPool, uint32_t query) final override;
+
+protected:
+    void Execute(Renderer *, std::vector<SemaphoreHandle *> waitSem, std::vector<SemaphoreHandle *> signalSem,
+                 FenceHandle * signalFence) final override;
+
+private:
+    struct BufferUpdate {
+        NullBufferHandle * buffer;
+        size_t offset;
+        std::vector<uint8_t> data;
+    };
+
+    NullCommandCounts counts;
+    std::vector<BufferUpdate> bufferUpdates;
+};
+
+#endif
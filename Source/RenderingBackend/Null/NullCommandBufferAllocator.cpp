@@ -0,0 +1,21 @@
+#ifdef USE_NULL_RENDERER
+#include "NullCommandBufferAllocator.h"
+
+#include <cassert>
+
+#include "NullCommandBuffer.h"
+
+CommandBuffer * NullCommandBufferAllocator::CreateBuffer(CommandBufferCreateInfo const & createInfo)
+{
+    return new NullCommandBuffer(new std::allocator<uint8_t>());
+}
+
+void NullCommandBufferAllocator::DestroyContext(CommandBuffer * ctx)
+{
+    assert(ctx != nullptr);
+    delete ctx;
+}
+
+void NullCommandBufferAllocator::Reset() {}
+
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+#ifdef USE_NULL_RENDERER
+
+#include "../Abstract/CommandBufferAllocator.h"
+
+struct NullCommandBufferAllocator : CommandBufferAllocator {
+    CommandBuffer * CreateBuffer(CommandBufferCreateInfo const & createInfo) final override;
+
+    void DestroyContext(CommandBuffer *) final override;
+
+    void Reset() final override;
+};
+
+#endif
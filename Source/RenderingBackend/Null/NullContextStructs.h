@@ -0,0 +1,126 @@
+#pragma once
+#ifdef USE_NULL_RENDERER
+#include <cstdint>
+#include <vector>
+
+#include "../Abstract/RenderResources.h"
+#include "../Abstract/ResourceCreationContext.h"
+
+/**
+ * Number of live resources of each kind created through NullResourceContext. The byte counts are the host memory
+ * backing buffers and images.
+ */
+struct NullResourceCounts {
+    int64_t buffers = 0;
+    int64_t bufferBytes = 0;
+    int64_t commandBufferAllocators = 0;
+    int64_t descriptorSets = 0;
+    int64_t descriptorSetLayouts = 0;
+    int64_t fences = 0;
+    int64_t framebuffers = 0;
+    int64_t images = 0;
+    int64_t imageBytes = 0;
+    int64_t imageViews = 0;
+    int64_t pipelines = 0;
+    int64_t pipelineLayouts = 0;
+    int64_t queryPools = 0;
+    int64_t renderPasses = 0;
+    int64_t samplers = 0;
+    int64_t semaphores = 0;
+    int64_t shaderModules = 0;
+    int64_t vertexInputStates = 0;
+};
+
+/**
+ * Number of commands recorded into NullCommandBuffers, and the amount of work the draws would have done on a GPU.
+ */
+struct NullCommandCounts {
+    uint64_t renderPasses = 0;
+    uint64_t subpasses = 0;
+    uint64_t descriptorSetBinds = 0;
+    uint64_t indexBufferBinds = 0;
+    uint64_t pipelineBinds = 0;
+    uint64_t vertexBufferBinds = 0;
+    uint64_t draws = 0;
+    uint64_t drawsIndexed = 0;
+    uint64_t drawsIndirect = 0;
+    uint64_t drawsIndexedIndirect = 0;
+    uint64_t executeCommands = 0;
+    uint64_t scissors = 0;
+    uint64_t viewports = 0;
+    uint64_t bufferUpdates = 0;
+    uint64_t bufferUpdateBytes = 0;
+    uint64_t queryResets = 0;
+    uint64_t timestamps = 0;
+    // Vertices and instances of direct draws, indirect draws only count towards drawsIndirect/drawsIndexedIndirect
+    uint64_t vertices = 0;
+    uint64_t instances = 0;
+
+    NullCommandCounts & operator+=(NullCommandCounts const & other);
+};
+
+struct NullBufferHandle : BufferHandle {
+    std::vector<uint8_t> data;
+    uint32_t usage = 0;
+    uint32_t memoryProperties = 0;
+};
+
+struct NullDescriptorSet : DescriptorSet {
+    std::vector<ResourceCreationContext::DescriptorSetCreateInfo::Descriptor> descriptors;
+};
+
+struct NullDescriptorSetLayoutHandle : DescriptorSetLayoutHandle {
+    std::vector<ResourceCreationContext::DescriptorSetLayoutCreateInfo::Binding> bindings;
+};
+
+struct NullFenceHandle : FenceHandle {
+    bool Wait(uint64_t timeOut) final override;
+};
+
+struct NullFramebufferHandle : FramebufferHandle {
+    std::vector<ImageViewHandle *> attachments;
+    uint32_t width, height, layers;
+};
+
+struct NullImageHandle : ImageHandle {
+    std::vector<uint8_t> data;
+    uint32_t mipLevels = 1;
+};
+
+struct NullImageViewHandle : ImageViewHandle {
+    ImageHandle * image;
+    ImageSubresourceRange subresourceRange;
+};
+
+struct NullPipelineLayoutHandle : PipelineLayoutHandle {
+    std::vector<DescriptorSetLayoutHandle *> descriptorLayouts;
+};
+
+struct NullPipelineHandle : PipelineHandle {
+    PipelineLayoutHandle * pipelineLayout;
+};
+
+// Timestamps are not supported, so the results are never available
+struct NullQueryPoolHandle : QueryPoolHandle {
+    bool GetTimestamps(uint32_t firstQuery, uint32_t count, uint64_t * results) final override;
+};
+
+struct NullRenderPassHandle : RenderPassHandle {
+    ResourceCreationContext::RenderPassCreateInfo createInfo;
+};
+
+struct NullSamplerHandle : SamplerHandle {
+};
+
+struct NullSemaphoreHandle : SemaphoreHandle {
+};
+
+struct NullShaderModuleHandle : ShaderModuleHandle {
+    size_t codeSize = 0;
+};
+
+struct NullVertexInputStateHandle : VertexInputStateHandle {
+    ResourceCreationContext::VertexInputStateCreateInfo createInfo;
+};
+
+#endif
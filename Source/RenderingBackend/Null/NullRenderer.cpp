@@ -0,0 +1,158 @@
+#ifdef USE_NULL_RENDERER
+#include "NullRenderer.h"
+
+#include <ThirdParty/optick/src/optick.h>
+
+#include "Logging/Logger.h"
+#include "NullCommandBuffer.h"
+#include "NullResourceContext.h"
+
+static const auto logger = Logger::Create("NullRenderer");
+
+Renderer::Renderer(char const * title, int const winX, int const winY, uint32_t const flags, RendererConfig config,
+                   int numThreads)
+    : config(config)
+{
+    // Use the largest alignments the Vulkan spec allows so offsets computed while running headless are also valid on
+    // real devices
+    properties = RendererProperties(256, 256, true, false);
+    RecreateSwapchain();
+    logger.Info("Running headless with resolution={}x{}", config.windowResolution.x, config.windowResolution.y);
+}
+
+Renderer::~Renderer()
+{
+    auto counts = GetResourceCounts();
+    logger.Info("Shutting down after frameCount={} with buffers={} (bytes={}), images={} (bytes={}), imageViews={}, "
+                "descriptorSets={}, pipelines={} still alive",
+                frameCount,
+                counts.buffers,
+                counts.bufferBytes,
+                counts.images,
+                counts.imageBytes,
+                counts.imageViews,
+                counts.descriptorSets,
+                counts.pipelines);
+}
+
+uint32_t Renderer::AcquireNextFrameIndex(SemaphoreHandle * signalSem, FenceHandle * signalFence)
+{
+    OPTICK_EVENT();
+    // Everything executes synchronously so there is nothing to signal, semaphores and fences are always signalled
+    if (backbufferIsStale) {
+        return UINT32_MAX;
+    }
+    auto ret = nextFrameIndex;
+    nextFrameIndex = (nextFrameIndex + 1) % SWAP_COUNT;
+    return ret;
+}
+
+std::vector<ImageViewHandle *> Renderer::GetBackbuffers()
+{
+    std::vector<ImageViewHandle *> ret;
+    for (uint32_t i = 0; i < SWAP_COUNT; ++i) {
+        ret.push_back(&backbufferViews[i]);
+    }
+    return ret;
+}
+
+Format Renderer::GetBackbufferFormat() const
+{
+    return Format::RGBA8;
+}
+
+glm::uvec2 Renderer::GetResolution() const
+{
+    return config.windowResolution;
+}
+
+uint32_t Renderer::GetSwapCount() const
+{
+    return SWAP_COUNT;
+}
+
+void Renderer::CreateResources(std::function<void(ResourceCreationContext &)> fun)
+{
+    OPTICK_EVENT();
+    NullResourceContext ctx(this);
+    fun(ctx);
+}
+
+bool Renderer::IsUploadComplete(UploadToken token)
+{
+    return true;
+}
+
+void Renderer::WaitForUpload(UploadToken token) {}
+
+void Renderer::ExecuteCommandBuffer(CommandBuffer * ctx, std::vector<SemaphoreHandle *> waitSem,
+                                    std::vector<SemaphoreHandle *> signalSem, FenceHandle * signalFence)
+{
+    OPTICK_EVENT();
+    ctx->Execute(this, waitSem, signalSem, signalFence);
+}
+
+void Renderer::SwapWindow(uint32_t imageIndex, SemaphoreHandle * waitSem)
+{
+    OPTICK_EVENT();
+    std::lock_guard<std::mutex> guard(statsLock);
+    lastFrameCommands = currentFrameCommands;
+    currentFrameCommands = {};
+    frameCount++;
+}
+
+void Renderer::RecreateSwapchain()
+{
+    backbufferIsStale = false;
+    nextFrameIndex = 0;
+    for (uint32_t i = 0; i < SWAP_COUNT; ++i) {
+        backbufferImages[i].format = Format::RGBA8;
+        backbufferImages[i].type = ImageHandle::Type::TYPE_2D;
+        backbufferImages[i].width = config.windowResolution.x;
+        backbufferImages[i].height = config.windowResolution.y;
+        backbufferImages[i].depth = 1;
+
+        backbufferViews[i].image = &backbufferImages[i];
+        backbufferViews[i].subresourceRange.aspectMask = ImageViewHandle::ImageAspectFlagBits::COLOR_BIT;
+        backbufferViews[i].subresourceRange.baseArrayLayer = 0;
+        backbufferViews[i].subresourceRange.baseMipLevel = 0;
+        backbufferViews[i].subresourceRange.layerCount = 1;
+        backbufferViews[i].subresourceRange.levelCount = 1;
+    }
+}
+
+RendererConfig Renderer::GetConfig()
+{
+    return this->config;
+}
+
+void Renderer::UpdateConfig(RendererConfig config)
+{
+    backbufferIsStale = true;
+    this->config = config;
+}
+
+RendererProperties const & Renderer::GetProperties()
+{
+    return properties;
+}
+
+NullResourceCounts Renderer::GetResourceCounts()
+{
+    std::lock_guard<std::mutex> guard(statsLock);
+    return resourceCounts;
+}
+
+NullCommandCounts Renderer::GetFrameCommandCounts()
+{
+    std::lock_guard<std::mutex> guard(statsLock);
+    return lastFrameCommands;
+}
+
+NullCommandCounts Renderer::GetTotalCommandCounts()
+{
+    std::lock_guard<std::mutex> guard(statsLock);
+    return totalCommands;
+}
+
+#endif
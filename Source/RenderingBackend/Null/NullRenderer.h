@@ -0,0 +1,82 @@
+#pragma once
+#ifdef USE_NULL_RENDERER
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <ThirdParty/glm/glm/glm.hpp>
+
+#include "../Abstract/AbstractRenderer.h"
+#include "NullContextStructs.h"
+#include "NullResourceContext.h"
+
+/**
+ * Headless renderer that talks to no graphics API and opens no window. Resources are plain host allocations,
+ * MapBuffer returns pointers into them, and command buffers are "executed" synchronously by adding their command
+ * counts to the renderer's statistics. This makes it possible to run the engine on machines without a GPU, for
+ * example to test game logic or to profile the CPU side of the render system.
+ */
+class Renderer : public IRenderer
+{
+    friend class NullCommandBuffer;
+    friend class NullResourceContext;
+
+public:
+    Renderer(char const * title, int winX, int winY, uint32_t flags, RendererConfig config, int numThreads);
+    ~Renderer();
+
+    uint32_t AcquireNextFrameIndex(SemaphoreHandle * signalSem, FenceHandle * signalFence) final override;
+    std::vector<ImageViewHandle *> GetBackbuffers() final override;
+    Format GetBackbufferFormat() const final override;
+    glm::uvec2 GetResolution() const final override;
+    uint32_t GetSwapCount() const final override;
+
+    void CreateResources(std::function<void(ResourceCreationContext &)> fun) final override;
+    bool IsUploadComplete(UploadToken token) final override;
+    void WaitForUpload(UploadToken token) final override;
+    void ExecuteCommandBuffer(CommandBuffer * ctx, std::vector<SemaphoreHandle *> waitSem,
+                              std::vector<SemaphoreHandle *> signalSem,
+                              FenceHandle * signalFence = nullptr) final override;
+    void SwapWindow(uint32_t imageIndex, SemaphoreHandle * waitSem) final override;
+
+    void RecreateSwapchain() final override;
+
+    RendererConfig GetConfig() final override;
+    void UpdateConfig(RendererConfig) final override;
+
+    RendererProperties const & GetProperties() final override;
+
+    /**
+     * Returns the resources that are currently alive.
+     */
+    NullResourceCounts GetResourceCounts();
+    /**
+     * Returns the commands executed between the two most recent calls to SwapWindow.
+     */
+    NullCommandCounts GetFrameCommandCounts();
+    /**
+     * Returns all commands executed since the renderer was created.
+     */
+    NullCommandCounts GetTotalCommandCounts();
+
+    int abortCode = 0;
+
+private:
+    static constexpr uint32_t SWAP_COUNT = 2;
+
+    std::mutex statsLock;
+    NullResourceCounts resourceCounts;
+    NullCommandCounts currentFrameCommands;
+    NullCommandCounts lastFrameCommands;
+    NullCommandCounts totalCommands;
+    uint64_t frameCount = 0;
+
+    RendererConfig config;
+    RendererProperties properties;
+
+    bool backbufferIsStale = false;
+    uint32_t nextFrameIndex = 0;
+    NullImageHandle backbufferImages[SWAP_COUNT];
+    NullImageViewHandle backbufferViews[SWAP_COUNT];
+};
+#endif
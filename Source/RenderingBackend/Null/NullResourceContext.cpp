@@ -0,0 +1,345 @@
+#ifdef USE_NULL_RENDERER
+#include "NullResourceContext.h"
+
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+#include "Logging/Logger.h"
+#include "NullCommandBufferAllocator.h"
+#include "NullRenderer.h"
+
+static const auto logger = Logger::Create("NullResourceContext");
+
+static size_t BytesPerPixel(Format format)
+{
+    switch (format) {
+    case Format::R8:
+        return 1;
+    case Format::RG8:
+        return 2;
+    case Format::RGB8:
+        return 3;
+    case Format::B8G8R8A8_UNORM:
+    case Format::RGBA8:
+    case Format::R16G16_SFLOAT:
+    case Format::R32_SFLOAT:
+    case Format::D32_SFLOAT:
+        return 4;
+    case Format::R32G32B32A32_SFLOAT:
+        return 16;
+    }
+    return 4;
+}
+
+bool NullFenceHandle::Wait(uint64_t timeOut)
+{
+    // Command buffers execute synchronously so any work the fence guards has already finished
+    return true;
+}
+
+bool NullQueryPoolHandle::GetTimestamps(uint32_t firstQuery, uint32_t count, uint64_t * results)
+{
+    return false;
+}
+
+UploadToken NullResourceContext::BufferSubData(BufferHandle * buffer, uint8_t * data, size_t offset, size_t size)
+{
+    auto nullBuffer = (NullBufferHandle *)buffer;
+    assert(offset + size <= nullBuffer->data.size());
+    memcpy(nullBuffer->data.data() + offset, data, size);
+    return UPLOAD_COMPLETE;
+}
+
+BufferHandle * NullResourceContext::CreateBuffer(BufferCreateInfo const & bc)
+{
+    auto ret = new NullBufferHandle();
+    ret->data.resize(bc.size);
+    ret->usage = bc.usage;
+    ret->memoryProperties = bc.memoryProperties;
+    Track(&NullResourceCounts::buffers, 1);
+    Track(&NullResourceCounts::bufferBytes, bc.size);
+    return ret;
+}
+
+void NullResourceContext::DestroyBuffer(BufferHandle * handle)
+{
+    assert(handle != nullptr);
+    auto nullBuffer = (NullBufferHandle *)handle;
+    Track(&NullResourceCounts::buffers, -1);
+    Track(&NullResourceCounts::bufferBytes, -(int64_t)nullBuffer->data.size());
+    delete nullBuffer;
+}
+
+uint8_t * NullResourceContext::MapBuffer(BufferHandle * handle, size_t offset, size_t size)
+{
+    auto nullBuffer = (NullBufferHandle *)handle;
+    if (offset + size > nullBuffer->data.size()) {
+        logger.Error("MapBuffer called with offset={} and size={} on buffer with size={}",
+                     offset,
+                     size,
+                     nullBuffer->data.size());
+        return nullptr;
+    }
+    return nullBuffer->data.data() + offset;
+}
+
+void NullResourceContext::UnmapBuffer(BufferHandle * handle) {}
+
+void NullResourceContext::FlushBuffer(BufferHandle * handle, size_t offset, size_t size) {}
+
+ImageHandle * NullResourceContext::CreateImage(ImageCreateInfo const & ic)
+{
+    auto ret = new NullImageHandle();
+    ret->format = ic.format;
+    ret->type = ic.type;
+    ret->width = ic.width;
+    ret->height = ic.type == ImageHandle::Type::TYPE_1D ? 1 : ic.height;
+    ret->depth = 1;
+    ret->mipLevels = ic.mipLevels;
+    Track(&NullResourceCounts::images, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyImage(ImageHandle * handle)
+{
+    assert(handle != nullptr);
+    auto nullImage = (NullImageHandle *)handle;
+    Track(&NullResourceCounts::images, -1);
+    Track(&NullResourceCounts::imageBytes, -(int64_t)nullImage->data.size());
+    delete nullImage;
+}
+
+void NullResourceContext::AllocateImage(ImageHandle * handle)
+{
+    // Only the base mip level is backed by memory, nothing ever reads the others
+    auto nullImage = (NullImageHandle *)handle;
+    auto oldSize = nullImage->data.size();
+    nullImage->data.resize((size_t)handle->width * handle->height * handle->depth * BytesPerPixel(handle->format));
+    Track(&NullResourceCounts::imageBytes, (int64_t)nullImage->data.size() - (int64_t)oldSize);
+}
+
+UploadToken NullResourceContext::ImageData(ImageHandle * handle, std::vector<uint8_t> const & data)
+{
+    auto nullImage = (NullImageHandle *)handle;
+    auto oldSize = nullImage->data.size();
+    nullImage->data = data;
+    Track(&NullResourceCounts::imageBytes, (int64_t)nullImage->data.size() - (int64_t)oldSize);
+    return UPLOAD_COMPLETE;
+}
+
+RenderPassHandle * NullResourceContext::CreateRenderPass(ResourceCreationContext::RenderPassCreateInfo const & ci)
+{
+    auto ret = new NullRenderPassHandle();
+    ret->createInfo = ci;
+    Track(&NullResourceCounts::renderPasses, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyRenderPass(RenderPassHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::renderPasses, -1);
+    delete (NullRenderPassHandle *)handle;
+}
+
+ImageViewHandle * NullResourceContext::CreateImageView(ResourceCreationContext::ImageViewCreateInfo const & ci)
+{
+    auto ret = new NullImageViewHandle();
+    ret->image = ci.image;
+    ret->subresourceRange = ci.subresourceRange;
+    Track(&NullResourceCounts::imageViews, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyImageView(ImageViewHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::imageViews, -1);
+    delete (NullImageViewHandle *)handle;
+}
+
+FramebufferHandle * NullResourceContext::CreateFramebuffer(ResourceCreationContext::FramebufferCreateInfo const & ci)
+{
+    auto ret = new NullFramebufferHandle();
+    ret->attachments = ci.attachments;
+    ret->width = ci.width;
+    ret->height = ci.height;
+    ret->layers = ci.layers;
+    Track(&NullResourceCounts::framebuffers, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyFramebuffer(FramebufferHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::framebuffers, -1);
+    delete (NullFramebufferHandle *)handle;
+}
+
+PipelineLayoutHandle * NullResourceContext::CreatePipelineLayout(PipelineLayoutCreateInfo const & ci)
+{
+    auto ret = new NullPipelineLayoutHandle();
+    ret->descriptorLayouts = ci.setLayouts;
+    Track(&NullResourceCounts::pipelineLayouts, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyPipelineLayout(PipelineLayoutHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::pipelineLayouts, -1);
+    delete (NullPipelineLayoutHandle *)handle;
+}
+
+QueryPoolHandle * NullResourceContext::CreateTimestampQueryPool(uint32_t queryCount)
+{
+    Track(&NullResourceCounts::queryPools, 1);
+    return new NullQueryPoolHandle();
+}
+
+void NullResourceContext::DestroyQueryPool(QueryPoolHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::queryPools, -1);
+    delete (NullQueryPoolHandle *)handle;
+}
+
+PipelineHandle *
+NullResourceContext::CreateGraphicsPipeline(ResourceCreationContext::GraphicsPipelineCreateInfo const & ci)
+{
+    auto ret = new NullPipelineHandle();
+    ret->vertexInputState = ci.vertexInputState;
+    ret->pipelineLayout = ci.pipelineLayout;
+    Track(&NullResourceCounts::pipelines, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyPipeline(PipelineHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::pipelines, -1);
+    delete (NullPipelineHandle *)handle;
+}
+
+ShaderModuleHandle * NullResourceContext::CreateShaderModule(ResourceCreationContext::ShaderModuleCreateInfo const & ci)
+{
+    auto ret = new NullShaderModuleHandle();
+    ret->codeSize = ci.code.size() * sizeof(uint32_t);
+    Track(&NullResourceCounts::shaderModules, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyShaderModule(ShaderModuleHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::shaderModules, -1);
+    delete (NullShaderModuleHandle *)handle;
+}
+
+SamplerHandle * NullResourceContext::CreateSampler(ResourceCreationContext::SamplerCreateInfo const & ci)
+{
+    Track(&NullResourceCounts::samplers, 1);
+    return new NullSamplerHandle();
+}
+
+void NullResourceContext::DestroySampler(SamplerHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::samplers, -1);
+    delete (NullSamplerHandle *)handle;
+}
+
+DescriptorSetLayoutHandle * NullResourceContext::CreateDescriptorSetLayout(DescriptorSetLayoutCreateInfo const & ci)
+{
+    auto ret = new NullDescriptorSetLayoutHandle();
+    ret->bindings = std::vector<DescriptorSetLayoutCreateInfo::Binding>(ci.pBinding, ci.pBinding + ci.bindingCount);
+    Track(&NullResourceCounts::descriptorSetLayouts, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyDescriptorSetLayout(DescriptorSetLayoutHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::descriptorSetLayouts, -1);
+    delete (NullDescriptorSetLayoutHandle *)handle;
+}
+
+VertexInputStateHandle *
+NullResourceContext::CreateVertexInputState(ResourceCreationContext::VertexInputStateCreateInfo & ci)
+{
+    auto ret = new NullVertexInputStateHandle();
+    ret->createInfo = ci;
+    Track(&NullResourceCounts::vertexInputStates, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyVertexInputState(VertexInputStateHandle * handle)
+{
+    assert(handle != nullptr);
+    Track(&NullResourceCounts::vertexInputStates, -1);
+    delete (NullVertexInputStateHandle *)handle;
+}
+
+DescriptorSet * NullResourceContext::CreateDescriptorSet(DescriptorSetCreateInfo const & ci)
+{
+    auto ret = new NullDescriptorSet();
+    ret->descriptors = std::vector<DescriptorSetCreateInfo::Descriptor>(ci.descriptors,
+                                                                        ci.descriptors + ci.descriptorCount);
+    Track(&NullResourceCounts::descriptorSets, 1);
+    return ret;
+}
+
+void NullResourceContext::DestroyDescriptorSet(DescriptorSet * set)
+{
+    assert(set != nullptr);
+    Track(&NullResourceCounts::descriptorSets, -1);
+    delete (NullDescriptorSet *)set;
+}
+
+SemaphoreHandle * NullResourceContext::CreateSemaphore()
+{
+    Track(&NullResourceCounts::semaphores, 1);
+    return new NullSemaphoreHandle();
+}
+
+void NullResourceContext::DestroySemaphore(SemaphoreHandle * sem)
+{
+    assert(sem != nullptr);
+    Track(&NullResourceCounts::semaphores, -1);
+    delete (NullSemaphoreHandle *)sem;
+}
+
+CommandBufferAllocator * NullResourceContext::CreateCommandBufferAllocator()
+{
+    Track(&NullResourceCounts::commandBufferAllocators, 1);
+    return new NullCommandBufferAllocator();
+}
+
+void NullResourceContext::DestroyCommandBufferAllocator(CommandBufferAllocator * alloc)
+{
+    assert(alloc != nullptr);
+    Track(&NullResourceCounts::commandBufferAllocators, -1);
+    delete (NullCommandBufferAllocator *)alloc;
+}
+
+FenceHandle * NullResourceContext::CreateFence(bool startSignaled)
+{
+    Track(&NullResourceCounts::fences, 1);
+    return new NullFenceHandle();
+}
+
+void NullResourceContext::DestroyFence(FenceHandle * fence)
+{
+    assert(fence != nullptr);
+    Track(&NullResourceCounts::fences, -1);
+    delete (NullFenceHandle *)fence;
+}
+
+void NullResourceContext::Track(int64_t NullResourceCounts::*count, int64_t delta)
+{
+    std::lock_guard<std::mutex> guard(renderer->statsLock);
+    renderer->resourceCounts.*count += delta;
+}
+
+#endif
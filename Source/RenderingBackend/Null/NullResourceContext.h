@@ -0,0 +1,71 @@
+#pragma once
+#ifdef USE_NULL_RENDERER
+
+#include "../Abstract/ResourceCreationContext.h"
+#include "NullContextStructs.h"
+
+class Renderer;
+
+class NullResourceContext : public ResourceCreationContext
+{
+public:
+    NullResourceContext(Renderer * renderer) : renderer(renderer) {}
+
+    UploadToken BufferSubData(BufferHandle *, uint8_t *, size_t, size_t) final override;
+    BufferHandle * CreateBuffer(BufferCreateInfo const &) final override;
+    void DestroyBuffer(BufferHandle *) final override;
+    uint8_t * MapBuffer(BufferHandle *, size_t, size_t) final override;
+    void UnmapBuffer(BufferHandle *) final override;
+    void FlushBuffer(BufferHandle *, size_t, size_t) final override;
+    ImageHandle * CreateImage(ImageCreateInfo const &) final override;
+    void DestroyImage(ImageHandle *) final override;
+    void AllocateImage(ImageHandle *) final override;
+    UploadToken ImageData(ImageHandle *, std::vector<uint8_t> const &) final override;
+
+    RenderPassHandle * CreateRenderPass(ResourceCreationContext::RenderPassCreateInfo const &) final override;
+    void DestroyRenderPass(RenderPassHandle *) final override;
+
+    ImageViewHandle * CreateImageView(ResourceCreationContext::ImageViewCreateInfo const &) final override;
+    void DestroyImageView(ImageViewHandle *) final override;
+
+    FramebufferHandle * CreateFramebuffer(ResourceCreationContext::FramebufferCreateInfo const &) final override;
+    void DestroyFramebuffer(FramebufferHandle *) final override;
+
+    PipelineLayoutHandle * CreatePipelineLayout(PipelineLayoutCreateInfo const &) final override;
+    void DestroyPipelineLayout(PipelineLayoutHandle *) final override;
+
+    QueryPoolHandle * CreateTimestampQueryPool(uint32_t queryCount) final override;
+    void DestroyQueryPool(QueryPoolHandle *) final override;
+
+    PipelineHandle * CreateGraphicsPipeline(ResourceCreationContext::GraphicsPipelineCreateInfo const &) final override;
+    void DestroyPipeline(PipelineHandle *) final override;
+    ShaderModuleHandle * CreateShaderModule(ResourceCreationContext::ShaderModuleCreateInfo const &) final override;
+    void DestroyShaderModule(ShaderModuleHandle *) final override;
+
+    SamplerHandle * CreateSampler(ResourceCreationContext::SamplerCreateInfo const &) final override;
+    void DestroySampler(SamplerHandle *) final override;
+
+    DescriptorSetLayoutHandle * CreateDescriptorSetLayout(DescriptorSetLayoutCreateInfo const &) final override;
+    void DestroyDescriptorSetLayout(DescriptorSetLayoutHandle *) final override;
+    VertexInputStateHandle *
+    CreateVertexInputState(ResourceCreationContext::VertexInputStateCreateInfo &) final override;
+    void DestroyVertexInputState(VertexInputStateHandle *) final override;
+
+    DescriptorSet * CreateDescriptorSet(DescriptorSetCreateInfo const &) final override;
+    void DestroyDescriptorSet(DescriptorSet *) final override;
+
+    SemaphoreHandle * CreateSemaphore() final override;
+    void DestroySemaphore(SemaphoreHandle *) final override;
+
+    CommandBufferAllocator * CreateCommandBufferAllocator() final override;
+    void DestroyCommandBufferAllocator(CommandBufferAllocator *) final override;
+    FenceHandle * CreateFence(bool startSignaled) final override;
+    void DestroyFence(FenceHandle *) final override;
+
+private:
+    void Track(int64_t NullResourceCounts::*count, int64_t delta);
+
+    Renderer * renderer;
+};
+
+#endif
@@ -7,6 +7,7 @@ DescriptorSetBindingMap::DescriptorSetBindingMap(OpenGLPipelineLayoutHandle * la
 {
     GLuint bufferBindingOffset = 0;
     GLuint samplerBindingOffset = 0;
+    GLuint storageBindingOffset = 0;
     for (size_t i = 0; i < layout->descriptorLayouts.size(); ++i) {
         auto nativeDescriptorLayout =
             (OpenGLDescriptorSetLayoutHandle *)layout->descriptorLayouts[i];
@@ -15,9 +16,15 @@ DescriptorSetBindingMap::DescriptorSetBindingMap(OpenGLPipelineLayoutHandle * la
             if (binding.descriptorType == DescriptorType::COMBINED_IMAGE_SAMPLER) {
                 internalMap[key] = samplerBindingOffset;
                 samplerBindingOffset++;
-            } else if (binding.descriptorType == DescriptorType::UNIFORM_BUFFER) {
+            } else if (binding.descriptorType == DescriptorType::UNIFORM_BUFFER ||
+                       binding.descriptorType == DescriptorType::UNIFORM_BUFFER_DYNAMIC) {
                 internalMap[key] = bufferBindingOffset;
                 bufferBindingOffset++;
+            } else if (binding.descriptorType == DescriptorType::STORAGE_BUFFER ||
+                       binding.descriptorType == DescriptorType::STORAGE_BUFFER_DYNAMIC) {
+                // Shader storage blocks have their own binding points separate from uniform blocks
+                internalMap[key] = storageBindingOffset;
+                storageBindingOffset++;
             }
         }
     }
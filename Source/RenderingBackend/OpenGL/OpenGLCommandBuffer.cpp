@@ -32,6 +32,13 @@ void OpenGLCommandBuffer::CmdBeginRenderPass(CommandBuffer::RenderPassBeginInfo
 
 void OpenGLCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle * layout, uint32_t offset,
                                                 std::vector<DescriptorSet *> sets)
+{
+    CmdBindDescriptorSets(layout, offset, std::move(sets), {});
+}
+
+void OpenGLCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle * layout, uint32_t offset,
+                                                std::vector<DescriptorSet *> sets,
+                                                std::vector<uint32_t> dynamicOffsets)
 {
     auto nativeLayout = (OpenGLPipelineLayoutHandle *)layout;
     std::vector<OpenGLDescriptorSet *> nativeSets(sets.size());
@@ -40,6 +47,7 @@ void OpenGLCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle * layout, u
     }
     BindDescriptorSetArgs args;
     DescriptorSetBindingMap descriptorSetBindingMap(nativeLayout);
+    size_t dynamicOffsetIdx = 0;
 
     for (size_t i = 0; i < sets.size(); ++i) {
         auto nativeSet = (OpenGLDescriptorSet *)sets[i];
@@ -57,14 +65,29 @@ void OpenGLCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle * layout, u
                                        .hasSampler = true});
                 break;
             }
-            case DescriptorType::UNIFORM_BUFFER: {
+            case DescriptorType::UNIFORM_BUFFER:
+            case DescriptorType::STORAGE_BUFFER: {
                 auto buf = std::get<0>(d.descriptor);
-                args.buffers.push_back({finalBinding,
+                args.buffers.push_back({d.type == DescriptorType::UNIFORM_BUFFER ? GL_UNIFORM_BUFFER
+                                                                                 : GL_SHADER_STORAGE_BUFFER,
+                                        finalBinding,
                                         ((OpenGLBufferHandle *)buf.buffer)->nativeHandle,
                                         (GLintptr)buf.offset,
                                         (GLsizeiptr)buf.range});
                 break;
             }
+            case DescriptorType::UNIFORM_BUFFER_DYNAMIC:
+            case DescriptorType::STORAGE_BUFFER_DYNAMIC: {
+                assert(dynamicOffsetIdx < dynamicOffsets.size());
+                auto buf = std::get<0>(d.descriptor);
+                args.buffers.push_back({d.type == DescriptorType::UNIFORM_BUFFER_DYNAMIC ? GL_UNIFORM_BUFFER
+                                                                                         : GL_SHADER_STORAGE_BUFFER,
+                                        finalBinding,
+                                        ((OpenGLBufferHandle *)buf.buffer)->nativeHandle,
+                                        (GLintptr)(buf.offset + dynamicOffsets[dynamicOffsetIdx++]),
+                                        (GLsizeiptr)buf.range});
+                break;
+            }
             case DescriptorType::INPUT_ATTACHMENT: {
                 auto image = std::get<ResourceCreationContext::DescriptorSetCreateInfo::ImageDescriptor>(d.descriptor);
                 auto nativeImageView = (OpenGLImageViewHandle *)image.imageView;
@@ -132,6 +155,11 @@ void OpenGLCommandBuffer::CmdDrawIndexed(uint32_t indexCount, uint32_t instanceC
         static_cast<int>(indexCount), firstIndex, static_cast<int>(instanceCount), vertexOffset, firstInstance});
 }
 
+void OpenGLCommandBuffer::CmdDrawIndexedIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount)
+{
+    commandList.push_back(DrawIndexedIndirectArgs{((OpenGLBufferHandle *)buffer)->nativeHandle, offset, drawCount});
+}
+
 void OpenGLCommandBuffer::CmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex,
                                   uint32_t firstInstance)
 {
@@ -157,6 +185,8 @@ void OpenGLCommandBuffer::CmdExecuteCommands(std::vector<CommandBuffer *> && com
 
 void OpenGLCommandBuffer::CmdNextSubpass(SubpassContents subpassContents) {}
 
+void OpenGLCommandBuffer::CmdResetQueryPool(QueryPoolHandle * queryPool, uint32_t firstQuery, uint32_t queryCount) {}
+
 void OpenGLCommandBuffer::CmdSetScissor(uint32_t firstScissor, uint32_t scissorCount,
                                         CommandBuffer::Rect2D const * pScissors)
 {
@@ -183,6 +213,8 @@ void OpenGLCommandBuffer::CmdUpdateBuffer(BufferHandle * buffer, size_t offset,
     commandList.push_back(cmd);
 }
 
+void OpenGLCommandBuffer::CmdWriteTimestamp(QueryPoolHandle * queryPool, uint32_t query) {}
+
 void OpenGLCommandBuffer::Execute(Renderer * renderer, std::vector<SemaphoreHandle *> waitSem,
                                   std::vector<SemaphoreHandle *> signalSem, FenceHandle * signalFence)
 {
@@ -213,7 +245,7 @@ void OpenGLCommandBuffer::Execute(Renderer * renderer, std::vector<SemaphoreHand
         case RenderCommandType::BIND_DESCRIPTOR_SET: {
             auto args = std::get<BindDescriptorSetArgs>(rc);
             for (auto b : args.buffers) {
-                glBindBufferRange(GL_UNIFORM_BUFFER, b.binding, b.buffer, b.offset, b.size);
+                glBindBufferRange(b.target, b.binding, b.buffer, b.offset, b.size);
             }
             for (auto i : args.images) {
                 glUniform1i(i.binding, i.binding);
@@ -286,6 +318,14 @@ void OpenGLCommandBuffer::Execute(Renderer * renderer, std::vector<SemaphoreHand
                                               args.basevertex);
             break;
         }
+        case RenderCommandType::DRAW_INDEXED_INDIRECT: {
+            auto args = std::get<DrawIndexedIndirectArgs>(rc);
+            assert(indexBufferType == GL_UNSIGNED_SHORT || indexBufferType == GL_UNSIGNED_INT);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, args.buffer);
+            glMultiDrawElementsIndirect(
+                primitiveTopology, indexBufferType, (void *)args.offset, (GLsizei)args.drawCount, (GLsizei)20);
+            break;
+        }
         case RenderCommandType::EXECUTE_COMMANDS: {
             auto args = std::get<ExecuteCommandsArgs>(rc);
             assert(args.pCommandBuffers != nullptr);
@@ -354,4 +394,9 @@ bool OpenGLFenceHandle::Wait(uint64_t timeOut)
     return true;
 }
 
+bool OpenGLQueryPoolHandle::GetTimestamps(uint32_t firstQuery, uint32_t count, uint64_t * results)
+{
+    return false;
+}
+
 #endif
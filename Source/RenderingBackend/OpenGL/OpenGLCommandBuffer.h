@@ -25,6 +25,8 @@ public:
                             CommandBuffer::SubpassContents contents) final override;
     void CmdBindDescriptorSets(PipelineLayoutHandle *, uint32_t offset,
                                std::vector<DescriptorSet *> sets) final override;
+    void CmdBindDescriptorSets(PipelineLayoutHandle *, uint32_t offset, std::vector<DescriptorSet *> sets,
+                               std::vector<uint32_t> dynamicOffsets) final override;
     void CmdBindIndexBuffer(BufferHandle * buffer, size_t offset, CommandBuffer::IndexType indexType) final override;
     void CmdBindPipeline(RenderPassHandle::PipelineBindPoint, PipelineHandle *) final override;
     void CmdBindVertexBuffer(BufferHandle * buffer, uint32_t binding, size_t offset, uint32_t stride) final override;
@@ -33,15 +35,18 @@ public:
     void CmdDrawIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount) final override;
     void CmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset,
                         uint32_t firstInstance) final override;
+    void CmdDrawIndexedIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount) final override;
     void CmdEndRenderPass() final override;
     void CmdExecuteCommands(uint32_t commandBufferCount, CommandBuffer ** pCommandBuffers) final override;
     void CmdExecuteCommands(std::vector<CommandBuffer *> && commandBuffers) final override;
     void CmdNextSubpass(SubpassContents subpassContents) final override;
+    void CmdResetQueryPool(QueryPoolHandle * queryPool, uint32_t firstQuery, uint32_t queryCount) final override;
     void CmdSetScissor(uint32_t firstScissor, uint32_t scissorCount,
                        CommandBuffer::Rect2D const * pScissors) final override;
     void CmdSetViewport(uint32_t firstViewport, uint32_t viewportCount,
                         CommandBuffer::Viewport const * pViewports) final override;
     void CmdUpdateBuffer(BufferHandle * buffer, size_t offset, size_t size, uint32_t const * pData) final override;
+    void CmdWriteTimestamp(QueryPoolHandle * queryPool, uint32_t query) final override;
 
 protected:
     void Execute(Renderer *, std::vector<SemaphoreHandle *> waitSem, std::vector<SemaphoreHandle *> signalSem,
@@ -57,6 +62,7 @@ private:
         DRAW,
         DRAW_INDIRECT,
         DRAW_INDEXED,
+        DRAW_INDEXED_INDIRECT,
         END_RENDERPASS,
         EXECUTE_COMMANDS,
         EXECUTE_COMMANDS_VECTOR,
@@ -75,6 +81,7 @@ private:
     };
     struct BindDescriptorSetArgs {
         struct GLBufferDescriptor {
+            GLenum target;
             GLuint binding;
             GLuint buffer;
             GLintptr offset;
@@ -129,6 +136,11 @@ private:
         GLint basevertex;
         uint32_t firstInstance;
     };
+    struct DrawIndexedIndirectArgs {
+        GLuint buffer;
+        size_t offset;
+        uint32_t drawCount;
+    };
     struct EndRenderPassArgs {
     };
     struct ExecuteCommandsArgs {
@@ -156,8 +168,9 @@ private:
     };
     using RenderCommand =
         std::variant<BeginRenderPassArgs, BindDescriptorSetArgs, BindIndexBufferArgs, BindPipelineArgs,
-                     BindVertexBufferArgs, DrawArgs, DrawIndirectArgs, DrawIndexedArgs, EndRenderPassArgs,
-                     ExecuteCommandsArgs, ExecuteCommandsVectorArgs, SetScissorArgs, SetViewportArgs, UpdateBufferArgs>;
+                     BindVertexBufferArgs, DrawArgs, DrawIndirectArgs, DrawIndexedArgs, DrawIndexedIndirectArgs,
+                     EndRenderPassArgs, ExecuteCommandsArgs, ExecuteCommandsVectorArgs, SetScissorArgs,
+                     SetViewportArgs, UpdateBufferArgs>;
 
     /*
             The list of commands to execute
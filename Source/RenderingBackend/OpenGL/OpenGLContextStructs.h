@@ -48,6 +48,11 @@ struct OpenGLImageViewHandle : ImageViewHandle {
     ImageSubresourceRange subresourceRange;
 };
 
+// The GL renderer does not support timestamp queries, so GPU timings are always reported as unavailable
+struct OpenGLQueryPoolHandle : QueryPoolHandle {
+    bool GetTimestamps(uint32_t firstQuery, uint32_t count, uint64_t * results) final override;
+};
+
 struct OpenGLRenderPassHandle : RenderPassHandle {
     ResourceCreationContext::RenderPassCreateInfo createInfo;
 };
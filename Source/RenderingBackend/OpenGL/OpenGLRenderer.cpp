@@ -58,6 +58,9 @@ Renderer::Renderer(char const * title, int const winX, int const winY, uint32_t
 
     stbi_set_flip_vertically_on_load(true);
 
+    // glMultiDraw*Indirect is core since 4.3 and we always request a 4.6 context
+    properties = RendererProperties(0, 0, true, false);
+
     glReadBuffer(GL_BACK);
     glGenFramebuffers(1, &backbufferFramebuffer);
     RecreateSwapchain();
@@ -81,6 +84,14 @@ void Renderer::CreateResources(std::function<void(ResourceCreationContext &)> fu
     renderQueueWrite.Push(RenderCommand(RenderCommand::CreateResourceParams(fun)));
 }
 
+bool Renderer::IsUploadComplete(UploadToken token)
+{
+    // Uploads are finished by the time the CreateResources function that started them returns
+    return true;
+}
+
+void Renderer::WaitForUpload(UploadToken token) {}
+
 void Renderer::ExecuteCommandBuffer(CommandBuffer * ctx, std::vector<SemaphoreHandle *> waitSem,
                                     std::vector<SemaphoreHandle *> signalSem, FenceHandle * signalFence)
 {
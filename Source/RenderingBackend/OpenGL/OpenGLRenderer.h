@@ -27,6 +27,8 @@ public:
     uint32_t GetSwapCount() const final override;
 
     void CreateResources(std::function<void(ResourceCreationContext &)> fun) final override;
+    bool IsUploadComplete(UploadToken token) final override;
+    void WaitForUpload(UploadToken token) final override;
     void ExecuteCommandBuffer(CommandBuffer * ctx, std::vector<SemaphoreHandle *> waitSem,
                               std::vector<SemaphoreHandle *> signalSem,
                               FenceHandle * signalFence = nullptr) final override;
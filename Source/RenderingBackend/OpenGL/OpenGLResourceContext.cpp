@@ -11,10 +11,11 @@
 
 static const auto logger = Logger::Create("OpenGLResourceContext");
 
-void OpenGLResourceContext::BufferSubData(BufferHandle * buffer, uint8_t * data, size_t offset, size_t size)
+UploadToken OpenGLResourceContext::BufferSubData(BufferHandle * buffer, uint8_t * data, size_t offset, size_t size)
 {
     auto nativeHandle = (OpenGLBufferHandle *)buffer;
     glNamedBufferSubData(nativeHandle->nativeHandle, offset, size, &data[0]);
+    return UPLOAD_COMPLETE;
 }
 
 BufferHandle * OpenGLResourceContext::CreateBuffer(BufferCreateInfo const & bc)
@@ -23,6 +24,8 @@ BufferHandle * OpenGLResourceContext::CreateBuffer(BufferCreateInfo const & bc)
     GLbitfield flags = GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
     if (bc.memoryProperties & MemoryPropertyFlagBits::HOST_COHERENT_BIT) {
         flags |= GL_MAP_COHERENT_BIT | GL_MAP_PERSISTENT_BIT;
+    } else if (bc.memoryProperties & MemoryPropertyFlagBits::HOST_VISIBLE_BIT) {
+        flags |= GL_MAP_PERSISTENT_BIT;
     }
 
     glCreateBuffers(1, &ret->nativeHandle);
@@ -43,6 +46,9 @@ uint8_t * OpenGLResourceContext::MapBuffer(BufferHandle * handle, size_t offset,
     GLbitfield access = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
     if (nativeHandle->memoryProperties & MemoryPropertyFlagBits::HOST_COHERENT_BIT) {
         access |= GL_MAP_COHERENT_BIT | GL_MAP_PERSISTENT_BIT;
+    } else if (nativeHandle->memoryProperties & MemoryPropertyFlagBits::HOST_VISIBLE_BIT) {
+        // Writes are made visible by FlushBuffer, so the buffer can stay mapped while it is in use
+        access |= GL_MAP_PERSISTENT_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
     }
     return (uint8_t *)glMapNamedBufferRange(nativeHandle->nativeHandle, offset, size, access);
 }
@@ -52,6 +58,16 @@ void OpenGLResourceContext::UnmapBuffer(BufferHandle * handle)
     glUnmapNamedBuffer(((OpenGLBufferHandle *)handle)->nativeHandle);
 }
 
+void OpenGLResourceContext::FlushBuffer(BufferHandle * handle, size_t offset, size_t size)
+{
+    auto nativeHandle = (OpenGLBufferHandle *)handle;
+    if (nativeHandle->memoryProperties & MemoryPropertyFlagBits::HOST_COHERENT_BIT) {
+        return;
+    }
+    // Buffers are always mapped from offset 0, so the offset within the mapping is the offset within the buffer
+    glFlushMappedNamedBufferRange(nativeHandle->nativeHandle, offset, size);
+}
+
 ImageHandle * OpenGLResourceContext::CreateImage(ImageCreateInfo const & ic)
 {
     auto ret = (OpenGLImageHandle *)allocator.allocate(sizeof(OpenGLImageHandle));
@@ -100,7 +116,7 @@ void OpenGLResourceContext::AllocateImage(ImageHandle * handle)
     }
 }
 
-void OpenGLResourceContext::ImageData(ImageHandle * handle, std::vector<uint8_t> const & data)
+UploadToken OpenGLResourceContext::ImageData(ImageHandle * handle, std::vector<uint8_t> const & data)
 {
     auto native = (OpenGLImageHandle *)handle;
     switch (handle->type) {
@@ -124,6 +140,7 @@ void OpenGLResourceContext::ImageData(ImageHandle * handle, std::vector<uint8_t>
                         data.data());
         break;
     }
+    return UPLOAD_COMPLETE;
 }
 
 RenderPassHandle * OpenGLResourceContext::CreateRenderPass(ResourceCreationContext::RenderPassCreateInfo const & ci)
@@ -215,6 +232,18 @@ void OpenGLResourceContext::DestroyPipelineLayout(PipelineLayoutHandle * layout)
     allocator.deallocate((uint8_t *)layout, sizeof(PipelineLayoutHandle));
 }
 
+QueryPoolHandle * OpenGLResourceContext::CreateTimestampQueryPool(uint32_t queryCount)
+{
+    auto ret = (OpenGLQueryPoolHandle *)allocator.allocate(sizeof(OpenGLQueryPoolHandle));
+    return new (ret) OpenGLQueryPoolHandle();
+}
+
+void OpenGLResourceContext::DestroyQueryPool(QueryPoolHandle * queryPool)
+{
+    assert(queryPool != nullptr);
+    allocator.deallocate((uint8_t *)queryPool, sizeof(OpenGLQueryPoolHandle));
+}
+
 PipelineHandle *
 OpenGLResourceContext::CreateGraphicsPipeline(ResourceCreationContext::GraphicsPipelineCreateInfo const & ci)
 {
@@ -249,6 +278,11 @@ OpenGLResourceContext::CreateGraphicsPipeline(ResourceCreationContext::GraphicsP
     for (int i = 0; i < numUniformBlocks; ++i) {
         glUniformBlockBinding(ret->nativeHandle, i, i);
     }
+    GLint numStorageBlocks;
+    glGetProgramInterfaceiv(ret->nativeHandle, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &numStorageBlocks);
+    for (int i = 0; i < numStorageBlocks; ++i) {
+        glShaderStorageBlockBinding(ret->nativeHandle, i, i);
+    }
 
     ret->depthStencil = *ci.depthStencil;
     ret->rasterizationState = *ci.rasterizationState;
@@ -392,15 +426,32 @@ OpenGLResourceContext::CreateVertexInputState(ResourceCreationContext::VertexInp
             logger.Error("Unknown vertex input type {}", ToUnderlyingType(attributeDescription.type));
         }
 
-        glVertexArrayAttribFormat(ret->nativeHandle,
-                                  attributeDescription.location,
-                                  attributeDescription.size,
-                                  type,
-                                  attributeDescription.normalized,
-                                  attributeDescription.offset);
+        bool isFloat = attributeDescription.type == VertexComponentType::FLOAT ||
+                       attributeDescription.type == VertexComponentType::HALF_FLOAT ||
+                       attributeDescription.type == VertexComponentType::DOUBLE;
+        // Integer attributes that are not normalized are read as integers by the shader, like in Vulkan
+        if (!isFloat && !attributeDescription.normalized) {
+            glVertexArrayAttribIFormat(ret->nativeHandle,
+                                       attributeDescription.location,
+                                       attributeDescription.size,
+                                       type,
+                                       attributeDescription.offset);
+        } else {
+            glVertexArrayAttribFormat(ret->nativeHandle,
+                                      attributeDescription.location,
+                                      attributeDescription.size,
+                                      type,
+                                      attributeDescription.normalized,
+                                      attributeDescription.offset);
+        }
         glVertexArrayAttribBinding(ret->nativeHandle, attributeDescription.location, attributeDescription.binding);
         glEnableVertexArrayAttrib(ret->nativeHandle, attributeDescription.location);
     }
+    for (auto const & bindingDescription : ci.vertexBindingDescriptions) {
+        if (bindingDescription.inputRate == VertexInputRate::INSTANCE) {
+            glVertexArrayBindingDivisor(ret->nativeHandle, bindingDescription.binding, 1);
+        }
+    }
     return ret;
 }
 
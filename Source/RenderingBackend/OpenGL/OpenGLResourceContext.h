@@ -6,15 +6,16 @@
 class OpenGLResourceContext : public ResourceCreationContext
 {
 public:
-    void BufferSubData(BufferHandle *, uint8_t *, size_t, size_t) final override;
+    UploadToken BufferSubData(BufferHandle *, uint8_t *, size_t, size_t) final override;
     BufferHandle * CreateBuffer(BufferCreateInfo const &) final override;
     void DestroyBuffer(BufferHandle *) final override;
     uint8_t * MapBuffer(BufferHandle *, size_t, size_t) final override;
     void UnmapBuffer(BufferHandle *) final override;
+    void FlushBuffer(BufferHandle *, size_t, size_t) final override;
     ImageHandle * CreateImage(ImageCreateInfo const &) final override;
     void DestroyImage(ImageHandle *) final override;
     void AllocateImage(ImageHandle *) final override;
-    void ImageData(ImageHandle *, std::vector<uint8_t> const &) final override;
+    UploadToken ImageData(ImageHandle *, std::vector<uint8_t> const &) final override;
 
     RenderPassHandle * CreateRenderPass(ResourceCreationContext::RenderPassCreateInfo const &) final override;
     void DestroyRenderPass(RenderPassHandle *) final override;
@@ -28,6 +29,9 @@ public:
     PipelineLayoutHandle * CreatePipelineLayout(PipelineLayoutCreateInfo const &) final override;
     void DestroyPipelineLayout(PipelineLayoutHandle *) final override;
 
+    QueryPoolHandle * CreateTimestampQueryPool(uint32_t queryCount) final override;
+    void DestroyQueryPool(QueryPoolHandle *) final override;
+
     PipelineHandle * CreateGraphicsPipeline(ResourceCreationContext::GraphicsPipelineCreateInfo const &) final override;
     void DestroyPipeline(PipelineHandle *) final override;
     ShaderModuleHandle * CreateShaderModule(ResourceCreationContext::ShaderModuleCreateInfo const &) final override;
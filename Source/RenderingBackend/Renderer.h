@@ -7,8 +7,10 @@
         so this is how it's going to be done for now.
         DOOM(2016) does something like this, since it contains a separate executable for the Vulkan renderer.
 */
-#ifndef USE_OGL_RENDERER
-#include "Vulkan/VulkanRenderer.h"
-#else
+#if defined(USE_NULL_RENDERER)
+#include "Null/NullRenderer.h"
+#elif defined(USE_OGL_RENDERER)
 #include "OpenGL/OpenGLRenderer.h"
+#else
+#include "Vulkan/VulkanRenderer.h"
 #endif
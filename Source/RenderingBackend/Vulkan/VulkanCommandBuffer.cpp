@@ -1,4 +1,4 @@
-#ifndef USE_OGL_RENDERER
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
 #include "VulkanCommandBuffer.h"
 
 #include <ThirdParty/optick/src/optick.h>
@@ -24,6 +24,12 @@ void VulkanCommandBuffer::Execute(Renderer * renderer, std::vector<SemaphoreHand
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &this->buffer;
     std::vector<VkPipelineStageFlags> flags(vulkanWaitSems.size(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
+    // Nothing is known about which stage reads the uploaded resources, so uploads are waited for before any of them
+    auto uploadWaits = renderer->stagingRing->TakePendingWaits();
+    vulkanWaitSems.insert(vulkanWaitSems.end(), uploadWaits.begin(), uploadWaits.end());
+    flags.resize(vulkanWaitSems.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
     submitInfo.pWaitDstStageMask = vulkanWaitSems.size() > 0 ? &flags[0] : nullptr;
     submitInfo.waitSemaphoreCount = (uint32_t)vulkanWaitSems.size();
     submitInfo.pWaitSemaphores = vulkanWaitSems.size() > 0 ? &vulkanWaitSems[0] : nullptr;
@@ -31,12 +37,13 @@ void VulkanCommandBuffer::Execute(Renderer * renderer, std::vector<SemaphoreHand
     submitInfo.pSignalSemaphores = vulkanSignalSems.size() > 0 ? &vulkanSignalSems[0] : nullptr;
 
     {
-        auto queue = renderer->GetGraphicsQueue();
+        auto queue = renderer->GetPrimaryGraphicsQueue();
         auto res = vkQueueSubmit(queue.queue,
                                  1,
                                  &submitInfo,
                                  signalFence != nullptr ? ((VulkanFenceHandle *)signalFence)->fence : VK_NULL_HANDLE);
         assert(res == VK_SUCCESS);
+        renderer->stagingRing->RecycleWaits(queue.queue, std::move(uploadWaits));
     }
 }
 
@@ -113,6 +120,13 @@ void VulkanCommandBuffer::CmdBeginRenderPass(CommandBuffer::RenderPassBeginInfo
 
 void VulkanCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle * layout, uint32_t offset,
                                                 std::vector<DescriptorSet *> sets)
+{
+    CmdBindDescriptorSets(layout, offset, std::move(sets), {});
+}
+
+void VulkanCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle * layout, uint32_t offset,
+                                                std::vector<DescriptorSet *> sets,
+                                                std::vector<uint32_t> dynamicOffsets)
 {
     assert(sets.size() > 0);
 
@@ -124,8 +138,14 @@ void VulkanCommandBuffer::CmdBindDescriptorSets(PipelineLayoutHandle * layout, u
     }
 
     // TODO: compute
-    vkCmdBindDescriptorSets(
-        buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, nativeLayout, offset, nativeSets.size(), &nativeSets[0], 0, nullptr);
+    vkCmdBindDescriptorSets(buffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            nativeLayout,
+                            offset,
+                            nativeSets.size(),
+                            &nativeSets[0],
+                            dynamicOffsets.size(),
+                            dynamicOffsets.data());
 }
 
 void VulkanCommandBuffer::CmdBindIndexBuffer(BufferHandle * buffer, size_t offset, CommandBuffer::IndexType indexType)
@@ -188,6 +208,12 @@ void VulkanCommandBuffer::CmdDrawIndexed(uint32_t indexCount, uint32_t instanceC
     vkCmdDrawIndexed(this->buffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
+void VulkanCommandBuffer::CmdDrawIndexedIndirect(BufferHandle * buffer, size_t offset, uint32_t drawCount)
+{
+    vkCmdDrawIndexedIndirect(
+        this->buffer, ((VulkanBufferHandle *)buffer)->buffer, offset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
 void VulkanCommandBuffer::CmdEndRenderPass()
 {
     vkCmdEndRenderPass(this->buffer);
@@ -231,6 +257,11 @@ void VulkanCommandBuffer::CmdNextSubpass(SubpassContents contents)
     vkCmdNextSubpass(this->buffer, subpassContents);
 }
 
+void VulkanCommandBuffer::CmdResetQueryPool(QueryPoolHandle * queryPool, uint32_t firstQuery, uint32_t queryCount)
+{
+    vkCmdResetQueryPool(this->buffer, ((VulkanQueryPoolHandle *)queryPool)->queryPool, firstQuery, queryCount);
+}
+
 void VulkanCommandBuffer::CmdSetScissor(uint32_t firstScissor, uint32_t scissorCount,
                                         CommandBuffer::Rect2D const * pScissors)
 {
@@ -257,4 +288,10 @@ void VulkanCommandBuffer::CmdUpdateBuffer(BufferHandle * buffer, size_t offset,
     vkCmdUpdateBuffer(this->buffer, ((VulkanBufferHandle *)buffer)->buffer, offset, size, pData);
 }
 
+void VulkanCommandBuffer::CmdWriteTimestamp(QueryPoolHandle * queryPool, uint32_t query)
+{
+    vkCmdWriteTimestamp(
+        this->buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, ((VulkanQueryPoolHandle *)queryPool)->queryPool, query);
+}
+
 #endif
@@ -1,4 +1,4 @@
-#ifndef USE_OGL_RENDERER
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
 #include "VulkanCommandBufferAllocator.h"
 
 #include <cassert>
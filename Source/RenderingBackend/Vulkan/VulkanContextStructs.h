@@ -4,10 +4,28 @@
 #include "../Abstract/RenderResources.h"
 #include "../Abstract/ResourceCreationContext.h"
 
+/**
+ * A range of device memory handed out by VulkanMemoryAllocator. Most allocations are sub-ranges of a larger block
+ * that is shared with other resources, so memory must always be bound and mapped using offset.
+ */
+struct VulkanAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Points to offset inside the persistently mapped block, or nullptr if the memory is not host visible
+    uint8_t * mapped = nullptr;
+    uint32_t memoryType = 0;
+    uint32_t poolIdx = 0;
+    // UINT32_MAX for dedicated allocations
+    uint32_t blockIdx = UINT32_MAX;
+    uint32_t nodeIdx = UINT32_MAX;
+};
+
 struct VulkanBufferHandle : BufferHandle {
-    // TODO: Both necessary? Maybe memory needs its own super-type?
     VkBuffer buffer;
-    VkDeviceMemory memory;
+    VulkanAllocation allocation;
+    // The buffer can't be destroyed until this upload has finished reading from the staging ring
+    UploadToken lastUpload;
 };
 
 struct VulkanDescriptorSet : DescriptorSet {
@@ -33,13 +51,23 @@ struct VulkanFramebufferHandle : FramebufferHandle {
 
 struct VulkanImageHandle : ImageHandle {
     VkImage image;
-    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VulkanAllocation allocation;
+    UploadToken lastUpload;
 };
 
 struct VulkanImageViewHandle : ImageViewHandle {
     VkImageView imageView;
 };
 
+struct VulkanQueryPoolHandle : QueryPoolHandle {
+    bool GetTimestamps(uint32_t firstQuery, uint32_t count, uint64_t * results) final override;
+
+    VkDevice device;
+    VkQueryPool queryPool;
+    float timestampPeriod;
+    uint32_t timestampValidBits;
+};
+
 struct VulkanRenderPassHandle : RenderPassHandle {
     VkRenderPass renderPass;
 };
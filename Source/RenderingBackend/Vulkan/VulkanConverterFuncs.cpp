@@ -1,4 +1,4 @@
-#ifndef USE_OGL_RENDERER
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
 #include "VulkanConverterFuncs.h"
 
 #include "Logging/Logger.h"
@@ -112,6 +112,8 @@ bool IsBufferDescriptorType(DescriptorType descriptorType)
     switch (descriptorType) {
     case DescriptorType::STORAGE_BUFFER:
     case DescriptorType::UNIFORM_BUFFER:
+    case DescriptorType::UNIFORM_BUFFER_DYNAMIC:
+    case DescriptorType::STORAGE_BUFFER_DYNAMIC:
         return true;
     case DescriptorType::COMBINED_IMAGE_SAMPLER:
     case DescriptorType::INPUT_ATTACHMENT:
@@ -125,6 +127,8 @@ bool IsImageDescriptorType(DescriptorType descriptorType)
     switch (descriptorType) {
     case DescriptorType::STORAGE_BUFFER:
     case DescriptorType::UNIFORM_BUFFER:
+    case DescriptorType::UNIFORM_BUFFER_DYNAMIC:
+    case DescriptorType::STORAGE_BUFFER_DYNAMIC:
         return false;
     case DescriptorType::COMBINED_IMAGE_SAMPLER:
     case DescriptorType::INPUT_ATTACHMENT:
@@ -142,6 +146,10 @@ VkDescriptorType ToVulkanDescriptorType(DescriptorType descriptorType)
         return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     case DescriptorType::UNIFORM_BUFFER:
         return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    case DescriptorType::UNIFORM_BUFFER_DYNAMIC:
+        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    case DescriptorType::STORAGE_BUFFER_DYNAMIC:
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
     case DescriptorType::INPUT_ATTACHMENT:
         return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
     }
@@ -285,4 +293,56 @@ VkRect2D ToVulkanRect2D(CommandBuffer::Rect2D const & rect)
     return VkRect2D{{rect.offset.x, rect.offset.y}, {rect.extent.width, rect.extent.height}};
 }
 
+VkFormat ToVulkanVertexFormat(VertexComponentType type, uint8_t size, bool normalized)
+{
+    assert(size >= 1 && size <= 4);
+    // Indexed by [normalized][size - 1], integer types that are not normalized are read as integers by the shader
+    static VkFormat const byteFormats[2][4] = {
+        {VK_FORMAT_R8_SINT, VK_FORMAT_R8G8_SINT, VK_FORMAT_R8G8B8_SINT, VK_FORMAT_R8G8B8A8_SINT},
+        {VK_FORMAT_R8_SNORM, VK_FORMAT_R8G8_SNORM, VK_FORMAT_R8G8B8_SNORM, VK_FORMAT_R8G8B8A8_SNORM}};
+    static VkFormat const ubyteFormats[2][4] = {
+        {VK_FORMAT_R8_UINT, VK_FORMAT_R8G8_UINT, VK_FORMAT_R8G8B8_UINT, VK_FORMAT_R8G8B8A8_UINT},
+        {VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_R8G8B8A8_UNORM}};
+    static VkFormat const shortFormats[2][4] = {
+        {VK_FORMAT_R16_SINT, VK_FORMAT_R16G16_SINT, VK_FORMAT_R16G16B16_SINT, VK_FORMAT_R16G16B16A16_SINT},
+        {VK_FORMAT_R16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16B16_SNORM, VK_FORMAT_R16G16B16A16_SNORM}};
+    static VkFormat const ushortFormats[2][4] = {
+        {VK_FORMAT_R16_UINT, VK_FORMAT_R16G16_UINT, VK_FORMAT_R16G16B16_UINT, VK_FORMAT_R16G16B16A16_UINT},
+        {VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16A16_UNORM}};
+    static VkFormat const intFormats[4] = {
+        VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+    static VkFormat const uintFormats[4] = {
+        VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+    static VkFormat const halfFormats[4] = {
+        VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT};
+    static VkFormat const floatFormats[4] = {
+        VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+    static VkFormat const doubleFormats[4] = {
+        VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT};
+
+    switch (type) {
+    case VertexComponentType::BYTE:
+        return byteFormats[normalized][size - 1];
+    case VertexComponentType::UBYTE:
+        return ubyteFormats[normalized][size - 1];
+    case VertexComponentType::SHORT:
+        return shortFormats[normalized][size - 1];
+    case VertexComponentType::USHORT:
+        return ushortFormats[normalized][size - 1];
+    case VertexComponentType::INT:
+        return intFormats[size - 1];
+    case VertexComponentType::UINT:
+        return uintFormats[size - 1];
+    case VertexComponentType::HALF_FLOAT:
+        return halfFormats[size - 1];
+    case VertexComponentType::FLOAT:
+        return floatFormats[size - 1];
+    case VertexComponentType::DOUBLE:
+        return doubleFormats[size - 1];
+    default:
+        assert(false);
+        return VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+}
+
 #endif
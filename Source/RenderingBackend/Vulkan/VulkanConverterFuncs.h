@@ -1,5 +1,5 @@
 #pragma once
-#ifndef USE_OGL_RENDERER
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
 
 #include <cassert>
 #include <vulkan/vulkan.h>
@@ -27,5 +27,6 @@ VkShaderStageFlagBits ToVulkanShaderStage(uint32_t stage);
 VkAttachmentStoreOp ToVulkanStoreOp(RenderPassHandle::AttachmentDescription::StoreOp op);
 VkImageSubresourceRange ToVulkanSubResourceRange(ImageViewHandle::ImageSubresourceRange range);
 VkRect2D ToVulkanRect2D(CommandBuffer::Rect2D const & rect);
+VkFormat ToVulkanVertexFormat(VertexComponentType type, uint8_t size, bool normalized);
 
 #endif
@@ -0,0 +1,444 @@
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
+#include "VulkanMemoryAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+
+#include <ThirdParty/optick/src/optick.h>
+
+#include "Logging/Logger.h"
+#include "Util/Tlsf.h"
+
+static const auto logger = Logger::Create("VulkanMemoryAllocator");
+
+// Size of the blocks in heaps larger than SMALL_HEAP_MAX_SIZE, smaller heaps use an eighth of the heap per block
+static constexpr VkDeviceSize LARGE_HEAP_BLOCK_SIZE = 64 * 1024 * 1024;
+static constexpr VkDeviceSize SMALL_HEAP_MAX_SIZE = 1024ull * 1024 * 1024;
+// Images this large are usually render targets, which get memory of their own instead of taking up a block
+static constexpr VkDeviceSize DEDICATED_IMAGE_MIN_SIZE = 8 * 1024 * 1024;
+
+struct VulkanMemoryAllocator::Block {
+    struct NodeData {
+        VkDeviceSize alignment;
+        void * userData;
+    };
+
+    Block(VkDeviceMemory memory, VkDeviceSize size, uint8_t * mapped) : memory(memory), size(size), mapped(mapped)
+    {
+        ranges.AddRange(0, size, {1, nullptr});
+    }
+
+    /**
+     * Returns the index of the node that was allocated, or NO_NODE if there is no free range large enough.
+     */
+    uint32_t Allocate(VkDeviceSize allocSize, VkDeviceSize alignment, void * userData)
+    {
+        auto node = ranges.FindFree(alignment > 1 ? allocSize + alignment - 1 : allocSize);
+        if (node == Tlsf::NO_NODE) {
+            return Tlsf::NO_NODE;
+        }
+        ranges.AllocateFrom(node, allocSize, alignment);
+        ranges.nodes[node].data = {alignment, userData};
+        allocationCount++;
+        allocatedBytes += allocSize;
+        return node;
+    }
+
+    void Free(uint32_t node)
+    {
+        allocationCount--;
+        allocatedBytes -= ranges.nodes[node].size;
+        ranges.nodes[node].data.userData = nullptr;
+        ranges.Free(node);
+    }
+
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint8_t * mapped;
+
+    uint32_t allocationCount = 0;
+    VkDeviceSize allocatedBytes = 0;
+
+    Tlsf::FreeLists<VkDeviceSize, NodeData> ranges;
+};
+
+struct VulkanMemoryAllocator::Pool {
+    std::mutex lock;
+    uint32_t memoryType;
+    VkDeviceSize blockSize;
+    // Entries are set to nullptr when their block is freed and reused by the next block that is created
+    std::vector<std::unique_ptr<Block>> blocks;
+    uint32_t dedicatedCount = 0;
+    VkDeviceSize dedicatedBytes = 0;
+};
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice) : device(device)
+{
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    bufferImageGranularity = props.limits.bufferImageGranularity;
+    nonCoherentAtomSize = props.limits.nonCoherentAtomSize;
+
+    pools.resize(memoryProperties.memoryTypeCount * 2);
+    for (uint32_t i = 0; i < pools.size(); ++i) {
+        pools[i] = std::make_unique<Pool>();
+        pools[i]->memoryType = i / 2;
+        pools[i]->blockSize = GetBlockSize(i / 2);
+    }
+    logger.Info("Created allocator with memoryTypeCount={}, bufferImageGranularity={}",
+                memoryProperties.memoryTypeCount,
+                bufferImageGranularity);
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+    for (auto & pool : pools) {
+        for (uint32_t i = 0; i < pool->blocks.size(); ++i) {
+            if (pool->blocks[i] == nullptr) {
+                continue;
+            }
+            if (pool->blocks[i]->allocationCount > 0) {
+                logger.Warn("Freeing block {} of memoryType={} with allocationCount={} still alive",
+                            i,
+                            pool->memoryType,
+                            pool->blocks[i]->allocationCount);
+            }
+            DestroyBlock(*pool, i);
+        }
+        if (pool->dedicatedCount > 0) {
+            logger.Warn("dedicatedCount={} allocations of memoryType={} were never freed",
+                        pool->dedicatedCount,
+                        pool->memoryType);
+        }
+    }
+}
+
+bool VulkanMemoryAllocator::Allocate(VkMemoryRequirements const & requirements, uint32_t memoryType,
+                                     VulkanResourceKind kind, void * userData, VulkanAllocation * out)
+{
+    OPTICK_EVENT();
+    assert(memoryType < memoryProperties.memoryTypeCount);
+    assert(requirements.size > 0);
+    auto poolIdx = GetPoolIdx(memoryType, kind);
+    auto & pool = *pools[poolIdx];
+    auto alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    std::lock_guard<std::mutex> guard(pool.lock);
+    if (requirements.size > pool.blockSize / 2 ||
+        (kind == VulkanResourceKind::OPTIMAL && requirements.size >= DEDICATED_IMAGE_MIN_SIZE)) {
+        return AllocateDedicated(poolIdx, requirements.size, out);
+    }
+
+    for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+        if (pool.blocks[i] == nullptr) {
+            continue;
+        }
+        auto node = pool.blocks[i]->Allocate(requirements.size, alignment, userData);
+        if (node != Tlsf::NO_NODE) {
+            *out = MakeAllocation(poolIdx, i, node);
+            return true;
+        }
+    }
+
+    uint32_t blockIdx;
+    auto block = CreateBlock(pool, &blockIdx);
+    if (block == nullptr) {
+        // A whole block may not fit in what is left of the heap even if this allocation does
+        return AllocateDedicated(poolIdx, requirements.size, out);
+    }
+    auto node = block->Allocate(requirements.size, alignment, userData);
+    assert(node != Tlsf::NO_NODE);
+    *out = MakeAllocation(poolIdx, blockIdx, node);
+    return true;
+}
+
+void VulkanMemoryAllocator::Free(VulkanAllocation const & allocation)
+{
+    OPTICK_EVENT();
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+    auto & pool = *pools[allocation.poolIdx];
+    std::lock_guard<std::mutex> guard(pool.lock);
+    if (allocation.blockIdx == UINT32_MAX) {
+        vkFreeMemory(device, allocation.memory, nullptr);
+        pool.dedicatedCount--;
+        pool.dedicatedBytes -= allocation.size;
+        return;
+    }
+
+    auto block = pool.blocks[allocation.blockIdx].get();
+    assert(block != nullptr && block->memory == allocation.memory);
+    block->Free(allocation.nodeIdx);
+    if (block->allocationCount > 0) {
+        return;
+    }
+    // One empty block is kept around so that freeing and recreating a resource does not allocate a block every time
+    for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+        if (i != allocation.blockIdx && pool.blocks[i] != nullptr && pool.blocks[i]->allocationCount == 0) {
+            DestroyBlock(pool, allocation.blockIdx);
+            return;
+        }
+    }
+}
+
+void VulkanMemoryAllocator::Flush(VulkanAllocation const & allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    OPTICK_EVENT();
+    auto propertyFlags = memoryProperties.memoryTypes[allocation.memoryType].propertyFlags;
+    if ((propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0) {
+        return;
+    }
+    assert(allocation.mapped != nullptr && offset + size <= allocation.size);
+    // Flushed ranges must be aligned to nonCoherentAtomSize unless they end at the end of the memory
+    VkDeviceSize memorySize = allocation.size;
+    if (allocation.blockIdx != UINT32_MAX) {
+        auto & pool = *pools[allocation.poolIdx];
+        std::lock_guard<std::mutex> guard(pool.lock);
+        memorySize = pool.blocks[allocation.blockIdx]->size;
+    }
+    VkDeviceSize begin = (allocation.offset + offset) / nonCoherentAtomSize * nonCoherentAtomSize;
+    VkDeviceSize end = std::min(Tlsf::AlignUp(allocation.offset + offset + size, nonCoherentAtomSize), memorySize);
+    VkMappedMemoryRange range{VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr, allocation.memory, begin, end - begin};
+    auto res = vkFlushMappedMemoryRanges(device, 1, &range);
+    if (res != VK_SUCCESS) {
+        logger.Error("Failed to flush memory of memoryType={}, error={}", allocation.memoryType, res);
+    }
+}
+
+size_t VulkanMemoryAllocator::Defragment(MoveCallback const & move, size_t maxMoves)
+{
+    OPTICK_EVENT();
+    size_t moves = 0;
+    for (uint32_t poolIdx = 0; poolIdx < pools.size() && moves < maxMoves; ++poolIdx) {
+        auto & pool = *pools[poolIdx];
+        std::lock_guard<std::mutex> guard(pool.lock);
+
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+            if (pool.blocks[i] != nullptr && pool.blocks[i]->allocationCount > 0) {
+                order.push_back(i);
+            }
+        }
+        if (order.size() < 2) {
+            continue;
+        }
+        // The least used half of the blocks is emptied into the most used half, which keeps allocations from moving
+        // back and forth between blocks if this is called repeatedly
+        std::sort(order.begin(), order.end(), [&pool](uint32_t a, uint32_t b) {
+            return pool.blocks[a]->allocatedBytes < pool.blocks[b]->allocatedBytes;
+        });
+        auto srcCount = order.size() / 2;
+        for (size_t s = 0; s < srcCount && moves < maxMoves; ++s) {
+            auto srcIdx = order[s];
+            auto src = pool.blocks[srcIdx].get();
+            for (uint32_t n = 0; n < src->ranges.nodes.size() && moves < maxMoves; ++n) {
+                auto node = src->ranges.nodes[n];
+                if (node.size == 0 || node.isFree) {
+                    continue;
+                }
+                for (size_t d = order.size(); d-- > srcCount;) {
+                    auto dstIdx = order[d];
+                    auto dstNode = pool.blocks[dstIdx]->Allocate(node.size, node.data.alignment, node.data.userData);
+                    if (dstNode == Tlsf::NO_NODE) {
+                        continue;
+                    }
+                    auto from = MakeAllocation(poolIdx, srcIdx, n);
+                    auto to = MakeAllocation(poolIdx, dstIdx, dstNode);
+                    if (move(node.data.userData, from, to)) {
+                        src->Free(n);
+                        moves++;
+                    } else {
+                        pool.blocks[dstIdx]->Free(dstNode);
+                    }
+                    break;
+                }
+            }
+            if (src->allocationCount == 0) {
+                DestroyBlock(pool, srcIdx);
+            }
+        }
+    }
+    if (moves > 0) {
+        logger.Info("Defragment moved {} allocations", moves);
+    }
+    return moves;
+}
+
+std::vector<VulkanMemoryTypeStats> VulkanMemoryAllocator::GetStats()
+{
+    std::vector<VulkanMemoryTypeStats> ret;
+    for (uint32_t memoryType = 0; memoryType < memoryProperties.memoryTypeCount; ++memoryType) {
+        VulkanMemoryTypeStats stats;
+        stats.memoryType = memoryType;
+        stats.propertyFlags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+        for (uint32_t poolIdx = memoryType * 2; poolIdx < memoryType * 2 + 2; ++poolIdx) {
+            auto & pool = *pools[poolIdx];
+            std::lock_guard<std::mutex> guard(pool.lock);
+            stats.dedicatedCount += pool.dedicatedCount;
+            stats.dedicatedBytes += pool.dedicatedBytes;
+            for (auto const & block : pool.blocks) {
+                if (block == nullptr) {
+                    continue;
+                }
+                stats.blockCount++;
+                stats.blockBytes += block->size;
+                stats.allocationCount += block->allocationCount;
+                stats.allocatedBytes += block->allocatedBytes;
+                for (auto const & node : block->ranges.nodes) {
+                    if (node.size > 0 && node.isFree) {
+                        stats.freeRangeCount++;
+                        stats.largestFreeRange = std::max(stats.largestFreeRange, node.size);
+                    }
+                }
+            }
+        }
+        if (stats.blockCount > 0 || stats.dedicatedCount > 0) {
+            ret.push_back(stats);
+        }
+    }
+    return ret;
+}
+
+void VulkanMemoryAllocator::LogStats()
+{
+    auto stats = GetStats();
+    if (stats.size() == 0) {
+        logger.Info("No device memory is allocated");
+        return;
+    }
+    for (auto const & s : stats) {
+        logger.Info("memoryType={} propertyFlags={} blocks={} ({} KiB) allocations={} ({} KiB, {}% of blocks in use) "
+                    "dedicated={} ({} KiB) freeRanges={} largestFreeRange={} KiB",
+                    s.memoryType,
+                    s.propertyFlags,
+                    s.blockCount,
+                    s.blockBytes / 1024,
+                    s.allocationCount,
+                    s.allocatedBytes / 1024,
+                    s.blockBytes > 0 ? s.allocatedBytes * 100 / s.blockBytes : 0,
+                    s.dedicatedCount,
+                    s.dedicatedBytes / 1024,
+                    s.freeRangeCount,
+                    s.largestFreeRange / 1024);
+    }
+}
+
+bool VulkanMemoryAllocator::AllocateDedicated(uint32_t poolIdx, VkDeviceSize size, VulkanAllocation * out)
+{
+    auto & pool = *pools[poolIdx];
+    VkMemoryAllocateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    info.allocationSize = size;
+    info.memoryTypeIndex = pool.memoryType;
+    VkDeviceMemory memory;
+    auto res = vkAllocateMemory(device, &info, nullptr, &memory);
+    if (res != VK_SUCCESS) {
+        logger.Error("Failed to allocate dedicated memory of size={} for memoryType={}, error={}",
+                     size,
+                     pool.memoryType,
+                     res);
+        return false;
+    }
+    pool.dedicatedCount++;
+    pool.dedicatedBytes += size;
+
+    *out = {};
+    out->memory = memory;
+    out->offset = 0;
+    out->size = size;
+    out->mapped = MapIfHostVisible(pool.memoryType, memory);
+    out->memoryType = pool.memoryType;
+    out->poolIdx = poolIdx;
+    return true;
+}
+
+VulkanMemoryAllocator::Block * VulkanMemoryAllocator::CreateBlock(Pool & pool, uint32_t * outBlockIdx)
+{
+    OPTICK_EVENT();
+    VkMemoryAllocateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    info.allocationSize = pool.blockSize;
+    info.memoryTypeIndex = pool.memoryType;
+    VkDeviceMemory memory;
+    auto res = vkAllocateMemory(device, &info, nullptr, &memory);
+    if (res != VK_SUCCESS) {
+        logger.Warn("Failed to allocate block of size={} for memoryType={}, error={}",
+                    pool.blockSize,
+                    pool.memoryType,
+                    res);
+        return nullptr;
+    }
+
+    uint32_t blockIdx = 0;
+    while (blockIdx < pool.blocks.size() && pool.blocks[blockIdx] != nullptr) {
+        blockIdx++;
+    }
+    if (blockIdx == pool.blocks.size()) {
+        pool.blocks.emplace_back();
+    }
+    pool.blocks[blockIdx] =
+        std::make_unique<Block>(memory, pool.blockSize, MapIfHostVisible(pool.memoryType, memory));
+    logger.Info("Allocated block {} of size={} for memoryType={}", blockIdx, pool.blockSize, pool.memoryType);
+    *outBlockIdx = blockIdx;
+    return pool.blocks[blockIdx].get();
+}
+
+void VulkanMemoryAllocator::DestroyBlock(Pool & pool, uint32_t blockIdx)
+{
+    // Freeing the memory also unmaps it
+    vkFreeMemory(device, pool.blocks[blockIdx]->memory, nullptr);
+    pool.blocks[blockIdx] = nullptr;
+}
+
+VkDeviceSize VulkanMemoryAllocator::GetBlockSize(uint32_t memoryType)
+{
+    auto heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    if (heapSize <= SMALL_HEAP_MAX_SIZE) {
+        return Tlsf::AlignUp(heapSize / 8, 1024);
+    }
+    return LARGE_HEAP_BLOCK_SIZE;
+}
+
+uint32_t VulkanMemoryAllocator::GetPoolIdx(uint32_t memoryType, VulkanResourceKind kind)
+{
+    // Linear and optimal resources only need to be kept apart when they could end up sharing a page
+    if (bufferImageGranularity > 1 && kind == VulkanResourceKind::OPTIMAL) {
+        return memoryType * 2 + 1;
+    }
+    return memoryType * 2;
+}
+
+VulkanAllocation VulkanMemoryAllocator::MakeAllocation(uint32_t poolIdx, uint32_t blockIdx, uint32_t nodeIdx)
+{
+    auto const & pool = *pools[poolIdx];
+    auto const & block = *pool.blocks[blockIdx];
+    auto const & node = block.ranges.nodes[nodeIdx];
+    VulkanAllocation ret;
+    ret.memory = block.memory;
+    ret.offset = node.offset;
+    ret.size = node.size;
+    ret.mapped = block.mapped != nullptr ? block.mapped + node.offset : nullptr;
+    ret.memoryType = pool.memoryType;
+    ret.poolIdx = poolIdx;
+    ret.blockIdx = blockIdx;
+    ret.nodeIdx = nodeIdx;
+    return ret;
+}
+
+uint8_t * VulkanMemoryAllocator::MapIfHostVisible(uint32_t memoryType, VkDeviceMemory memory)
+{
+    if ((memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0) {
+        return nullptr;
+    }
+    uint8_t * ret = nullptr;
+    auto res = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, (void **)&ret);
+    if (res != VK_SUCCESS) {
+        logger.Error("Failed to map memory of memoryType={}, error={}", memoryType, res);
+        return nullptr;
+    }
+    return ret;
+}
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "VulkanContextStructs.h"
+
+/**
+ * Buffers and linearly tiled images are LINEAR, optimally tiled images are OPTIMAL. The two kinds must not share a
+ * bufferImageGranularity sized page, so on devices where that granularity is larger than 1 they get separate blocks.
+ */
+enum class VulkanResourceKind { LINEAR, OPTIMAL };
+
+struct VulkanMemoryTypeStats {
+    uint32_t memoryType = 0;
+    VkMemoryPropertyFlags propertyFlags = 0;
+    uint32_t blockCount = 0;
+    VkDeviceSize blockBytes = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize allocatedBytes = 0;
+    uint32_t dedicatedCount = 0;
+    VkDeviceSize dedicatedBytes = 0;
+    uint32_t freeRangeCount = 0;
+    VkDeviceSize largestFreeRange = 0;
+};
+
+/**
+ * Sub-allocates device memory for buffers and images. Each memory type gets a list of large blocks which are split up
+ * with a two level segregated fit (TLSF) allocator of its own. Finding or freeing a range within a block is O(1), but
+ * allocating tries the pool's blocks in turn so it is linear in the number of blocks, and freeing the last allocation
+ * of a block scans the blocks for another empty one before releasing it. Only allocating a new block costs a
+ * vkAllocateMemory call. Large resources get a dedicated VkDeviceMemory of their own. Host visible blocks are mapped
+ * once when they are created and stay mapped until they are freed.
+ *
+ * All public methods are thread safe.
+ */
+class VulkanMemoryAllocator
+{
+public:
+    /**
+     * Called by Defragment for every allocation it wants to move. The callback must copy the contents of the resource
+     * from the old range to the new one and rebind the resource to the new range, then return true. Returning false
+     * leaves the allocation where it is. The callback must not allocate or free memory using the allocator.
+     */
+    using MoveCallback =
+        std::function<bool(void * userData, VulkanAllocation const & from, VulkanAllocation const & to)>;
+
+    VulkanMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+    ~VulkanMemoryAllocator();
+
+    /**
+     * Finds memory for a resource with the given requirements in the memory type memoryType. userData is passed to the
+     * MoveCallback if the allocation is ever moved by Defragment. Returns false if the device is out of memory.
+     */
+    bool Allocate(VkMemoryRequirements const & requirements, uint32_t memoryType, VulkanResourceKind kind,
+                  void * userData, VulkanAllocation * out);
+    void Free(VulkanAllocation const & allocation);
+    /**
+     * Makes host writes to size bytes at offset within the allocation visible to the device. Does nothing if the
+     * allocation's memory type is host coherent.
+     */
+    void Flush(VulkanAllocation const & allocation, VkDeviceSize offset, VkDeviceSize size);
+
+    /**
+     * Tries to empty the least used blocks of every memory type by moving their allocations into the other blocks, and
+     * frees the blocks that end up empty. Resources that may be in use by the GPU must not be moved, so this should
+     * only be called when the device is idle or when the callback knows the resource is not in use.
+     * Returns the number of allocations that were moved.
+     */
+    size_t Defragment(MoveCallback const & move, size_t maxMoves = SIZE_MAX);
+
+    std::vector<VulkanMemoryTypeStats> GetStats();
+    void LogStats();
+
+private:
+    struct Block;
+    struct Pool;
+
+    bool AllocateDedicated(uint32_t poolIdx, VkDeviceSize size, VulkanAllocation * out);
+    Block * CreateBlock(Pool & pool, uint32_t * outBlockIdx);
+    void DestroyBlock(Pool & pool, uint32_t blockIdx);
+    VkDeviceSize GetBlockSize(uint32_t memoryType);
+    uint32_t GetPoolIdx(uint32_t memoryType, VulkanResourceKind kind);
+    VulkanAllocation MakeAllocation(uint32_t poolIdx, uint32_t blockIdx, uint32_t nodeIdx);
+    uint8_t * MapIfHostVisible(uint32_t memoryType, VkDeviceMemory memory);
+
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    VkDeviceSize bufferImageGranularity;
+    VkDeviceSize nonCoherentAtomSize;
+
+    // Two pools per memory type, one for each VulkanResourceKind
+    std::vector<std::unique_ptr<Pool>> pools;
+};
+#endif
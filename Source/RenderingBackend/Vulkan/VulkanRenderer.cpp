@@ -1,19 +1,92 @@
-#ifndef USE_OGL_RENDERER
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
 #include "VulkanRenderer.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
 #include <ThirdParty/SDL2/include/SDL_vulkan.h>
 #include <ThirdParty/optick/src/optick.h>
 #include <ThirdParty/stb/stb_image.h>
 #include <vulkan/vulkan.h>
 
-#include "Jobs/JobEngine.h"
+#include "Console/Console.h"
 #include "Logging/Logger.h"
+#include "Util/Fnv1a.h"
+#include "VulkanMemoryAllocator.h"
 #include "VulkanResourceContext.h"
 
 static const auto logger = Logger::Create("VulkanRenderer");
 static const auto vulkanLogger = Logger::Create("Vulkan");
 
-static const size_t MIN_STAGING_BUFFER_SIZE = 2 * 1024 * 1024;
+// Large enough that a level's worth of textures can be in flight at once without waiting for the ring to drain
+static constexpr VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+
+static char const * PIPELINE_CACHE_PATH = "cache/vulkan_pipelines.bin";
+// headerSize, headerVersion, vendorID, deviceID and pipelineCacheUUID as laid out by the Vulkan spec
+static constexpr size_t PIPELINE_CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+// The data from the driver is prefixed with this magic, its size and its hash so that a file which was only partly
+// written is never handed back to the driver
+// "VKPC"
+static constexpr uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x43504b56;
+static constexpr size_t PIPELINE_CACHE_FILE_HEADER_SIZE = sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+// The application quits by calling exit() which skips the Renderer's destructor, so the pipeline cache is saved from an
+// atexit handler as well. The handler is registered once and saves whichever Renderer currently owns the cache.
+static Renderer * pipelineCacheOwner = nullptr;
+static std::once_flag pipelineCacheAtExitRegistered;
+
+static std::vector<uint8_t> ReadPipelineCacheFile(VkPhysicalDeviceProperties const & props)
+{
+    std::ifstream in(PIPELINE_CACHE_PATH, std::ios::binary | std::ios::ate);
+    if (!in) {
+        logger.Info("No pipeline cache at {}, starting with an empty cache", PIPELINE_CACHE_PATH);
+        return {};
+    }
+    std::vector<uint8_t> file((size_t)in.tellg());
+    in.seekg(0);
+    in.read((char *)file.data(), file.size());
+    if (!in || file.size() < PIPELINE_CACHE_FILE_HEADER_SIZE) {
+        logger.Warn("Pipeline cache at {} is truncated, starting with an empty cache", PIPELINE_CACHE_PATH);
+        return {};
+    }
+    uint32_t magic;
+    uint64_t dataSize, dataHash;
+    memcpy(&magic, &file[0], sizeof(uint32_t));
+    memcpy(&dataSize, &file[4], sizeof(uint64_t));
+    memcpy(&dataHash, &file[12], sizeof(uint64_t));
+    if (magic != PIPELINE_CACHE_FILE_MAGIC || dataSize != file.size() - PIPELINE_CACHE_FILE_HEADER_SIZE ||
+        Fnv1a(file.data() + PIPELINE_CACHE_FILE_HEADER_SIZE, dataSize) != dataHash) {
+        logger.Warn("Pipeline cache at {} is truncated or corrupt, starting with an empty cache", PIPELINE_CACHE_PATH);
+        return {};
+    }
+    std::vector<uint8_t> data(file.begin() + PIPELINE_CACHE_FILE_HEADER_SIZE, file.end());
+    if (data.size() < PIPELINE_CACHE_HEADER_SIZE) {
+        logger.Warn("Pipeline cache at {} is truncated, starting with an empty cache", PIPELINE_CACHE_PATH);
+        return {};
+    }
+
+    uint32_t headerSize, headerVersion, vendorId, deviceId;
+    memcpy(&headerSize, &data[0], sizeof(uint32_t));
+    memcpy(&headerVersion, &data[4], sizeof(uint32_t));
+    memcpy(&vendorId, &data[8], sizeof(uint32_t));
+    memcpy(&deviceId, &data[12], sizeof(uint32_t));
+    if (headerSize < PIPELINE_CACHE_HEADER_SIZE || headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        logger.Warn("Pipeline cache at {} has an unknown header, starting with an empty cache", PIPELINE_CACHE_PATH);
+        return {};
+    }
+    // The driver would also reject a mismatching cache, but some drivers have crashed on caches from other devices
+    // so it is checked here first
+    if (vendorId != props.vendorID || deviceId != props.deviceID ||
+        memcmp(&data[16], props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        logger.Info("Pipeline cache at {} was created by a different device or driver, starting with an empty cache",
+                    PIPELINE_CACHE_PATH);
+        return {};
+    }
+    return data;
+}
 
 static Format ToAbstractFormat(VkFormat format)
 {
@@ -169,6 +242,14 @@ static bool CreateVkSemaphore(VkDevice device, VkSemaphore * const ret)
 
 Renderer::~Renderer()
 {
+    SavePipelineCache();
+    if (pipelineCacheOwner == this) {
+        pipelineCacheOwner = nullptr;
+    }
+    vkDestroyPipelineCache(basics.device, pipelineCache, nullptr);
+    pipelineCache = VK_NULL_HANDLE;
+    stagingRing = nullptr;
+    memoryAllocator = nullptr;
     SDL_DestroyWindow(window);
 }
 
@@ -187,7 +268,6 @@ uint32_t Renderer::AcquireNextFrameIndex(SemaphoreHandle * signalReady, FenceHan
         return UINT32_MAX;
     }
     assert(res == VK_SUCCESS);
-    currFrameInfoIdx = imageIndex;
     return imageIndex;
 }
 std::vector<ImageViewHandle *> Renderer::GetBackbuffers()
@@ -212,6 +292,17 @@ void Renderer::CreateResources(std::function<void(ResourceCreationContext &)> fu
     fun(ctx);
 }
 
+bool Renderer::IsUploadComplete(UploadToken token)
+{
+    return stagingRing->IsComplete(token);
+}
+
+void Renderer::WaitForUpload(UploadToken token)
+{
+    OPTICK_EVENT();
+    stagingRing->Wait(token);
+}
+
 void Renderer::ExecuteCommandBuffer(CommandBuffer * ctx, std::vector<SemaphoreHandle *> waitSem,
                                     std::vector<SemaphoreHandle *> signalSem, FenceHandle * signalFence)
 {
@@ -486,9 +577,7 @@ Renderer::Renderer(char const * title, int winX, int winY, uint32_t flags, Rende
 
     vkGetPhysicalDeviceFeatures(basics.physicalDevice, &this->supportedFeatures);
     if (!this->supportedFeatures.multiDrawIndirect) {
-        logger.Severe(
-            "multiDrawIndirect feature not supported. The engine currently only works with multiDrawIndirect");
-        exit(1);
+        logger.Warn("multiDrawIndirect feature not supported. Falling back to one indirect draw per command.");
     }
     if (!this->supportedFeatures.independentBlend) {
         logger.Severe("independentBlend feature not supported. The engine currently only works with independentBlend");
@@ -502,7 +591,7 @@ Renderer::Renderer(char const * title, int winX, int winY, uint32_t flags, Rende
     }
     VkPhysicalDeviceFeatures enabledFeatures = {0};
     enabledFeatures.independentBlend = VK_TRUE;
-    enabledFeatures.multiDrawIndirect = VK_TRUE;
+    enabledFeatures.multiDrawIndirect = this->supportedFeatures.multiDrawIndirect;
     enabledFeatures.wideLines = VK_TRUE;
 
     VkDeviceCreateInfo deviceCreateInfo = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
@@ -543,6 +632,8 @@ Renderer::Renderer(char const * title, int winX, int winY, uint32_t flags, Rende
     {
         std::vector<VkDescriptorPoolSize> poolSizes({{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 100},
                                                      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 100},
+                                                     {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 100},
+                                                     {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 100},
                                                      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100},
                                                      {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 100}});
 
@@ -569,13 +660,112 @@ Renderer::Renderer(char const * title, int winX, int winY, uint32_t flags, Rende
     {
         VkPhysicalDeviceProperties props;
         vkGetPhysicalDeviceProperties(basics.physicalDevice, &props);
-        properties = RendererProperties(props.limits.minUniformBufferOffsetAlignment);
+        timestampPeriod = props.limits.timestampPeriod;
+        timestampValidBits = queueFamilyProperties[graphicsQueueIdx].timestampValidBits;
+        properties = RendererProperties(props.limits.minUniformBufferOffsetAlignment,
+                                        props.limits.minStorageBufferOffsetAlignment,
+                                        this->supportedFeatures.multiDrawIndirect == VK_TRUE,
+                                        props.limits.timestampComputeAndGraphics == VK_TRUE && timestampValidBits > 0);
     }
 
+    memoryAllocator = std::make_unique<VulkanMemoryAllocator>(basics.device, basics.physicalDevice);
+    CommandDefinition memoryStatsCommand("vk_memory_stats",
+                                         "vk_memory_stats - Logs how much device memory is allocated for each "
+                                         "memory type and how much of it is in use.",
+                                         0,
+                                         [this](auto args) { this->memoryAllocator->LogStats(); });
+    Console::RegisterCommand(memoryStatsCommand);
+    stagingRing = std::make_unique<VulkanStagingRing>(this, STAGING_RING_SIZE);
+
+    CreatePipelineCache();
+
     // TODO: This will likely result in multiple threads writing to the same graphics queue simultaneously
     OPTICK_GPU_INIT_VULKAN(&basics.device, &basics.physicalDevice, &graphicsQueues[0].queue, &graphicsQueueIdx, 1);
 }
 
+void Renderer::CreatePipelineCache()
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(basics.physicalDevice, &props);
+    auto initialData = ReadPipelineCacheFile(props);
+
+    VkPipelineCacheCreateInfo ci = {};
+    ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    ci.initialDataSize = initialData.size();
+    ci.pInitialData = initialData.size() > 0 ? initialData.data() : nullptr;
+    auto res = vkCreatePipelineCache(basics.device, &ci, nullptr, &pipelineCache);
+    if (res != VK_SUCCESS && initialData.size() > 0) {
+        logger.Warn("Failed to create pipeline cache from {}, error={}. Retrying with an empty cache",
+                    PIPELINE_CACHE_PATH,
+                    res);
+        ci.initialDataSize = 0;
+        ci.pInitialData = nullptr;
+        res = vkCreatePipelineCache(basics.device, &ci, nullptr, &pipelineCache);
+    }
+    if (res != VK_SUCCESS) {
+        logger.Error("Failed to create pipeline cache, error={}. Pipelines will be created without a cache", res);
+        pipelineCache = VK_NULL_HANDLE;
+        return;
+    }
+    logger.Info("Created pipeline cache with initialDataSize={}", initialData.size());
+
+    pipelineCacheOwner = this;
+    std::call_once(pipelineCacheAtExitRegistered, []() {
+        std::atexit([]() {
+            if (pipelineCacheOwner != nullptr) {
+                pipelineCacheOwner->SavePipelineCache();
+            }
+        });
+    });
+}
+
+void Renderer::SavePipelineCache()
+{
+    if (pipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+    size_t size;
+    if (vkGetPipelineCacheData(basics.device, pipelineCache, &size, nullptr) != VK_SUCCESS) {
+        logger.Error("Failed to get pipeline cache size, the cache will not be saved");
+        return;
+    }
+    std::vector<uint8_t> data(size);
+    if (vkGetPipelineCacheData(basics.device, pipelineCache, &size, data.data()) != VK_SUCCESS) {
+        logger.Error("Failed to get pipeline cache data, the cache will not be saved");
+        return;
+    }
+
+    std::error_code err;
+    std::filesystem::path path(PIPELINE_CACHE_PATH);
+    std::filesystem::create_directories(path.parent_path(), err);
+    // Written to a temporary file which is renamed into place so that a crash while writing never leaves a partially
+    // written cache behind
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        uint64_t dataSize = size;
+        uint64_t dataHash = Fnv1a(data.data(), size);
+        std::ofstream out(tempPath, std::ios::binary);
+        out.write((char const *)&PIPELINE_CACHE_FILE_MAGIC, sizeof(PIPELINE_CACHE_FILE_MAGIC));
+        out.write((char const *)&dataSize, sizeof(dataSize));
+        out.write((char const *)&dataHash, sizeof(dataHash));
+        out.write((char const *)data.data(), size);
+        if (!out) {
+            logger.Error("Failed to write pipeline cache to {}", tempPath.string());
+            out.close();
+            std::filesystem::remove(tempPath, err);
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, path, err);
+    if (err) {
+        logger.Error("Failed to move pipeline cache into place at {}: {}", PIPELINE_CACHE_PATH, err.message());
+        std::filesystem::remove(tempPath, err);
+        return;
+    }
+    logger.Info("Saved pipeline cache with size={} to {}", size, PIPELINE_CACHE_PATH);
+}
+
 uint32_t Renderer::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
 {
     VkPhysicalDeviceMemoryProperties memProperties;
@@ -591,21 +781,21 @@ uint32_t Renderer::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pro
     return 0;
 }
 
-void Renderer::CopyBufferToBuffer(VkCommandBuffer commandBuffer, VkBuffer src, VkBuffer dst, size_t dstOffset,
-                                  size_t size)
+void Renderer::CopyBufferToBuffer(VkCommandBuffer commandBuffer, VkBuffer src, size_t srcOffset, VkBuffer dst,
+                                  size_t dstOffset, size_t size)
 {
     VkBufferCopy region = {};
-    region.srcOffset = 0;
+    region.srcOffset = srcOffset;
     region.dstOffset = dstOffset;
     region.size = size;
     vkCmdCopyBuffer(commandBuffer, src, dst, 1, &region);
 }
 
-void Renderer::CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width,
-                                 uint32_t height)
+void Renderer::CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, size_t bufferOffset, VkImage image,
+                                 uint32_t width, uint32_t height)
 {
     VkBufferImageCopy region = {};
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -683,130 +873,6 @@ uint32_t Renderer::GetDesiredNumberOfImages(VkSurfaceCapabilitiesKHR surfaceCapa
     return desiredNumberOfImages;
 }
 
-GuardedBufferHandle Renderer::GetStagingBuffer(size_t size)
-{
-    OPTICK_EVENT();
-    for (size_t i = 0; i < stagingBuffers.size(); ++i) {
-        if (stagingBuffers[i].size >= size && stagingBuffers[i].guard.try_lock()) {
-            return {std::lock_guard<std::mutex>(stagingBuffers[i].guard, std::adopt_lock),
-                    &stagingBuffers[i].buffer,
-                    stagingBuffers[i].size};
-        }
-    }
-
-    VkBufferCreateInfo stagingInfo = {};
-    stagingInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    // We always round up to a multiplier of MIN_STAGING_BUFFER_SIZE
-    size_t multiplier = (size + MIN_STAGING_BUFFER_SIZE - 1) / MIN_STAGING_BUFFER_SIZE;
-    stagingInfo.size = multiplier * MIN_STAGING_BUFFER_SIZE;
-    stagingInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    stagingInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    VkBuffer stagingBuffer;
-    auto res = vkCreateBuffer(basics.device, &stagingInfo, nullptr, &stagingBuffer);
-    assert(res == VK_SUCCESS);
-
-    VkMemoryRequirements stagingRequirements = {};
-    vkGetBufferMemoryRequirements(basics.device, stagingBuffer, &stagingRequirements);
-
-    VkMemoryAllocateInfo stagingAllocateInfo{};
-    stagingAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    stagingAllocateInfo.allocationSize = stagingRequirements.size;
-    stagingAllocateInfo.memoryTypeIndex = FindMemoryType(
-        stagingRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    VkDeviceMemory stagingMemory;
-    res = vkAllocateMemory(basics.device, &stagingAllocateInfo, nullptr, &stagingMemory);
-    assert(res == VK_SUCCESS);
-
-    vkBindBufferMemory(basics.device, stagingBuffer, stagingMemory, 0);
-
-    // 20 minutes of fighting the compiler over copy constructors led to this
-    VulkanBufferHandle ffs;
-    ffs.buffer = stagingBuffer;
-    ffs.memory = stagingMemory;
-    stagingBuffers.emplace_back(ffs, stagingInfo.size);
-    // Despite all the fucking around this still isn't actually thread safe
-    auto idx = stagingBuffers.size() - 1;
-    return {std::lock_guard<std::mutex>(stagingBuffers[idx].guard), &stagingBuffers[idx].buffer, stagingInfo.size};
-}
-
-CommandBufferAndFence Renderer::GetGraphicsStagingCommandBuffer()
-{
-    OPTICK_EVENT();
-
-    auto threadIndex = JobEngine::GetInstance()->GetCurrentThreadIndex();
-    auto & currFrame = frameInfos[currFrameInfoIdx];
-
-    auto & buffers = currFrame.graphicsCommandBuffers[threadIndex];
-    for (auto const & buf : buffers) {
-        if (vkGetFenceStatus(basics.device, buf.isReady) == VK_SUCCESS) {
-            vkResetFences(basics.device, 1, &buf.isReady);
-            return buf;
-        }
-    }
-
-    VkFenceCreateInfo fenceCreateInfo;
-    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceCreateInfo.pNext = nullptr;
-    fenceCreateInfo.flags = 0;
-    VkFence fence;
-    auto res = vkCreateFence(basics.device, &fenceCreateInfo, nullptr, &fence);
-    assert(res == VK_SUCCESS);
-
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo;
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.pNext = nullptr;
-    commandBufferAllocateInfo.commandBufferCount = 1;
-    commandBufferAllocateInfo.commandPool = currFrame.graphicsCommandPools[threadIndex];
-    commandBufferAllocateInfo.level = VkCommandBufferLevel::VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-    VkCommandBuffer commandBuffer;
-    res = vkAllocateCommandBuffers(basics.device, &commandBufferAllocateInfo, &commandBuffer);
-    assert(res == VK_SUCCESS);
-
-    CommandBufferAndFence ret = {commandBuffer, fence};
-    buffers.push_back(ret);
-    return ret;
-}
-
-CommandBufferAndFence Renderer::GetStagingCommandBuffer()
-{
-    OPTICK_EVENT();
-
-    auto threadIndex = JobEngine::GetInstance()->GetCurrentThreadIndex();
-    auto & currFrame = frameInfos[currFrameInfoIdx];
-
-    auto & buffers = currFrame.transferCommandBuffers[threadIndex];
-    for (auto const & buf : buffers) {
-        if (vkGetFenceStatus(basics.device, buf.isReady) == VK_SUCCESS) {
-            vkResetFences(basics.device, 1, &buf.isReady);
-            return buf;
-        }
-    }
-
-    VkFenceCreateInfo fenceCreateInfo;
-    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceCreateInfo.pNext = nullptr;
-    fenceCreateInfo.flags = 0;
-    VkFence fence;
-    auto res = vkCreateFence(basics.device, &fenceCreateInfo, nullptr, &fence);
-    assert(res == VK_SUCCESS);
-
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo;
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.pNext = nullptr;
-    commandBufferAllocateInfo.commandBufferCount = 1;
-    commandBufferAllocateInfo.commandPool = currFrame.transferCommandPools[threadIndex];
-    commandBufferAllocateInfo.level = VkCommandBufferLevel::VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-    VkCommandBuffer commandBuffer;
-    res = vkAllocateCommandBuffers(basics.device, &commandBufferAllocateInfo, &commandBuffer);
-    assert(res == VK_SUCCESS);
-
-    CommandBufferAndFence ret = {commandBuffer, fence};
-    buffers.push_back(ret);
-    return ret;
-}
-
 LockedQueue Renderer::GetGraphicsQueue()
 {
     OPTICK_EVENT();
@@ -823,6 +889,11 @@ LockedQueue Renderer::GetGraphicsQueue()
     return {std::lock_guard<std::mutex>(graphicsQueues[0].queueLock), graphicsQueues[0].queue};
 }
 
+LockedQueue Renderer::GetPrimaryGraphicsQueue()
+{
+    return {std::lock_guard<std::mutex>(graphicsQueues[0].queueLock), graphicsQueues[0].queue};
+}
+
 LockedQueue Renderer::GetTransferQueue()
 {
     OPTICK_EVENT();
@@ -1034,35 +1105,6 @@ void Renderer::RecreateSwapchain()
             exit(1);
         }
     }
-
-    for (auto const & frameInfo : frameInfos) {
-        for (auto & pool : frameInfo.graphicsCommandPools) {
-            vkDestroyCommandPool(basics.device, pool, nullptr);
-        }
-        for (auto & pool : frameInfo.transferCommandPools) {
-            vkDestroyCommandPool(basics.device, pool, nullptr);
-        }
-    }
-    frameInfos.clear();
-    frameInfos.resize(swapchain.images.size());
-    for (auto & frameInfo : frameInfos) {
-        frameInfo.graphicsCommandBuffers.resize(numThreads);
-        frameInfo.graphicsCommandPools.resize(numThreads);
-        frameInfo.transferCommandBuffers.resize(numThreads);
-        frameInfo.transferCommandPools.resize(numThreads);
-        for (int i = 0; i < numThreads; ++i) {
-            VkCommandPoolCreateInfo graphicsPoolCreateInfo = {};
-            graphicsPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-            graphicsPoolCreateInfo.queueFamilyIndex = graphicsQueueIdx;
-            graphicsPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-            vkCreateCommandPool(basics.device, &graphicsPoolCreateInfo, nullptr, &frameInfo.graphicsCommandPools[i]);
-            VkCommandPoolCreateInfo transferPoolCreateInfo = {};
-            transferPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-            transferPoolCreateInfo.queueFamilyIndex = transferFamilyIdx;
-            transferPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-            vkCreateCommandPool(basics.device, &transferPoolCreateInfo, nullptr, &frameInfo.transferCommandPools[i]);
-        }
-    }
 }
 
 RendererConfig Renderer::GetConfig()
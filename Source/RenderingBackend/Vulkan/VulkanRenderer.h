@@ -1,5 +1,5 @@
 #pragma once
-#ifndef USE_OGL_RENDERER
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
 #include <atomic>
 #include <chrono>
 #include <cstdint>
@@ -17,17 +17,8 @@
 #include "../Abstract/AbstractRenderer.h"
 #include "Util/Queue.h"
 #include "VulkanContextStructs.h"
-
-struct CommandBufferAndFence {
-    VkCommandBuffer commandBuffer;
-    VkFence isReady;
-};
-
-struct GuardedBufferHandle {
-    std::lock_guard<std::mutex> guard;
-    VulkanBufferHandle * buffer;
-    size_t size;
-};
+#include "VulkanMemoryAllocator.h"
+#include "VulkanStagingRing.h"
 
 struct GuardedDescriptorPool {
     std::mutex poolLock;
@@ -44,36 +35,12 @@ struct LockedQueue {
     VkQueue queue;
 };
 
-struct VulkanStagingBuffer {
-    VulkanStagingBuffer(VulkanBufferHandle buffer, size_t size) : buffer(buffer), size(size) {}
-
-    VulkanBufferHandle buffer;
-    size_t size;
-    std::mutex guard;
-};
-
-struct VulkanStagingCommandBuffer {
-    VulkanStagingCommandBuffer(VkFence inUse, VkCommandBuffer commandBuffer)
-        : inUse(inUse), commandBuffer(commandBuffer)
-    {
-    }
-
-    std::mutex guard;
-    VkFence inUse;
-    VkCommandBuffer commandBuffer;
-};
-
-struct GuardedStagingCommandBuffer {
-    std::lock_guard<std::mutex> guard;
-    VkFence inUse;
-    VkCommandBuffer commandBuffer;
-};
-
-class Renderer : IRenderer
+class Renderer : public IRenderer
 {
     friend class VulkanResourceContext;
     friend class VulkanCommandBuffer;
     friend class VulkanResourceContext;
+    friend class VulkanStagingRing;
 
 public:
     Renderer(char const * title, int winX, int winY, uint32_t flags, RendererConfig config, int numThreads);
@@ -86,6 +53,8 @@ public:
     uint32_t GetSwapCount() const final override;
 
     void CreateResources(std::function<void(ResourceCreationContext &)> fun) final override;
+    bool IsUploadComplete(UploadToken token) final override;
+    void WaitForUpload(UploadToken token) final override;
     void ExecuteCommandBuffer(CommandBuffer * ctx, std::vector<SemaphoreHandle *> waitSem,
                               std::vector<SemaphoreHandle *> signalSem,
                               FenceHandle * signalFence = nullptr) final override;
@@ -122,36 +91,32 @@ private:
         std::vector<VkImageView> imageViews;
     };
 
+    void CreatePipelineCache();
+    /**
+     * Writes the contents of the pipeline cache to disk so the next launch can skip compiling the pipelines that were
+     * created during this one.
+     */
+    void SavePipelineCache();
     uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-    void CopyBufferToBuffer(VkCommandBuffer commandBuffer, VkBuffer src, VkBuffer dst, size_t dstOffset, size_t size);
-    void CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width,
-                           uint32_t height);
+    void CopyBufferToBuffer(VkCommandBuffer commandBuffer, VkBuffer src, size_t srcOffset, VkBuffer dst,
+                            size_t dstOffset, size_t size);
+    void CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, size_t bufferOffset, VkImage image,
+                           uint32_t width, uint32_t height);
     VkExtent2D GetDesiredExtent(VkSurfaceCapabilitiesKHR, RendererConfig);
     VkPresentModeKHR GetDesiredPresentMode(std::vector<VkPresentModeKHR>);
     VkSurfaceFormatKHR GetDesiredSurfaceFormat(std::vector<VkSurfaceFormatKHR>);
     uint32_t GetDesiredNumberOfImages(VkSurfaceCapabilitiesKHR);
-    CommandBufferAndFence GetGraphicsStagingCommandBuffer();
-    GuardedBufferHandle GetStagingBuffer(size_t size);
-    CommandBufferAndFence GetStagingCommandBuffer();
     LockedQueue GetGraphicsQueue();
+    /**
+     * Locks the graphics queue that every frame is submitted to. Uploads are made visible to rendering by having the
+     * next submission to this queue wait for them, which orders them before every later submission to it as well.
+     */
+    LockedQueue GetPrimaryGraphicsQueue();
     LockedQueue GetTransferQueue();
     void InitSurfaceCapabilities();
     void TransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout,
                                VkImageLayout newLayout);
 
-    struct FrameInfo {
-        // All these vectors should have length = NumWorkerThreads after constructor is done
-        std::vector<VkCommandPool> graphicsCommandPools;
-        std::vector<std::vector<CommandBufferAndFence>> graphicsCommandBuffers;
-        std::vector<VkCommandPool> transferCommandPools;
-        std::vector<std::vector<CommandBufferAndFence>> transferCommandBuffers;
-    };
-
-    uint32_t currFrameInfoIdx = 0;
-    uint32_t prevFrameInfoIdx = 0;
-    // length = swapchain length
-    std::vector<FrameInfo> frameInfos;
-
     RendererConfig config;
     RendererProperties properties;
 
@@ -168,18 +133,29 @@ private:
     VkSurfaceKHR surface;
     VulkanSwapchain swapchain;
 
+    // Shared by every pipeline creation, VkPipelineCache is internally synchronized so pipelines can be created from
+    // any thread
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+    // Every buffer and image gets its memory from here instead of calling vkAllocateMemory itself
+    std::unique_ptr<VulkanMemoryAllocator> memoryAllocator;
+    // BufferSubData and ImageData copy their data through here instead of waiting for a staging buffer of their own
+    std::unique_ptr<VulkanStagingRing> stagingRing;
+
     std::deque<GuardedQueue> graphicsQueues;
     std::deque<GuardedQueue> transferQueues;
 
     uint32_t graphicsQueueIdx;
+    // Nanoseconds per timestamp tick
+    float timestampPeriod = 0.f;
+    // Number of meaningful low bits in timestamps written on the graphics queue, 0 if it can't write timestamps
+    uint32_t timestampValidBits = 0;
 
     uint32_t presentQueueIdx;
     VkQueue presentQueue;
 
     uint32_t transferFamilyIdx;
 
-    std::deque<VulkanStagingBuffer> stagingBuffers;
-
     int numThreads;
 
     SDL_Window * window;
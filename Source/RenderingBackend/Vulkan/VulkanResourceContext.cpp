@@ -1,6 +1,9 @@
-#ifndef USE_OGL_RENDERER
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
 #include "VulkanResourceContext.h"
 
+#include <cstring>
+#include <numeric>
+
 #include <ThirdParty/optick/src/optick.h>
 
 #include "Jobs/JobEngine.h"
@@ -9,10 +12,32 @@
 #include "VulkanCommandBufferAllocator.h"
 #include "VulkanContextStructs.h"
 #include "VulkanConverterFuncs.h"
+#include "VulkanMemoryAllocator.h"
 #include "VulkanRenderer.h"
 
 static const auto logger = Logger::Create("VulkanResourceContext");
 
+static VkDeviceSize BytesPerPixel(Format format)
+{
+    switch (format) {
+    case Format::R8:
+        return 1;
+    case Format::RG8:
+        return 2;
+    case Format::RGB8:
+        return 3;
+    case Format::B8G8R8A8_UNORM:
+    case Format::RGBA8:
+    case Format::R16G16_SFLOAT:
+    case Format::R32_SFLOAT:
+    case Format::D32_SFLOAT:
+        return 4;
+    case Format::R32G32B32A32_SFLOAT:
+        return 16;
+    }
+    return 4;
+}
+
 CommandBufferAllocator * VulkanResourceContext::CreateCommandBufferAllocator()
 {
     auto mem = allocator.allocate(sizeof(VulkanCommandBufferAllocator));
@@ -34,60 +59,62 @@ void VulkanResourceContext::DestroyCommandBufferAllocator(CommandBufferAllocator
     vkDestroyCommandPool(renderer->basics.device, nativeHandle->commandPool, nullptr);
 }
 
-void VulkanResourceContext::BufferSubData(BufferHandle * buffer, uint8_t * data, size_t offset, size_t size)
+UploadToken VulkanResourceContext::BufferSubData(BufferHandle * buffer, uint8_t * data, size_t offset, size_t size)
 {
     OPTICK_EVENT();
     auto const nativeHandle = (VulkanBufferHandle *)buffer;
+    auto const ring = renderer->stagingRing.get();
 
-    auto stagingBuffer = renderer->GetStagingBuffer(size);
-
-    uint8_t * const mappedMemory = [this](VkDeviceMemory const & memory, size_t size) {
-        uint8_t * ret = nullptr;
-        auto const res = vkMapMemory(renderer->basics.device, memory, 0, size, 0, (void **)&ret);
-        assert(res == VK_SUCCESS);
-        return ret;
-    }(stagingBuffer.buffer->memory, size);
-
-    memcpy(mappedMemory, data, size);
-
-    vkUnmapMemory(renderer->basics.device, stagingBuffer.buffer->memory);
-
-    auto cb = renderer->GetStagingCommandBuffer();
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    // vkCmdCopyBuffer has no alignment requirements, but copies from aligned offsets are faster on most hardware
+    auto region = ring->Reserve(size, 16);
     {
-        OPTICK_EVENT("RecordTransferCommands");
-        vkBeginCommandBuffer(cb.commandBuffer, &beginInfo);
-        renderer->CopyBufferToBuffer(
-            cb.commandBuffer, stagingBuffer.buffer->buffer, nativeHandle->buffer, offset, size);
-        vkEndCommandBuffer(cb.commandBuffer);
+        OPTICK_EVENT("CopyToStagingRing");
+        memcpy(region.mapped, data, size);
     }
 
-    VkFence tempFence;
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    vkCreateFence(renderer->basics.device, &fenceInfo, nullptr, &tempFence);
-
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cb.commandBuffer;
-    // TODO: Should submit and return a fence here that the user can use to know that their data has uploaded instead of
-    // using vkQueueWaitIdle
-    {
-        auto queue = renderer->GetTransferQueue();
-        vkQueueSubmit(queue.queue, 1, &submitInfo, cb.isReady);
-        VkSubmitInfo dummySubmit = {};
-        dummySubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        dummySubmit.commandBufferCount = 0;
-        vkQueueSubmit(queue.queue, 1, &dummySubmit, tempFence);
-    }
-    {
-        OPTICK_EVENT("FenceWait")
-        vkWaitForFences(renderer->basics.device, 1, &tempFence, VK_TRUE, UINT64_MAX);
-    }
-    vkDestroyFence(renderer->basics.device, tempFence, nullptr);
+    VkBufferMemoryBarrier release = {};
+    release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    release.dstAccessMask = 0;
+    release.srcQueueFamilyIndex = ring->GetTransferFamily();
+    release.dstQueueFamilyIndex = ring->GetGraphicsFamily();
+    release.buffer = nativeHandle->buffer;
+    release.offset = offset;
+    release.size = size;
+    nativeHandle->lastUpload = ring->Submit(
+        region,
+        [&](VkCommandBuffer commandBuffer) {
+            renderer->CopyBufferToBuffer(
+                commandBuffer, region.buffer, region.offset, nativeHandle->buffer, offset, size);
+            if (ring->NeedsOwnershipTransfer()) {
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                     0,
+                                     0,
+                                     nullptr,
+                                     1,
+                                     &release,
+                                     0,
+                                     nullptr);
+            }
+        },
+        [&](VkCommandBuffer commandBuffer) {
+            auto acquire = release;
+            acquire.srcAccessMask = 0;
+            acquire.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                 0,
+                                 0,
+                                 nullptr,
+                                 1,
+                                 &acquire,
+                                 0,
+                                 nullptr);
+        });
+    return nativeHandle->lastUpload;
 }
 
 BufferHandle * VulkanResourceContext::CreateBuffer(BufferCreateInfo const & ci)
@@ -105,16 +132,16 @@ BufferHandle * VulkanResourceContext::CreateBuffer(BufferCreateInfo const & ci)
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(renderer->basics.device, ret->buffer, &memRequirements);
 
-    VkMemoryAllocateInfo memInfo = {};
-    memInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memInfo.allocationSize = memRequirements.size;
-    memInfo.memoryTypeIndex = renderer->FindMemoryType(memRequirements.memoryTypeBits, ci.memoryProperties);
-
-    res = vkAllocateMemory(renderer->basics.device, &memInfo, nullptr, &ret->memory);
-    assert(res == VK_SUCCESS);
+    auto memoryType = renderer->FindMemoryType(memRequirements.memoryTypeBits, ci.memoryProperties);
+    if (!renderer->memoryAllocator->Allocate(
+            memRequirements, memoryType, VulkanResourceKind::LINEAR, ret, &ret->allocation)) {
+        logger.Error("Failed to allocate memory for buffer with size={}, usage={}", ci.size, ci.usage);
+        assert(false);
+    }
 
-    res = vkBindBufferMemory(renderer->basics.device, ret->buffer, ret->memory, 0);
+    res = vkBindBufferMemory(renderer->basics.device, ret->buffer, ret->allocation.memory, ret->allocation.offset);
     assert(res == VK_SUCCESS);
+    ret->lastUpload = UPLOAD_COMPLETE;
     return ret;
 }
 
@@ -124,8 +151,9 @@ void VulkanResourceContext::DestroyBuffer(BufferHandle * buffer)
 
     auto nativeHandle = (VulkanBufferHandle *)buffer;
 
+    renderer->stagingRing->Wait(nativeHandle->lastUpload);
     vkDestroyBuffer(renderer->basics.device, nativeHandle->buffer, nullptr);
-    vkFreeMemory(renderer->basics.device, nativeHandle->memory, nullptr);
+    renderer->memoryAllocator->Free(nativeHandle->allocation);
     allocator.deallocate((uint8_t *)buffer, sizeof(VulkanBufferHandle));
 }
 
@@ -133,18 +161,25 @@ uint8_t * VulkanResourceContext::MapBuffer(BufferHandle * buffer, size_t offset,
 {
     assert(buffer != nullptr);
 
-    uint8_t * ret;
-    auto const res =
-        vkMapMemory(renderer->basics.device, ((VulkanBufferHandle *)buffer)->memory, offset, size, 0, (void **)&ret);
-    assert(res == VK_SUCCESS);
-    return ret;
+    // Host visible memory is mapped for as long as it is allocated, so mapping only has to find the buffer in it
+    auto const & allocation = ((VulkanBufferHandle *)buffer)->allocation;
+    if (allocation.mapped == nullptr) {
+        logger.Error("MapBuffer called on buffer in memoryType={} which is not host visible", allocation.memoryType);
+        return nullptr;
+    }
+    assert(offset + size <= allocation.size);
+    return allocation.mapped + offset;
 }
 
 void VulkanResourceContext::UnmapBuffer(BufferHandle * buffer)
 {
     assert(buffer != nullptr);
+}
 
-    vkUnmapMemory(renderer->basics.device, ((VulkanBufferHandle *)buffer)->memory);
+void VulkanResourceContext::FlushBuffer(BufferHandle * buffer, size_t offset, size_t size)
+{
+    assert(buffer != nullptr);
+    renderer->memoryAllocator->Flush(((VulkanBufferHandle *)buffer)->allocation, offset, size);
 }
 
 ImageHandle * VulkanResourceContext::CreateImage(ImageCreateInfo const & ci)
@@ -186,6 +221,8 @@ ImageHandle * VulkanResourceContext::CreateImage(ImageCreateInfo const & ci)
     ret->height = extent.height;
     ret->type = ci.type;
     ret->width = extent.width;
+    ret->allocation = {};
+    ret->lastUpload = UPLOAD_COMPLETE;
     auto const res = vkCreateImage(renderer->basics.device, &info, nullptr, &ret->image);
     assert(res == VK_SUCCESS);
     return ret;
@@ -197,10 +234,9 @@ void VulkanResourceContext::DestroyImage(ImageHandle * img)
 
     auto nativeHandle = (VulkanImageHandle *)img;
 
+    renderer->stagingRing->Wait(nativeHandle->lastUpload);
     vkDestroyImage(renderer->basics.device, nativeHandle->image, nullptr);
-    if (nativeHandle->memory != VK_NULL_HANDLE) {
-        vkFreeMemory(renderer->basics.device, nativeHandle->memory, nullptr);
-    }
+    renderer->memoryAllocator->Free(nativeHandle->allocation);
     allocator.deallocate((uint8_t *)nativeHandle, sizeof(VulkanImageHandle));
 }
 
@@ -216,27 +252,10 @@ void VulkanResourceContext::AllocateImage(ImageHandle * img)
         return ret;
     }(nativeImg->image);
 
-    VkPhysicalDeviceMemoryProperties memoryProperties;
-    vkGetPhysicalDeviceMemoryProperties(renderer->basics.physicalDevice, &memoryProperties);
-
-    auto memoryIndex = renderer->FindMemoryType(memoryRequirements.memoryTypeBits, 0);
-
-    VkMemoryAllocateInfo const info{
-        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, nullptr, memoryRequirements.size, memoryIndex};
-
-    VkDeviceMemory const memory = [this](VkMemoryAllocateInfo const & info) {
-        VkDeviceMemory ret{0};
-        auto const res = vkAllocateMemory(renderer->basics.device, &info, nullptr, &ret);
-        assert(res == VK_SUCCESS);
-        return ret;
-    }(info);
-
-    nativeImg->memory = memory;
-    auto res = vkBindImageMemory(renderer->basics.device, nativeImg->image, memory, 0);
-    assert(res == VK_SUCCESS);
+    AllocateImageMemory(nativeImg, memoryRequirements);
 }
 
-void VulkanResourceContext::ImageData(ImageHandle * img, std::vector<uint8_t> const & data)
+UploadToken VulkanResourceContext::ImageData(ImageHandle * img, std::vector<uint8_t> const & data)
 {
     OPTICK_EVENT();
     assert(img != nullptr);
@@ -250,124 +269,93 @@ void VulkanResourceContext::ImageData(ImageHandle * img, std::vector<uint8_t> co
 
     assert(data.size() <= memoryRequirements.size);
 
-    VkPhysicalDeviceMemoryProperties memoryProperties;
-    vkGetPhysicalDeviceMemoryProperties(renderer->basics.physicalDevice, &memoryProperties);
-
-    auto memoryIndex = renderer->FindMemoryType(memoryRequirements.memoryTypeBits, 0);
-
-    VkMemoryAllocateInfo const info{
-        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, nullptr, memoryRequirements.size, memoryIndex};
-
-    VkDeviceMemory const memory = [this](VkMemoryAllocateInfo const & info) {
-        VkDeviceMemory ret{0};
-        auto const res = vkAllocateMemory(renderer->basics.device, &info, nullptr, &ret);
-        assert(res == VK_SUCCESS);
-        return ret;
-    }(info);
-
-    auto guardedStagingBuffer = renderer->GetStagingBuffer(data.size());
-    {
-        OPTICK_EVENT("UploadData")
-        uint8_t * const mappedMemory = [this](VkDeviceMemory const & memory, size_t size) {
-            uint8_t * ret = nullptr;
-            auto const res = vkMapMemory(renderer->basics.device, memory, 0, size, 0, (void **)&ret);
-            assert(res == VK_SUCCESS);
-            return ret;
-        }(guardedStagingBuffer.buffer->memory, guardedStagingBuffer.size);
-
-        memcpy(mappedMemory, &data[0], data.size());
-
-        vkUnmapMemory(renderer->basics.device, guardedStagingBuffer.buffer->memory);
-    }
-
-    nativeImg->memory = memory;
-    VkResult res = vkBindImageMemory(renderer->basics.device, nativeImg->image, memory, 0);
+    VkResult res = AllocateImageMemory(nativeImg, memoryRequirements);
     assert(res == VK_SUCCESS);
 
-    auto cb = renderer->GetStagingCommandBuffer();
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    {
-        OPTICK_EVENT("RecordTransferCommands")
-        vkBeginCommandBuffer(cb.commandBuffer, &beginInfo);
-        renderer->TransitionImageLayout(cb.commandBuffer,
-                                        nativeImg->image,
-                                        ToVulkanFormat(nativeImg->format),
-                                        VK_IMAGE_LAYOUT_UNDEFINED,
-                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        renderer->CopyBufferToImage(cb.commandBuffer,
-                                    guardedStagingBuffer.buffer->buffer,
-                                    nativeImg->image,
-                                    nativeImg->width,
-                                    nativeImg->height);
-        vkEndCommandBuffer(cb.commandBuffer);
-    }
-
-    VkSemaphore sem;
-    {
-        OPTICK_EVENT("CreateSemaphore")
-        VkSemaphoreCreateInfo semInfo = {};
-        semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        vkCreateSemaphore(renderer->basics.device, &semInfo, nullptr, &sem);
-    }
-
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cb.commandBuffer;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &sem;
-
+    auto const ring = renderer->stagingRing.get();
+    // vkCmdCopyBufferToImage requires the buffer offset to be a multiple of both 4 and the texel size
+    auto region = ring->Reserve(data.size(), std::lcm<VkDeviceSize>(4, BytesPerPixel(nativeImg->format)));
     {
-        OPTICK_EVENT("SubmitTransferCommands")
-        auto transferQueue = renderer->GetTransferQueue();
-        vkQueueSubmit(transferQueue.queue, 1, &submitInfo, cb.isReady);
+        OPTICK_EVENT("CopyToStagingRing");
+        memcpy(region.mapped, &data[0], data.size());
     }
 
-    auto graphicsCommandBuffer = renderer->GetGraphicsStagingCommandBuffer();
-    {
-        OPTICK_EVENT("RecordGraphicsCommands")
-        vkBeginCommandBuffer(graphicsCommandBuffer.commandBuffer, &beginInfo);
-        renderer->TransitionImageLayout(graphicsCommandBuffer.commandBuffer,
-                                        nativeImg->image,
-                                        ToVulkanFormat(nativeImg->format),
-                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        vkEndCommandBuffer(graphicsCommandBuffer.commandBuffer);
-    }
+    // The layout transition to SHADER_READ_ONLY has to be part of both the release and the acquire if the image
+    // changes queue family
+    VkImageMemoryBarrier release = {};
+    release.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    release.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    release.dstAccessMask = 0;
+    release.srcQueueFamilyIndex = ring->GetTransferFamily();
+    release.dstQueueFamilyIndex = ring->GetGraphicsFamily();
+    release.image = nativeImg->image;
+    release.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    release.subresourceRange.baseMipLevel = 0;
+    release.subresourceRange.levelCount = 1;
+    release.subresourceRange.baseArrayLayer = 0;
+    release.subresourceRange.layerCount = 1;
+    nativeImg->lastUpload = ring->Submit(
+        region,
+        [&](VkCommandBuffer commandBuffer) {
+            auto format = ToVulkanFormat(nativeImg->format);
+            renderer->TransitionImageLayout(commandBuffer,
+                                            nativeImg->image,
+                                            format,
+                                            VK_IMAGE_LAYOUT_UNDEFINED,
+                                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            renderer->CopyBufferToImage(
+                commandBuffer, region.buffer, region.offset, nativeImg->image, nativeImg->width, nativeImg->height);
+            if (ring->NeedsOwnershipTransfer()) {
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                     0,
+                                     0,
+                                     nullptr,
+                                     0,
+                                     nullptr,
+                                     1,
+                                     &release);
+            } else {
+                renderer->TransitionImageLayout(commandBuffer,
+                                                nativeImg->image,
+                                                format,
+                                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            }
+        },
+        [&](VkCommandBuffer commandBuffer) {
+            auto acquire = release;
+            acquire.srcAccessMask = 0;
+            acquire.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                 0,
+                                 0,
+                                 nullptr,
+                                 0,
+                                 nullptr,
+                                 1,
+                                 &acquire);
+        });
+    return nativeImg->lastUpload;
+}
 
-    VkFence tempFence;
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    vkCreateFence(renderer->basics.device, &fenceInfo, nullptr, &tempFence);
-
-    VkPipelineStageFlags waitMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    VkSubmitInfo graphicsSubmitInfo = {};
-    graphicsSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    graphicsSubmitInfo.commandBufferCount = 1;
-    graphicsSubmitInfo.pCommandBuffers = &graphicsCommandBuffer.commandBuffer;
-    graphicsSubmitInfo.waitSemaphoreCount = 1;
-    graphicsSubmitInfo.pWaitSemaphores = &sem;
-    graphicsSubmitInfo.pWaitDstStageMask = &waitMask;
-    {
-        OPTICK_EVENT("SubmitGraphicsCommands")
-        auto queue = renderer->GetGraphicsQueue();
-        vkQueueSubmit(queue.queue, 1, &graphicsSubmitInfo, graphicsCommandBuffer.isReady);
-        VkSubmitInfo dummySubmit = {};
-        dummySubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        dummySubmit.commandBufferCount = 0;
-        vkQueueSubmit(queue.queue, 1, &dummySubmit, tempFence);
-    }
-    {
-        OPTICK_EVENT("FenceWait")
-        vkWaitForFences(renderer->basics.device, 1, &tempFence, VK_TRUE, UINT64_MAX);
+VkResult VulkanResourceContext::AllocateImageMemory(VulkanImageHandle * img, VkMemoryRequirements const & requirements)
+{
+    auto memoryType = renderer->FindMemoryType(requirements.memoryTypeBits, 0);
+    if (!renderer->memoryAllocator->Allocate(
+            requirements, memoryType, VulkanResourceKind::OPTIMAL, img, &img->allocation)) {
+        logger.Error("Failed to allocate memory for image with size={}x{}", img->width, img->height);
+        assert(false);
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
     }
-
-    vkDestroyFence(renderer->basics.device, tempFence, nullptr);
-    vkDestroySemaphore(renderer->basics.device, sem, nullptr);
-
+    auto res = vkBindImageMemory(renderer->basics.device, img->image, img->allocation.memory, img->allocation.offset);
     assert(res == VK_SUCCESS);
+    return res;
 }
 
 RenderPassHandle * VulkanResourceContext::CreateRenderPass(ResourceCreationContext::RenderPassCreateInfo const & ci)
@@ -573,6 +561,31 @@ void VulkanResourceContext::DestroyPipelineLayout(PipelineLayoutHandle * layout)
     allocator.deallocate((uint8_t *)layout, sizeof(VulkanPipelineLayoutHandle));
 }
 
+QueryPoolHandle * VulkanResourceContext::CreateTimestampQueryPool(uint32_t queryCount)
+{
+    assert(renderer->properties.SupportsTimestampQueries());
+    VkQueryPoolCreateInfo ci = {};
+    ci.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    ci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    ci.queryCount = queryCount;
+
+    auto mem = allocator.allocate(sizeof(VulkanQueryPoolHandle));
+    auto ret = new (mem) VulkanQueryPoolHandle();
+    ret->device = renderer->basics.device;
+    ret->timestampPeriod = renderer->timestampPeriod;
+    ret->timestampValidBits = renderer->timestampValidBits;
+    auto res = vkCreateQueryPool(renderer->basics.device, &ci, nullptr, &ret->queryPool);
+    assert(res == VK_SUCCESS);
+    return ret;
+}
+
+void VulkanResourceContext::DestroyQueryPool(QueryPoolHandle * queryPool)
+{
+    assert(queryPool != nullptr);
+    vkDestroyQueryPool(renderer->basics.device, ((VulkanQueryPoolHandle *)queryPool)->queryPool, nullptr);
+    allocator.deallocate((uint8_t *)queryPool, sizeof(VulkanQueryPoolHandle));
+}
+
 PipelineHandle *
 VulkanResourceContext::CreateGraphicsPipeline(ResourceCreationContext::GraphicsPipelineCreateInfo const & ci)
 {
@@ -628,36 +641,18 @@ VulkanResourceContext::CreateGraphicsPipeline(ResourceCreationContext::GraphicsP
         nativeVertexInputState.vertexBindingDescriptions.size());
     for (size_t i = 0; i < bindingDescriptions.size(); ++i) {
         auto & description = nativeVertexInputState.vertexBindingDescriptions[i];
-        bindingDescriptions[i] =
-            VkVertexInputBindingDescription{description.binding, description.stride, VK_VERTEX_INPUT_RATE_VERTEX};
+        bindingDescriptions[i] = VkVertexInputBindingDescription{description.binding,
+                                                                 description.stride,
+                                                                 description.inputRate == VertexInputRate::INSTANCE
+                                                                     ? VK_VERTEX_INPUT_RATE_INSTANCE
+                                                                     : VK_VERTEX_INPUT_RATE_VERTEX};
     }
 
     std::vector<VkVertexInputAttributeDescription> attributeDescriptions(
         nativeVertexInputState.vertexAttributeDescriptions.size());
     for (size_t i = 0; i < attributeDescriptions.size(); ++i) {
         auto & description = nativeVertexInputState.vertexAttributeDescriptions[i];
-        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
-        if (description.type == VertexComponentType::FLOAT) {
-            if (description.size == 1) {
-                format = VK_FORMAT_R32_SFLOAT;
-            } else if (description.size == 2) {
-                format = VK_FORMAT_R32G32_SFLOAT;
-            } else if (description.size == 3) {
-                format = VK_FORMAT_R32G32B32_SFLOAT;
-            } else if (description.size == 4) {
-                format = VK_FORMAT_R32G32B32A32_SFLOAT;
-            }
-        } else if (description.type == VertexComponentType::UINT) {
-            if (description.size == 1) {
-                format = VK_FORMAT_R32_UINT;
-            } else if (description.size == 2) {
-                format = VK_FORMAT_R32G32_UINT;
-            } else if (description.size == 3) {
-                format = VK_FORMAT_R32G32B32_UINT;
-            } else if (description.size == 4) {
-                format = VK_FORMAT_R32G32B32A32_UINT;
-            }
-        }
+        VkFormat format = ToVulkanVertexFormat(description.type, description.size, description.normalized);
         attributeDescriptions[i] =
             VkVertexInputAttributeDescription{description.location, description.binding, format, description.offset};
     }
@@ -802,8 +797,8 @@ VulkanResourceContext::CreateGraphicsPipeline(ResourceCreationContext::GraphicsP
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
     auto ret = (VulkanPipelineHandle *)allocator.allocate(sizeof(VulkanPipelineHandle));
-    auto res =
-        vkCreateGraphicsPipelines(renderer->basics.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &ret->pipeline);
+    auto res = vkCreateGraphicsPipelines(
+        renderer->basics.device, renderer->pipelineCache, 1, &pipelineInfo, nullptr, &ret->pipeline);
     assert(res == VK_SUCCESS);
     ret->vertexInputState = ci.vertexInputState;
 
@@ -1053,4 +1048,24 @@ bool VulkanFenceHandle::Wait(uint64_t timeOut)
     return res != VK_TIMEOUT;
 }
 
+bool VulkanQueryPoolHandle::GetTimestamps(uint32_t firstQuery, uint32_t count, uint64_t * results)
+{
+    auto res = vkGetQueryPoolResults(device,
+                                     queryPool,
+                                     firstQuery,
+                                     count,
+                                     count * sizeof(uint64_t),
+                                     results,
+                                     sizeof(uint64_t),
+                                     VK_QUERY_RESULT_64_BIT);
+    if (res != VK_SUCCESS) {
+        return false;
+    }
+    uint64_t const validMask = timestampValidBits >= 64 ? UINT64_MAX : (uint64_t(1) << timestampValidBits) - 1;
+    for (uint32_t i = 0; i < count; ++i) {
+        results[i] = static_cast<uint64_t>(static_cast<double>(results[i] & validMask) * timestampPeriod);
+    }
+    return true;
+}
+
 #endif
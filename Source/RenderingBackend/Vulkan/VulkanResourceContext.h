@@ -1,11 +1,13 @@
 #pragma once
-#ifndef USE_OGL_RENDERER
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
 #include "../Abstract/CommandBufferAllocator.h"
 #include "../Abstract/RenderResources.h"
 #include "../Abstract/ResourceCreationContext.h"
 
 #include <vulkan/vulkan.h>
 
+struct VulkanImageHandle;
+
 class VulkanResourceContext : public ResourceCreationContext
 {
     friend class Renderer;
@@ -14,15 +16,16 @@ public:
     CommandBufferAllocator * CreateCommandBufferAllocator() final override;
     void DestroyCommandBufferAllocator(CommandBufferAllocator *) final override;
 
-    void BufferSubData(BufferHandle *, uint8_t *, size_t offset, size_t size) final override;
+    UploadToken BufferSubData(BufferHandle *, uint8_t *, size_t offset, size_t size) final override;
     BufferHandle * CreateBuffer(BufferCreateInfo const &) final override;
     void DestroyBuffer(BufferHandle *) final override;
     uint8_t * MapBuffer(BufferHandle *, size_t, size_t) final override;
     void UnmapBuffer(BufferHandle *) final override;
+    void FlushBuffer(BufferHandle *, size_t, size_t) final override;
     ImageHandle * CreateImage(ImageCreateInfo const &) final override;
     void DestroyImage(ImageHandle *) final override;
     void AllocateImage(ImageHandle *) final override;
-    void ImageData(ImageHandle *, std::vector<uint8_t> const &) final override;
+    UploadToken ImageData(ImageHandle *, std::vector<uint8_t> const &) final override;
 
     RenderPassHandle * CreateRenderPass(ResourceCreationContext::RenderPassCreateInfo const &) final override;
     void DestroyRenderPass(RenderPassHandle *) final override;
@@ -36,6 +39,9 @@ public:
     PipelineLayoutHandle * CreatePipelineLayout(PipelineLayoutCreateInfo const &) final override;
     void DestroyPipelineLayout(PipelineLayoutHandle *) final override;
 
+    QueryPoolHandle * CreateTimestampQueryPool(uint32_t queryCount) final override;
+    void DestroyQueryPool(QueryPoolHandle *) final override;
+
     PipelineHandle * CreateGraphicsPipeline(ResourceCreationContext::GraphicsPipelineCreateInfo const &) final override;
     void DestroyPipeline(PipelineHandle *) final override;
     ShaderModuleHandle * CreateShaderModule(ResourceCreationContext::ShaderModuleCreateInfo const &) final override;
@@ -63,6 +69,8 @@ public:
 private:
     VulkanResourceContext(Renderer * renderer) : renderer(renderer) {}
 
+    VkResult AllocateImageMemory(VulkanImageHandle * img, VkMemoryRequirements const & requirements);
+
     Renderer * renderer;
 };
 
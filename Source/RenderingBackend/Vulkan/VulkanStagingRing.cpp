@@ -0,0 +1,395 @@
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
+#include "VulkanStagingRing.h"
+
+#include <cassert>
+#include <thread>
+
+#include <ThirdParty/optick/src/optick.h>
+
+#include "Logging/Logger.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanRenderer.h"
+
+static const auto logger = Logger::Create("VulkanStagingRing");
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+VulkanStagingRing::VulkanStagingRing(Renderer * renderer, VkDeviceSize size)
+    : renderer(renderer), device(renderer->basics.device), size(size)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    auto res = vkCreateBuffer(device, &bufferInfo, nullptr, &buffer);
+    assert(res == VK_SUCCESS);
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    auto memoryType = renderer->FindMemoryType(
+        requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (!renderer->memoryAllocator->Allocate(
+            requirements, memoryType, VulkanResourceKind::LINEAR, nullptr, &allocation)) {
+        logger.Severe("Failed to allocate staging ring with size={}", size);
+        assert(false);
+        exit(1);
+    }
+    assert(allocation.mapped != nullptr);
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = GetTransferFamily();
+    vkCreateCommandPool(device, &poolInfo, nullptr, &transferPool);
+    poolInfo.queueFamilyIndex = GetGraphicsFamily();
+    vkCreateCommandPool(device, &poolInfo, nullptr, &graphicsPool);
+
+    logger.Info("Created staging ring with size={}, ownership transfers are {}",
+                size,
+                NeedsOwnershipTransfer() ? "required" : "not required");
+}
+
+VulkanStagingRing::~VulkanStagingRing()
+{
+    Wait(nextToken - 1);
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto & release : semaphoreReleases) {
+        vkWaitForFences(device, 1, &release.fence, VK_TRUE, UINT64_MAX);
+    }
+    Retire();
+    for (auto fence : freeFences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+    for (auto semaphore : freeSemaphores) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+    for (auto semaphore : pendingWaits) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+    // Destroying the pools also frees their command buffers
+    vkDestroyCommandPool(device, transferPool, nullptr);
+    vkDestroyCommandPool(device, graphicsPool, nullptr);
+    vkDestroyBuffer(device, buffer, nullptr);
+    renderer->memoryAllocator->Free(allocation);
+}
+
+VulkanStagingRing::Region VulkanStagingRing::Reserve(VkDeviceSize regionSize, VkDeviceSize alignment)
+{
+    OPTICK_EVENT();
+    // Anything larger than half the ring would have to wait for most of the ring to drain, so it gets its own buffer
+    if (regionSize > size / 2) {
+        return ReserveOwnedBuffer(regionSize);
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        Retire();
+        if (uploads.empty()) {
+            head = 0;
+            tail = 0;
+        }
+
+        // The used part of the ring is [tail, head), wrapping around the end when head < tail. head must never catch
+        // up with tail since head == tail means that the ring is empty.
+        auto start = AlignUp(head, alignment);
+        bool fits = false;
+        if (head >= tail) {
+            if (start + regionSize <= size) {
+                fits = true;
+            } else if (regionSize < tail) {
+                start = 0;
+                fits = true;
+            }
+        } else {
+            fits = start + regionSize < tail;
+        }
+
+        if (fits) {
+            head = start + regionSize;
+            Upload upload;
+            upload.token = nextToken++;
+            upload.end = head;
+            uploads.push_back(upload);
+            return {buffer, start, allocation.mapped + start, upload.token};
+        }
+
+        // The ring is full. The oldest upload is waited for if it has been submitted, otherwise the thread that
+        // reserved it is still writing its data and needs the lock to submit it.
+        auto const & oldest = uploads.front();
+        if (oldest.isSubmitted) {
+            OPTICK_EVENT("WaitForOldestUpload");
+            vkWaitForFences(device, 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+        } else {
+            guard.unlock();
+            std::this_thread::yield();
+            guard.lock();
+        }
+    }
+}
+
+UploadToken VulkanStagingRing::Submit(Region const & region, RecordFunction const & recordTransfer,
+                                      RecordFunction const & recordAcquire)
+{
+    OPTICK_EVENT();
+    bool const needsOwnershipTransfer = NeedsOwnershipTransfer();
+    VkCommandBuffer transferCommandBuffer;
+    VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+    VkSemaphore ownershipSemaphore = VK_NULL_HANDLE;
+    VkSemaphore done;
+    VkFence fence;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        transferCommandBuffer = GetCommandBuffer(transferPool, freeTransferCommandBuffers);
+        if (needsOwnershipTransfer) {
+            graphicsCommandBuffer = GetCommandBuffer(graphicsPool, freeGraphicsCommandBuffers);
+            ownershipSemaphore = GetSemaphore();
+        }
+        done = GetSemaphore();
+        fence = GetFence();
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    {
+        OPTICK_EVENT("RecordTransferCommands");
+        vkBeginCommandBuffer(transferCommandBuffer, &beginInfo);
+        recordTransfer(transferCommandBuffer);
+        vkEndCommandBuffer(transferCommandBuffer);
+    }
+    if (needsOwnershipTransfer) {
+        OPTICK_EVENT("RecordAcquireCommands");
+        vkBeginCommandBuffer(graphicsCommandBuffer, &beginInfo);
+        recordAcquire(graphicsCommandBuffer);
+        vkEndCommandBuffer(graphicsCommandBuffer);
+    }
+
+    // The queues are locked without holding the ring's lock since RecycleWaits takes them in the opposite order
+    {
+        OPTICK_EVENT("SubmitTransferCommands");
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &transferCommandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = needsOwnershipTransfer ? &ownershipSemaphore : &done;
+        auto queue = renderer->GetTransferQueue();
+        auto res = vkQueueSubmit(queue.queue, 1, &submitInfo, needsOwnershipTransfer ? VK_NULL_HANDLE : fence);
+        assert(res == VK_SUCCESS);
+    }
+    if (needsOwnershipTransfer) {
+        OPTICK_EVENT("SubmitAcquireCommands");
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &ownershipSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &graphicsCommandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &done;
+        auto queue = renderer->GetGraphicsQueue();
+        auto res = vkQueueSubmit(queue.queue, 1, &submitInfo, fence);
+        assert(res == VK_SUCCESS);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    assert(uploads.size() > 0 && region.token >= uploads.front().token);
+    // Tokens are handed out in the same order as uploads are added, so the upload can be found without searching
+    auto & upload = uploads[region.token - uploads.front().token];
+    assert(upload.token == region.token);
+    upload.fence = fence;
+    upload.transferCommandBuffer = transferCommandBuffer;
+    upload.graphicsCommandBuffer = graphicsCommandBuffer;
+    upload.ownershipSemaphore = ownershipSemaphore;
+    upload.isSubmitted = true;
+    pendingWaits.push_back(done);
+    return upload.token;
+}
+
+bool VulkanStagingRing::IsComplete(UploadToken token)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Retire();
+    return uploads.empty() || token < uploads.front().token;
+}
+
+void VulkanStagingRing::Wait(UploadToken token)
+{
+    OPTICK_EVENT();
+    std::unique_lock<std::mutex> guard(lock);
+    Retire();
+    // Uploads are retired in order, so waiting for the oldest one until the token's upload has been retired does not
+    // wait for anything that was started after it
+    while (uploads.size() > 0 && token >= uploads.front().token) {
+        auto const & oldest = uploads.front();
+        if (oldest.isSubmitted) {
+            vkWaitForFences(device, 1, &oldest.fence, VK_TRUE, UINT64_MAX);
+        } else {
+            guard.unlock();
+            std::this_thread::yield();
+            guard.lock();
+        }
+        Retire();
+    }
+}
+
+bool VulkanStagingRing::NeedsOwnershipTransfer() const
+{
+    return GetTransferFamily() != GetGraphicsFamily();
+}
+
+uint32_t VulkanStagingRing::GetGraphicsFamily() const
+{
+    return renderer->graphicsQueueIdx;
+}
+
+uint32_t VulkanStagingRing::GetTransferFamily() const
+{
+    return renderer->transferFamilyIdx;
+}
+
+std::vector<VkSemaphore> VulkanStagingRing::TakePendingWaits()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<VkSemaphore> ret;
+    ret.swap(pendingWaits);
+    return ret;
+}
+
+void VulkanStagingRing::RecycleWaits(VkQueue queue, std::vector<VkSemaphore> && semaphores)
+{
+    if (semaphores.size() == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    // A semaphore can be reused once the submission that waited for it has finished. The submission's own fence may
+    // belong to the caller, so an empty submission with a fence of our own is made right after it.
+    auto fence = GetFence();
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    auto res = vkQueueSubmit(queue, 1, &submitInfo, fence);
+    assert(res == VK_SUCCESS);
+    semaphoreReleases.push_back({fence, std::move(semaphores)});
+}
+
+VkCommandBuffer VulkanStagingRing::GetCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer> & freeList)
+{
+    if (freeList.size() > 0) {
+        auto ret = freeList.back();
+        freeList.pop_back();
+        return ret;
+    }
+    VkCommandBufferAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = pool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+    VkCommandBuffer ret;
+    auto res = vkAllocateCommandBuffers(device, &allocateInfo, &ret);
+    assert(res == VK_SUCCESS);
+    return ret;
+}
+
+VkFence VulkanStagingRing::GetFence()
+{
+    if (freeFences.size() > 0) {
+        auto ret = freeFences.back();
+        freeFences.pop_back();
+        return ret;
+    }
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence ret;
+    auto res = vkCreateFence(device, &fenceInfo, nullptr, &ret);
+    assert(res == VK_SUCCESS);
+    return ret;
+}
+
+VkSemaphore VulkanStagingRing::GetSemaphore()
+{
+    if (freeSemaphores.size() > 0) {
+        auto ret = freeSemaphores.back();
+        freeSemaphores.pop_back();
+        return ret;
+    }
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    VkSemaphore ret;
+    auto res = vkCreateSemaphore(device, &semaphoreInfo, nullptr, &ret);
+    assert(res == VK_SUCCESS);
+    return ret;
+}
+
+VulkanStagingRing::Region VulkanStagingRing::ReserveOwnedBuffer(VkDeviceSize regionSize)
+{
+    OPTICK_EVENT();
+    Upload upload;
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = regionSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    auto res = vkCreateBuffer(device, &bufferInfo, nullptr, &upload.ownedBuffer);
+    assert(res == VK_SUCCESS);
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, upload.ownedBuffer, &requirements);
+    auto memoryType = renderer->FindMemoryType(
+        requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (!renderer->memoryAllocator->Allocate(
+            requirements, memoryType, VulkanResourceKind::LINEAR, nullptr, &upload.ownedAllocation)) {
+        logger.Error("Failed to allocate staging buffer with size={}", regionSize);
+        assert(false);
+    }
+    vkBindBufferMemory(device, upload.ownedBuffer, upload.ownedAllocation.memory, upload.ownedAllocation.offset);
+    logger.Trace("Upload with size={} does not fit in the staging ring, using a staging buffer of its own", regionSize);
+
+    std::lock_guard<std::mutex> guard(lock);
+    upload.token = nextToken++;
+    // The ring is not used, so retiring this upload must leave the tail where it would have been anyway
+    upload.end = head;
+    uploads.push_back(upload);
+    return {upload.ownedBuffer, 0, upload.ownedAllocation.mapped, upload.token};
+}
+
+void VulkanStagingRing::Retire()
+{
+    while (uploads.size() > 0) {
+        auto & upload = uploads.front();
+        if (!upload.isSubmitted || vkGetFenceStatus(device, upload.fence) != VK_SUCCESS) {
+            break;
+        }
+        vkResetFences(device, 1, &upload.fence);
+        freeFences.push_back(upload.fence);
+        freeTransferCommandBuffers.push_back(upload.transferCommandBuffer);
+        if (upload.graphicsCommandBuffer != VK_NULL_HANDLE) {
+            freeGraphicsCommandBuffers.push_back(upload.graphicsCommandBuffer);
+        }
+        if (upload.ownershipSemaphore != VK_NULL_HANDLE) {
+            freeSemaphores.push_back(upload.ownershipSemaphore);
+        }
+        if (upload.ownedBuffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, upload.ownedBuffer, nullptr);
+            renderer->memoryAllocator->Free(upload.ownedAllocation);
+        }
+        tail = upload.end;
+        uploads.pop_front();
+    }
+
+    while (semaphoreReleases.size() > 0 &&
+           vkGetFenceStatus(device, semaphoreReleases.front().fence) == VK_SUCCESS) {
+        auto & release = semaphoreReleases.front();
+        vkResetFences(device, 1, &release.fence);
+        freeFences.push_back(release.fence);
+        freeSemaphores.insert(freeSemaphores.end(), release.semaphores.begin(), release.semaphores.end());
+        semaphoreReleases.pop_front();
+    }
+}
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+#if !defined(USE_OGL_RENDERER) && !defined(USE_NULL_RENDERER)
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "../Abstract/ResourceCreationContext.h"
+#include "VulkanContextStructs.h"
+
+class Renderer;
+
+/**
+ * Streams uploads to the GPU through a persistently mapped ring buffer. Uploads are copied into the ring on the
+ * calling thread and then copied into their destination on the transfer queue without waiting for the copy to finish.
+ * If the transfer queue belongs to a different queue family than the graphics queue, ownership of the destination is
+ * released on the transfer queue and acquired on a graphics queue.
+ *
+ * Each upload signals a semaphore which the next command buffer executed on the primary graphics queue waits for, so
+ * rendering never sees a resource whose upload is still running. Space in the ring is reclaimed once the fence of the
+ * upload that used it has signalled. Uploads that are larger than the ring get a staging buffer of their own.
+ *
+ * All public methods are thread safe.
+ */
+class VulkanStagingRing
+{
+public:
+    struct Region {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        uint8_t * mapped;
+        UploadToken token;
+    };
+    using RecordFunction = std::function<void(VkCommandBuffer)>;
+
+    VulkanStagingRing(Renderer * renderer, VkDeviceSize size);
+    ~VulkanStagingRing();
+
+    /**
+     * Reserves size bytes of staging memory. The caller must write its data to region.mapped and then call Submit with
+     * the returned region before reserving another region on the same thread.
+     */
+    Region Reserve(VkDeviceSize size, VkDeviceSize alignment);
+    /**
+     * Records recordTransfer into a command buffer on the transfer queue family and submits it. If the destination has
+     * to change queue family, recordTransfer must end by releasing it and recordAcquire must acquire it. recordAcquire
+     * is only called when NeedsOwnershipTransfer returns true.
+     */
+    UploadToken Submit(Region const & region, RecordFunction const & recordTransfer,
+                       RecordFunction const & recordAcquire);
+
+    bool IsComplete(UploadToken token);
+    void Wait(UploadToken token);
+
+    bool NeedsOwnershipTransfer() const;
+    uint32_t GetGraphicsFamily() const;
+    uint32_t GetTransferFamily() const;
+
+    /**
+     * Returns the semaphores signalled by uploads that no command buffer has waited for yet. The caller must wait for
+     * them in its next submission to the primary graphics queue and then call RecycleWaits with the queue still locked.
+     */
+    std::vector<VkSemaphore> TakePendingWaits();
+    void RecycleWaits(VkQueue queue, std::vector<VkSemaphore> && semaphores);
+
+private:
+    struct Upload {
+        UploadToken token;
+        // Where the ring's tail moves to once the upload has finished
+        VkDeviceSize end;
+        bool isSubmitted = false;
+        VkFence fence = VK_NULL_HANDLE;
+        VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore ownershipSemaphore = VK_NULL_HANDLE;
+        // Only set for uploads that did not fit in the ring
+        VkBuffer ownedBuffer = VK_NULL_HANDLE;
+        VulkanAllocation ownedAllocation;
+    };
+    struct SemaphoreRelease {
+        VkFence fence;
+        std::vector<VkSemaphore> semaphores;
+    };
+
+    VkCommandBuffer GetCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer> & freeList);
+    VkFence GetFence();
+    VkSemaphore GetSemaphore();
+    Region ReserveOwnedBuffer(VkDeviceSize size);
+    void Retire();
+
+    Renderer * renderer;
+    VkDevice device;
+    VkDeviceSize size;
+    VkBuffer buffer;
+    VulkanAllocation allocation;
+
+    std::mutex lock;
+    VkDeviceSize head = 0;
+    VkDeviceSize tail = 0;
+    UploadToken nextToken = UPLOAD_COMPLETE + 1;
+    std::deque<Upload> uploads;
+    std::deque<SemaphoreRelease> semaphoreReleases;
+    std::vector<VkSemaphore> pendingWaits;
+
+    VkCommandPool transferPool;
+    VkCommandPool graphicsPool;
+    std::vector<VkCommandBuffer> freeTransferCommandBuffers;
+    std::vector<VkCommandBuffer> freeGraphicsCommandBuffers;
+    std::vector<VkFence> freeFences;
+    std::vector<VkSemaphore> freeSemaphores;
+};
+#endif
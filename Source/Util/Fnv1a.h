@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+inline constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+inline constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+/**
+ * 64 bit FNV-1a hash of size bytes at data. Pass the result of a previous call as hash to hash several pieces of data
+ * as if they were one.
+ */
+inline uint64_t Fnv1a(void const * data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    auto bytes = (uint8_t const *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <ThirdParty/optick/src/optick.h>
+
+template <typename T>
+class Future;
+template <typename T>
+class Promise;
+
+namespace FutureDetail
+{
+// Future<void> stores a monostate so the shared state and continuations don't need a specialization of their own
+template <typename T>
+using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+template <typename T>
+struct State {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::optional<Value<T>> value;
+    std::vector<std::function<void(Value<T> const &)>> continuations;
+};
+
+template <typename T, typename Fun>
+decltype(auto) Invoke(Fun & fun, Value<T> const & value)
+{
+    if constexpr (std::is_void_v<T>) {
+        return fun();
+    } else {
+        return fun(value);
+    }
+}
+}
+
+/**
+ * The writing end of a Future. Copies of a Promise refer to the same shared state, so a Promise can be captured by value
+ * in a std::function.
+ */
+template <typename T>
+class Promise
+{
+public:
+    Promise() : state(std::make_shared<FutureDetail::State<T>>()) {}
+
+    Future<T> GetFuture() const { return Future<T>(state); }
+
+    /**
+     * Completes the future with a value constructed from args and runs its continuations on the calling thread. Must
+     * only be called once.
+     */
+    template <typename... Args>
+    void Set(Args &&... args)
+    {
+        std::vector<std::function<void(FutureDetail::Value<T> const &)>> continuations;
+        {
+            std::lock_guard<std::mutex> guard(state->lock);
+            assert(!state->value.has_value());
+            state->value.emplace(std::forward<Args>(args)...);
+            continuations.swap(state->continuations);
+        }
+        state->ready.notify_all();
+        // The value is never modified after being set so it can be read without holding the lock
+        for (auto & continuation : continuations) {
+            continuation(*state->value);
+        }
+    }
+
+private:
+    std::shared_ptr<FutureDetail::State<T>> state;
+};
+
+/**
+ * A value that becomes available at some point in the future, usually when another thread has finished producing it.
+ * Unlike std::future it can be waited on and read any number of times and from any number of threads, and work can be
+ * chained onto it with Then instead of blocking.
+ */
+template <typename T>
+class Future
+{
+public:
+    friend class Promise<T>;
+
+    Future() = default;
+
+    bool IsValid() const { return state != nullptr; }
+
+    bool IsReady() const
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        return state->value.has_value();
+    }
+
+    void Wait() const
+    {
+        OPTICK_EVENT();
+        std::unique_lock<std::mutex> guard(state->lock);
+        state->ready.wait(guard, [this]() { return state->value.has_value(); });
+    }
+
+    /**
+     * Blocks until the future is ready and returns its value.
+     */
+    decltype(auto) Get() const
+    {
+        Wait();
+        if constexpr (!std::is_void_v<T>) {
+            return static_cast<T const &>(*state->value);
+        }
+    }
+
+    /**
+     * Calls fun with the value once the future is ready and returns a future for fun's return value. fun runs on the
+     * thread that completes this future, or immediately on the calling thread if the future is already ready, so it
+     * should not do anything expensive.
+     */
+    template <typename Fun>
+    auto Then(Fun && fun) const
+    {
+        using Result = decltype(FutureDetail::Invoke<T>(fun, std::declval<FutureDetail::Value<T> const &>()));
+        Promise<Result> promise;
+        auto ret = promise.GetFuture();
+        std::function<void(FutureDetail::Value<T> const &)> continuation =
+            [promise, fun = std::forward<Fun>(fun)](FutureDetail::Value<T> const & value) mutable {
+                if constexpr (std::is_void_v<Result>) {
+                    FutureDetail::Invoke<T>(fun, value);
+                    promise.Set();
+                } else {
+                    promise.Set(FutureDetail::Invoke<T>(fun, value));
+                }
+            };
+        std::unique_lock<std::mutex> guard(state->lock);
+        if (!state->value.has_value()) {
+            state->continuations.push_back(std::move(continuation));
+            return ret;
+        }
+        guard.unlock();
+        continuation(*state->value);
+        return ret;
+    }
+
+private:
+    Future(std::shared_ptr<FutureDetail::State<T>> state) : state(std::move(state)) {}
+
+    std::shared_ptr<FutureDetail::State<T>> state;
+};
+
+/**
+ * Blocks until every future in futures is ready.
+ */
+template <typename T>
+void WaitAll(std::vector<Future<T>> const & futures)
+{
+    OPTICK_EVENT();
+    for (auto const & future : futures) {
+        future.Wait();
+    }
+}
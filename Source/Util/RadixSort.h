@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ThirdParty/optick/src/optick.h>
+
+#include "Jobs/JobEngine.h"
+#include "Util/Semaphore.h"
+
+/**
+ * Maps a float to an unsigned key that sorts in the same order as the float, so floats can be used as RadixSort keys.
+ * Positive floats get their sign bit set and negative floats have all their bits flipped.
+ */
+inline uint32_t FloatToRadixKey(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+}
+
+// Below this many values the sort runs on the calling thread since scheduling the jobs costs more than it saves
+size_t constexpr RADIX_SORT_MIN_PARALLEL_SIZE = 16384;
+
+/**
+ * Stable LSD radix sort of values by an unsigned integer key, 8 bits per pass. Passes where every value has the same
+ * digit are skipped so keys that only use some of their bits are cheap to sort.
+ * scratch is used as the temporary buffer. Keeping it around between calls avoids reallocating it.
+ * If jobEngine is not null and there are enough values, the histograms and scatters are split across the job threads.
+ * The calling thread blocks until the sort is done.
+ */
+template <typename T, typename GetKey>
+void RadixSort(std::vector<T> & values, std::vector<T> & scratch, GetKey getKey, JobEngine * jobEngine = nullptr)
+{
+    OPTICK_EVENT();
+    using Key = decltype(getKey(std::declval<T const &>()));
+    static_assert(std::is_unsigned_v<Key>, "RadixSort requires an unsigned key");
+
+    size_t const numValues = values.size();
+    if (numValues < 2) {
+        return;
+    }
+    scratch.resize(numValues);
+
+    size_t numChunks = 1;
+    if (jobEngine != nullptr && numValues >= RADIX_SORT_MIN_PARALLEL_SIZE) {
+        numChunks = jobEngine->GetNumThreads();
+    }
+    size_t const chunkSize = (numValues + numChunks - 1) / numChunks;
+
+    auto forEachChunk = [&](auto const & fn) {
+        if (numChunks == 1) {
+            fn(0);
+            return;
+        }
+        std::vector<JobId> chunkJobs;
+        for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+            auto chunkJob = jobEngine->CreateJob({}, [&fn, chunk]() {
+                OPTICK_EVENT("RadixSortChunk");
+                fn(chunk);
+            });
+            jobEngine->ScheduleJob(chunkJob, JobPriority::HIGH);
+            chunkJobs.push_back(chunkJob);
+        }
+        Semaphore done;
+        auto gatherJob = jobEngine->CreateJob(chunkJobs, [&done]() { done.Signal(); });
+        jobEngine->ScheduleJob(gatherJob, JobPriority::HIGH);
+        done.Wait();
+    };
+
+    std::vector<std::array<size_t, 256>> histograms(numChunks);
+    T * src = values.data();
+    T * dst = scratch.data();
+    for (size_t pass = 0; pass < sizeof(Key); ++pass) {
+        size_t const shift = pass * 8;
+
+        forEachChunk([&](size_t chunk) {
+            auto & histogram = histograms[chunk];
+            histogram.fill(0);
+            size_t end = std::min(numValues, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; ++i) {
+                histogram[(getKey(src[i]) >> shift) & 0xFF]++;
+            }
+        });
+
+        // Turn the histograms into the position where each chunk starts writing each digit
+        bool allSameDigit = false;
+        size_t total = 0;
+        for (size_t digit = 0; digit < 256; ++digit) {
+            size_t digitCount = 0;
+            for (auto & histogram : histograms) {
+                size_t count = histogram[digit];
+                histogram[digit] = total + digitCount;
+                digitCount += count;
+            }
+            if (digitCount == numValues) {
+                allSameDigit = true;
+                break;
+            }
+            total += digitCount;
+        }
+        if (allSameDigit) {
+            continue;
+        }
+
+        forEachChunk([&](size_t chunk) {
+            auto & offsets = histograms[chunk];
+            size_t end = std::min(numValues, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; ++i) {
+                dst[offsets[(getKey(src[i]) >> shift) & 0xFF]++] = std::move(src[i]);
+            }
+        });
+        std::swap(src, dst);
+    }
+
+    if (src != values.data()) {
+        values.swap(scratch);
+    }
+}
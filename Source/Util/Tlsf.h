@@ -0,0 +1,261 @@
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/**
+ * The size class math and free list bookkeeping of a two level segregated fit (TLSF) allocator, shared by the
+ * allocators that split up large buffers or blocks of memory. Offset is the type of the offsets and sizes of the
+ * ranges being allocated.
+ */
+namespace Tlsf
+{
+// Each first level of the TLSF covers a power of two range of sizes which is split linearly into SL_COUNT second
+// levels. Sizes below SMALL_SIZE all share first level 0.
+inline constexpr uint32_t SL_BITS = 4;
+inline constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+inline constexpr uint32_t FL_SHIFT = 8;
+inline constexpr uint64_t SMALL_SIZE = 1ull << FL_SHIFT;
+inline constexpr uint32_t FL_COUNT = 40;
+inline constexpr uint32_t NO_NODE = UINT32_MAX;
+
+template <typename Offset>
+Offset AlignUp(Offset value, std::type_identity_t<Offset> alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename Offset>
+uint32_t MostSignificantBit(Offset value)
+{
+    return 63 - std::countl_zero((uint64_t)value);
+}
+
+template <typename Offset>
+void MapSize(Offset size, uint32_t * fl, uint32_t * sl)
+{
+    if (size < SMALL_SIZE) {
+        *fl = 0;
+        *sl = (uint32_t)(size / (SMALL_SIZE / SL_COUNT));
+        return;
+    }
+    auto msb = MostSignificantBit(size);
+    *fl = msb - FL_SHIFT + 1;
+    *sl = (uint32_t)(size >> (msb - SL_BITS)) ^ SL_COUNT;
+}
+
+// Rounds size up to the next size class, every free range in the class MapSize returns for the result is then large
+// enough to hold size
+template <typename Offset>
+Offset RoundUpToSizeClass(Offset size)
+{
+    if (size < SMALL_SIZE) {
+        return size + SMALL_SIZE / SL_COUNT - 1;
+    }
+    return size + (Offset(1) << (MostSignificantBit(size) - SL_BITS)) - 1;
+}
+
+/**
+ * Ranges and their free lists. Each range is a node which links to its physical neighbours and, while it is free, to
+ * the other free ranges of the same size class. Nodes are never removed from nodes so their indices can be handed out
+ * as handles, the nodes of merged ranges are reused for new ranges instead. NodeData is stored in every node for the
+ * allocator's own bookkeeping and is copied into the nodes split off from a range.
+ */
+template <typename Offset, typename NodeData>
+class FreeLists
+{
+public:
+    struct Node {
+        Offset offset;
+        // 0 if the node is not part of a range, either because it was merged into a neighbour or never used
+        Offset size;
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        uint32_t prevFree;
+        uint32_t nextFree;
+        bool isFree;
+        NodeData data;
+    };
+
+    FreeLists()
+    {
+        for (uint32_t fl = 0; fl < FL_COUNT; ++fl) {
+            for (uint32_t sl = 0; sl < SL_COUNT; ++sl) {
+                freeHeads[fl][sl] = NO_NODE;
+            }
+        }
+    }
+
+    /**
+     * Adds a free range without physical neighbours and returns its node.
+     */
+    uint32_t AddRange(Offset offset, Offset size, NodeData const & data)
+    {
+        auto node = NewNode(offset, size, data);
+        InsertFree(node);
+        return node;
+    }
+
+    /**
+     * Returns a free node that is at least size large, or NO_NODE if there is none.
+     */
+    uint32_t FindFree(Offset size) const
+    {
+        uint32_t fl, sl;
+        MapSize(RoundUpToSizeClass(size), &fl, &sl);
+        if (fl >= FL_COUNT) {
+            return NO_NODE;
+        }
+        uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+        if (slMap == 0) {
+            if (fl + 1 >= FL_COUNT) {
+                return NO_NODE;
+            }
+            uint64_t flMap = flBitmap & (~0ull << (fl + 1));
+            if (flMap == 0) {
+                return NO_NODE;
+            }
+            fl = std::countr_zero(flMap);
+            slMap = slBitmaps[fl];
+        }
+        sl = std::countr_zero(slMap);
+        return freeHeads[fl][sl];
+    }
+
+    /**
+     * Allocates the first aligned allocSize of the free node and puts the rest of it back in the free lists. The node
+     * keeps its index and covers exactly the allocated range afterwards.
+     */
+    void AllocateFrom(uint32_t node, Offset allocSize, Offset alignment)
+    {
+        assert(nodes[node].isFree);
+        RemoveFree(node);
+        auto padding = AlignUp(nodes[node].offset, alignment) - nodes[node].offset;
+        if (padding > 0) {
+            auto front = NewNode(nodes[node].offset, padding, nodes[node].data);
+            auto prev = nodes[node].prevPhysical;
+            nodes[front].prevPhysical = prev;
+            nodes[front].nextPhysical = node;
+            if (prev != NO_NODE) {
+                nodes[prev].nextPhysical = front;
+            }
+            nodes[node].prevPhysical = front;
+            nodes[node].offset += padding;
+            nodes[node].size -= padding;
+            InsertFree(front);
+        }
+        assert(nodes[node].size >= allocSize);
+        if (nodes[node].size > allocSize) {
+            auto back = NewNode(nodes[node].offset + allocSize, nodes[node].size - allocSize, nodes[node].data);
+            auto next = nodes[node].nextPhysical;
+            nodes[back].prevPhysical = node;
+            nodes[back].nextPhysical = next;
+            if (next != NO_NODE) {
+                nodes[next].prevPhysical = back;
+            }
+            nodes[node].nextPhysical = back;
+            nodes[node].size = allocSize;
+            InsertFree(back);
+        }
+    }
+
+    /**
+     * Puts an allocated node back in the free lists, merged with its free physical neighbours.
+     */
+    void Free(uint32_t node)
+    {
+        assert(node < nodes.size() && nodes[node].size > 0 && !nodes[node].isFree);
+        auto prev = nodes[node].prevPhysical;
+        if (prev != NO_NODE && nodes[prev].isFree) {
+            RemoveFree(prev);
+            Absorb(prev, node);
+            node = prev;
+        }
+        auto next = nodes[node].nextPhysical;
+        if (next != NO_NODE && nodes[next].isFree) {
+            RemoveFree(next);
+            Absorb(node, next);
+        }
+        InsertFree(node);
+    }
+
+    std::vector<Node> nodes;
+
+private:
+    void InsertFree(uint32_t node)
+    {
+        uint32_t fl, sl;
+        MapSize(nodes[node].size, &fl, &sl);
+        assert(fl < FL_COUNT);
+        auto head = freeHeads[fl][sl];
+        nodes[node].isFree = true;
+        nodes[node].prevFree = NO_NODE;
+        nodes[node].nextFree = head;
+        if (head != NO_NODE) {
+            nodes[head].prevFree = node;
+        }
+        freeHeads[fl][sl] = node;
+        flBitmap |= 1ull << fl;
+        slBitmaps[fl] |= 1u << sl;
+    }
+
+    void RemoveFree(uint32_t node)
+    {
+        uint32_t fl, sl;
+        MapSize(nodes[node].size, &fl, &sl);
+        auto prev = nodes[node].prevFree;
+        auto next = nodes[node].nextFree;
+        if (prev != NO_NODE) {
+            nodes[prev].nextFree = next;
+        }
+        if (next != NO_NODE) {
+            nodes[next].prevFree = prev;
+        }
+        if (freeHeads[fl][sl] == node) {
+            freeHeads[fl][sl] = next;
+            if (next == NO_NODE) {
+                slBitmaps[fl] &= ~(1u << sl);
+                if (slBitmaps[fl] == 0) {
+                    flBitmap &= ~(1ull << fl);
+                }
+            }
+        }
+        nodes[node].isFree = false;
+    }
+
+    // Merges next into its physical predecessor node, neither may be in a free list
+    void Absorb(uint32_t node, uint32_t next)
+    {
+        auto after = nodes[next].nextPhysical;
+        nodes[node].size += nodes[next].size;
+        nodes[node].nextPhysical = after;
+        if (after != NO_NODE) {
+            nodes[after].prevPhysical = node;
+        }
+        nodes[next].size = 0;
+        unusedNodes.push_back(next);
+    }
+
+    uint32_t NewNode(Offset offset, Offset size, NodeData const & data)
+    {
+        uint32_t ret;
+        if (unusedNodes.size() > 0) {
+            ret = unusedNodes.back();
+            unusedNodes.pop_back();
+        } else {
+            ret = (uint32_t)nodes.size();
+            nodes.emplace_back();
+        }
+        nodes[ret] = {offset, size, NO_NODE, NO_NODE, NO_NODE, NO_NODE, false, data};
+        return ret;
+    }
+
+    std::vector<uint32_t> unusedNodes;
+    uint64_t flBitmap = 0;
+    uint32_t slBitmaps[FL_COUNT] = {};
+    uint32_t freeHeads[FL_COUNT][SL_COUNT];
+};
+}
@@ -1,20 +1,50 @@
-
-const uint MAX_LIGHTS = 512;
+// Must match LightInstance.h
+const uint LIGHT_CLUSTERS_X = 16;
+const uint LIGHT_CLUSTERS_Y = 9;
+const uint LIGHT_CLUSTERS_Z = 24;
+const uint LIGHT_CLUSTER_COUNT = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z;
 const float PI = 3.14159265359;
 
 struct Light {
-    uint isActive;
-    mat4 localToWorld;
-
-    vec3 color;
+    // xyz: world position, w: radius
+    vec4 positionAndRadius;
+    vec4 color;
 };
 
 // TODO: This is probably not a great idea. This is needed for CalculateLight to compile, and I want CalculateLight to be in this file.
 // If I add lights as a parameter to CalculateLight, it appears the array will be copied into the function on each call which completely wrecks the frame rate.
-layout (std140, set = 0, binding = 0) uniform lightsData {
-	Light lights[MAX_LIGHTS];
+layout (std430, set = 0, binding = 0) readonly buffer lightsData {
+	Light lights[];
 };
 
+layout (std430, set = 0, binding = 1) readonly buffer lightClusterData {
+	mat4 clusterView;
+	mat4 clusterProjection;
+	// x: near depth, y: far depth, z: slices per unit of log depth (or depth if w is 0), w: 1 if perspective
+	vec4 clusterDepthParams;
+	// x: offset into clusterLightIndexes, y: number of lights in the cluster
+	uvec2 clusterLightRanges[LIGHT_CLUSTER_COUNT];
+	uint clusterLightIndexes[];
+};
+
+uint GetLightCluster(vec3 WorldPos)
+{
+    vec4 viewPos = clusterView * vec4(WorldPos, 1.0);
+    vec4 clipPos = clusterProjection * viewPos;
+    vec2 screenPos = clamp(clipPos.xy / clipPos.w * 0.5 + 0.5, 0.0, 0.9999);
+    float depth = -viewPos.z;
+    float slice;
+    if (clusterDepthParams.w > 0.0) {
+        slice = log(max(depth, clusterDepthParams.x) / clusterDepthParams.x) * clusterDepthParams.z;
+    } else {
+        slice = (depth - clusterDepthParams.x) * clusterDepthParams.z;
+    }
+    uint x = uint(screenPos.x * LIGHT_CLUSTERS_X);
+    uint y = uint(screenPos.y * LIGHT_CLUSTERS_Y);
+    uint z = uint(clamp(slice, 0.0, float(LIGHT_CLUSTERS_Z - 1)));
+    return x + y * LIGHT_CLUSTERS_X + z * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y;
+}
+
 vec3 FresnelSchlick(float cosTheta, vec3 F0)
 {
     return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
@@ -59,16 +89,18 @@ vec3 CalculateLight(vec3 WorldPos, vec3 N, vec3 V, vec3 albedo, float metallic,
 {
     vec3 Lo = vec3(0.0);
 
-    for (int i = 0; i < MAX_LIGHTS; ++i) {
-        if (lights[i].isActive == 0) {
+    uvec2 clusterRange = clusterLightRanges[GetLightCluster(WorldPos)];
+    for (uint c = 0; c < clusterRange.y; ++c) {
+        Light light = lights[clusterLightIndexes[clusterRange.x + c]];
+        vec3 lightPos = light.positionAndRadius.xyz;
+        float dist = length(lightPos - WorldPos);
+        if (dist > light.positionAndRadius.w) {
             continue;
         }
-        vec3 lightPos = lights[i].localToWorld[3].xyz;
         vec3 L = normalize(lightPos - WorldPos);
         vec3 H = normalize(V + L);
-        float dist = length(lightPos - WorldPos);
         float attenuation = 1.0 / (dist * dist + 1);
-        vec3 radiance = lights[i].color * attenuation;
+        vec3 radiance = light.color.rgb * attenuation;
 
         float NDF = DistributionGGX(N, H, roughness);
         vec3 F = FresnelSchlick(max(dot(H, V), 0.0), F0);
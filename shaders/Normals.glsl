@@ -17,3 +17,13 @@ vec2 encode(vec3 n)
     float f = sqrt(8 * n.z + 8);
     return n.xy / f + 0.5;
 }
+
+// Decodes a normal stored by OctahedralEncode in Vertex.cpp
+vec3 OctahedralDecode(vec2 enc)
+{
+    vec3 n = vec3(enc, 1 - abs(enc.x) - abs(enc.y));
+    if (n.z < 0) {
+        n.xy = (1 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+    }
+    return normalize(n);
+}
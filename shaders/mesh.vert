@@ -1,11 +1,13 @@
 #version 460
 #extension GL_GOOGLE_include_directive : require
 
+#include "Normals.glsl"
 #include "Specialization.glsl"
 
 layout (location = 0) in vec3 pos;
-layout (location = 1) in vec3 color;
-layout (location = 2) in vec3 normal;
+layout (location = 1) in vec4 color;
+// Octahedral encoded, see Normals.glsl
+layout (location = 2) in vec2 normal;
 layout (location = 3) in vec2 texcoord;
 
 layout (std140, set = 1, binding = 0) uniform camera {
@@ -23,10 +25,12 @@ layout (location = 3) out vec3 WorldPos;
 layout (location = 4) out mat4 WorldTransform;
 
 void main() {
-	mat4 pvm = p * v * m[gl_BaseInstance];
+	// gl_InstanceIndex includes the base instance on Vulkan but not on OpenGL
+	int instance = gfxApi == GFX_API_VULKAN ? gl_InstanceIndex : gl_BaseInstance + gl_InstanceIndex;
+	mat4 pvm = p * v * m[instance];
 	gl_Position = pvm * vec4(pos, 1.0);
-	Color = color;
-	Normal = normalize(mat3(m[gl_BaseInstance]) * normal);
+	Color = color.rgb;
+	Normal = normalize(mat3(m[instance]) * OctahedralDecode(normal));
 	Texcoord = texcoord;
 
 	//TODO: In the future this should be changed to be the other way around so OpenGL is the one getting penalized
@@ -34,7 +38,7 @@ void main() {
 		gl_Position.y = -gl_Position.y;
 	}
 	
-	WorldPos = (m[gl_BaseInstance] * vec4(pos, 1.0)).xyz;
-	WorldTransform = m[gl_BaseInstance];
+	WorldPos = (m[instance] * vec4(pos, 1.0)).xyz;
+	WorldTransform = m[instance];
 }
 
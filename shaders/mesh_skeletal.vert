@@ -1,17 +1,15 @@
 #version 460
 #extension GL_GOOGLE_include_directive : require
 
+#include "Normals.glsl"
 #include "Specialization.glsl"
 
-#ifndef UINT32_MAX
-#define UINT32_MAX 0xffffffff
-#endif
-
 #define MAX_VERTEX_BONES 4
 
 layout (location = 0) in vec3 pos;
-layout (location = 1) in vec3 color;
-layout (location = 2) in vec3 normal;
+layout (location = 1) in vec4 color;
+// Octahedral encoded, see Normals.glsl
+layout (location = 2) in vec2 normal;
 layout (location = 3) in vec2 texcoord;
 layout (location = 4) in uvec4 boneIds;
 layout (location = 5) in vec4 weights;
@@ -35,17 +33,15 @@ layout (location = 4) out mat4 WorldTransform;
 
 void main() {
     mat4 accumulatedTransform = mat4(0.0);
+    // Unused bones have a weight of 0 so they don't need to be skipped
     for (int i = 0; i < MAX_VERTEX_BONES; ++i) {
-        if (boneIds[i] == UINT32_MAX) {
-            break;
-        }
         accumulatedTransform += weights[i] * transformations[boneIds[i]];
     }
 
 	mat4 pvm = p * v * m[gl_BaseInstance];
 	gl_Position = pvm * (accumulatedTransform * vec4(pos, 1.0));
-	Color = color;
-	Normal = normalize(mat3(m[gl_BaseInstance] * accumulatedTransform) * normal);
+	Color = color.rgb;
+	Normal = normalize(mat3(m[gl_BaseInstance] * accumulatedTransform) * OctahedralDecode(normal));
 	Texcoord = texcoord;
 
 	//TODO: In the future this should be changed to be the other way around so OpenGL is the one getting penalized
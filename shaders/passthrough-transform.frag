@@ -9,7 +9,7 @@ layout (location = 1) in vec2 Texcoord;
 layout (location = 0) out vec4 outColor;
 layout (location = 1) out vec2 outNormals;
 
-layout (set = 1, binding = 1) uniform sampler2D tex;
+layout (set = 1, binding = 0) uniform sampler2D tex;
 
 void main() {
 	vec4 col = texture(tex, Texcoord) * vec4(Color, 1.0);
@@ -6,14 +6,14 @@
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec3 color;
 layout (location = 2) in vec2 texcoord;
+// Per instance
+layout (location = 3) in mat4 m;
+layout (location = 7) in vec4 uvRect;
 
 layout (std140, set = 0, binding = 0) uniform camera {
 	mat4 p;
 	mat4 v;
 };
-layout (std140, set = 1, binding = 0) uniform model {
-	mat4 m;
-};
 
 layout (location = 0) out vec3 Color;
 layout (location = 1) out vec2 Texcoord;
@@ -22,7 +22,7 @@ void main() {
 	mat4 pvm = p * v * m;
 	gl_Position = pvm * vec4(pos, 1.0);
 	Color = color;
-	Texcoord = texcoord;
+	Texcoord = uvRect.xy + texcoord * uvRect.zw;
 
 	//TODO: In the future this should be changed to be the other way around so OpenGL is the one getting penalized
 	if (gfxApi == GFX_API_VULKAN) {
@@ -4,8 +4,9 @@
 #include "Specialization.glsl"
 
 layout (location = 0) in vec3 pos;
-layout (location = 1) in vec3 color;
-layout (location = 2) in vec3 normal;
+layout (location = 1) in vec4 color;
+// Octahedral encoded, see Normals.glsl
+layout (location = 2) in vec2 normal;
 layout (location = 3) in vec2 texcoord;
 
 layout (std140, set = 0, binding = 0) uniform camera {
@@ -20,9 +21,11 @@ layout (location = 0) out vec3 Color;
 layout (location = 1) out vec2 Texcoord;
 
 void main() {
-	mat4 pvm = p * v * m[gl_BaseInstance];
+	// gl_InstanceIndex includes the base instance on Vulkan but not on OpenGL
+	int instance = gfxApi == GFX_API_VULKAN ? gl_InstanceIndex : gl_BaseInstance + gl_InstanceIndex;
+	mat4 pvm = p * v * m[instance];
 	gl_Position = pvm * vec4(pos, 1.0);
-	Color = color;
+	Color = color.rgb;
 	Texcoord = texcoord;
 
 	//TODO: In the future this should be changed to be the other way around so OpenGL is the one getting penalized